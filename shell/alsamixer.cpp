@@ -0,0 +1,151 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#include "alsamixer.h"
+
+#include <QDebug>
+#include <QVector>
+#include <poll.h>
+#include <alsa/asoundlib.h>
+
+AlsaMixer::AlsaMixer(QString card, QString control, QObject *parent) : QObject(parent)
+{
+    this->control = control;
+
+    if (snd_mixer_open(&mixer, 0) < 0) {
+        mixer = NULL;
+        return;
+    }
+
+    if (snd_mixer_attach(mixer, card.toLocal8Bit().constData()) < 0 || snd_mixer_selem_register(mixer, NULL, NULL) < 0) {
+        qWarning() << "Couldn't open ALSA mixer for" << card;
+        snd_mixer_close(mixer);
+        mixer = NULL;
+        return;
+    }
+
+    //Elements are announced through the mixer callback as they load, including ones that are hotplugged later
+    snd_mixer_set_callback(mixer, &AlsaMixer::mixerEvent);
+    snd_mixer_set_callback_private(mixer, this);
+    snd_mixer_load(mixer);
+
+    //Let the Qt event loop wake us when ALSA has something to say rather than asking it
+    int count = snd_mixer_poll_descriptors_count(mixer);
+    if (count > 0) {
+        QVector<struct pollfd> fds(count);
+        count = snd_mixer_poll_descriptors(mixer, fds.data(), count);
+        for (int i = 0; i < count; i++) {
+            QSocketNotifier* notifier = new QSocketNotifier(fds.at(i).fd, fds.at(i).events & POLLOUT ? QSocketNotifier::Write : QSocketNotifier::Read, this);
+            connect(notifier, SIGNAL(activated(int)), this, SLOT(handleEvents()));
+            notifiers.append(notifier);
+        }
+    }
+}
+
+AlsaMixer::~AlsaMixer() {
+    if (mixer != NULL) snd_mixer_close(mixer);
+}
+
+bool AlsaMixer::isOpen() {
+    return mixer != NULL;
+}
+
+int AlsaMixer::volume() {
+    return currentVolume;
+}
+
+void AlsaMixer::handleEvents() {
+    if (mixer != NULL) snd_mixer_handle_events(mixer);
+}
+
+int AlsaMixer::mixerEvent(snd_mixer_t *mixer, unsigned int mask, snd_mixer_elem_t *elem) {
+    AlsaMixer* alsaMixer = (AlsaMixer*) snd_mixer_get_callback_private(mixer);
+    if (mask & SND_CTL_EVENT_MASK_ADD) {
+        alsaMixer->attach(elem);
+    }
+    return 0;
+}
+
+int AlsaMixer::elementEvent(snd_mixer_elem_t *elem, unsigned int mask) {
+    AlsaMixer* alsaMixer = (AlsaMixer*) snd_mixer_elem_get_callback_private(elem);
+    if (mask == SND_CTL_EVENT_MASK_REMOVE) {
+        alsaMixer->element = NULL;
+        alsaMixer->updateVolume();
+    } else if (mask & SND_CTL_EVENT_MASK_VALUE) {
+        alsaMixer->updateVolume();
+    }
+    return 0;
+}
+
+void AlsaMixer::attach(snd_mixer_elem_t *elem) {
+    if (element != NULL || !snd_mixer_selem_has_playback_volume(elem)) return;
+    if (QString::fromLocal8Bit(snd_mixer_selem_get_name(elem)) != control || snd_mixer_selem_get_index(elem) != 0) return;
+
+    element = elem;
+    snd_mixer_selem_get_playback_volume_range(element, &minimum, &maximum);
+    snd_mixer_elem_set_callback(element, &AlsaMixer::elementEvent);
+    snd_mixer_elem_set_callback_private(element, this);
+    updateVolume();
+}
+
+void AlsaMixer::updateVolume() {
+    int volume = 0;
+    if (element != NULL && maximum > minimum) {
+        int on = 1;
+        if (snd_mixer_selem_has_playback_switch(element)) {
+            snd_mixer_selem_get_playback_switch(element, SND_MIXER_SCHN_FRONT_LEFT, &on);
+        }
+
+        if (on) {
+            long value;
+            snd_mixer_selem_get_playback_volume(element, SND_MIXER_SCHN_FRONT_LEFT, &value);
+            volume = qRound((value - minimum) * 100.0 / (maximum - minimum));
+        }
+    }
+
+    if (volume != currentVolume) {
+        currentVolume = volume;
+        emit volumeChanged(volume);
+    }
+}
+
+void AlsaMixer::setVolume(int volume) {
+    if (element == NULL) return;
+
+    volume = qBound(0, volume, 100);
+    snd_mixer_selem_set_playback_volume_all(element, minimum + qRound((maximum - minimum) * volume / 100.0));
+    if (snd_mixer_selem_has_playback_switch(element)) {
+        snd_mixer_selem_set_playback_switch_all(element, 1);
+    }
+
+    //Report the change straight away rather than waiting for the control event to come back round
+    updateVolume();
+}
+
+void AlsaMixer::changeVolume(int delta) {
+    setVolume(currentVolume + delta);
+}
+
+void AlsaMixer::setMute(bool mute) {
+    if (element == NULL || !snd_mixer_selem_has_playback_switch(element)) return;
+
+    snd_mixer_selem_set_playback_switch_all(element, mute ? 0 : 1);
+    updateVolume();
+}
@@ -0,0 +1,67 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#ifndef ALSAMIXER_H
+#define ALSAMIXER_H
+
+#include <QObject>
+#include <QList>
+#include <QSocketNotifier>
+
+typedef struct _snd_mixer snd_mixer_t;
+typedef struct _snd_mixer_elem snd_mixer_elem_t;
+
+class AlsaMixer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AlsaMixer(QString card = "default", QString control = "Master", QObject *parent = 0);
+    ~AlsaMixer();
+
+    bool isOpen();
+    int volume();
+
+signals:
+    void volumeChanged(int volume);
+
+public slots:
+    void setVolume(int volume);
+    void changeVolume(int delta);
+    void setMute(bool mute);
+
+private slots:
+    void handleEvents();
+
+private:
+    static int mixerEvent(snd_mixer_t *mixer, unsigned int mask, snd_mixer_elem_t *elem);
+    static int elementEvent(snd_mixer_elem_t *elem, unsigned int mask);
+
+    void attach(snd_mixer_elem_t *elem);
+    void updateVolume();
+
+    snd_mixer_t* mixer = NULL;
+    snd_mixer_elem_t* element = NULL;
+    QString control;
+    QList<QSocketNotifier*> notifiers;
+    long minimum = 0, maximum = 0;
+    int currentVolume = 0;
+};
+
+#endif // ALSAMIXER_H
@@ -19,6 +19,7 @@
  * *************************************/
 
 #include "appslistmodel.h"
+#include "../startuptrace.h"
 
 extern float getDPIScaling();
 extern NativeEventFilter* NativeFilter;
@@ -27,6 +28,7 @@ extern QSettings::Format desktopFileFormat;
 extern void EndSession(EndSessionWait::shutdownType type);
 
 AppsListModel::AppsListModel(QObject *parent) : QAbstractListModel(parent) {
+    TRACE_SPAN("AppsListModel");
     //this->bt = bt;
     loadData();
 }
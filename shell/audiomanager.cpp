@@ -19,11 +19,64 @@
  * *************************************/
 
 #include "audiomanager.h"
+#include "startuptrace.h"
+#include "sessionstate.h"
+#include "shellsettings.h"
+
+#include <math.h>
+
+namespace {
+    void releaseOperation(pa_operation* operation) {
+        if (operation != NULL) pa_operation_unref(operation);
+    }
+}
 
 AudioManager::AudioManager(QObject *parent) : QObject(parent)
 {
+    TRACE_SPAN("AudioManager");
+    pa_cvolume_init(&defaultSinkVolume);
     pulseLoopApi = pa_glib_mainloop_get_api(pa_glib_mainloop_new(NULL));
 
+    //Keep trying to get PulseAudio back while we're driving the hardware mixer ourselves
+    pulseReconnectTimer = new QTimer(this);
+    pulseReconnectTimer->setInterval(5000);
+    pulseReconnectTimer->setSingleShot(true);
+    connect(pulseReconnectTimer, &QTimer::timeout, this, &AudioManager::connectPulse);
+
+    connectPulse();
+
+    duckTimer = new QTimer(this);
+    duckTimer->setInterval(30);
+    connect(duckTimer, &QTimer::timeout, this, &AudioManager::duckTick);
+
+    duckReleaseTimer = new QTimer(this);
+    duckReleaseTimer->setSingleShot(true);
+    connect(duckReleaseTimer, &QTimer::timeout, this, &AudioManager::startDuckRamp);
+
+    quietModeWatcher = new QTimer();
+    quietModeWatcher->setInterval(1000);
+    connect(quietModeWatcher, &QTimer::timeout, [=] {
+        if (QDateTime::currentDateTime() > quietModeOff) {
+            setQuietMode(none);
+            setQuietModeResetTime(QDateTime());
+        }
+    });
+
+    //PulseAudio keeps the sink muted across a restart, so only the mode itself needs to come back
+    if (SessionState::instance()->isRestored()) {
+        currentQuietMode = (quietMode) SessionState::instance()->quietMode();
+        setQuietModeResetTime(SessionState::instance()->quietModeResetTime());
+    }
+}
+
+void AudioManager::connectPulse() {
+    if (pulseContext != NULL) {
+        //Don't let tearing down the old connection report back as a failure of the new one
+        pa_context_set_state_callback(pulseContext, NULL, NULL);
+        pa_context_disconnect(pulseContext);
+        pa_context_unref(pulseContext);
+    }
+
     pa_proplist* propList = pa_proplist_new();
     pa_proplist_sets(propList, PA_PROP_APPLICATION_NAME, "theShell");
     pa_proplist_sets(propList, PA_PROP_APPLICATION_ID, "org.thesuite.theshell");
@@ -37,29 +90,27 @@ AudioManager::AudioManager(QObject *parent) : QObject(parent)
 
     if (connected < 0) {
         pulseAvailable = false;
-    } else {
+        startAlsaFallback();
+        pulseReconnectTimer->start();
+    } else if (alsaMixer == NULL) {
         pulseAvailable = true;
-    }
-
-    quietModeWatcher = new QTimer();
-    quietModeWatcher->setInterval(1000);
-    connect(quietModeWatcher, &QTimer::timeout, [=] {
-        if (QDateTime::currentDateTime() > quietModeOff) {
-            setQuietMode(none);
-            quietModeWatcher->stop();
-        }
-    });
+    } //When reconnecting, keep using the hardware mixer until the context is ready
 }
 
 void AudioManager::changeVolume(int volume) {
     if (currentQuietMode != mute) {
+        if (!pulseAvailable) {
+            if (alsaMixer != NULL) alsaMixer->changeVolume(volume);
+            return;
+        }
+
         pa_volume_t avgVol = pa_cvolume_avg(&defaultSinkVolume);
         int onePercent = (PA_VOLUME_NORM - PA_VOLUME_MUTED) / 100;
         pa_volume_t newVol = avgVol + (onePercent * volume);
         if (newVol < PA_VOLUME_MUTED) newVol = PA_VOLUME_MUTED;
         if (newVol > PA_VOLUME_MAX) newVol = PA_VOLUME_MAX;
 
-        if (!settings.value("sound/volumeOverdrive", true).toBool() && newVol > PA_VOLUME_NORM) {
+        if (!ShellSettings::instance()->volumeOverdrive() && newVol > PA_VOLUME_NORM) {
             newVol = PA_VOLUME_NORM;
         }
 
@@ -79,8 +130,8 @@ void AudioManager::changeVolume(int volume) {
         for (int i = 0; i < newCVol.channels; i++) {
             newCVol.values[i] = newVol;
         }
-        pa_context_set_sink_mute_by_index(pulseContext, defaultSinkIndex, false, NULL, NULL);
-        pa_context_set_sink_volume_by_index(pulseContext, defaultSinkIndex, &newCVol, NULL, NULL);
+        setDefaultSinkMute(false);
+        releaseOperation(pa_context_set_sink_volume_by_index(pulseContext, defaultSinkIndex, &newCVol, NULL, NULL));
     }
 }
 
@@ -92,32 +143,9 @@ void AudioManager::setMasterVolume(int volume) {
             for (int i = 0; i < newVol.channels; i++) {
                 newVol.values[i] = setVol;
             }
-            pa_context_set_sink_volume_by_index(pulseContext, defaultSinkIndex, &newVol, NULL, NULL);
-        } else {
-            //Get Current Limits
-            QProcess* mixer = new QProcess();
-            mixer->start("amixer");
-            mixer->waitForFinished();
-            QString output(mixer->readAll());
-
-            bool readLine = false;
-            int limit;
-            for (QString line : output.split("\n")) {
-                if (line.startsWith(" ") && readLine) {
-                    if (line.startsWith("  Limits:")) {
-                        limit = line.split(" ").last().toInt();
-                    }
-                } else {
-                    if (line.contains("'Master'")) {
-                        readLine = true;
-                    } else {
-                        readLine = false;
-                    }
-                }
-            }
-
-            mixer->start("amixer set Master " + QString::number(limit * (volume / (float) 100)) + " on");
-            connect(mixer, SIGNAL(finished(int)), mixer, SLOT(deleteLater()));
+            releaseOperation(pa_context_set_sink_volume_by_index(pulseContext, defaultSinkIndex, &newVol, NULL, NULL));
+        } else if (alsaMixer != NULL) {
+            alsaMixer->setVolume(volume);
         }
     }
 }
@@ -127,33 +155,8 @@ int AudioManager::MasterVolume() {
         pa_volume_t avgVol = pa_cvolume_avg(&defaultSinkVolume);
         int currentVol = ((float) (avgVol - PA_VOLUME_MUTED) / (float) PA_VOLUME_NORM) * 100;
         return currentVol;
-    } else {
-        //Get Current Volume
-        QProcess* mixer = new QProcess(this);
-        mixer->start("amixer");
-        mixer->waitForFinished();
-        QString output(mixer->readAll());
-        delete mixer;
-
-        bool readLine = false;
-        for (QString line : output.split("\n")) {
-            if (line.startsWith(" ") && readLine) {
-                if (line.startsWith("  Front Left:")) {
-                    if (line.contains("[off]")) {
-                        return 0;
-                    } else {
-                        QString percent = line.mid(line.indexOf("\[") + 1, 3).remove("\%").remove("]");
-                        return percent.toInt();
-                    }
-                }
-            } else {
-                if (line.contains("'Master'")) {
-                    readLine = true;
-                } else {
-                    readLine = false;
-                }
-            }
-        }
+    } else if (alsaMixer != NULL) {
+        return alsaMixer->volume();
     }
     return 0;
 }
@@ -162,178 +165,458 @@ void AudioManager::pulseStateChanged(pa_context *c, void *userdata) {
     AudioManager* currentManager = (AudioManager*) userdata;
     switch (pa_context_get_state(c)) {
         case PA_CONTEXT_READY:
+            //PulseAudio is back, so it owns the hardware mixer again
+            currentManager->pulseAvailable = true;
+            currentManager->pulseReconnectTimer->stop();
+            if (currentManager->alsaMixer != NULL) {
+                currentManager->alsaMixer->deleteLater();
+                currentManager->alsaMixer = NULL;
+            }
+
             pa_context_set_subscribe_callback(c, &AudioManager::pulseSubscribe, currentManager);
-            pa_context_subscribe(c, (pa_subscription_mask_t) (PA_SUBSCRIPTION_MASK_SINK | PA_SUBSCRIPTION_MASK_SOURCE | PA_SUBSCRIPTION_MASK_SINK_INPUT | PA_SUBSCRIPTION_MASK_CLIENT), NULL, userdata);
-            pa_context_get_server_info(c, &AudioManager::pulseServerInfo, currentManager);
-            pa_context_get_sink_info_list(c, &AudioManager::pulseGetSinks, currentManager);
-            pa_context_get_source_info_list(c, &AudioManager::pulseGetSources, currentManager);
-            pa_context_get_sink_input_info_list(c, &AudioManager::pulseGetInputSinks, currentManager);
-            pa_context_get_client_info_list(c, &AudioManager::pulseGetClients, currentManager);
+            releaseOperation(pa_context_subscribe(c, (pa_subscription_mask_t) (PA_SUBSCRIPTION_MASK_SINK | PA_SUBSCRIPTION_MASK_SOURCE | PA_SUBSCRIPTION_MASK_SINK_INPUT | PA_SUBSCRIPTION_MASK_CLIENT | PA_SUBSCRIPTION_MASK_SERVER), NULL, userdata));
+            releaseOperation(pa_context_get_server_info(c, &AudioManager::pulseServerInfo, currentManager));
+            releaseOperation(pa_context_get_sink_info_list(c, &AudioManager::pulseGetSinks, currentManager));
+            releaseOperation(pa_context_get_source_info_list(c, &AudioManager::pulseGetSources, currentManager));
+            releaseOperation(pa_context_get_sink_input_info_list(c, &AudioManager::pulseGetInputSinks, currentManager));
+            releaseOperation(pa_context_get_client_info_list(c, &AudioManager::pulseGetClients, currentManager));
+            break;
+        case PA_CONTEXT_FAILED:
+        case PA_CONTEXT_TERMINATED:
+            //Everything we knew belonged to the old connection
+            currentManager->sinkCache.clear();
+            currentManager->sourceCache.clear();
+            currentManager->sinkInputCache.clear();
+            currentManager->clientCache.clear();
+            currentManager->duckStreams.clear();
+            currentManager->duckWritesPending = 0;
+            currentManager->peakStreams.clear();
+            currentManager->defaultSinkIndex = -1;
+
+            //Drive the hardware mixer directly until PulseAudio comes back
+            currentManager->pulseAvailable = false;
+            currentManager->startAlsaFallback();
+            currentManager->pulseReconnectTimer->start();
+            break;
+        default:
+            break;
     }
 }
 
 void AudioManager::pulseSubscribe(pa_context *c, pa_subscription_event_type_t t, uint32_t index, void *userdata) {
     AudioManager* currentManager = (AudioManager*) userdata;
+    bool removed = (t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE;
+
+    //Only the object named by the event has changed, so fetch that one rather than the whole list
     switch (t & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) {
+        case PA_SUBSCRIPTION_EVENT_SERVER:
+            releaseOperation(pa_context_get_server_info(c, &AudioManager::pulseServerInfo, currentManager));
+            break;
         case PA_SUBSCRIPTION_EVENT_SINK:
-            pa_context_get_server_info(c, &AudioManager::pulseServerInfo, currentManager);
-            pa_context_get_sink_info_list(c, &AudioManager::pulseGetSinks, currentManager);
+            if (removed) {
+                currentManager->sinkCache.remove(index);
+                emit currentManager->sinkRemoved(index);
+                if ((int) index == currentManager->defaultSinkIndex) currentManager->updateDefaultSink();
+            } else {
+                releaseOperation(pa_context_get_sink_info_by_index(c, index, &AudioManager::pulseGetSinks, currentManager));
+            }
             break;
         case PA_SUBSCRIPTION_EVENT_SINK_INPUT:
-            pa_context_get_sink_input_info_list(c, &AudioManager::pulseGetInputSinks, currentManager);
+            if (removed) {
+                currentManager->stopPeakMonitor(index);
+                currentManager->sinkInputCache.remove(index);
+                currentManager->duckStreams.remove(index);
+                emit currentManager->sinkInputRemoved(index);
+            } else {
+                releaseOperation(pa_context_get_sink_input_info(c, index, &AudioManager::pulseGetInputSinks, currentManager));
+            }
             break;
         case PA_SUBSCRIPTION_EVENT_SOURCE:
-            pa_context_get_server_info(c, &AudioManager::pulseServerInfo, currentManager);
-            pa_context_get_source_info_list(c, &AudioManager::pulseGetSources, currentManager);
+            if (removed) {
+                currentManager->sourceCache.remove(index);
+                emit currentManager->sourceRemoved(index);
+            } else {
+                releaseOperation(pa_context_get_source_info_by_index(c, index, &AudioManager::pulseGetSources, currentManager));
+            }
             break;
         case PA_SUBSCRIPTION_EVENT_CLIENT:
-            pa_context_get_client_info_list(c, &AudioManager::pulseGetClients, currentManager);
+            if (removed) {
+                currentManager->clientCache.remove(index);
+                emit currentManager->clientRemoved(index);
+            } else {
+                releaseOperation(pa_context_get_client_info(c, index, &AudioManager::pulseGetClients, currentManager));
+            }
+            break;
+    }
+}
+
+void AudioManager::startAlsaFallback() {
+    if (alsaMixer != NULL) return;
+
+    alsaMixer = new AlsaMixer("default", "Master", this);
+    connect(alsaMixer, &AlsaMixer::volumeChanged, this, &AudioManager::masterVolumeChanged);
+    if (currentQuietMode == mute) alsaMixer->setMute(true);
+    emit masterVolumeChanged(alsaMixer->volume());
+}
+
+void AudioManager::setDefaultSinkMute(bool mute) {
+    if (pulseAvailable) {
+        releaseOperation(pa_context_set_sink_mute_by_index(pulseContext, defaultSinkIndex, mute, NULL, NULL));
+    } else if (alsaMixer != NULL) {
+        alsaMixer->setMute(mute);
     }
 }
 
 void AudioManager::pulseGetSinks(pa_context *c, const pa_sink_info *i, int eol, void *userdata) {
+    AudioManager* currentManager = (AudioManager*) userdata;
+    if (eol == 0) {
+        Sink sink;
+        sink.index = i->index;
+        sink.name = QString::fromUtf8(i->name);
+        sink.description = QString::fromUtf8(i->description);
+        sink.volume = i->volume;
+        sink.mute = i->mute;
+        sink.monitorSource = i->monitor_source;
+        currentManager->sinkCache.insert(i->index, sink);
+
+        if (sink.name == currentManager->defaultSinkName) {
+            bool wasDefault = currentManager->defaultSinkIndex == (int) i->index;
+            int oldVolume = wasDefault ? currentManager->MasterVolume() : -1;
+
+            currentManager->defaultSinkIndex = i->index;
+            currentManager->defaultSinkVolume = i->volume;
+
+            if (!wasDefault) emit currentManager->defaultSinkChanged(i->index);
+            if (!wasDefault || oldVolume != currentManager->MasterVolume()) emit currentManager->masterVolumeChanged(currentManager->MasterVolume());
+        }
 
+        emit currentManager->sinkChanged(i->index);
+    }
 }
 
 void AudioManager::pulseServerInfo(pa_context *c, const pa_server_info *i, void *userdata) {
-    pa_context_get_sink_info_by_name(c, i->default_sink_name, &AudioManager::pulseGetDefaultSink, userdata);
+    AudioManager* currentManager = (AudioManager*) userdata;
+    QString defaultSink = QString::fromUtf8(i->default_sink_name);
+    if (defaultSink != currentManager->defaultSinkName) {
+        currentManager->defaultSinkName = defaultSink;
+        currentManager->updateDefaultSink();
+    }
 }
 
-void AudioManager::pulseGetDefaultSink(pa_context *c, const pa_sink_info *i, int eol, void *userdata) {
-    if (eol == 0) {
-        AudioManager* currentManager = (AudioManager*) userdata;
-        currentManager->defaultSinkIndex = i->index;
-        currentManager->defaultSinkVolume = i->volume;
+void AudioManager::updateDefaultSink() {
+    for (Sink sink : sinkCache.values()) {
+        if (sink.name == defaultSinkName) {
+            defaultSinkIndex = sink.index;
+            defaultSinkVolume = sink.volume;
+            emit defaultSinkChanged(defaultSinkIndex);
+            emit masterVolumeChanged(MasterVolume());
+            return;
+        }
     }
+
+    //The sink has not been listed yet; pulseGetSinks picks it up by name when it is
+    defaultSinkIndex = -1;
 }
 
 void AudioManager::pulseGetSources(pa_context *c, const pa_source_info *i, int eol, void *userdata) {
     AudioManager* currentManager = (AudioManager*) userdata;
     if (eol == 0) {
+        Source source;
+        source.index = i->index;
+        source.name = QString::fromUtf8(i->name);
+        source.description = QString::fromUtf8(i->description);
+        source.volume = i->volume;
+        source.mute = i->mute;
+        source.monitorOfSink = i->monitor_of_sink;
+        currentManager->sourceCache.insert(i->index, source);
+
+        emit currentManager->sourceChanged(i->index);
+    }
+}
+
+void AudioManager::duck(duckSource source) {
+    duckRequests[source]++;
+    duckReleaseTimer->stop();
+    startDuckRamp();
+}
 
+void AudioManager::unduck(duckSource source, bool immediate) {
+    //Ignore unbalanced requests rather than letting the count go negative
+    if (duckRequests.value(source) == 0) return;
+
+    duckRequests[source]--;
+    if (duckRequests.value(source) == 0) duckRequests.remove(source);
+
+    if (immediate) {
+        duckReleaseTimer->stop();
+        startDuckRamp();
+    } else {
+        //Sounds much better if we hold the duck for a moment
+        duckReleaseTimer->start(ShellSettings::instance()->value("audio/duckReleaseDelay", 1000).toInt());
     }
 }
 
-void AudioManager::attenuateStreams() {
-    if (pulseAvailable) {
-        if (attenuateRequests == 0) {
-            for (int source : originalStreamVolumes.keys()) {
-                //Set volume to 50% of original
-                pa_cvolume originalVolume = originalStreamVolumes.value(source);
-                for (int i = 0; i < originalVolume.channels; i++) {
-                    if (originalVolume.values[i] > PA_VOLUME_NORM) {
-                        originalVolume.values[i] = PA_VOLUME_NORM / 2;
-                    } else {
-                        originalVolume.values[i] /= 2;
-                    }
-                }
-                pa_context_set_sink_input_volume(pulseContext, source, &originalVolume, NULL, NULL);
-            }
-            attenuateMode = true;
-        }
-        attenuateRequests++;
+double AudioManager::duckTargetLevel() {
+    //The deepest active source wins
+    double level = 1;
+    if (duckRequests.contains(duckNotification)) level = qMin(level, ShellSettings::instance()->value("audio/duckLevelNotification", 0.5).toDouble());
+    if (duckRequests.contains(duckCall)) level = qMin(level, ShellSettings::instance()->value("audio/duckLevelCall", 0.1).toDouble());
+    if (duckRequests.contains(duckVoiceFeedback)) level = qMin(level, ShellSettings::instance()->value("audio/duckLevelVoiceFeedback", 0.3).toDouble());
+    return qBound(0.0, level, 1.0);
+}
+
+void AudioManager::startDuckRamp() {
+    double target = duckTargetLevel();
+    if (qFuzzyCompare(target, duckTarget)) return;
+
+    bool attack = target < duckLevel;
+    duckRampStart = duckLevel;
+    duckTarget = target;
+    duckCurve = QEasingCurve((QEasingCurve::Type) ShellSettings::instance()->value(attack ? "audio/duckAttackCurve" : "audio/duckReleaseCurve", attack ? QEasingCurve::OutCubic : QEasingCurve::InOutSine).toInt());
+
+    //A ramp that reverses part way through only needs to cover the remaining distance
+    int fullDuration = ShellSettings::instance()->value(attack ? "audio/duckAttack" : "audio/duckRelease", attack ? 150 : 500).toInt();
+    double distance = fabs(target - duckLevel);
+    duckRampDuration = distance > 0 ? (int) (fullDuration * distance / (1 - qMin(target, duckLevel))) : 0;
+
+    duckRampClock.start();
+    duckTimer->start();
+}
+
+void AudioManager::duckTick() {
+    double progress = duckRampDuration <= 0 ? 1 : qMin(1.0, duckRampClock.elapsed() / (double) duckRampDuration);
+    if (progress >= 1) {
+        duckLevel = duckTarget;
+        duckTimer->stop();
+    } else {
+        duckLevel = duckRampStart + (duckTarget - duckRampStart) * duckCurve.valueForProgress(progress);
+    }
+
+    //Every ducked stream is updated in the same pass so each tick is one batch of writes
+    for (uint32_t index : duckStreams.keys()) {
+        applyDuck(index);
     }
 }
 
-void AudioManager::silenceStreams() {
-    if (pulseAvailable) {
-        for (int source : originalStreamVolumes.keys()) {
-            //Set volume to 10% of original
-            pa_cvolume originalVolume = originalStreamVolumes.value(source);
-            for (int i = 0; i < originalVolume.channels; i++) {
-                originalVolume.values[i] /= 10;
-            }
-            pa_context_set_sink_input_volume(pulseContext, source, &originalVolume, NULL, NULL);
-        }
-        attenuateMode = true;
+pa_cvolume AudioManager::scaleVolume(pa_cvolume volume, double level) {
+    for (int i = 0; i < volume.channels; i++) {
+        volume.values[i] = qBound((double) PA_VOLUME_MUTED, volume.values[i] * level, (double) PA_VOLUME_MAX);
     }
+    return volume;
 }
 
-void AudioManager::restoreStreams(bool immediate) {
+void AudioManager::applyDuck(uint32_t index) {
+    DuckStream& stream = duckStreams[index];
+    pa_cvolume volume = scaleVolume(stream.userVolume, duckLevel);
+    if (pa_cvolume_equal(&volume, &stream.appliedVolume)) return;
+
+    stream.appliedVolume = volume;
     if (pulseAvailable) {
-        attenuateRequests--;
-        if (attenuateRequests == 0) {
-            //Sounds much better if we delay by a second
-            QTimer::singleShot(immediate ? 0 : 1000, [=]() {
-                for (int source : originalStreamVolumes.keys()) {
-                    //Restore volume of each stream
-                    pa_cvolume originalVolume = originalStreamVolumes.value(source);
-                    if (originalVolume.channels > 0) {
-                        tVariantAnimation* anim = new tVariantAnimation;
-                        anim->setStartValue(originalVolume.values[0] / 2);
-                        pa_volume_t endValue = originalVolume.values[0];
-                        if (endValue > PA_VOLUME_NORM) {
-                            endValue = PA_VOLUME_NORM;
-                        }
-                        anim->setEndValue(endValue);
-                        anim->setDuration(500);
-                        connect(anim, &tVariantAnimation::valueChanged, [=](QVariant value) {
-                            pa_cvolume originalVolume = originalStreamVolumes.value(source);
-                            for (int i = 0; i < originalVolume.channels; i++) {
-                                originalVolume.values[i] = value.toUInt();
-                            }
-                            pa_context_set_sink_input_volume(pulseContext, source, &originalVolume, NULL, NULL);
-                        });
-                        connect(anim, &tVariantAnimation::finished, [=]() {
-                            attenuateMode = false;
-                        });
-                        connect(anim, SIGNAL(finished()), anim, SLOT(deleteLater()));
-                        anim->start();
-                    }
-
-                }
-            });
-        } else if (attenuateRequests == -1) {
-            attenuateRequests = 0;
-        }
+        duckWritesPending++;
+        releaseOperation(pa_context_set_sink_input_volume(pulseContext, index, &volume, &AudioManager::pulseDuckWritten, this));
+    }
+}
+
+void AudioManager::pulseDuckWritten(pa_context *c, int success, void *userdata) {
+    Q_UNUSED(c)
+    Q_UNUSED(success)
+    AudioManager* currentManager = (AudioManager*) userdata;
+    if (currentManager->duckWritesPending > 0) currentManager->duckWritesPending--;
+}
+
+void AudioManager::trackDuckStream(uint32_t index, pa_cvolume volume) {
+    if (!duckStreams.contains(index)) {
+        //A stream that appears mid-duck joins at the current level
+        DuckStream stream;
+        stream.userVolume = volume;
+        stream.appliedVolume = volume;
+        duckStreams.insert(index, stream);
+        applyDuck(index);
+    } else if (duckWritesPending == 0 && !pa_cvolume_equal(&volume, &duckStreams.value(index).appliedVolume)) {
+        //Replies are ordered after our writes, so anything different once they have all landed came from the user.
+        //Keep their volume as the ducked one and work out what it should be restored to.
+        DuckStream& stream = duckStreams[index];
+        stream.appliedVolume = volume;
+        stream.userVolume = duckLevel > 0 ? scaleVolume(volume, 1 / duckLevel) : volume;
     }
 }
 
 void AudioManager::pulseGetInputSinks(pa_context *c, const pa_sink_input_info *i, int eol, void *userdata) {
     AudioManager* currentManager = (AudioManager*) userdata;
     if (eol == 0) {
-        if (!currentManager->tsClientIndices.contains(i->client)) {
-            if (currentManager->attenuateMode) {
-                if (currentManager->originalStreamVolumes.contains(i->index)) {
-                    pa_cvolume originalVolume = i->volume;
-                    for (int i = 0; i < originalVolume.channels; i++) {
-                        originalVolume.values[i] = originalVolume.values[i] * 2;
-                    }
-                    currentManager->originalStreamVolumes.insert(i->index, originalVolume);
-                } else {
-                    currentManager->originalStreamVolumes.insert(i->index, i->volume);
-                }
-            } else {
-                currentManager->originalStreamVolumes.insert(i->index, i->volume);
-            }
+        SinkInput input;
+        input.index = i->index;
+        input.client = i->client;
+        input.sink = i->sink;
+        input.name = QString::fromUtf8(i->name);
+        input.applicationName = QString::fromUtf8(pa_proplist_gets(i->proplist, PA_PROP_APPLICATION_NAME));
+        input.iconName = QString::fromUtf8(pa_proplist_gets(i->proplist, PA_PROP_APPLICATION_ICON_NAME));
+        input.binary = QString::fromUtf8(pa_proplist_gets(i->proplist, PA_PROP_APPLICATION_PROCESS_BINARY));
+        input.volume = i->volume;
+        input.mute = i->mute;
+        currentManager->sinkInputCache.insert(i->index, input);
+
+        //The monitor source belongs to the old sink, so follow the stream when it is moved
+        if (currentManager->peakStreams.contains(i->index) && currentManager->peakStreams.value(i->index).sink != i->sink) {
+            currentManager->stopPeakMonitor(i->index);
+            currentManager->startPeakMonitor(i->index);
         }
+
+        if (!currentManager->isShellClient(i->client)) {
+            currentManager->trackDuckStream(i->index, i->volume);
+        }
+
+        emit currentManager->sinkInputChanged(i->index);
     }
 }
 
 void AudioManager::pulseGetClients(pa_context *c, const pa_client_info *i, int eol, void *userdata) {
     AudioManager* currentManager = (AudioManager*) userdata;
     if (eol == 0) {
-        if (QString::fromUtf8(i->name).toLower().contains("theshell") || QString::fromUtf8(i->name).toLower().contains("qtpulseaudio")) {
-            currentManager->newTsClientIndices.append(i->index);
+        Client client;
+        client.index = i->index;
+        client.name = QString::fromUtf8(i->name);
+        client.applicationName = QString::fromUtf8(pa_proplist_gets(i->proplist, PA_PROP_APPLICATION_NAME));
+        client.iconName = QString::fromUtf8(pa_proplist_gets(i->proplist, PA_PROP_APPLICATION_ICON_NAME));
+        client.binary = QString::fromUtf8(pa_proplist_gets(i->proplist, PA_PROP_APPLICATION_PROCESS_BINARY));
+        currentManager->clientCache.insert(i->index, client);
+
+        //Streams can be listed before the client that owns them; our own sounds must never be attenuated
+        if (currentManager->isShellClient(i->index)) {
+            for (SinkInput input : currentManager->sinkInputCache.values()) {
+                if (input.client == i->index) currentManager->duckStreams.remove(input.index);
+            }
         }
-    } else {
-        currentManager->tsClientIndices = currentManager->newTsClientIndices;
-        currentManager->newTsClientIndices.clear();
+
+        emit currentManager->clientChanged(i->index);
     }
 }
 
+bool AudioManager::isShellClient(uint32_t client) {
+    if (!clientCache.contains(client)) return false;
+
+    QString name = clientCache.value(client).name.toLower();
+    return name.contains("theshell") || name.contains("qtpulseaudio");
+}
+
+QMap<uint32_t, AudioManager::Sink> AudioManager::sinks() {
+    return sinkCache;
+}
+
+QMap<uint32_t, AudioManager::Source> AudioManager::sources() {
+    return sourceCache;
+}
+
+QMap<uint32_t, AudioManager::SinkInput> AudioManager::sinkInputs() {
+    return sinkInputCache;
+}
+
+QMap<uint32_t, AudioManager::Client> AudioManager::clients() {
+    return clientCache;
+}
+
+int AudioManager::defaultSink() {
+    return defaultSinkIndex;
+}
+
+void AudioManager::setSinkInputVolume(uint32_t index, int volume) {
+    if (!sinkInputCache.contains(index)) return;
+
+    pa_cvolume newVolume = sinkInputCache.value(index).volume;
+    pa_cvolume_set(&newVolume, newVolume.channels, PA_VOLUME_MUTED + (((float) volume / 100) * (float) PA_VOLUME_NORM));
+    releaseOperation(pa_context_set_sink_input_volume(pulseContext, index, &newVolume, NULL, NULL));
+}
+
+void AudioManager::setSinkInputMute(uint32_t index, bool mute) {
+    releaseOperation(pa_context_set_sink_input_mute(pulseContext, index, mute, NULL, NULL));
+}
+
+void AudioManager::startPeakMonitor(uint32_t index) {
+    if (peakStreams.contains(index) || !sinkInputCache.contains(index)) return;
+
+    uint32_t sink = sinkInputCache.value(index).sink;
+    if (!sinkCache.contains(sink)) return;
+
+    //Let the server do the peak detection and hand us a few samples a second
+    pa_sample_spec spec;
+    spec.format = PA_SAMPLE_FLOAT32;
+    spec.channels = 1;
+    spec.rate = 25;
+
+    pa_stream* stream = pa_stream_new(pulseContext, "Peak Meter", &spec, NULL);
+    if (stream == NULL) return;
+
+    pa_stream_set_monitor_stream(stream, index);
+    pa_stream_set_read_callback(stream, &AudioManager::pulseReadPeak, this);
+
+    pa_buffer_attr attr;
+    attr.maxlength = (uint32_t) -1;
+    attr.tlength = (uint32_t) -1;
+    attr.prebuf = (uint32_t) -1;
+    attr.minreq = (uint32_t) -1;
+    attr.fragsize = sizeof(float);
+
+    QByteArray source = QByteArray::number(sinkCache.value(sink).monitorSource);
+    if (pa_stream_connect_record(stream, source.constData(), &attr, (pa_stream_flags_t) (PA_STREAM_DONT_MOVE | PA_STREAM_PEAK_DETECT | PA_STREAM_ADJUST_LATENCY | PA_STREAM_DONT_INHIBIT_AUTO_SUSPEND)) < 0) {
+        pa_stream_unref(stream);
+        return;
+    }
+
+    PeakStream peakStream;
+    peakStream.stream = stream;
+    peakStream.sink = sink;
+    peakStreams.insert(index, peakStream);
+}
+
+void AudioManager::stopPeakMonitor(uint32_t index) {
+    if (!peakStreams.contains(index)) return;
+
+    pa_stream* stream = peakStreams.take(index).stream;
+    pa_stream_set_read_callback(stream, NULL, NULL);
+    pa_stream_disconnect(stream);
+    pa_stream_unref(stream);
+}
+
+void AudioManager::pulseReadPeak(pa_stream *s, size_t length, void *userdata) {
+    Q_UNUSED(length)
+    AudioManager* currentManager = (AudioManager*) userdata;
+
+    const void* data;
+    size_t bytes;
+    if (pa_stream_peek(s, &data, &bytes) < 0) return;
+
+    if (data == NULL) {
+        //A hole in the buffer; skip over it
+        if (bytes != 0) pa_stream_drop(s);
+        return;
+    }
+
+    //Plain loop with no branches so the compiler can vectorise it
+    const float* samples = (const float*) data;
+    size_t count = bytes / sizeof(float);
+    float peak = 0;
+    for (size_t n = 0; n < count; n++) {
+        float sample = fabsf(samples[n]);
+        peak = sample > peak ? sample : peak;
+    }
+    pa_stream_drop(s);
+
+    emit currentManager->peakChanged(pa_stream_get_monitor_stream(s), peak);
+}
+
 void AudioManager::setQuietMode(quietMode mode) {
     if (mode != currentQuietMode) {
         quietMode oldQuietMode = this->currentQuietMode;
         if (mode == mute) {
-            pa_context_set_sink_mute_by_index(pulseContext, defaultSinkIndex, 1, NULL, NULL);
+            setDefaultSinkMute(true);
         }
 
         this->currentQuietMode = mode;
+        SessionState::instance()->setQuietMode(mode);
         emit QuietModeChanged(mode);
 
         if (oldQuietMode == mute) {
-            pa_context_set_sink_mute_by_index(pulseContext, defaultSinkIndex, 0, NULL, NULL);
+            setDefaultSinkMute(false);
         }
     }
 }
@@ -360,4 +643,5 @@ void AudioManager::setQuietModeResetTime(QDateTime time) {
     } else {
         quietModeWatcher->stop();
     }
+    SessionState::instance()->setQuietModeResetTime(time);
 }
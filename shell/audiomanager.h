@@ -26,6 +26,9 @@
 #include <QMap>
 #include <QTimer>
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <QEasingCurve>
+#include <QSettings>
 #include <tvariantanimation.h>
 #include <pulse/context.h>
 #include <pulse/glib-mainloop.h>
@@ -33,6 +36,7 @@
 #include <pulse/introspect.h>
 #include <pulse/subscribe.h>
 #include <pulse/stream.h>
+#include "alsamixer.h"
 
 class AudioManager : public QObject
 {
@@ -47,21 +51,77 @@ public:
         mute
     };
 
+    enum duckSource {
+        duckNotification,
+        duckCall,
+        duckVoiceFeedback
+    };
+
+    struct Sink {
+        uint32_t index;
+        QString name, description;
+        pa_cvolume volume;
+        bool mute;
+        uint32_t monitorSource;
+    };
+
+    struct Source {
+        uint32_t index;
+        QString name, description;
+        pa_cvolume volume;
+        bool mute;
+        uint32_t monitorOfSink;
+    };
+
+    struct SinkInput {
+        uint32_t index;
+        uint32_t client, sink;
+        QString name, applicationName, iconName, binary;
+        pa_cvolume volume;
+        bool mute;
+    };
+
+    struct Client {
+        uint32_t index;
+        QString name, applicationName, iconName, binary;
+    };
+
     int MasterVolume();
     quietMode QuietMode();
     QString getCurrentQuietModeDescription();
 
+    QMap<uint32_t, Sink> sinks();
+    QMap<uint32_t, Source> sources();
+    QMap<uint32_t, SinkInput> sinkInputs();
+    QMap<uint32_t, Client> clients();
+    int defaultSink();
+    bool isShellClient(uint32_t client);
+
 signals:
     void QuietModeChanged(quietMode mode);
+    void masterVolumeChanged(int volume);
+    void defaultSinkChanged(int index);
+    void sinkChanged(uint32_t index);
+    void sinkRemoved(uint32_t index);
+    void sourceChanged(uint32_t index);
+    void sourceRemoved(uint32_t index);
+    void sinkInputChanged(uint32_t index);
+    void sinkInputRemoved(uint32_t index);
+    void clientChanged(uint32_t index);
+    void clientRemoved(uint32_t index);
+    void peakChanged(uint32_t index, float peak);
 
 public slots:
     void setMasterVolume(int volume);
     void changeVolume(int volume);
-    void attenuateStreams();
-    void silenceStreams();
-    void restoreStreams(bool immediate = false);
+    void duck(duckSource source);
+    void unduck(duckSource source, bool immediate = false);
     void setQuietMode(quietMode mode);
     void setQuietModeResetTime(QDateTime time);
+    void setSinkInputVolume(uint32_t index, int volume);
+    void setSinkInputMute(uint32_t index, bool mute);
+    void startPeakMonitor(uint32_t index);
+    void stopPeakMonitor(uint32_t index);
 
 private:
     pa_context* pulseContext = NULL;
@@ -69,22 +129,56 @@ private:
 
     static void pulseStateChanged(pa_context *c, void *userdata);
     static void pulseGetSinks(pa_context *c, const pa_sink_info *i, int eol, void *userdata);
-    static void pulseGetDefaultSink(pa_context *c, const pa_sink_info *i, int eol, void *userdata);
     static void pulseSubscribe(pa_context *c, pa_subscription_event_type_t t, uint32_t index, void *userdata);
     static void pulseServerInfo(pa_context *c, const pa_server_info *i, void *userdata);
     static void pulseGetSources(pa_context *c, const pa_source_info *i, int eol, void *userdata);
     static void pulseGetInputSinks(pa_context *c, const pa_sink_input_info *i, int eol, void *userdata);
     static void pulseGetClients(pa_context *c, const pa_client_info*i, int eol, void *userdata);
+    static void pulseReadPeak(pa_stream *s, size_t length, void *userdata);
+    static void pulseDuckWritten(pa_context *c, int success, void *userdata);
+
+    void connectPulse();
+    void updateDefaultSink();
+    void startAlsaFallback();
+    void setDefaultSinkMute(bool mute);
+    void trackDuckStream(uint32_t index, pa_cvolume volume);
+    void applyDuck(uint32_t index);
+    void startDuckRamp();
+    void duckTick();
+    double duckTargetLevel();
+    pa_cvolume scaleVolume(pa_cvolume volume, double level);
 
-    QMap<int, pa_cvolume> originalStreamVolumes;
-    int attenuateRequests = 0;
+    struct PeakStream {
+        pa_stream* stream;
+        uint32_t sink;
+    };
+    QMap<uint32_t, PeakStream> peakStreams;
+
+    struct DuckStream {
+        pa_cvolume userVolume;
+        pa_cvolume appliedVolume;
+    };
+    QMap<uint32_t, DuckStream> duckStreams;
+    QMap<duckSource, int> duckRequests;
+    QTimer* duckTimer;
+    QTimer* duckReleaseTimer;
+    QElapsedTimer duckRampClock;
+    QEasingCurve duckCurve;
+    double duckLevel = 1, duckRampStart = 1, duckTarget = 1;
+    int duckRampDuration = 0;
+    int duckWritesPending = 0;
 
     bool pulseAvailable = false;
-    bool attenuateMode = false;
+    QTimer* pulseReconnectTimer;
+    AlsaMixer* alsaMixer = NULL;
     int defaultSinkIndex = -1;
-    QList<uint> tsClientIndices;
-    QList<uint> newTsClientIndices;
+    QString defaultSinkName;
     pa_cvolume defaultSinkVolume;
+
+    QMap<uint32_t, Sink> sinkCache;
+    QMap<uint32_t, Source> sourceCache;
+    QMap<uint32_t, SinkInput> sinkInputCache;
+    QMap<uint32_t, Client> clientCache;
     quietMode currentQuietMode = none;
     QSettings settings;
 
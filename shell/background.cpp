@@ -19,7 +19,10 @@
  * *************************************/
 
 #include "background.h"
+#include "shellsettings.h"
 #include "ui_background.h"
+#include "backgroundrenderer.h"
+#include "backgroundprefetcher.h"
 
 extern float getDPIScaling();
 
@@ -39,6 +42,12 @@ Background::Background(MainWindow* mainwindow, bool imageGetter, QRect screenGeo
     background = QPixmap(screenGeometry.size());
     background.fill(Qt::black);
 
+    connect(BackgroundRenderer::instance(), SIGNAL(rendered(quint64,QImage)), this, SLOT(backgroundRendered(quint64,QImage)));
+    if (imageGetter) {
+        connect(BackgroundPrefetcher::instance(), SIGNAL(refreshed(bool)), this, SLOT(communityBackgroundsRefreshed(bool)));
+        connect(BackgroundPrefetcher::instance(), SIGNAL(imageReady(QString)), this, SLOT(communityImageReady(QString)));
+        connect(BackgroundPrefetcher::instance(), SIGNAL(imageFailed(QString)), this, SLOT(communityImageFailed(QString)));
+    }
     changeBackground();
     set = true;
 }
@@ -52,9 +61,8 @@ void Background::changeBackground() {
     QString backPath = settings.value("desktop/background", "inbuilt:triangles").toString();
 
     if (backPath.startsWith("inbuilt:")) { //Inbuilt background
-        QSvgRenderer renderer(QString(":/backgrounds/" + backPath.split(":").at(1)));
-        QPainter painter(&background);
-        renderer.render(&painter, background.rect());
+        communityMetadata = QJsonObject();
+        requestBackground(":/backgrounds/" + backPath.split(":").at(1));
     } else if (backPath.startsWith("community")) {
         QDir::home().mkpath(".theshell/backgrounds");
         bool metadataExists = QFile(QDir::homePath() + "/.theshell/backgrounds.conf").exists();
@@ -66,216 +74,108 @@ void Background::changeBackground() {
         } else {
             getNewCommunityBackground();
         }
-        return;
     } else {
-        QPixmap image;
-        image.load(backPath);
-        QPainter painter(&background);
-
-        //Clear background
-        painter.setBrush(QColor(0, 0, 0));
-        painter.setPen(Qt::transparent);
-        painter.drawRect(0, 0, background.width(), background.height());
+        communityMetadata = QJsonObject();
+        requestBackground(backPath);
+    }
+}
 
-        //Draw background
-        switch (settings.value("desktop/stretchStyle", 0).toInt()) {
-            case 0: //Stretch
-                painter.drawPixmap(0, 0, background.width(), background.height(), image);
-                break;
-            case 1: { //Zoom and Crop
-                QRect rect;
-                rect.setSize(image.size().scaled(background.width(), background.height(), Qt::KeepAspectRatioByExpanding));
-                rect.moveLeft(background.width() / 2 - rect.width() / 2);
-                rect.moveTop(background.height() / 2 - rect.height() / 2);
-                painter.drawPixmap(rect, image);
-                break;
-            }
-            case 2: { //Center
-                QRect rect;
-                rect.setSize(image.size());
-                rect.moveLeft(background.width() / 2 - rect.width() / 2);
-                rect.moveTop(background.height() / 2 - rect.height() / 2);
-                painter.drawPixmap(rect, image);
-                break;
-            }
-            case 3: //Tile
-                painter.drawTiledPixmap(0, 0, background.width(), background.height(), image);
-                break;
-            case 4: { //Zoom and Fit
-                QRect rect;
-                rect.setSize(image.size().scaled(background.width(), background.height(), Qt::KeepAspectRatio));
-                rect.moveLeft(background.width() / 2 - rect.width() / 2);
-                rect.moveTop(background.height() / 2 - rect.height() / 2);
-                painter.drawPixmap(rect, image);
-                break;
-            }
-        }
-        //background = background.scaled(screenGeometry.size());
+void Background::requestBackground(QString source) {
+    //Decoding and scaling happen on a worker thread; screens of the same size share the result
+    int style = settings.value("desktop/stretchStyle", 0).toInt();
+    QImage image = BackgroundRenderer::instance()->cached(source, screenGeometry.size(), style);
+    if (image.isNull()) {
+        pendingRequest = BackgroundRenderer::instance()->render(source, screenGeometry.size(), style);
+    } else {
+        pendingRequest = 0;
+        applyBackground(image);
     }
+}
 
-    this->update();
+void Background::backgroundRendered(quint64 request, QImage image) {
+    if (request != pendingRequest) return;
+    pendingRequest = 0;
+    if (!image.isNull()) applyBackground(image);
 }
 
 void Background::getNewCommunityBackground() {
     if (!imageGetter) return;
 
-    QNetworkRequest req(QUrl("https://vicr123.github.io/theshell/backgrounds/backgrounds.json"));
-    req.setHeader(QNetworkRequest::UserAgentHeader, QString("theShell/") + TS_VERSION);
-    req.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
-    QNetworkReply* listOfBackgrounds = manager.get(req);
-    connect(listOfBackgrounds, &QNetworkReply::finished, [=] {
-        QByteArray data = listOfBackgrounds->readAll();
-        QJsonDocument doc = QJsonDocument::fromJson(data);
-        if (!doc.isArray()) {
-            //error error
-            if (QFile(QDir::homePath() + "/.theshell/background.conf").exists()) {
-                //We have a valid image we can use
-                //Try getting a new image tomorrow
-                QDateTime oldFetchedValue = settings.value("desktop/fetched").toDateTime();
-                oldFetchedValue = oldFetchedValue.addDays(1);
-                settings.setValue("desktop/fetched", oldFetchedValue);
-                setNewBackgroundTimer();
-                loadCommunityBackgroundMetadata();
-            } else {
-                //ui->label->setText(tr("Couldn't get community backgrounds!"));
-            }
-        } else {
-            QJsonArray arr = doc.array();
-            arr.removeFirst();
-
-            QStringList downloadImages;
-            qsrand(QDateTime::currentMSecsSinceEpoch());
-
-            for (int i = 0; i < 10; i++) {
-                int index = qrand() % arr.count();
-                QString url = arr.at(index).toString();
-                downloadImages.append(url);
-                arr.removeAt(index);
+    //Known backgrounds and downloaded images are kept; the prefetcher only adds new ones
+    BackgroundPrefetcher::instance()->refresh();
+}
 
-                if (arr.count() == 0) {
-                    i = 10;
-                }
-            }
+void Background::communityBackgroundsRefreshed(bool success) {
+    if (success) {
+        //Keep track of time when these images were retrieved
+        settings.setValue("desktop/fetched", QDateTime::currentDateTimeUtc());
+        setNewBackgroundTimer();
 
-            //Keep track of time when these images were retrieved
-            settings.setValue("desktop/fetched", QDateTime::currentDateTimeUtc());
-
-            //Delete list of known images
-            QFile(QDir::homePath() + "/.theshell/backgrounds.conf").remove();
-            QDir(QDir::homePath() + "/.theshell/backgrounds/").removeRecursively();
-            QDir::home().mkpath(".theshell/backgrounds/");
-
-            numberDone = 0;
-            for (QString url : downloadImages) {
-                QNetworkRequest req((QUrl("https://vicr123.github.io" + url)));
-                req.setHeader(QNetworkRequest::UserAgentHeader, QString("theShell/") + TS_VERSION);
-                req.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
-                QNetworkReply* metadata = manager.get(req);
-                connect(metadata, &QNetworkReply::finished, [=] {
-                    QByteArray data = metadata->readAll();
-                    QJsonDocument doc = QJsonDocument::fromJson(data);
-                    if (doc.isObject()) {
-                        QJsonObject obj = doc.object();
-
-                        QString fileName = obj.value("filename").toString();
-                        QString dirName = fileName.left(fileName.indexOf("."));
-
-                        QDir::home().mkpath(".theshell/backgrounds/" + dirName);
-                        QFile metadataFile(QDir::homePath() + "/.theshell/backgrounds/" + dirName + "/metadata.json");
-                        metadataFile.open(QFile::WriteOnly);
-                        metadataFile.write(data);
-                        metadataFile.close();
-
-                        QFile backgroundListConf(QDir::homePath() + "/.theshell/backgrounds.conf");
-                        backgroundListConf.open(QFile::Append);
-                        backgroundListConf.write(dirName.append("\n").toUtf8());
-                        backgroundListConf.close();
-                    }
-                    metadata->deleteLater();
-                    numberDone++;
-
-                    if (numberDone == downloadImages.count()) {
-                        numberDone = 0;
-                        setNewBackgroundTimer();
-
-                        //Load up a new background from the cache
-                        loadCommunityBackgroundMetadata();
-                    }
-                });
-            }
-        }
-        listOfBackgrounds->deleteLater();
-    });
+        //Load up a new background from the cache
+        loadCommunityBackgroundMetadata();
+    } else if (!BackgroundPrefetcher::instance()->knownBackgrounds().isEmpty()) {
+        //We have valid images we can use
+        //Try getting new images tomorrow
+        QDateTime oldFetchedValue = settings.value("desktop/fetched").toDateTime();
+        oldFetchedValue = oldFetchedValue.addDays(1);
+        settings.setValue("desktop/fetched", oldFetchedValue);
+        setNewBackgroundTimer();
+        loadCommunityBackgroundMetadata();
+    }
 }
 
 void Background::loadCommunityBackgroundMetadata() {
     if (!imageGetter) return;
 
-    QFile backgroundListConf(QDir::homePath() + "/.theshell/backgrounds.conf");
-    backgroundListConf.open(QFile::ReadOnly);
-    QStringList allBackgrounds = QString(backgroundListConf.readAll()).split("\n");
-    backgroundListConf.close();
-
-    allBackgrounds.removeAll("");
+    BackgroundPrefetcher* prefetcher = BackgroundPrefetcher::instance();
+    QStringList readyBackgrounds = prefetcher->readyBackgrounds();
+    if (readyBackgrounds.count() > 1) readyBackgrounds.removeAll(currentBackground);
 
     qsrand(QDateTime::currentMSecsSinceEpoch());
-    QString background = allBackgrounds.at(qrand() % allBackgrounds.count());
-
-    if (QFile(QDir::homePath() + "/.theshell/backgrounds/" + background + "/" + background + ".jpeg").exists()) {
+    if (!readyBackgrounds.isEmpty()) {
+        QString background = readyBackgrounds.at(qrand() % readyBackgrounds.count());
+        waitingBackground = "";
         QTimer::singleShot(0, [=] {
             emit setAllBackgrounds(background);
             setCommunityBackground(background);
-        });;
+        });
+
+        //Top up the images waiting on disk for next time
+        prefetcher->prefetch();
     } else {
-        QFile metadataFile(QDir::homePath() + "/.theshell/backgrounds/" + background + "/metadata.json");
-        metadataFile.open(QFile::ReadOnly);
-        QJsonDocument doc = QJsonDocument::fromJson(metadataFile.readAll());
-        metadataFile.close();
-
-        if (doc.isObject()) {
-            QString fileName = doc.object().value("filename").toString();
-            QString dirName = fileName.left(fileName.indexOf("."));
-
-            QNetworkRequest req(QUrl(QString("https://vicr123.github.io/theshell/backgrounds/%1/%2").arg(dirName, fileName)));
-            req.setHeader(QNetworkRequest::UserAgentHeader, QString("theShell/") + TS_VERSION);
-            req.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
-            QNetworkReply* image = manager.get(req);
-            connect(image, &QNetworkReply::finished, [=] {
-                if (image->error() == QNetworkReply::NoError) {
-                    QByteArray data = image->readAll();
-                    QFile imageFile(QDir::homePath() + "/.theshell/backgrounds/" + background + "/" + background + ".jpeg");
-                    imageFile.open(QFile::WriteOnly);
-                    imageFile.write(data);
-                    imageFile.close();
-                    image->deleteLater();
-
-                    if (set) {
-                        emit reloadBackground();
-                    } else {
-                        //ui->stackedWidget->setCurrentIndex(0);
-                        setCommunityBackground(background);
-                        if (imageGetter) {
-                            emit setAllBackgrounds(background);
-                        }
-                    }
-                } else {
-                    //Error retrieving image
-                    //Try another image
-                    loadCommunityBackgroundMetadata();
-                    image->deleteLater();
-                }
-            });
-        } else {
-            //Error reading metadata file
-            //Clear and start again
+        QStringList allBackgrounds = prefetcher->knownBackgrounds();
+        if (allBackgrounds.isEmpty()) {
             getNewCommunityBackground();
+            return;
         }
+
+        //Nothing has been downloaded ahead of time; fetch one now
+        waitingBackground = allBackgrounds.at(qrand() % allBackgrounds.count());
+        prefetcher->fetch(waitingBackground);
+    }
+}
+
+void Background::communityImageReady(QString background) {
+    if (background != waitingBackground) return;
+    waitingBackground = "";
+
+    setCommunityBackground(background);
+    emit setAllBackgrounds(background);
+}
+
+void Background::communityImageFailed(QString background) {
+    if (background != waitingBackground) return;
+    waitingBackground = "";
+
+    //Try another image, but don't spin if nothing can be downloaded at all
+    if (!BackgroundPrefetcher::instance()->readyBackgrounds().isEmpty()) {
+        loadCommunityBackgroundMetadata();
     }
 }
 
 void Background::setCommunityBackground(QString bg) {
-    QFile metadataFile(QDir::homePath() + "/.theshell/backgrounds/" + bg + "/metadata.json");
-    QFile imageFile(QDir::homePath() + "/.theshell/backgrounds/" + bg + "/" + bg + ".jpeg");
+    QFile metadataFile(BackgroundPrefetcher::instance()->metadataPath(bg));
+    QFile imageFile(BackgroundPrefetcher::instance()->imagePath(bg));
     if (!metadataFile.exists()) {
         getNewCommunityBackground();
         return;
@@ -288,119 +188,85 @@ void Background::setCommunityBackground(QString bg) {
     metadataFile.open(QFile::ReadOnly);
     QJsonDocument doc = QJsonDocument::fromJson(metadataFile.readAll());
     if (doc.isObject()) {
-        QJsonObject metadata = doc.object();
-        QPixmap image;
-        image.load(imageFile.fileName());
+        communityMetadata = doc.object();
+        BackgroundPrefetcher::instance()->markUsed(bg);
+        requestBackground(imageFile.fileName());
+        currentBackground = bg;
 
-        QPainter painter(&this->background);
+        if (imageGetter) {
+            settings.setValue("desktop/changed", QDateTime::currentDateTimeUtc());
+            setTimer();
+        }
+    } else {
+        getNewCommunityBackground();
+    }
+}
 
-        //Clear background
-        painter.setBrush(QColor(0, 0, 0));
-        painter.setPen(Qt::transparent);
-        painter.drawRect(0, 0, background.width(), background.height());
+void Background::applyBackground(QImage image) {
+    background = QPixmap::fromImage(image);
 
-        //Draw background
-        switch (settings.value("desktop/stretchStyle", 0).toInt()) {
-            case 0: //Stretch
-                painter.drawPixmap(0, 0, background.width(), background.height(), image);
-                break;
-            case 1: { //Zoom and Crop
-                QRect rect;
-                rect.setSize(image.size().scaled(background.width(), background.height(), Qt::KeepAspectRatioByExpanding));
-                rect.moveLeft(background.width() / 2 - rect.width() / 2);
-                rect.moveTop(background.height() / 2 - rect.height() / 2);
-                painter.drawPixmap(rect, image);
-                break;
-            }
-            case 2: { //Center
-                QRect rect;
-                rect.setSize(image.size());
-                rect.moveLeft(background.width() / 2 - rect.width() / 2);
-                rect.moveTop(background.height() / 2 - rect.height() / 2);
-                painter.drawPixmap(rect, image);
-                break;
-            }
-            case 3: //Tile
-                painter.drawTiledPixmap(0, 0, background.width(), background.height(), image);
-                break;
-            case 4: { //Zoom and Fit
-                QRect rect;
-                rect.setSize(image.size().scaled(background.width(), background.height(), Qt::KeepAspectRatio));
-                rect.moveLeft(background.width() / 2 - rect.width() / 2);
-                rect.moveTop(background.height() / 2 - rect.height() / 2);
-                painter.drawPixmap(rect, image);
-                break;
-            }
-        }
-        //painter.drawImage(0, 0, image.scaled(background.width(), background.height(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
-
-        if (settings.value("desktop/showLabels", true).toBool()) {
-            QLinearGradient darkener;
-            darkener.setColorAt(0, QColor::fromRgb(0, 0, 0, 0));
-            darkener.setColorAt(1, QColor::fromRgb(0, 0, 0, 200));
-
-            if (settings.value("bar/onTop").toBool()) {
-                darkener.setStart(0, 0);
-                darkener.setFinalStop(0, background.height());
-            } else {
-                darkener.setStart(0, background.height());
-                darkener.setFinalStop(0, 0);
-            }
-            painter.setBrush(darkener);
-            painter.drawRect(0, 0, background.width(), background.height());
+    if (!communityMetadata.isEmpty() && settings.value("desktop/showLabels", true).toBool()) {
+        QPainter painter(&this->background);
+        QLinearGradient darkener;
+        darkener.setColorAt(0, QColor::fromRgb(0, 0, 0, 0));
+        darkener.setColorAt(1, QColor::fromRgb(0, 0, 0, 200));
 
-            painter.setPen(Qt::white);
-            int currentX = 30 * getDPIScaling();
-            int baselineY;
+        if (ShellSettings::instance()->barOnTop()) {
+            darkener.setStart(0, 0);
+            darkener.setFinalStop(0, background.height());
+        } else {
+            darkener.setStart(0, background.height());
+            darkener.setFinalStop(0, 0);
+        }
+        painter.setBrush(darkener);
+        painter.drawRect(0, 0, background.width(), background.height());
 
-            if (settings.value("bar/onTop").toBool()) {
-                baselineY = background.height() - 30 * getDPIScaling();
-            } else {
-                baselineY = 30 * getDPIScaling() + QFontMetrics(QFont(this->font().family(), 20)).ascent();
-            }
+        painter.setPen(Qt::white);
+        int currentX = 30 * getDPIScaling();
+        int baselineY;
 
-            if (metadata.contains("name")) {
-                painter.setFont(QFont(this->font().family(), 20));
-                QString name = metadata.value("name").toString();
-                int width = painter.fontMetrics().width(name);
-                painter.drawText(currentX, baselineY, name);
+        if (ShellSettings::instance()->barOnTop()) {
+            baselineY = background.height() - 30 * getDPIScaling();
+        } else {
+            baselineY = 30 * getDPIScaling() + QFontMetrics(QFont(this->font().family(), 20)).ascent();
+        }
 
-                currentX += width + 9 * getDPIScaling();
-            }
+        if (communityMetadata.contains("name")) {
+            painter.setFont(QFont(this->font().family(), 20));
+            QString name = communityMetadata.value("name").toString();
+            int width = painter.fontMetrics().width(name);
+            painter.drawText(currentX, baselineY, name);
 
+            currentX += width + 9 * getDPIScaling();
+        }
 
-            if (metadata.contains("location")) {
-                painter.setFont(QFont(this->font().family(), 10));
-                QIcon locationIcon = QIcon::fromTheme("gps");
-                QString location = metadata.value("location").toString();
-                int height = painter.fontMetrics().height();
-                int width = painter.fontMetrics().width(location) + height;
 
-                painter.drawPixmap(currentX, baselineY - height, locationIcon.pixmap(16 * getDPIScaling(), 16 * getDPIScaling()));
-                painter.drawText(currentX + height + 6 * getDPIScaling(), baselineY - painter.fontMetrics().descent(), location);
+        if (communityMetadata.contains("location")) {
+            painter.setFont(QFont(this->font().family(), 10));
+            QIcon locationIcon = QIcon::fromTheme("gps");
+            QString location = communityMetadata.value("location").toString();
+            int height = painter.fontMetrics().height();
+            int width = painter.fontMetrics().width(location) + height;
 
-                currentX += width + 20 * getDPIScaling();
-            }
+            painter.drawPixmap(currentX, baselineY - height, locationIcon.pixmap(16 * getDPIScaling(), 16 * getDPIScaling()));
+            painter.drawText(currentX + height + 6 * getDPIScaling(), baselineY - painter.fontMetrics().descent(), location);
 
-            if (metadata.contains("author")) {
-                painter.setFont(QFont(this->font().family(), 10));
-                QString author = tr("by %1").arg(metadata.value("author").toString());
-                int width = painter.fontMetrics().width(author);
-                painter.drawText(background.width() - width - 30 * getDPIScaling(), baselineY, author);
-            }
+            currentX += width + 20 * getDPIScaling();
         }
 
-        painter.end();
-        this->update();
-        currentBackground = bg;
-
-        if (imageGetter) {
-            settings.setValue("desktop/changed", QDateTime::currentDateTimeUtc());
-            setTimer();
+        if (communityMetadata.contains("author")) {
+            painter.setFont(QFont(this->font().family(), 10));
+            QString author = tr("by %1").arg(communityMetadata.value("author").toString());
+            int width = painter.fontMetrics().width(author);
+            painter.drawText(background.width() - width - 30 * getDPIScaling(), baselineY, author);
         }
-    } else {
-        getNewCommunityBackground();
     }
+
+    this->update();
+}
+
+QString Background::communityBackground() {
+    return currentBackground;
 }
 
 void Background::show() {
@@ -53,6 +53,7 @@ class Background : public QDialog
         ~Background();
 
         void show();
+        QString communityBackground();
 
     public slots:
         void setCommunityBackground(QString background);
@@ -85,20 +86,31 @@ class Background : public QDialog
 
         void setNewBackgroundTimer();
 
+        void backgroundRendered(quint64 request, QImage image);
+
+        void communityBackgroundsRefreshed(bool success);
+
+        void communityImageReady(QString background);
+
+        void communityImageFailed(QString background);
+
     private:
         Ui::Background *ui;
 
         void reject();
+        void requestBackground(QString source);
+        void applyBackground(QImage image);
         bool imageGetter;
         bool set = false;
         QSettings settings;
-        int numberDone;
         QString currentBackground;
+        QString waitingBackground;
         QRect screenGeometry;
 
         MainWindow* mainwindow;
-        QNetworkAccessManager manager;
         QPixmap background;
+        QJsonObject communityMetadata;
+        quint64 pendingRequest = 0;
         QTimer* timer = nullptr, *newBackgroundTimer = nullptr;
 
         void paintEvent(QPaintEvent* event);
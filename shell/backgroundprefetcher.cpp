@@ -0,0 +1,489 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#include "backgroundprefetcher.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QTimer>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QCryptographicHash>
+#include <QImageReader>
+
+#define MAX_CONCURRENT_DOWNLOADS 2
+#define PREFETCH_AHEAD 3
+#define NEW_BACKGROUNDS_PER_REFRESH 10
+#define MAX_ROTATION 40
+
+BackgroundPrefetcher* BackgroundPrefetcher::instance() {
+    static BackgroundPrefetcher* prefetcher = new BackgroundPrefetcher();
+    return prefetcher;
+}
+
+BackgroundPrefetcher::BackgroundPrefetcher(QObject *parent) : QObject(parent)
+{
+    QDir::home().mkpath(".theshell/backgrounds");
+    loadIndex();
+}
+
+QUrl BackgroundPrefetcher::serverUrl(QString path) {
+    //Point this at a local server to test without hitting the real one
+    return QUrl(settings.value("desktop/communityServer", "https://vicr123.github.io").toString() + path);
+}
+
+QNetworkRequest BackgroundPrefetcher::request(QUrl url) {
+    QNetworkRequest req(url);
+    req.setHeader(QNetworkRequest::UserAgentHeader, QString("theShell/") + TS_VERSION);
+    req.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
+    return req;
+}
+
+QString BackgroundPrefetcher::metadataPath(QString background) {
+    return QDir::homePath() + "/.theshell/backgrounds/" + background + "/metadata.json";
+}
+
+QString BackgroundPrefetcher::imagePath(QString background) {
+    return QDir::homePath() + "/.theshell/backgrounds/" + background + "/" + background + ".jpeg";
+}
+
+QStringList BackgroundPrefetcher::knownBackgrounds() {
+    QFile backgroundListConf(QDir::homePath() + "/.theshell/backgrounds.conf");
+    backgroundListConf.open(QFile::ReadOnly);
+    QStringList backgrounds = QString(backgroundListConf.readAll()).split("\n");
+    backgroundListConf.close();
+
+    backgrounds.removeAll("");
+    return backgrounds;
+}
+
+QStringList BackgroundPrefetcher::readyBackgrounds() {
+    QStringList ready;
+    for (QString background : knownBackgrounds()) {
+        if (QFile::exists(imagePath(background))) ready.append(background);
+    }
+    return ready;
+}
+
+void BackgroundPrefetcher::markUsed(QString background) {
+    //Don't touch the image itself; the renderer caches decoded images by modification time
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (now - usage.value(background, 0) < 60000) return; //Every screen shows the same image at once
+
+    usage.insert(background, now);
+    saveIndex();
+}
+
+QDateTime BackgroundPrefetcher::lastUsed(QString background) {
+    if (usage.contains(background)) return QDateTime::fromMSecsSinceEpoch(usage.value(background));
+
+    //Never shown; go by when it was downloaded, or failing that when its metadata arrived
+    QFileInfo image(imagePath(background));
+    return image.exists() ? image.lastModified() : QFileInfo(metadataPath(background)).lastModified();
+}
+
+void BackgroundPrefetcher::loadIndex() {
+    QFile indexFile(QDir::homePath() + "/.theshell/backgrounds.index");
+    indexFile.open(QFile::ReadOnly);
+    QJsonObject obj = QJsonDocument::fromJson(indexFile.readAll()).object();
+    indexFile.close();
+
+    index.clear();
+    QJsonObject entries = obj.value("entries").toObject();
+    for (QString entry : entries.keys()) {
+        index.insert(entry, entries.value(entry).toString());
+    }
+
+    usage.clear();
+    QJsonObject lastUsed = obj.value("lastUsed").toObject();
+    for (QString background : lastUsed.keys()) {
+        usage.insert(background, (qint64) lastUsed.value(background).toDouble());
+    }
+}
+
+void BackgroundPrefetcher::saveIndex() {
+    QJsonObject entries;
+    for (QString entry : index.keys()) {
+        entries.insert(entry, index.value(entry));
+    }
+
+    QJsonObject lastUsed;
+    for (QString background : usage.keys()) {
+        lastUsed.insert(background, (double) usage.value(background));
+    }
+
+    QJsonObject obj;
+    obj.insert("entries", entries);
+    obj.insert("lastUsed", lastUsed);
+
+    QSaveFile indexFile(QDir::homePath() + "/.theshell/backgrounds.index");
+    indexFile.open(QSaveFile::WriteOnly);
+    indexFile.write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+    indexFile.commit();
+}
+
+void BackgroundPrefetcher::writeKnownBackgrounds(QStringList backgrounds) {
+    QSaveFile backgroundListConf(QDir::homePath() + "/.theshell/backgrounds.conf");
+    backgroundListConf.open(QSaveFile::WriteOnly);
+    backgroundListConf.write(backgrounds.join("\n").append("\n").toUtf8());
+    backgroundListConf.commit();
+}
+
+void BackgroundPrefetcher::refresh() {
+    if (refreshing) return;
+    refreshing = true;
+
+    QNetworkReply* listOfBackgrounds = manager.get(request(serverUrl("/theshell/backgrounds/backgrounds.json")));
+    connect(listOfBackgrounds, &QNetworkReply::finished, [=] {
+        QJsonDocument doc = QJsonDocument::fromJson(listOfBackgrounds->readAll());
+        listOfBackgrounds->deleteLater();
+
+        if (!doc.isArray()) {
+            refreshing = false;
+            emit refreshed(false);
+            return;
+        }
+
+        QJsonArray arr = doc.array();
+        arr.removeFirst();
+
+        QStringList remote;
+        for (QJsonValue value : arr) {
+            remote.append(value.toString());
+        }
+
+        //Forget about backgrounds that are no longer published
+        QStringList known = knownBackgrounds();
+        for (QString entry : index.keys()) {
+            if (!remote.contains(entry)) {
+                QString background = index.take(entry);
+                known.removeAll(background);
+                usage.remove(background);
+                QDir(QDir::homePath() + "/.theshell/backgrounds/" + background).removeRecursively();
+            }
+        }
+        refreshBackgrounds = known;
+
+        //Pick a few new backgrounds to add to the rotation. Entries trimmed from the rotation stay in the index
+        //so they aren't picked again
+        QStringList newEntries;
+        for (QString entry : remote) {
+            if (!index.contains(entry)) newEntries.append(entry);
+        }
+
+        qsrand(QDateTime::currentMSecsSinceEpoch());
+        pendingMetadata = 0;
+        for (int i = 0; i < NEW_BACKGROUNDS_PER_REFRESH && !newEntries.isEmpty(); i++) {
+            Download download;
+            download.entry = newEntries.takeAt(qrand() % newEntries.count());
+            download.url = serverUrl(download.entry);
+            download.image = false;
+            enqueue(download);
+            pendingMetadata++;
+        }
+
+        finishRefreshIfDone();
+    });
+}
+
+void BackgroundPrefetcher::finishRefreshIfDone() {
+    if (pendingMetadata != 0) return;
+
+    dropUnindexed();
+    trimRotation();
+    saveIndex();
+    writeKnownBackgrounds(refreshBackgrounds);
+    refreshing = false;
+    emit refreshed(true);
+
+    prefetch();
+}
+
+void BackgroundPrefetcher::dropUnindexed() {
+    //Backgrounds left over from before the index existed can't be matched against the server's list, so they
+    //would never be pruned. Replace them once this refresh has picked new ones; their entries get picked again
+    //later and adopt the same directory
+    QStringList indexed = index.values();
+    for (QString background : QStringList(refreshBackgrounds)) {
+        if (indexed.contains(background) || activeDownloads.contains(background)) continue;
+
+        refreshBackgrounds.removeAll(background);
+        usage.remove(background);
+        QDir(QDir::homePath() + "/.theshell/backgrounds/" + background).removeRecursively();
+    }
+}
+
+void BackgroundPrefetcher::trimRotation() {
+    if (refreshBackgrounds.count() <= MAX_ROTATION) return;
+
+    //Each refresh adds a few backgrounds, so drop the ones shown least recently
+    QMap<QString, QDateTime> used;
+    for (QString background : refreshBackgrounds) {
+        used.insert(background, lastUsed(background));
+    }
+
+    QStringList rotation = refreshBackgrounds;
+    std::sort(rotation.begin(), rotation.end(), [=](QString first, QString second) {
+        return used.value(first) < used.value(second);
+    });
+
+    for (QString background : rotation) {
+        if (refreshBackgrounds.count() <= MAX_ROTATION) break;
+        if (activeDownloads.contains(background)) continue;
+
+        //Keep its index entries as tombstones so the next refresh doesn't download it again
+        refreshBackgrounds.removeAll(background);
+        usage.remove(background);
+        QDir(QDir::homePath() + "/.theshell/backgrounds/" + background).removeRecursively();
+    }
+}
+
+void BackgroundPrefetcher::prefetch() {
+    QStringList known = knownBackgrounds();
+    int available = readyBackgrounds().count() + activeDownloads.count();
+    for (Download download : queue) {
+        if (download.image) available++;
+    }
+
+    qsrand(QDateTime::currentMSecsSinceEpoch());
+    while (available < PREFETCH_AHEAD && !known.isEmpty()) {
+        QString background = known.takeAt(qrand() % known.count());
+        if (QFile::exists(imagePath(background)) || activeDownloads.contains(background)) continue;
+
+        QFile metadataFile(metadataPath(background));
+        metadataFile.open(QFile::ReadOnly);
+        QJsonObject metadata = QJsonDocument::fromJson(metadataFile.readAll()).object();
+        metadataFile.close();
+        if (!metadata.contains("filename")) continue;
+
+        QString fileName = metadata.value("filename").toString();
+        Download download;
+        download.background = background;
+        download.url = serverUrl(QString("/theshell/backgrounds/%1/%2").arg(background, fileName));
+        download.image = true;
+        enqueue(download);
+        available++;
+    }
+}
+
+void BackgroundPrefetcher::fetch(QString background) {
+    if (QFile::exists(imagePath(background))) {
+        QTimer::singleShot(0, [=] {
+            emit imageReady(background);
+        });
+        return;
+    }
+
+    QFile metadataFile(metadataPath(background));
+    metadataFile.open(QFile::ReadOnly);
+    QJsonObject metadata = QJsonDocument::fromJson(metadataFile.readAll()).object();
+    metadataFile.close();
+
+    if (!metadata.contains("filename")) {
+        QTimer::singleShot(0, [=] {
+            emit imageFailed(background);
+        });
+        return;
+    }
+
+    Download download;
+    download.background = background;
+    download.url = serverUrl(QString("/theshell/backgrounds/%1/%2").arg(background, metadata.value("filename").toString()));
+    download.image = true;
+    enqueue(download, true);
+}
+
+void BackgroundPrefetcher::enqueue(Download download, bool priority) {
+    if (download.image) {
+        if (activeDownloads.contains(download.background)) return;
+        for (int i = 0; i < queue.count(); i++) {
+            if (queue.at(i).image && queue.at(i).background == download.background) {
+                if (priority) queue.move(i, 0);
+                return;
+            }
+        }
+    }
+
+    if (priority) {
+        queue.prepend(download);
+    } else {
+        queue.enqueue(download);
+    }
+    startDownloads();
+}
+
+void BackgroundPrefetcher::startDownloads() {
+    while (runningDownloads < MAX_CONCURRENT_DOWNLOADS && !queue.isEmpty()) {
+        Download download = queue.dequeue();
+        runningDownloads++;
+        if (download.image) {
+            activeDownloads.insert(download.background);
+            downloadImage(download);
+        } else {
+            downloadMetadata(download);
+        }
+    }
+}
+
+void BackgroundPrefetcher::downloadMetadata(Download download) {
+    QNetworkReply* reply = manager.get(request(download.url));
+    connect(reply, &QNetworkReply::finished, [=] {
+        QByteArray data = reply->readAll();
+        QJsonDocument doc = QJsonDocument::fromJson(data);
+        if (reply->error() == QNetworkReply::NoError && doc.isObject()) {
+            QString fileName = doc.object().value("filename").toString();
+            QString dirName = fileName.left(fileName.indexOf("."));
+
+            if (dirName != "") {
+                QDir::home().mkpath(".theshell/backgrounds/" + dirName);
+                QSaveFile metadataFile(metadataPath(dirName));
+                metadataFile.open(QSaveFile::WriteOnly);
+                metadataFile.write(data);
+                if (metadataFile.commit()) {
+                    index.insert(download.entry, dirName);
+                    if (!refreshBackgrounds.contains(dirName)) refreshBackgrounds.append(dirName);
+                }
+            }
+        }
+        reply->deleteLater();
+
+        runningDownloads--;
+        pendingMetadata--;
+        finishRefreshIfDone();
+        startDownloads();
+    });
+}
+
+void BackgroundPrefetcher::downloadImage(Download download) {
+    //Partial downloads are kept next to the image so they can be resumed later
+    QFile* partFile = new QFile(imagePath(download.background) + ".part");
+    partFile->open(QFile::Append);
+    qint64 offset = partFile->size();
+
+    QNetworkRequest req = request(download.url);
+    if (offset > 0) {
+        req.setRawHeader("Range", QString("bytes=%1-").arg(offset).toLatin1());
+    }
+
+    QNetworkReply* reply = manager.get(req);
+    connect(reply, &QNetworkReply::readyRead, [=] {
+        if (!reply->property("statusChecked").toBool()) {
+            //The server ignored our range request; start the file again
+            if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206) partFile->resize(0);
+            reply->setProperty("statusChecked", true);
+        }
+        partFile->write(reply->readAll());
+    });
+    connect(reply, &QNetworkReply::finished, [=] {
+        if (reply->error() == QNetworkReply::NoError) {
+            if (!reply->property("statusChecked").toBool() && reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206) partFile->resize(0);
+            partFile->write(reply->readAll());
+        }
+        partFile->close();
+
+        runningDownloads--;
+        activeDownloads.remove(download.background);
+
+        bool success = false;
+        if (reply->error() == QNetworkReply::NoError) {
+            partFile->open(QFile::ReadOnly);
+            QCryptographicHash hash(QCryptographicHash::Sha256);
+            hash.addData(partFile);
+            partFile->close();
+            QByteArray checksum = hash.result().toHex();
+
+            QFile metadataFile(metadataPath(download.background));
+            metadataFile.open(QFile::ReadOnly);
+            QJsonObject metadata = QJsonDocument::fromJson(metadataFile.readAll()).object();
+            metadataFile.close();
+
+            //Not every background publishes a hash; without one, at least make sure the whole file arrived
+            //and is an image we can read
+            qint64 expectedSize = -1;
+            QByteArray contentRange = reply->rawHeader("Content-Range");
+            if (contentRange.contains('/')) {
+                expectedSize = contentRange.mid(contentRange.lastIndexOf('/') + 1).toLongLong();
+            } else if (reply->header(QNetworkRequest::ContentLengthHeader).isValid()) {
+                expectedSize = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+            }
+
+            QString expected = metadata.value("sha256").toString();
+            bool valid;
+            if (expected != "") {
+                valid = expected.toLatin1().toLower() == checksum;
+            } else {
+                valid = (expectedSize <= 0 || partFile->size() == expectedSize) && QImageReader(partFile->fileName()).canRead();
+            }
+
+            if (!valid) {
+                //Corrupt download; throw it away rather than resuming from it
+                partFile->remove();
+            } else {
+                QFile::remove(imagePath(download.background));
+                success = partFile->rename(imagePath(download.background));
+            }
+        } else if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 416) {
+            //Our partial file is bigger than the image; it can't be resumed
+            partFile->remove();
+        }
+
+        reply->deleteLater();
+        partFile->deleteLater();
+
+        if (success) {
+            evict();
+            emit imageReady(download.background);
+        } else {
+            emit imageFailed(download.background);
+        }
+        startDownloads();
+    });
+}
+
+void BackgroundPrefetcher::evict() {
+    qint64 budget = settings.value("desktop/communityCacheSize", 100).toLongLong() * 1024 * 1024;
+
+    QStringList images;
+    QMap<QString, QDateTime> used;
+    qint64 total = 0;
+    for (QString background : knownBackgrounds()) {
+        QFileInfo image(imagePath(background));
+        if (image.exists()) {
+            images.append(background);
+            used.insert(background, lastUsed(background));
+            total += image.size();
+        }
+    }
+
+    std::sort(images.begin(), images.end(), [=](QString first, QString second) {
+        return used.value(first) < used.value(second);
+    });
+
+    //Always keep the most recently used image
+    while (total > budget && images.count() > 1) {
+        QFileInfo image(imagePath(images.takeFirst()));
+        total -= image.size();
+        QFile::remove(image.filePath());
+    }
+}
@@ -0,0 +1,93 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#ifndef BACKGROUNDPREFETCHER_H
+#define BACKGROUNDPREFETCHER_H
+
+#include <QObject>
+#include <QQueue>
+#include <QSet>
+#include <QUrl>
+#include <QDateTime>
+#include <QSettings>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+
+class BackgroundPrefetcher : public QObject
+{
+        Q_OBJECT
+    public:
+        static BackgroundPrefetcher* instance();
+
+        QStringList knownBackgrounds();
+        QStringList readyBackgrounds();
+        QString imagePath(QString background);
+        QString metadataPath(QString background);
+        void markUsed(QString background);
+
+    signals:
+        void refreshed(bool success);
+        void imageReady(QString background);
+        void imageFailed(QString background);
+
+    public slots:
+        void refresh();
+        void prefetch();
+        void fetch(QString background);
+
+    private:
+        explicit BackgroundPrefetcher(QObject *parent = nullptr);
+
+        struct Download {
+            QString background;
+            QString entry;
+            QUrl url;
+            bool image;
+        };
+
+        QUrl serverUrl(QString path);
+        QNetworkRequest request(QUrl url);
+        void loadIndex();
+        void saveIndex();
+        void writeKnownBackgrounds(QStringList backgrounds);
+        void enqueue(Download download, bool priority = false);
+        void startDownloads();
+        void downloadMetadata(Download download);
+        void downloadImage(Download download);
+        void finishRefreshIfDone();
+        void dropUnindexed();
+        void trimRotation();
+        QDateTime lastUsed(QString background);
+        void evict();
+
+        QNetworkAccessManager manager;
+        QSettings settings;
+        QQueue<Download> queue;
+        QSet<QString> activeDownloads;
+        int runningDownloads = 0;
+
+        QMap<QString, QString> index;
+        QMap<QString, qint64> usage;
+        bool refreshing = false;
+        QStringList refreshBackgrounds;
+        int pendingMetadata = 0;
+};
+
+#endif // BACKGROUNDPREFETCHER_H
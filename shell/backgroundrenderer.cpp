@@ -0,0 +1,191 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#include "backgroundrenderer.h"
+
+#include <QFileInfo>
+#include <QDir>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QImageReader>
+#include <QSaveFile>
+#include <QPainter>
+#include <QSvgRenderer>
+#include <QDataStream>
+#include <QtConcurrent>
+#include <utime.h>
+
+#define DISK_CACHE_BYTES (96 * 1024 * 1024)
+
+//Decoded source images shared between screens so each file is only decoded once
+static QMutex sourceMutex;
+static QString decodedSourceKey;
+static QImage decodedSource;
+
+BackgroundRenderer* BackgroundRenderer::instance() {
+    static BackgroundRenderer* renderer = new BackgroundRenderer();
+    return renderer;
+}
+
+BackgroundRenderer::BackgroundRenderer(QObject *parent) : QObject(parent)
+{
+    //Cost is measured in bytes; enough for a handful of 4K screens
+    scaledCache.setMaxCost(192 * 1024 * 1024);
+}
+
+QString BackgroundRenderer::cacheKey(QString source, QSize size, int style) {
+    qint64 modified = 0;
+    if (!source.startsWith(":")) modified = QFileInfo(source).lastModified().toMSecsSinceEpoch();
+    return QString("%1|%2|%3x%4|%5").arg(source).arg(modified).arg(size.width()).arg(size.height()).arg(style);
+}
+
+QString BackgroundRenderer::diskCachePath(QString key) {
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/backgrounds";
+    return dir + "/" + QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex() + ".bg";
+}
+
+QImage BackgroundRenderer::cached(QString source, QSize size, int style) {
+    QImage* image = scaledCache.object(cacheKey(source, size, style));
+    if (image == nullptr) return QImage();
+    return *image;
+}
+
+quint64 BackgroundRenderer::render(QString source, QSize size, int style) {
+    quint64 request = nextRequest++;
+    QString key = cacheKey(source, size, style);
+
+    QFutureWatcher<QImage>* watcher = new QFutureWatcher<QImage>(this);
+    connect(watcher, &QFutureWatcher<QImage>::finished, [=] {
+        QImage image = watcher->result();
+        if (!image.isNull()) {
+            scaledCache.insert(key, new QImage(image), image.byteCount());
+        }
+        emit rendered(request, image);
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run(&BackgroundRenderer::renderJob, source, key, size, style));
+    return request;
+}
+
+QImage BackgroundRenderer::renderJob(QString source, QString key, QSize size, int style) {
+    QImage image = readDiskCache(key);
+    if (!image.isNull()) return image;
+
+    image = QImage(size, QImage::Format_RGB32);
+    image.fill(Qt::black);
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    if (source.endsWith(".svg") || source.startsWith(":/backgrounds/")) {
+        //Vector backgrounds are rendered straight at the screen size
+        QSvgRenderer renderer(source);
+        renderer.render(&painter, image.rect());
+    } else {
+        QImage sourceImage = decodeSource(source);
+        if (sourceImage.isNull()) return QImage();
+
+        switch (style) {
+            case Stretch:
+                painter.drawImage(image.rect(), sourceImage.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+                break;
+            case ZoomCrop:
+            case ZoomFit: {
+                QRect rect;
+                rect.setSize(sourceImage.size().scaled(size, style == ZoomCrop ? Qt::KeepAspectRatioByExpanding : Qt::KeepAspectRatio));
+                rect.moveLeft(size.width() / 2 - rect.width() / 2);
+                rect.moveTop(size.height() / 2 - rect.height() / 2);
+                painter.drawImage(rect, sourceImage.scaled(rect.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+                break;
+            }
+            case Center: {
+                QRect rect;
+                rect.setSize(sourceImage.size());
+                rect.moveLeft(size.width() / 2 - rect.width() / 2);
+                rect.moveTop(size.height() / 2 - rect.height() / 2);
+                painter.drawImage(rect, sourceImage);
+                break;
+            }
+            case Tile:
+                painter.fillRect(image.rect(), QBrush(sourceImage));
+                break;
+        }
+    }
+    painter.end();
+
+    writeDiskCache(key, image);
+    return image;
+}
+
+QImage BackgroundRenderer::decodeSource(QString source) {
+    QString key = source + "|" + QString::number(QFileInfo(source).lastModified().toMSecsSinceEpoch());
+
+    QMutexLocker locker(&sourceMutex);
+    if (decodedSourceKey != key) {
+        QImageReader reader(source);
+        reader.setAutoTransform(true);
+        decodedSource = reader.read();
+        decodedSourceKey = key;
+    }
+    return decodedSource;
+}
+
+QImage BackgroundRenderer::readDiskCache(QString key) {
+    QFile file(diskCachePath(key));
+    if (!file.open(QFile::ReadOnly)) return QImage();
+
+    //Stored raw so that showing the desktop at login needs no decoding at all
+    QDataStream stream(&file);
+    QString storedKey;
+    qint32 width, height, bytesPerLine;
+    stream >> storedKey >> width >> height >> bytesPerLine;
+    if (storedKey != key || width <= 0 || height <= 0) return QImage();
+
+    QImage image(width, height, QImage::Format_RGB32);
+    if (image.bytesPerLine() != bytesPerLine) return QImage();
+    if (stream.readRawData((char*) image.bits(), image.byteCount()) != image.byteCount()) return QImage();
+
+    //Touch the file so eviction keeps recently used entries
+    file.close();
+    utime(QFile::encodeName(file.fileName()).constData(), nullptr);
+    return image;
+}
+
+void BackgroundRenderer::writeDiskCache(QString key, QImage image) {
+    QDir dir(QFileInfo(diskCachePath(key)).path());
+    dir.mkpath(".");
+
+    QSaveFile file(diskCachePath(key));
+    if (!file.open(QSaveFile::WriteOnly)) return;
+
+    QDataStream stream(&file);
+    stream << key << (qint32) image.width() << (qint32) image.height() << (qint32) image.bytesPerLine();
+    stream.writeRawData((const char*) image.constBits(), image.byteCount());
+    file.commit();
+
+    //Raw frames are large at high resolutions, so bound the cache by size rather than by count; always keep the newest
+    QFileInfoList entries = dir.entryInfoList(QStringList() << "*.bg", QDir::Files, QDir::Time);
+    qint64 total = 0;
+    for (int i = 0; i < entries.count(); i++) {
+        total += entries.at(i).size();
+        if (i > 0 && total > DISK_CACHE_BYTES) {
+            QFile::remove(entries.at(i).filePath());
+        }
+    }
+}
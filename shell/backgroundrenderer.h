@@ -0,0 +1,64 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#ifndef BACKGROUNDRENDERER_H
+#define BACKGROUNDRENDERER_H
+
+#include <QObject>
+#include <QImage>
+#include <QCache>
+#include <QMutex>
+#include <QFutureWatcher>
+
+class BackgroundRenderer : public QObject
+{
+        Q_OBJECT
+    public:
+        static BackgroundRenderer* instance();
+
+        enum StretchStyle {
+            Stretch = 0,
+            ZoomCrop = 1,
+            Center = 2,
+            Tile = 3,
+            ZoomFit = 4
+        };
+
+        QImage cached(QString source, QSize size, int style);
+        quint64 render(QString source, QSize size, int style);
+
+    signals:
+        void rendered(quint64 request, QImage image);
+
+    private:
+        explicit BackgroundRenderer(QObject *parent = nullptr);
+
+        static QString cacheKey(QString source, QSize size, int style);
+        static QString diskCachePath(QString key);
+        static QImage renderJob(QString source, QString key, QSize size, int style);
+        static QImage decodeSource(QString source);
+        static QImage readDiskCache(QString key);
+        static void writeDiskCache(QString key, QImage image);
+
+        QCache<QString, QImage> scaledCache;
+        quint64 nextRequest = 1;
+};
+
+#endif // BACKGROUNDRENDERER_H
@@ -0,0 +1,243 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#include "batteryhistory.h"
+#include "upowerdbus.h"
+
+#include <QFile>
+#include <QDebug>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QDir>
+#include <QDataStream>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusArgument>
+#include <algorithm>
+#include <math.h>
+
+extern UPowerDBus* updbus;
+
+#define HISTORY_MAGIC "TSBH"
+#define HISTORY_VERSION 1
+#define HISTORY_HEADER_SIZE 5
+#define HISTORY_RECORD_SIZE 9
+
+BatteryHistory* BatteryHistory::instance() {
+    static BatteryHistory* history = new BatteryHistory();
+    return history;
+}
+
+BatteryHistory::BatteryHistory(QObject *parent) : QObject(parent)
+{
+    QDir::root().mkpath(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+    load(Charge);
+    load(Rate);
+
+    //UPower only keeps a few days, so keep topping up our own copy even while nobody is looking at it
+    syncTimer = new QTimer(this);
+    syncTimer->setInterval(600000);
+    connect(syncTimer, &QTimer::timeout, this, static_cast<void (BatteryHistory::*)()>(&BatteryHistory::refresh));
+    syncTimer->start();
+}
+
+QString BatteryHistory::fileName(Kind kind) {
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + (kind == Charge ? "/battery-charge.history" : "/battery-rate.history");
+}
+
+QVector<BatteryHistory::Sample> BatteryHistory::samples(Kind kind) {
+    return history[kind];
+}
+
+void BatteryHistory::load(Kind kind) {
+    QFile file(fileName(kind));
+    if (!file.open(QFile::ReadOnly)) return;
+
+    QDataStream stream(&file);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    quint8 version = 0;
+    QByteArray magic = file.read(4);
+    stream >> version;
+    if (magic != HISTORY_MAGIC || version != HISTORY_VERSION) {
+        qWarning() << "Discarding unreadable battery history" << file.fileName();
+        file.close();
+        save(kind);
+        return;
+    }
+
+    QSettings settings;
+    quint32 cutoff = QDateTime::currentSecsSinceEpoch() - settings.value("power/batteryHistoryDays", 90).toInt() * 86400;
+
+    qint64 records = (file.size() - HISTORY_HEADER_SIZE) / HISTORY_RECORD_SIZE;
+    bool pruned = (file.size() - HISTORY_HEADER_SIZE) % HISTORY_RECORD_SIZE != 0;
+    history[kind].reserve(records);
+    for (qint64 i = 0; i < records; i++) {
+        Sample sample;
+        stream >> sample.time >> sample.value >> sample.state;
+        if (sample.time < cutoff) {
+            pruned = true;
+        } else {
+            history[kind].append(sample);
+        }
+    }
+    file.close();
+
+    //Rewrite the file without expired samples or a record torn by a crash
+    if (pruned) save(kind);
+}
+
+void BatteryHistory::save(Kind kind) {
+    QSaveFile file(fileName(kind));
+    if (!file.open(QFile::WriteOnly)) return;
+
+    QDataStream stream(&file);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    file.write(HISTORY_MAGIC, 4);
+    stream << (quint8) HISTORY_VERSION;
+    for (Sample sample : history[kind]) {
+        stream << sample.time << sample.value << sample.state;
+    }
+    file.commit();
+}
+
+void BatteryHistory::append(Kind kind, QVector<Sample> newSamples) {
+    std::sort(newSamples.begin(), newSamples.end(), [](const Sample& first, const Sample& second) {
+        return first.time < second.time;
+    });
+
+    //UPower hands back everything in the timespan we asked for, including samples we already have
+    quint32 lastTime = history[kind].isEmpty() ? 0 : history[kind].last().time;
+    auto firstNew = std::upper_bound(newSamples.begin(), newSamples.end(), lastTime, [](quint32 time, const Sample& sample) {
+        return time < sample.time;
+    });
+    if (firstNew == newSamples.end()) return;
+
+    QFile file(fileName(kind));
+    bool writeHeader = !file.exists() || file.size() == 0;
+    if (file.open(QFile::Append)) {
+        QDataStream stream(&file);
+        stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+        if (writeHeader) {
+            file.write(HISTORY_MAGIC, 4);
+            stream << (quint8) HISTORY_VERSION;
+        }
+
+        for (auto i = firstNew; i != newSamples.end(); i++) {
+            stream << i->time << i->value << i->state;
+        }
+    }
+
+    for (auto i = firstNew; i != newSamples.end(); i++) {
+        history[kind].append(*i);
+    }
+    emit historyChanged(kind);
+}
+
+void BatteryHistory::refresh() {
+    fetch(Charge);
+    fetch(Rate);
+}
+
+void BatteryHistory::fetch(Kind kind) {
+    if (refreshing[kind] || updbus == NULL || updbus->defaultBattery().path().isEmpty()) return;
+    refreshing[kind] = true;
+
+    //Only ask for what has happened since the last sample we kept
+    uint timespan = 0;
+    if (!history[kind].isEmpty()) {
+        timespan = qMax<qint64>(60, QDateTime::currentSecsSinceEpoch() - history[kind].last().time + 60);
+    }
+
+    QDBusMessage message = QDBusMessage::createMethodCall("org.freedesktop.UPower", updbus->defaultBattery().path(), "org.freedesktop.UPower.Device", "GetHistory");
+    message.setArguments(QVariantList() << QString(kind == Charge ? "charge" : "rate") << timespan << (uint) 10000);
+
+    QDBusPendingCallWatcher* watcher = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(message), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [=] {
+        watcher->deleteLater();
+        refreshing[kind] = false;
+        if (watcher->isError()) return;
+
+        QVector<Sample> samples;
+        QDBusArgument arrayArgument = watcher->reply().arguments().value(0).value<QDBusArgument>();
+        arrayArgument.beginArray();
+        while (!arrayArgument.atEnd()) {
+            uint time, state;
+            double value;
+            arrayArgument.beginStructure();
+            arrayArgument >> time >> value >> state;
+            arrayArgument.endStructure();
+
+            Sample sample;
+            sample.time = time;
+            sample.value = value;
+            sample.state = state;
+            samples.append(sample);
+        }
+        arrayArgument.endArray();
+
+        append(kind, samples);
+    });
+}
+
+QVector<QPointF> BatteryHistory::downsample(const QVector<QPointF>& points, int threshold) {
+    if (threshold < 3 || points.count() <= threshold) return points;
+
+    //Largest-Triangle-Three-Buckets: from each bucket keep the point forming the largest triangle
+    //with the point kept before it and the average of the following bucket
+    QVector<QPointF> sampled;
+    sampled.reserve(threshold);
+    sampled.append(points.first());
+
+    double bucketSize = (double) (points.count() - 2) / (threshold - 2);
+    QPointF previous = points.first();
+    for (int bucket = 0; bucket < threshold - 2; bucket++) {
+        int nextStart = (int) ((bucket + 1) * bucketSize) + 1;
+        int nextEnd = qMin((int) ((bucket + 2) * bucketSize) + 1, points.count());
+
+        QPointF average;
+        for (int i = nextStart; i < nextEnd; i++) {
+            average += points.at(i);
+        }
+        if (nextEnd > nextStart) average /= nextEnd - nextStart;
+
+        int start = (int) (bucket * bucketSize) + 1;
+        int end = (int) ((bucket + 1) * bucketSize) + 1;
+        double largestArea = -1;
+        QPointF chosen = points.at(start);
+        for (int i = start; i < end; i++) {
+            QPointF point = points.at(i);
+            double area = fabs((previous.x() - average.x()) * (point.y() - previous.y()) - (previous.x() - point.x()) * (average.y() - previous.y()));
+            if (area > largestArea) {
+                largestArea = area;
+                chosen = point;
+            }
+        }
+
+        sampled.append(chosen);
+        previous = chosen;
+    }
+
+    sampled.append(points.last());
+    return sampled;
+}
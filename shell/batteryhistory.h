@@ -0,0 +1,69 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#ifndef BATTERYHISTORY_H
+#define BATTERYHISTORY_H
+
+#include <QObject>
+#include <QVector>
+#include <QPointF>
+#include <QTimer>
+
+class BatteryHistory : public QObject
+{
+        Q_OBJECT
+    public:
+        enum Kind {
+            Charge = 0,
+            Rate = 1
+        };
+
+        struct Sample {
+            quint32 time;
+            float value;
+            quint8 state;
+        };
+
+        static BatteryHistory* instance();
+
+        QVector<Sample> samples(Kind kind);
+        static QVector<QPointF> downsample(const QVector<QPointF>& points, int threshold);
+
+    signals:
+        void historyChanged(BatteryHistory::Kind kind);
+
+    public slots:
+        void refresh();
+
+    private:
+        explicit BatteryHistory(QObject *parent = nullptr);
+
+        void fetch(Kind kind);
+        void load(Kind kind);
+        void save(Kind kind);
+        void append(Kind kind, QVector<Sample> newSamples);
+        QString fileName(Kind kind);
+
+        QVector<Sample> history[2];
+        bool refreshing[2] = {false, false};
+        QTimer* syncTimer;
+};
+
+#endif // BATTERYHISTORY_H
@@ -19,6 +19,9 @@
  * *************************************/
 
 #include "bthandsfree.h"
+#include "audiomanager.h"
+
+extern AudioManager* AudioMan;
 
 BTHandsfree::BTHandsfree(QWidget *parent) : QWidget(parent)
 {
@@ -40,94 +43,210 @@ BTHandsfree::BTHandsfree(QWidget *parent) : QWidget(parent)
     hangupButton->setIcon(QIcon::fromTheme("call-stop"));
     hangupButton->setVisible(false);
     connect(hangupButton, &QPushButton::clicked, [=]() {
-        hangUpButtonInterface->call("HangUp");
+        if (callDevice == "") return;
+        QDBusMessage hangUp = QDBusMessage::createMethodCall("org.thesuite.tsbt", "/org/thesuite/tsbt/handsfree/" + callDevice, "org.thesuite.tsbt.Handsfree", "HangUp");
+        QDBusConnection::sessionBus().asyncCall(hangUp);
     });
     layout->addWidget(hangupButton);
 
     this->setVisible(false);
 
-    QTimer* detector = new QTimer;
-    detector->setInterval(1000);
-    connect(detector, SIGNAL(timeout()), this, SLOT(detectDevices()));
-    detector->start();
+    //tsbt announces its own changes with custom signals (BluetoothEnabledChanged and friends), so listen
+    //to everything on its interfaces and fetch again when anything is said, rather than polling
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    bus.connect("org.thesuite.tsbt", "/org/thesuite/tsbt", "org.thesuite.tsbt", "", this, SLOT(reload()));
+    bus.connect("org.thesuite.tsbt", "", "org.thesuite.tsbt.Handsfree", "", this, SLOT(handsfreeSignal(QDBusMessage)));
+
+    //Pick up the standard object manager and property signals too, in case tsbt sends them
+    bus.connect("org.thesuite.tsbt", "/org/thesuite/tsbt", "org.freedesktop.DBus.ObjectManager", "InterfacesAdded", this, SLOT(interfacesAdded(QDBusMessage)));
+    bus.connect("org.thesuite.tsbt", "/org/thesuite/tsbt", "org.freedesktop.DBus.ObjectManager", "InterfacesRemoved", this, SLOT(interfacesRemoved(QDBusMessage)));
+    bus.connect("org.thesuite.tsbt", "", "org.freedesktop.DBus.Properties", "PropertiesChanged", this, SLOT(propertiesChanged(QDBusMessage)));
+
+    watcher = new QDBusServiceWatcher("org.thesuite.tsbt", bus, QDBusServiceWatcher::WatchForOwnerChange, this);
+    connect(watcher, SIGNAL(serviceRegistered(QString)), this, SLOT(reload()));
+    connect(watcher, &QDBusServiceWatcher::serviceUnregistered, [=] {
+        knownDevices.clear();
+        deviceProperties.clear();
+        updateState();
+    });
+
+    reload();
 }
 
-void BTHandsfree::detectDevices() {
-    if (QDBusConnection::sessionBus().interface()->registeredServiceNames().value().contains("org.thesuite.tsbt")) {
-        QStringList labelContent;
-        QString labelOverride;
+void BTHandsfree::reload() {
+    QDBusMessage getDevices = QDBusMessage::createMethodCall("org.thesuite.tsbt", "/org/thesuite/tsbt", "org.thesuite.tsbt", "handsfreeDevices");
+    QDBusPendingCallWatcher* callWatcher = new QDBusPendingCallWatcher(QDBusConnection::sessionBus().asyncCall(getDevices), this);
+    connect(callWatcher, &QDBusPendingCallWatcher::finished, [=] {
+        callWatcher->deleteLater();
 
-        QEventLoop loop;
-        QDBusMessage getDevices = QDBusMessage::createMethodCall("org.thesuite.tsbt", "/org/thesuite/tsbt", "org.thesuite.tsbt", "handsfreeDevices");
-        QDBusPendingReply<QStringList> reply = QDBusConnection::sessionBus().asyncCall(getDevices);
-        while (!reply.isFinished()) {
-            QApplication::processEvents();
+        QDBusPendingReply<QStringList> reply = *callWatcher;
+        QStringList devices;
+        if (!reply.isError()) devices = reply.value();
+
+        for (QString device : QStringList(knownDevices)) {
+            if (!devices.contains(device)) removeDevice(device);
         }
 
-        if (reply.isValid()) {
-            for (QString device : knownDevices) {
-                if (!reply.value().contains(device)) {
-                    interfaces.at(knownDevices.indexOf(device))->deleteLater();
-                    interfaces.removeAt(knownDevices.indexOf(device));
-                    knownDevices.removeAll(device);
-                }
+        for (QString device : devices) {
+            if (!knownDevices.contains(device)) {
+                knownDevices.append(device);
+                loadDevice(device);
             }
+        }
 
-            for (QString device : reply.value()) {
-                if (!knownDevices.contains(device)) {
-                    knownDevices.append(device);
+        updateState();
+    });
+}
 
-                    QDBusInterface* interface = new QDBusInterface("org.thesuite.tsbt", "/org/thesuite/tsbt/handsfree/" + device, "org.thesuite.tsbt.Handsfree");
-                    interfaces.append(interface);
-                }
-            }
+void BTHandsfree::loadDevice(QString device) {
+    QDBusMessage getAll = QDBusMessage::createMethodCall("org.thesuite.tsbt", "/org/thesuite/tsbt/handsfree/" + device, "org.freedesktop.DBus.Properties", "GetAll");
+    getAll.setArguments(QVariantList() << "org.thesuite.tsbt.Handsfree");
+    QDBusPendingCallWatcher* callWatcher = new QDBusPendingCallWatcher(QDBusConnection::sessionBus().asyncCall(getAll), this);
+    connect(callWatcher, &QDBusPendingCallWatcher::finished, [=] {
+        callWatcher->deleteLater();
+        if (!knownDevices.contains(device)) return; //Went away while we were asking
 
-            for (QDBusInterface* interface : interfaces) {
-                QString callState = interface->property("CallState").toString();
-                if (callState == "InCall") {
-                    labelOverride = interface->property("DeviceName").toString();
-                    labelOverride.append(" (" + tr("In call") + ")");
-                    hangUpButtonInterface = interface;
-                } else if (callState == "Dialling") {
-                    labelOverride = interface->property("DeviceName").toString();
-                    labelOverride.append(" (" + tr("Dialling...") + ")");
-                    hangUpButtonInterface = interface;
-                } else {
-                    QString description;
-                    description.append(interface->property("OperatorName").toString());
-                    description.append(" (");
-                    description.append(interface->property("DeviceName").toString());
-                    description.append(")");
-                    labelContent.append(description);
-                }
-            }
+        QDBusPendingReply<QVariantMap> reply = *callWatcher;
+        if (reply.isError()) return;
 
-            if (knownDevices.count() == 0) {
-                this->setVisible(false);
-            } else {
-                if (labelOverride == "") {
-                    this->infoLabel->setText(labelContent.join(" · "));
-                    hangupButton->setVisible(false);
-                } else {
-                    this->infoLabel->setText(labelOverride);
-                    hangupButton->setVisible(true);
-                }
-                this->setVisible(true);
-            }
-        }
+        deviceProperties.insert(device, reply.value());
+        updateState();
+    });
+}
+
+void BTHandsfree::removeDevice(QString device) {
+    knownDevices.removeAll(device);
+    deviceProperties.remove(device);
+}
+
+void BTHandsfree::handsfreeSignal(QDBusMessage message) {
+    if (!message.path().startsWith("/org/thesuite/tsbt/handsfree/")) return;
+
+    //Whatever changed (call state, operator, signal), fetch the device's properties again
+    QString device = message.path().section('/', -1);
+    if (knownDevices.contains(device)) {
+        loadDevice(device);
     } else {
+        reload();
+    }
+}
+
+void BTHandsfree::interfacesAdded(QDBusMessage message) {
+    if (message.arguments().count() < 2) return;
+
+    QString path = message.arguments().at(0).value<QDBusObjectPath>().path();
+    QMap<QString, QVariantMap> interfaces;
+    message.arguments().at(1).value<QDBusArgument>() >> interfaces;
+
+    if (!path.startsWith("/org/thesuite/tsbt/handsfree/") || !interfaces.contains("org.thesuite.tsbt.Handsfree")) return;
+
+    QString device = path.section('/', -1);
+    if (!knownDevices.contains(device)) knownDevices.append(device);
+    deviceProperties.insert(device, interfaces.value("org.thesuite.tsbt.Handsfree"));
+    updateState();
+}
+
+void BTHandsfree::interfacesRemoved(QDBusMessage message) {
+    if (message.arguments().count() < 2) return;
+
+    QString path = message.arguments().at(0).value<QDBusObjectPath>().path();
+    QStringList interfaces = message.arguments().at(1).toStringList();
+
+    if (!path.startsWith("/org/thesuite/tsbt/handsfree/") || !interfaces.contains("org.thesuite.tsbt.Handsfree")) return;
+
+    removeDevice(path.section('/', -1));
+    updateState();
+}
+
+void BTHandsfree::propertiesChanged(QDBusMessage message) {
+    if (message.arguments().count() < 3 || message.arguments().at(0).toString() != "org.thesuite.tsbt.Handsfree") return;
+
+    QString device = message.path().section('/', -1);
+    if (!deviceProperties.contains(device)) return;
+
+    QVariantMap changed;
+    message.arguments().at(1).value<QDBusArgument>() >> changed;
+    QVariantMap& properties = deviceProperties[device];
+    for (QString property : changed.keys()) {
+        properties.insert(property, changed.value(property));
+    }
+
+    //Invalidated properties come without values, so fetch the device again
+    if (!message.arguments().at(2).toStringList().isEmpty()) {
+        loadDevice(device);
+    }
+
+    updateState();
+}
+
+void BTHandsfree::updateState() {
+    QStringList labelContent;
+    QString labelOverride;
+    callDevice = "";
+
+    //Devices whose properties haven't arrived yet aren't shown
+    QStringList loadedDevices;
+    for (QString device : knownDevices) {
+        if (!deviceProperties.contains(device)) continue;
+        loadedDevices.append(device);
+
+        QVariantMap properties = deviceProperties.value(device);
+        QString callState = properties.value("CallState").toString();
+        if (callState == "InCall") {
+            labelOverride = properties.value("DeviceName").toString();
+            labelOverride.append(" (" + tr("In call") + ")");
+            callDevice = device;
+        } else if (callState == "Dialling") {
+            labelOverride = properties.value("DeviceName").toString();
+            labelOverride.append(" (" + tr("Dialling...") + ")");
+            callDevice = device;
+        } else {
+            QString description;
+            description.append(properties.value("OperatorName").toString());
+            description.append(" (");
+            description.append(properties.value("DeviceName").toString());
+            description.append(")");
+            labelContent.append(description);
+        }
+    }
+
+    bool callActive = callDevice != "";
+    if (loadedDevices.count() == 0) {
         this->setVisible(false);
+    } else {
+        if (labelOverride == "") {
+            this->infoLabel->setText(labelContent.join(" · "));
+            hangupButton->setVisible(false);
+        } else {
+            this->infoLabel->setText(labelOverride);
+            hangupButton->setVisible(true);
+        }
+        this->setVisible(true);
+    }
+
+    //Keep other audio out of the way for as long as a call is dialling or connected
+    if (callActive != ducking) {
+        ducking = callActive;
+        if (ducking) {
+            AudioMan->duck(AudioManager::duckCall);
+        } else {
+            AudioMan->unduck(AudioManager::duckCall, true);
+        }
     }
 }
 
 QList<QString> BTHandsfree::getDevices() {
     QStringList retval;
-    for (QDBusInterface* device : interfaces) {
-        retval.append(device->property("DeviceName").toString());
+    for (QString device : knownDevices) {
+        retval.append(deviceProperties.value(device).value("DeviceName").toString());
     }
     return retval;
 }
 
 void BTHandsfree::placeCall(int deviceIndex, QString number) {
-    interfaces.at(deviceIndex)->call(QDBus::NoBlock, "PlaceCall", number);
+    if (deviceIndex < 0 || deviceIndex >= knownDevices.count()) return;
+
+    QDBusMessage call = QDBusMessage::createMethodCall("org.thesuite.tsbt", "/org/thesuite/tsbt/handsfree/" + knownDevices.at(deviceIndex), "org.thesuite.tsbt.Handsfree", "PlaceCall");
+    call.setArguments(QVariantList() << number);
+    QDBusConnection::sessionBus().asyncCall(call);
 }
@@ -27,11 +27,13 @@
 #include <QFrame>
 #include <QLabel>
 #include <QPushButton>
-#include <QTimer>
-#include <QApplication>
-#include <QDBusInterface>
 #include <QDBusConnection>
-#include <QDBusConnectionInterface>
+#include <QDBusMessage>
+#include <QDBusServiceWatcher>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDBusArgument>
+#include <QDBusObjectPath>
 
 class BTHandsfree : public QWidget
 {
@@ -42,17 +44,29 @@ public:
 signals:
 
 public slots:
-    void detectDevices();
+    void reload();
     QList<QString> getDevices();
     void placeCall(int deviceIndex, QString number);
 
+private slots:
+    void handsfreeSignal(QDBusMessage message);
+    void interfacesAdded(QDBusMessage message);
+    void interfacesRemoved(QDBusMessage message);
+    void propertiesChanged(QDBusMessage message);
+
 private:
+    void loadDevice(QString device);
+    void removeDevice(QString device);
+    void updateState();
+
     QBoxLayout* layout;
     QLabel* infoLabel;
     QPushButton* hangupButton;
-    QList<QDBusInterface*> interfaces;
-    QDBusInterface* hangUpButtonInterface;
+    QDBusServiceWatcher* watcher;
     QStringList knownDevices;
+    QMap<QString, QVariantMap> deviceProperties;
+    QString callDevice;
+    bool ducking = false;
 };
 
 #endif // BTHANDSFREE_H
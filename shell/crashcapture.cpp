@@ -0,0 +1,313 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+
+#define UNW_LOCAL_ONLY
+
+#include "crashcapture.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QMap>
+#include <QDateTime>
+#include <libunwind.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <elf.h>
+
+#define CRASHCAPTURE_MAX_FRAMES 128
+
+namespace {
+    struct RawHeader {
+        char magic[4];
+        quint32 signal;
+        quint32 frames;
+        qint64 time;
+    };
+
+    const char rawMagic[4] = {'T', 'S', 'C', '1'};
+    char reportFile[PATH_MAX];
+    char alternateStack[64 * 1024];
+
+    int unwind(quint64* pcs, int max) {
+        unw_context_t ctx;
+        unw_cursor_t cur;
+        int count = 0;
+
+        unw_getcontext(&ctx);
+        if (unw_init_local(&cur, &ctx) != 0) return 0;
+
+        while (count < max && unw_step(&cur) > 0) {
+            unw_word_t pc;
+            unw_get_reg(&cur, UNW_REG_IP, &pc);
+            if (pc == 0) break;
+            pcs[count++] = pc;
+        }
+        return count;
+    }
+
+    void writeAll(int fd, const void* data, size_t length) {
+        const char* bytes = (const char*) data;
+        while (length > 0) {
+            ssize_t written = write(fd, bytes, length);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return;
+            }
+            bytes += written;
+            length -= written;
+        }
+    }
+
+    void handleSignal(int sig) {
+        //Nothing in here may allocate or take locks; the heap could be what broke
+        quint64 pcs[CRASHCAPTURE_MAX_FRAMES];
+        int count = unwind(pcs, CRASHCAPTURE_MAX_FRAMES);
+
+        int fd = open(reportFile, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd >= 0) {
+            RawHeader header;
+            memset(&header, 0, sizeof(header));
+            memcpy(header.magic, rawMagic, sizeof(rawMagic));
+            header.signal = sig;
+            header.frames = count;
+            header.time = time(nullptr);
+            writeAll(fd, &header, sizeof(header));
+            writeAll(fd, pcs, count * sizeof(quint64));
+
+            //The memory map lets the frames be matched to modules later on
+            int maps = open("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+            if (maps >= 0) {
+                char buffer[4096];
+                ssize_t length;
+                while ((length = read(maps, buffer, sizeof(buffer))) > 0) {
+                    writeAll(fd, buffer, length);
+                }
+                close(maps);
+            }
+            close(fd);
+        }
+
+        //SA_RESETHAND has put the default action back, so this brings the process down as usual
+        raise(sig);
+    }
+
+    QString signalDescription(int sig) {
+        switch (sig) {
+            case SIGSEGV:
+                return "Signal Received: SIGSEGV (Segmentation Fault)";
+            case SIGBUS:
+                return "Signal Received: SIGBUS (Bus Error)";
+            case SIGABRT:
+                return "Signal Received: SIGABRT (Aborted)";
+            case SIGILL:
+                return "Signal Received: SIGILL (Illegal Instruction)";
+            case SIGFPE:
+                return "Signal Received: SIGFPE (Floating Point Exception)";
+            default:
+                return "Backtrace";
+        }
+    }
+
+    bool isPositionIndependent(QString module) {
+        //Executables that aren't PIE are symbolized by absolute address rather than file offset
+        QFile file(module);
+        if (!file.open(QFile::ReadOnly)) return true;
+
+        QByteArray header = file.read(sizeof(Elf64_Ehdr));
+        if (header.length() < EI_NIDENT + 2 || !header.startsWith(ELFMAG)) return true;
+        return ((const Elf64_Ehdr*) header.constData())->e_type != ET_EXEC;
+    }
+}
+
+void CrashCapture::install(QString reportPath) {
+    qstrncpy(reportFile, QFile::encodeName(reportPath).constData(), sizeof(reportFile));
+
+    //libunwind sets itself up lazily; get that out of the way while it's still safe to allocate
+    quint64 pcs[4];
+    unwind(pcs, 4);
+
+    //Run the handler on its own stack so that a stack overflow can still be reported
+    stack_t stack;
+    stack.ss_sp = alternateStack;
+    stack.ss_size = sizeof(alternateStack);
+    stack.ss_flags = 0;
+    sigaltstack(&stack, nullptr);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handleSignal;
+    action.sa_flags = SA_ONSTACK | SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+
+    for (int sig : {SIGSEGV, SIGBUS, SIGABRT, SIGILL, SIGFPE}) {
+        sigaction(sig, &action, nullptr);
+    }
+}
+
+CrashCapture::Report CrashCapture::capture() {
+    quint64 pcs[CRASHCAPTURE_MAX_FRAMES];
+    int count = unwind(pcs, CRASHCAPTURE_MAX_FRAMES);
+
+    Report report;
+    report.valid = true;
+    report.time = QDateTime::currentMSecsSinceEpoch() / 1000;
+    for (int i = 0; i < count; i++) {
+        report.pcs.append(pcs[i]);
+    }
+
+    QFile maps("/proc/self/maps");
+    if (maps.open(QFile::ReadOnly)) {
+        report.maps = maps.readAll();
+    }
+    return report;
+}
+
+CrashCapture::Report CrashCapture::load(QString reportPath) {
+    Report report;
+
+    QFile file(reportPath);
+    if (!file.open(QFile::ReadOnly)) return report;
+    QByteArray data = file.readAll();
+
+    RawHeader header;
+    if ((uint) data.length() < sizeof(header)) return report;
+    memcpy(&header, data.constData(), sizeof(header));
+    if (memcmp(header.magic, rawMagic, sizeof(rawMagic)) != 0 || header.frames > CRASHCAPTURE_MAX_FRAMES) return report;
+
+    uint pcsLength = header.frames * sizeof(quint64);
+    if ((uint) data.length() < sizeof(header) + pcsLength) return report;
+
+    report.pcs.resize(header.frames);
+    memcpy(report.pcs.data(), data.constData() + sizeof(header), pcsLength);
+    report.maps = data.mid(sizeof(header) + pcsLength);
+    report.signal = header.signal;
+    report.time = header.time;
+    report.valid = true;
+    return report;
+}
+
+QString CrashCapture::symbolize(Report report) {
+    struct Mapping {
+        quint64 start, end, offset;
+        QString module;
+    };
+
+    //Only executable mappings can hold a program counter
+    QList<Mapping> mappings;
+    for (QByteArray line : report.maps.split('\n')) {
+        QList<QByteArray> parts = line.simplified().split(' ');
+        if (parts.count() < 6 || !parts.at(1).contains('x')) continue;
+
+        QList<QByteArray> range = parts.at(0).split('-');
+        if (range.count() != 2) continue;
+
+        Mapping mapping;
+        mapping.start = range.at(0).toULongLong(nullptr, 16);
+        mapping.end = range.at(1).toULongLong(nullptr, 16);
+        mapping.offset = parts.at(2).toULongLong(nullptr, 16);
+        mapping.module = QString::fromLocal8Bit(parts.mid(5).join(' '));
+        mappings.append(mapping);
+    }
+
+    struct Frame {
+        quint64 pc;
+        quint64 address = 0;
+        QString module, function, location;
+    };
+
+    QVector<Frame> frames;
+    QMap<QString, QVector<int>> moduleFrames;
+    QMap<QString, bool> pic;
+    for (int i = 0; i < report.pcs.count(); i++) {
+        Frame frame;
+        frame.pc = report.pcs.at(i);
+
+        //Return addresses point after the call; step back so the line is the call site
+        quint64 lookup = i == 0 ? frame.pc : frame.pc - 1;
+        for (Mapping mapping : mappings) {
+            if (lookup >= mapping.start && lookup < mapping.end) {
+                if (!pic.contains(mapping.module)) {
+                    pic.insert(mapping.module, isPositionIndependent(mapping.module));
+                }
+
+                frame.module = mapping.module;
+                frame.address = pic.value(mapping.module) ? lookup - mapping.start + mapping.offset : lookup;
+                break;
+            }
+        }
+
+        if (frame.module.startsWith("/")) {
+            moduleFrames[frame.module].append(i);
+        }
+        frames.append(frame);
+    }
+
+    //One addr2line per module for every frame in it, all running at once
+    QMap<QString, QProcess*> processes;
+    for (QString module : moduleFrames.keys()) {
+        QStringList arguments;
+        arguments << "-C" << "-f" << "-s" << "-e" << module;
+        for (int i : moduleFrames.value(module)) {
+            arguments.append("0x" + QString::number(frames.at(i).address, 16));
+        }
+
+        QProcess* process = new QProcess();
+        process->start("addr2line", arguments);
+        processes.insert(module, process);
+    }
+
+    for (QString module : processes.keys()) {
+        QProcess* process = processes.value(module);
+        process->waitForFinished();
+
+        //addr2line answers with a function line and a location line per address, in order
+        QStringList lines = QString::fromLocal8Bit(process->readAllStandardOutput()).split('\n');
+        QVector<int> indices = moduleFrames.value(module);
+        for (int j = 0; j < indices.count() && j * 2 + 1 < lines.count(); j++) {
+            frames[indices.at(j)].function = lines.at(j * 2);
+            frames[indices.at(j)].location = lines.at(j * 2 + 1);
+        }
+        delete process;
+    }
+
+    QString output = signalDescription(report.signal) + "\n\n";
+    for (Frame frame : frames) {
+        QString line = "0x" + QString::number(frame.pc, 16) + ": ";
+        if (frame.function == "" || frame.function == "??") {
+            line.append("??");
+            if (frame.module != "") {
+                line.append(" (" + QFileInfo(frame.module).fileName() + "+0x" + QString::number(frame.address, 16) + ")");
+            }
+        } else {
+            line.append(frame.function);
+            if (!frame.location.startsWith("??")) {
+                line.append(" " + frame.location);
+            }
+        }
+        output.append(line + "\n");
+    }
+    return output;
+}
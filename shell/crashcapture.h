@@ -0,0 +1,48 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+
+#ifndef CRASHCAPTURE_H
+#define CRASHCAPTURE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+
+//Captures crashes from inside the signal handler using only async-signal-safe
+//calls: the raw program counters and the process memory map go straight to disk.
+//Turning those into function names and source lines happens later, in another
+//process, with one addr2line run per module.
+namespace CrashCapture {
+    struct Report {
+        bool valid = false;
+        int signal = 0;
+        qint64 time = 0;
+        QVector<quint64> pcs;
+        QByteArray maps;
+    };
+
+    void install(QString reportPath);
+    Report capture();
+    Report load(QString reportPath);
+    QString symbolize(Report report);
+}
+
+#endif // CRASHCAPTURE_H
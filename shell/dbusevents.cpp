@@ -19,6 +19,7 @@
  * *************************************/
 
 #include "dbusevents.h"
+#include "soundeffects.h"
 
 extern NotificationsDBusAdaptor* ndbus;
 
@@ -44,25 +45,12 @@ DbusEvents::DbusEvents(QObject *parent) : QObject(parent)
                                         "org.freedesktop.login1.Manager", "PrepareForSleep",
                                         this, SLOT(SleepingNow())); //Register Sleep
 
-    QDBusConnection::systemBus().connect("org.freedesktop.UDisks2", "/org/freedesktop/UDisks2", "org.freedesktop.DBus.ObjectManager",
-                                         "InterfacesAdded", this, SLOT(NewUdisksInterface(QDBusObjectPath)));
-    //QDBusConnection::systemBus().connect("org.freedesktop.UDisks2", "/org/freedesktop/UDisks2", "org.freedesktop.DBus.ObjectManager",
-    //                                     "InterfacesRemoved", this, SLOT(RemoveUdisksInterface(QDBusObjectPath,QStringList)));
+    connect(DeviceMonitor::instance(), SIGNAL(driveAdded(QDBusObjectPath,QString)), this, SLOT(DriveAdded(QDBusObjectPath,QString)));
+    connect(DeviceMonitor::instance(), SIGNAL(driveRemoved(QDBusObjectPath)), this, SLOT(DriveRemoved(QDBusObjectPath)));
+    connect(DeviceMonitor::instance(), SIGNAL(iosDeviceAdded(QString,QString)), this, SLOT(iOSDeviceAdded(QString,QString)));
+    connect(DeviceMonitor::instance(), SIGNAL(iosDeviceRemoved(QString)), this, SLOT(iOSDeviceRemoved(QString)));
 
     connect(ndbus, SIGNAL(ActionInvoked(uint,QString)), this, SLOT(NotificationAction(uint,QString)));
-
-    if (QFile("/usr/bin/idevice_id").exists()) {
-        QProcess deviceId;
-        deviceId.start("/usr/bin/idevice_id -l");
-        deviceId.waitForFinished();
-
-        connectediOSDevices = QString(deviceId.readAll()).split("\n", QString::SkipEmptyParts);
-    }
-
-    QTimer* driveDetect = new QTimer;
-    driveDetect->setInterval(1000);
-    connect(driveDetect, SIGNAL(timeout()), this, SLOT(DetectNewDevices()));
-    driveDetect->start();
 }
 
 void DbusEvents::LockScreen() {
@@ -89,88 +77,54 @@ void DbusEvents::SleepingNow() {
     }
 }
 
-void DbusEvents::NewUdisksInterface(QDBusObjectPath path) {
-    if (path.path().startsWith("/org/freedesktop/UDisks2/drives")) {
-        if (settings.value("notifications/mediaInsert", true).toBool()) {
-            QDBusInterface interface("org.freedesktop.UDisks2", path.path(), "org.freedesktop.UDisks2.Drive", QDBusConnection::systemBus());
-
-            QString deviceName = interface.property("Model").toString();
-            QStringList actions;
-            actions.append("action");
-            actions.append(tr("Perform Action..."));
-            QVariantMap hints;
-            hints.insert("transient", true);
-            hints.insert("category", "device.added");
-            hints.insert("sound-file", "qrc:/sounds/media-insert.wav");
-            uint id = ndbus->Notify("theShell", 0, "", tr("%1 Connected").arg(deviceName), tr("%1 has been connected to this PC.").arg(deviceName), actions, hints, -1);
-            notificationIds.insert(id, path);
-        }
+void DbusEvents::DriveAdded(QDBusObjectPath path, QString model) {
+    if (settings.value("notifications/mediaInsert", true).toBool()) {
+        QStringList actions;
+        actions.append("action");
+        actions.append(tr("Perform Action..."));
+        QVariantMap hints;
+        hints.insert("transient", true);
+        hints.insert("category", "device.added");
+        hints.insert("sound-file", "qrc:/sounds/media-insert.wav");
+        uint id = ndbus->Notify("theShell", 0, "", tr("%1 Connected").arg(model), tr("%1 has been connected to this PC.").arg(model), actions, hints, -1);
+        notificationIds.insert(id, qMakePair(path, model));
     }
 }
 
-void DbusEvents::RemoveUdisksInterface(QDBusObjectPath path, QStringList interfaces) {
+void DbusEvents::DriveRemoved(QDBusObjectPath path) {
     Q_UNUSED(path)
 
-    if (interfaces.contains("org.freedesktop.UDisks2.Drive")) {
-        QSoundEffect* mediaSound = new QSoundEffect();
-        mediaSound->setSource(QUrl("qrc:/sounds/media-remove.wav"));
-        mediaSound->play();
-        connect(mediaSound, SIGNAL(playingChanged()), mediaSound, SLOT(deleteLater()));
+    if (settings.value("notifications/mediaInsert", true).toBool()) {
+        SoundEffects::instance()->play(SoundEffects::MediaRemove);
     }
 }
 
 void DbusEvents::NotificationAction(uint id, QString key) {
     if (notificationIds.keys().contains(id)) {
         if (key == "action") {
-            QDBusInterface interface("org.freedesktop.UDisks2", notificationIds.value(id).path(), "org.freedesktop.UDisks2.Drive", QDBusConnection::systemBus());
-
-            QString description = tr("%1 was just connected. What do you want to do?").arg(interface.property("Model").toString());
+            QString description = tr("%1 was just connected. What do you want to do?").arg(notificationIds.value(id).second);
             NewMedia* mediaWindow = new NewMedia(description);
             mediaWindow->show();
         }
     }
 }
 
-void DbusEvents::DetectNewDevices() {
-    if (QFile("/usr/bin/idevice_id").exists()) {
-        if (settings.value("notifications/mediaInsert", true).toBool()) {
-            QProcess deviceId;
-            deviceId.start("/usr/bin/idevice_id -l");
-            deviceId.waitForFinished();
-
-            //Detect disconnected devices
-            QStringList foundDevices = QString(deviceId.readAll()).split("\n", QString::SkipEmptyParts);
-            for (QString device : connectediOSDevices) {
-                if (!foundDevices.contains(device)) {
-                    connectediOSDevices.removeOne(device);
-
-                    QSoundEffect* mediaSound = new QSoundEffect();
-                    mediaSound->setSource(QUrl("qrc:/sounds/media-remove.wav"));
-                    mediaSound->play();
-                    connect(mediaSound, SIGNAL(playingChanged()), mediaSound, SLOT(deleteLater()));
-                }
-            }
-
-            //Detect connected device
-            for (QString device : foundDevices) {
-                if (!connectediOSDevices.contains(device)) {
-                    QProcess deviceNameProc;
-                    deviceNameProc.start("/usr/bin/idevice_id " + device);
-                    deviceNameProc.waitForFinished();
-
-                    QString deviceName = deviceNameProc.readAll().trimmed();
-                    if (deviceName == "") {
-                        deviceName = tr("iOS Device");
-                    }
-
-                    QVariantMap hints;
-                    hints.insert("transient", true);
-                    hints.insert("category", "device.added");
-                    hints.insert("sound-file", "qrc:/sounds/media-insert.wav");
-                    ndbus->Notify("theShell", 0, "", tr("%1 Connected").arg(deviceName), tr("%1 has been connected to this PC.").arg(deviceName), QStringList(), hints, -1);
-                    connectediOSDevices.append(device);
-                }
-            }
-        }
+void DbusEvents::iOSDeviceAdded(QString serial, QString name) {
+    Q_UNUSED(serial)
+
+    if (settings.value("notifications/mediaInsert", true).toBool()) {
+        QVariantMap hints;
+        hints.insert("transient", true);
+        hints.insert("category", "device.added");
+        hints.insert("sound-file", "qrc:/sounds/media-insert.wav");
+        ndbus->Notify("theShell", 0, "", tr("%1 Connected").arg(name), tr("%1 has been connected to this PC.").arg(name), QStringList(), hints, -1);
+    }
+}
+
+void DbusEvents::iOSDeviceRemoved(QString serial) {
+    Q_UNUSED(serial)
+
+    if (settings.value("notifications/mediaInsert", true).toBool()) {
+        SoundEffects::instance()->play(SoundEffects::MediaRemove);
     }
 }
@@ -35,6 +35,7 @@
 #include <QSoundEffect>
 #include "notificationsWidget/notificationsdbusadaptor.h"
 #include "newmedia.h"
+#include "devicemonitor.h"
 
 class DbusEvents : public QObject
 {
@@ -49,13 +50,15 @@ public slots:
 
     void UnlockScreen();
 
-    void NewUdisksInterface(QDBusObjectPath path);
+    void DriveAdded(QDBusObjectPath path, QString model);
 
-    void RemoveUdisksInterface(QDBusObjectPath path, QStringList interfaces);
+    void DriveRemoved(QDBusObjectPath path);
 
     void NotificationAction(uint id, QString key);
 
-    void DetectNewDevices();
+    void iOSDeviceAdded(QString serial, QString name);
+
+    void iOSDeviceRemoved(QString serial);
 
 private slots:
     void SleepingNow();
@@ -64,8 +67,7 @@ private:
     QProcess* LockScreenProcess = NULL;
 
     QSettings settings;
-    QStringList connectediOSDevices;
-    QMap<uint, QDBusObjectPath> notificationIds;
+    QMap<uint, QPair<QDBusObjectPath, QString>> notificationIds;
 };
 
 #endif // DBUSEVENTS_H
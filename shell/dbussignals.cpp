@@ -19,20 +19,58 @@
  * *************************************/
 
 #include "dbussignals.h"
-#include "theshell_adaptor.h"
 #include "mainwindow.h"
+#include "audiomanager.h"
 
 extern MainWindow* MainWin;
+extern AudioManager* AudioMan;
 
 DBusSignals::DBusSignals(QObject *parent) : QObject(parent)
 {
-    new TheshellAdaptor(this);
+    //Export the object directly rather than through an adaptor so that calls carry their sender
     QDBusConnection dbus = QDBusConnection::sessionBus();
-    dbus.registerObject("/org/thesuite/theshell", this);
+    dbus.registerObject("/org/thesuite/theshell", this, QDBusConnection::ExportScriptableContents);
     dbus.registerService("org.thesuite.theshell");
+
+    duckWatcher = new QDBusServiceWatcher(this);
+    duckWatcher->setConnection(dbus);
+    duckWatcher->setWatchMode(QDBusServiceWatcher::WatchForUnregistration);
+    connect(duckWatcher, SIGNAL(serviceUnregistered(QString)), this, SLOT(duckClientGone(QString)));
 }
 
 void DBusSignals::NextKeyboard() {
     MainWin->getInfoPane()->setNextKeyboardLayout();
     //Hotkeys->show(QIcon::fromTheme("input-keyboard"), tr("Keyboard Layout"), tr("Keyboard Layout set to %1").arg(newKeyboardLayout), 5000);
 }
+
+void DBusSignals::DuckAudio() {
+    //Remember who asked so a client that crashes or forgets to unduck doesn't leave audio ducked
+    QString client = calledFromDBus() ? message().service() : "";
+    if (!duckClients.contains(client) && client != "") {
+        duckWatcher->addWatchedService(client);
+    }
+    duckClients[client]++;
+
+    if (AudioMan != NULL) AudioMan->duck(AudioManager::duckVoiceFeedback);
+}
+
+void DBusSignals::UnduckAudio() {
+    QString client = calledFromDBus() ? message().service() : "";
+    if (!duckClients.contains(client)) return; //Never ducked; don't release somebody else's duck
+
+    if (--duckClients[client] == 0) {
+        duckClients.remove(client);
+        duckWatcher->removeWatchedService(client);
+    }
+
+    if (AudioMan != NULL) AudioMan->unduck(AudioManager::duckVoiceFeedback);
+}
+
+void DBusSignals::duckClientGone(QString service) {
+    int ducks = duckClients.take(service);
+    duckWatcher->removeWatchedService(service);
+
+    for (int i = 0; i < ducks; i++) {
+        if (AudioMan != NULL) AudioMan->unduck(AudioManager::duckVoiceFeedback);
+    }
+}
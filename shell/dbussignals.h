@@ -22,9 +22,12 @@
 #define DBUSSIGNALS_H
 
 #include <QObject>
+#include <QMap>
 #include <QDBusConnection>
+#include <QDBusContext>
+#include <QDBusServiceWatcher>
 
-class DBusSignals : public QObject
+class DBusSignals : public QObject, protected QDBusContext
 {
     Q_OBJECT
     Q_CLASSINFO("D-Bus Interface", "org.thesuite.theshell")
@@ -40,6 +43,15 @@ class DBusSignals : public QObject
 
     public Q_SLOTS:
         Q_SCRIPTABLE void NextKeyboard();
+        Q_SCRIPTABLE void DuckAudio();
+        Q_SCRIPTABLE void UnduckAudio();
+
+    private slots:
+        void duckClientGone(QString service);
+
+    private:
+        QDBusServiceWatcher* duckWatcher;
+        QMap<QString, int> duckClients;
 };
 
 #endif // DBUSSIGNALS_H
@@ -0,0 +1,185 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#include "devicemonitor.h"
+
+#include <QDBusConnection>
+#include <QDBusArgument>
+#include <QProcess>
+#include <QTimer>
+#include <QFile>
+#include <QDebug>
+#include <libudev.h>
+
+static QString udevProperty(udev_device* device, const char* key) {
+    return QString::fromLocal8Bit(udev_device_get_property_value(device, key));
+}
+
+DeviceMonitor* DeviceMonitor::instance() {
+    static DeviceMonitor* monitor = new DeviceMonitor();
+    return monitor;
+}
+
+DeviceMonitor::DeviceMonitor(QObject *parent) : QObject(parent)
+{
+    QDBusConnection::systemBus().connect("org.freedesktop.UDisks2", "/org/freedesktop/UDisks2", "org.freedesktop.DBus.ObjectManager",
+                                         "InterfacesAdded", this, SLOT(interfacesAdded(QDBusMessage)));
+    QDBusConnection::systemBus().connect("org.freedesktop.UDisks2", "/org/freedesktop/UDisks2", "org.freedesktop.DBus.ObjectManager",
+                                         "InterfacesRemoved", this, SLOT(interfacesRemoved(QDBusMessage)));
+
+    udev = udev_new();
+    if (udev == NULL) {
+        qWarning() << "Couldn't connect to udev; USB devices won't be detected";
+        return;
+    }
+
+    //Subscribe before enumerating so nothing plugged in between the two is missed
+    monitor = udev_monitor_new_from_netlink(udev, "udev");
+    if (monitor != NULL) {
+        udev_monitor_filter_add_match_subsystem_devtype(monitor, "usb", "usb_device");
+        udev_monitor_enable_receiving(monitor);
+
+        notifier = new QSocketNotifier(udev_monitor_get_fd(monitor), QSocketNotifier::Read, this);
+        connect(notifier, SIGNAL(activated(int)), this, SLOT(udevEvent()));
+    }
+
+    udev_enumerate* enumerate = udev_enumerate_new(udev);
+    udev_enumerate_add_match_subsystem(enumerate, "usb");
+    udev_enumerate_add_match_property(enumerate, "DEVTYPE", "usb_device");
+    udev_enumerate_scan_devices(enumerate);
+
+    udev_list_entry* entry;
+    udev_list_entry_foreach(entry, udev_enumerate_get_list_entry(enumerate)) {
+        udev_device* device = udev_device_new_from_syspath(udev, udev_list_entry_get_name(entry));
+        if (device != NULL) {
+            addUsbDevice(device, false);
+            udev_device_unref(device);
+        }
+    }
+    udev_enumerate_unref(enumerate);
+}
+
+DeviceMonitor::~DeviceMonitor() {
+    if (monitor != NULL) udev_monitor_unref(monitor);
+    if (udev != NULL) udev_unref(udev);
+}
+
+QString DeviceMonitor::iosDeviceName(QString serial) {
+    //Names are kept under the USB serial, which is the UDID without its dash
+    return iosNames.value(serial.remove('-'));
+}
+
+void DeviceMonitor::udevEvent() {
+    udev_device* device = udev_monitor_receive_device(monitor);
+    if (device == NULL) return;
+
+    QString action = QString::fromLocal8Bit(udev_device_get_action(device));
+    if (action == "add") {
+        addUsbDevice(device, true);
+    } else if (action == "remove") {
+        removeUsbDevice(device);
+    }
+    udev_device_unref(device);
+}
+
+void DeviceMonitor::addUsbDevice(udev_device* device, bool announce) {
+    //Apple uses the 0x12xx product range for iPhones, iPads and iPods
+    if (udevProperty(device, "ID_VENDOR_ID") != "05ac" || !udevProperty(device, "ID_MODEL_ID").startsWith("12")) return;
+
+    QString serial = udevProperty(device, "ID_SERIAL_SHORT");
+    if (serial == "" || iosNames.contains(serial)) return;
+
+    iosSyspaths.insert(QString::fromLocal8Bit(udev_device_get_syspath(device)), serial);
+    iosNames.insert(serial, "");
+    lookupIosName(serial, announce);
+}
+
+void DeviceMonitor::removeUsbDevice(udev_device* device) {
+    //Properties on a remove event can be incomplete, so go by the path we saw it arrive on
+    QString serial = iosSyspaths.take(QString::fromLocal8Bit(udev_device_get_syspath(device)));
+    if (serial == "") return;
+
+    iosNames.remove(serial);
+    emit iosDeviceRemoved(serial);
+}
+
+void DeviceMonitor::lookupIosName(QString serial, bool announce, int attempt) {
+    if (!QFile("/usr/bin/idevice_id").exists()) {
+        if (announce) emit iosDeviceAdded(serial, tr("iOS Device"));
+        return;
+    }
+
+    QProcess* proc = new QProcess(this);
+    connect(proc, (void(QProcess::*)(int, QProcess::ExitStatus)) &QProcess::finished, [=] {
+        proc->deleteLater();
+        if (!iosNames.contains(serial)) return; //Unplugged while we were asking
+
+        QString name = QString(proc->readAll()).trimmed();
+        if (name == "" || name.startsWith("ERROR:")) {
+            //usbmuxd is started off the same hotplug event, so it may not know about the device yet
+            if (attempt < 3) {
+                QTimer::singleShot(1000 * (attempt + 1), this, [=] {
+                    if (iosNames.contains(serial)) lookupIosName(serial, announce, attempt + 1);
+                });
+                return;
+            }
+            name = "";
+        }
+
+        iosNames.insert(serial, name);
+        if (announce) emit iosDeviceAdded(serial, name == "" ? tr("iOS Device") : name);
+    });
+    proc->start("/usr/bin/idevice_id", QStringList() << udid(serial));
+}
+
+QString DeviceMonitor::udid(QString serial) {
+    //Newer devices report a 24 digit USB serial; their UDID is the same digits with a dash after the eighth
+    if (serial.length() == 24) {
+        return serial.left(8) + "-" + serial.mid(8);
+    }
+    return serial;
+}
+
+void DeviceMonitor::interfacesAdded(QDBusMessage message) {
+    if (message.arguments().count() < 2) return;
+
+    QDBusObjectPath path = message.arguments().at(0).value<QDBusObjectPath>();
+    QMap<QString, QVariantMap> interfaces;
+    message.arguments().at(1).value<QDBusArgument>() >> interfaces;
+
+    //The signal carries the drive's properties, so there's no need to go back and ask for them
+    if (interfaces.contains("org.freedesktop.UDisks2.Drive") && !drives.contains(path.path())) {
+        QString model = interfaces.value("org.freedesktop.UDisks2.Drive").value("Model").toString();
+        drives.insert(path.path());
+        emit driveAdded(path, model);
+    }
+}
+
+void DeviceMonitor::interfacesRemoved(QDBusMessage message) {
+    if (message.arguments().count() < 2) return;
+
+    QDBusObjectPath path = message.arguments().at(0).value<QDBusObjectPath>();
+    QStringList interfaces = message.arguments().at(1).toStringList();
+
+    if (interfaces.contains("org.freedesktop.UDisks2.Drive")) {
+        drives.remove(path.path());
+        emit driveRemoved(path);
+    }
+}
@@ -0,0 +1,72 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#ifndef DEVICEMONITOR_H
+#define DEVICEMONITOR_H
+
+#include <QObject>
+#include <QMap>
+#include <QSet>
+#include <QSocketNotifier>
+#include <QDBusObjectPath>
+#include <QDBusMessage>
+
+struct udev;
+struct udev_monitor;
+struct udev_device;
+
+class DeviceMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    static DeviceMonitor* instance();
+    ~DeviceMonitor();
+
+    QString iosDeviceName(QString serial);
+
+signals:
+    void iosDeviceAdded(QString serial, QString name);
+    void iosDeviceRemoved(QString serial);
+    void driveAdded(QDBusObjectPath path, QString model);
+    void driveRemoved(QDBusObjectPath path);
+
+private slots:
+    void udevEvent();
+    void interfacesAdded(QDBusMessage message);
+    void interfacesRemoved(QDBusMessage message);
+
+private:
+    explicit DeviceMonitor(QObject *parent = 0);
+
+    void addUsbDevice(udev_device* device, bool announce);
+    void removeUsbDevice(udev_device* device);
+    void lookupIosName(QString serial, bool announce, int attempt = 0);
+    static QString udid(QString serial);
+
+    struct udev* udev = NULL;
+    struct udev_monitor* monitor = NULL;
+    QSocketNotifier* notifier = NULL;
+
+    QMap<QString, QString> iosSyspaths;
+    QMap<QString, QString> iosNames;
+    QSet<QString> drives;
+};
+
+#endif // DEVICEMONITOR_H
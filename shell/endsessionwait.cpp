@@ -22,7 +22,6 @@
 #include "ui_endsessionwait.h"
 
 extern float getDPIScaling();
-extern void sendMessageToRootWindow(const char* message, Window window, long data0 = 0, long data1 = 0, long data2 = 0, long data3 = 0, long data4 = 0);
 
 EndSessionWait::EndSessionWait(shutdownType type, QWidget *parent) :
     QDialog(parent),
@@ -33,19 +32,13 @@ EndSessionWait::EndSessionWait(shutdownType type, QWidget *parent) :
     ui->cancelButton->setFixedHeight(0);
     ui->killAllButton->setFixedHeight(0);
 
-    tbManager = new TaskbarManager();
-    connect(tbManager, &TaskbarManager::deleteWindow, [=] {
-        if (tbManager->Windows().count() - 1 == 0) {
-            tbTimer->stop();
-            if (performEndSessionWhenAllAppsClosed) {
-                performEndSession();
-            }
+    coordinator = new ShutdownCoordinator(this);
+    connect(coordinator, &ShutdownCoordinator::allClosed, [=] {
+        if (performEndSessionWhenAllAppsClosed) {
+            performEndSession();
         }
     });
-
-    tbTimer = new QTimer();
-    tbTimer->setInterval(100);
-    connect(tbTimer, SIGNAL(timeout()), tbManager, SLOT(ReloadWindows()));
+    connect(coordinator, SIGNAL(windowsChanged()), this, SLOT(reloadAppList()));
 
     powerOffTimer = new QVariantAnimation();
     powerOffTimer->setStartValue(0);
@@ -217,139 +210,34 @@ void EndSessionWait::showFullScreen() {
             parallelAnimGroup->addAnimation(anim);
 
             connect(parallelAnimGroup, SIGNAL(finished()), parallelAnimGroup, SLOT(deleteLater()));
+            connect(parallelAnimGroup, &QParallelAnimationGroup::finished, [=] {
+                closeApps();
+            });
             parallelAnimGroup->start();
-
-            while (parallelAnimGroup->state() == QSequentialAnimationGroup::Running) {
-                QApplication::processEvents();
-            }
+            return;
         }
 
-        if (this->type != dummy && this->type != ask) {
-            powerOffTimer->stop();
-            powerOffTimer->setCurrentTime(0);
-
-            //Prepare a window list
-            QList<WmWindow> wlist;
-
-            //Get the current display
-            Display* d = QX11Info::display();
-
-            //Create list of all top windows and populate it
-            QList<Window> TopWindows;
-
-            Atom WindowListType;
-            int format;
-            unsigned long items, bytes;
-            unsigned char *data;
-            XGetWindowProperty(d, RootWindow(d, 0), XInternAtom(d, "_NET_CLIENT_LIST", true), 0L, (~0L),
-                                            False, AnyPropertyType, &WindowListType, &format, &items, &bytes, &data);
+        closeApps();
+    }
+}
 
-            quint64 *windows = (quint64*) data;
-            for (unsigned long i = 0; i < items; i++) {
-                TopWindows.append((Window) windows[i]);
+void EndSessionWait::closeApps() {
+    if (this->type != dummy && this->type != ask) {
+        powerOffTimer->stop();
+        powerOffTimer->setCurrentTime(0);
 
-            }
-            XFree(data);
-
-            for (Window win : TopWindows) {
-                XWindowAttributes attributes;
-
-                int retval = XGetWindowAttributes(d, win, &attributes);
-                unsigned long items, bytes;
-                unsigned char *netWmName;
-                XTextProperty wmName;
-                int format;
-                Atom ReturnType;
-                retval = XGetWindowProperty(d, win, XInternAtom(d, "_NET_WM_VISIBLE_NAME", False), 0, 1024, False,
-                                   XInternAtom(d, "UTF8_STRING", False), &ReturnType, &format, &items, &bytes, &netWmName);
-                if (retval != 0 || netWmName == 0x0) {
-                    retval = XGetWindowProperty(d, win, XInternAtom(d, "_NET_WM_NAME", False), 0, 1024, False,
-                                       AnyPropertyType, &ReturnType, &format, &items, &bytes, &netWmName);
-                    if (retval != 0) {
-                        retval = XGetWMName(d, win, &wmName);
-                        if (retval == 1) {
-                            retval = 0;
-                        } else {
-                            retval = 1;
-                        }
-                    }
-                }
-                if (retval == 0) {
-                    WmWindow w;
-                    w.setWID(win);
-
-                    QString title;
-                    if (netWmName) {
-                        title = QString::fromLocal8Bit((char *) netWmName);
-                        XFree(netWmName);
-                    } else if (wmName.value) {
-                        title = QString::fromLatin1((char *) wmName.value);
-                        //XFree(wmName);
-                    }
-
-                    unsigned long *pidPointer;
-                    unsigned long pitems, pbytes;
-                    int pformat;
-                    Atom pReturnType;
-                    int retval = XGetWindowProperty(d, win, XInternAtom(d, "_NET_WM_PID", False), 0, 1024, False,
-                                                    XA_CARDINAL, &pReturnType, &pformat, &pitems, &pbytes, (unsigned char**) &pidPointer);
-                    if (retval == 0) {
-                        if (pidPointer != 0) {
-                            unsigned long pid = *pidPointer;
-                            w.setPID(pid);
-                        }
-                    }
-
-                    XFree(pidPointer);
-
-                    //Set the title of the window
-                    w.setTitle(title);
-
-                    //Make sure PID is not current application PID
-                    if (w.PID() != QCoreApplication::applicationPid()) {
-                        wlist.append(w);
-                    }
-                }
-            }
+        //Ask everything to close at once; the coordinator tells us when the last window goes away
+        QStringList spareTitles;
+        if (QApplication::arguments().contains("--debug")) {
+            spareTitles << "theterminal" << "qt creator";
+        }
+        coordinator->closeAll(spareTitles);
 
-            for (WmWindow window : wlist) {
-                if (QApplication::arguments().contains("--debug")) {
-                    if (!window.title().toLower().contains("theterminal") && !window.title().toLower().contains("qt creator")) {
-                        sendMessageToRootWindow("_NET_CLOSE_WINDOW", window.WID());
-                    }
-                } else {
-                    sendMessageToRootWindow("_NET_CLOSE_WINDOW", window.WID());
-                }
-            }
+        if (coordinator->count() == 0) {
+            performEndSession();
+        } else {
+            performEndSessionWhenAllAppsClosed = true;
 
-            tbManager->ReloadWindows();
-            if (tbManager->Windows().count() == 0) {
-                performEndSession();
-            } else {
-                tbTimer->start();
-                performEndSessionWhenAllAppsClosed = true;
-
-                QTimer::singleShot(5000, [=] {
-                    auto animateResize = [=](QWidget* widget) {
-                        tVariantAnimation* anim = new tVariantAnimation();
-                        anim->setStartValue(widget->height());
-                        anim->setEndValue(widget->sizeHint().height());
-                        anim->setEasingCurve(QEasingCurve::OutCubic);
-                        anim->setDuration(500);
-                        connect(anim, &tVariantAnimation::valueChanged, [=](QVariant value) {
-                            widget->setFixedHeight(value.toInt());
-                        });
-                        connect(anim, SIGNAL(finished()), anim, SLOT(deleteLater()));
-                        anim->start();
-                    };
-
-                    animateResize(ui->powerType);
-                    animateResize(ui->closingAppsMessage);
-                    animateResize(ui->cancelButton);
-                    animateResize(ui->killAllButton);
-                });
-            }
-        } else if (this->type == dummy) {
             QTimer::singleShot(5000, [=] {
                 auto animateResize = [=](QWidget* widget) {
                     tVariantAnimation* anim = new tVariantAnimation();
@@ -370,42 +258,36 @@ void EndSessionWait::showFullScreen() {
                 animateResize(ui->killAllButton);
             });
         }
+    } else if (this->type == dummy) {
+        QTimer::singleShot(5000, [=] {
+            auto animateResize = [=](QWidget* widget) {
+                tVariantAnimation* anim = new tVariantAnimation();
+                anim->setStartValue(widget->height());
+                anim->setEndValue(widget->sizeHint().height());
+                anim->setEasingCurve(QEasingCurve::OutCubic);
+                anim->setDuration(500);
+                connect(anim, &tVariantAnimation::valueChanged, [=](QVariant value) {
+                    widget->setFixedHeight(value.toInt());
+                });
+                connect(anim, SIGNAL(finished()), anim, SLOT(deleteLater()));
+                anim->start();
+            };
+
+            animateResize(ui->powerType);
+            animateResize(ui->closingAppsMessage);
+            animateResize(ui->cancelButton);
+            animateResize(ui->killAllButton);
+        });
     }
 }
 
 void EndSessionWait::on_killAllButton_clicked()
 {
-    QProcess p;
-    p.start("wmctrl -lp");
-    p.waitForStarted();
-    while (p.state() != 0) {
-        QApplication::processEvents();
-    }
-
-    QList<WmWindow> wlist;
-
-    QString output(p.readAllStandardOutput());
-    for (QString window : output.split("\n")) {
-        QStringList parts = window.split(" ");
-        parts.removeAll("");
-        if (parts.length() >= 4) {
-            if (parts[2].toInt() != QCoreApplication::applicationPid()) {
-                WmWindow w;
-                w.setPID(parts[2].toInt());
-                QString title;
-                for (int i = 4; i != parts.length(); i++) {
-                    title = title.append(" " + parts[i]);
-                }
-                title = title.remove(0, 1);
-
-                w.setTitle(title);
-                wlist.append(w);
-            }
-        }
-    }
-
-    tbTimer->stop();
-    performEndSession();
+    //Stop the windows going away from ending the session a second time
+    performEndSessionWhenAllAppsClosed = false;
+    ui->killAllButton->setEnabled(false);
+    connect(coordinator, &ShutdownCoordinator::allKilled, this, &EndSessionWait::performEndSession, Qt::UniqueConnection);
+    coordinator->killAll();
 }
 
 void EndSessionWait::performEndSession() {
@@ -562,151 +444,12 @@ void EndSessionWait::on_terminateApp_clicked()
     });
     ui->terminateAppFrame->setVisible(true);
 
-    this->reloadAppList();
+    coordinator->refresh();
 }
 
 void EndSessionWait::reloadAppList() {
-    QList<WmWindow> wlist;
-
-    Display* d = QX11Info::display();
-    QList<Window> TopWindows;
-
-    Atom WindowListType;
-    int format;
-    unsigned long items, bytes;
-    unsigned char *data;
-    XGetWindowProperty(d, RootWindow(d, 0), XInternAtom(d, "_NET_CLIENT_LIST", true), 0L, (~0L),
-                                    False, AnyPropertyType, &WindowListType, &format, &items, &bytes, &data);
-
-    quint64 *windows = (quint64*) data;
-    for (unsigned long i = 0; i < items; i++) {
-        TopWindows.append((Window) windows[i]);
-
-    }
-    XFree(data);
-
-    //XQueryTree(QX11Info::display(), RootWindow(d, 0), new Window(), new Window(), &ChildList, &NumOfChildren);
-    for (Window win : TopWindows) {
-        XWindowAttributes attributes;
-
-        int retval = XGetWindowAttributes(d, win, &attributes);
-        unsigned long items, bytes;
-        unsigned char *netWmName;
-        XTextProperty wmName;
-        int format;
-        Atom ReturnType;
-        retval = XGetWindowProperty(d, win, XInternAtom(d, "_NET_WM_VISIBLE_NAME", False), 0, 1024, False,
-                           XInternAtom(d, "UTF8_STRING", False), &ReturnType, &format, &items, &bytes, &netWmName);
-        if (retval != 0 || netWmName == 0x0) {
-            retval = XGetWindowProperty(d, win, XInternAtom(d, "_NET_WM_NAME", False), 0, 1024, False,
-                               AnyPropertyType, &ReturnType, &format, &items, &bytes, &netWmName);
-            if (retval != 0) {
-                retval = XGetWMName(d, win, &wmName);
-                if (retval == 1) {
-                    retval = 0;
-                } else {
-                    retval = 1;
-                }
-            }
-        }
-        if (retval == 0) {
-            WmWindow w;
-            w.setWID(win);
-
-            QString title;
-            if (netWmName) {
-                title = QString::fromLocal8Bit((char *) netWmName);
-                XFree(netWmName);
-            } else if (wmName.value) {
-                title = QString::fromLatin1((char *) wmName.value);
-                //XFree(wmName);
-            }
-
-            unsigned long *pidPointer;
-            unsigned long pitems, pbytes;
-            int pformat;
-            Atom pReturnType;
-            int retval = XGetWindowProperty(d, win, XInternAtom(d, "_NET_WM_PID", False), 0, 1024, False,
-                                            XA_CARDINAL, &pReturnType, &pformat, &pitems, &pbytes, (unsigned char**) &pidPointer);
-            if (retval == 0) {
-                if (pidPointer != 0) {
-                    unsigned long pid = *pidPointer;
-                    w.setPID(pid);
-                }
-            }
-
-            XFree(pidPointer);
-
-
-            {
-                bool noIcon = false;
-                unsigned long icItems, icBytes;
-                unsigned char *icon;
-                int icFormat;
-                Atom icReturnType;
-
-                unsigned char *ret;
-                int width, height;
-
-
-                retval = XGetWindowProperty(d, win, XInternAtom(d, "_NET_WM_ICON", False), 0, 1, False,
-                                   XA_CARDINAL, &icReturnType, &icFormat, &icItems, &icBytes, &ret);
-                if (ret == 0x0) {
-                    noIcon = true;
-                } else {
-                    width = *(int*) ret;
-                    XFree(ret);
-                }
-
-                retval = XGetWindowProperty(d, win, XInternAtom(d, "_NET_WM_ICON", False), 1, 1, False,
-                                   XA_CARDINAL, &icReturnType, &icFormat, &icItems, &icBytes, &ret);
-
-                if (ret == 0x0) {
-                    noIcon = true;
-                } else {
-                    height = *(int*) ret;
-                    XFree(ret);
-                }
-
-                if (!noIcon) {
-                    retval = XGetWindowProperty(d, win, XInternAtom(d, "_NET_WM_ICON", False), 2, width * height * 4, False,
-                                       XA_CARDINAL, &icReturnType, &icFormat, &icItems, &icBytes, &icon);
-
-                    QImage image(width, height, QImage::Format_ARGB32);
-
-                    for (int y = 0; y < height; y++) {
-                        for (int x = 0; x < width * 8; x = x + 8) {
-                            unsigned long a, r, g, b;
-
-                            b = (icon[y * width * 8 + x + 0]);
-                            g = (icon[y * width * 8 + x + 1]);
-                            r = (icon[y * width * 8 + x + 2]);
-                            a = (icon[y * width * 8 + x + 3]);
-
-                            QColor col = QColor(r, g, b, a);
-
-                            image.setPixelColor(x / 8, y, col);
-                        }
-                    }
-
-                    QPixmap iconPixmap(QPixmap::fromImage(image).scaled(16, 16, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
-                    w.setIcon(QIcon(iconPixmap));
-
-                    XFree(icon);
-                }
-            }
-
-            w.setTitle(title);
-
-            if (w.PID() != QCoreApplication::applicationPid()) {
-                wlist.append(w);
-            }
-
-        }
-    }
-
     ui->listWidget->clear();
-    for (WmWindow wi : wlist) {
+    for (WmWindow wi : coordinator->windows()) {
         QListWidgetItem* item = new QListWidgetItem();
         item->setText(wi.title() + " (PID " + QString::number(wi.PID()) + ")");
         item->setData(Qt::UserRole, QVariant::fromValue(wi.PID()));
@@ -765,18 +508,14 @@ void EndSessionWait::on_exitTerminate_clicked()
 
 void EndSessionWait::on_pushButton_5_clicked()
 {
-    //Send SIGTERM to app
-    kill(ui->listWidget->selectedItems().first()->data(Qt::UserRole).value<unsigned long>(), SIGTERM);
-    QThread::sleep(1);
-    reloadAppList();
+    //Send SIGTERM to app; the list updates itself as its windows close
+    coordinator->signalProcess(ui->listWidget->selectedItems().first()->data(Qt::UserRole).value<unsigned long>(), SIGTERM);
 }
 
 void EndSessionWait::on_pushButton_4_clicked()
 {
     //Send SIGKILL to app
-    kill(ui->listWidget->selectedItems().first()->data(Qt::UserRole).value<unsigned long>(), SIGKILL);
-    QThread::sleep(1);
-    reloadAppList();
+    coordinator->signalProcess(ui->listWidget->selectedItems().first()->data(Qt::UserRole).value<unsigned long>(), SIGKILL);
 }
 
 void EndSessionWait::on_listWidget_currentRowChanged(int currentRow)
@@ -65,7 +65,7 @@
 #include <QMouseEvent>
 #include "window.h"
 #include "tpropertyanimation.h"
-#include "taskbarmanager.h"
+#include "shutdowncoordinator.h"
 #include <QToolButton>
 
 #include <signal.h>
@@ -143,9 +143,9 @@ private:
 
     QVariantAnimation* powerOffTimer;
 
-    TaskbarManager* tbManager;
+    ShutdownCoordinator* coordinator;
     bool performEndSessionWhenAllAppsClosed = false;
-    QTimer* tbTimer;
+    void closeApps();
 
     int pressLocation;
 
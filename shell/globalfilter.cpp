@@ -19,18 +19,17 @@
  * *************************************/
 
 #include "globalfilter.h"
+#include "soundeffects.h"
+#include "shellsettings.h"
 
-extern void playSound(QUrl, bool = false);
 extern MainWindow* MainWin;
 
-Background* firstBackground;
+Background* firstBackground = nullptr;
 GlobalFilter::GlobalFilter(QApplication *application, QObject *parent) : QObject(parent)
 {
    application->installEventFilter(this);
 
-   connect(QApplication::desktop(), SIGNAL(screenCountChanged(int)), this, SLOT(reloadScreens()));
-   connect(QApplication::desktop(), SIGNAL(resized(int)), this, SLOT(reloadScreens()));
-   connect(QApplication::desktop(), SIGNAL(primaryScreenChanged()), this, SLOT(reloadScreens()));
+   connect(ScreenTopology::instance(), SIGNAL(screensChanged()), this, SLOT(reloadScreens()));
    connect(MainWin, SIGNAL(reloadBackgrounds()), this, SLOT(reloadBackgrounds()));
 
    reloadScreens();
@@ -39,32 +38,55 @@ GlobalFilter::GlobalFilter(QApplication *application, QObject *parent) : QObject
 bool GlobalFilter::eventFilter(QObject *object, QEvent *event) {
     Q_UNUSED(object)
     if (event->type() == QEvent::MouseButtonRelease) {
-        QSettings settings;
-        if (settings.value("input/touchFeedbackSound", false).toBool()) {
-            QSound::play(":/sounds/click.wav");
+        if (ShellSettings::instance()->touchFeedbackSound()) {
+            SoundEffects::instance()->play(SoundEffects::Click);
         }
     }
     return false;
 }
 
 void GlobalFilter::reloadScreens() {
-    QThread::msleep(500); //Wait for KScreen to apply screen changes
-    emit removeBackgrounds();
-    for (int i = 0; i < QApplication::desktop()->screenCount(); i++) {
-        Background* w = new Background(MainWin, i == 0 ? true : false, QApplication::desktop()->screenGeometry(i));
+    QList<QRect> screens = ScreenTopology::instance()->screens();
+
+    //The first background fetches community backgrounds for the others, so if its
+    //screen has changed every background needs to be created again
+    if (firstBackground == nullptr || backgrounds.value(firstBackground) != screens.first()) {
+        for (Background* w : backgrounds.keys()) {
+            w->deleteLater();
+        }
+        backgrounds.clear();
+        firstBackground = nullptr;
+    } else {
+        //Only remove backgrounds for screens that have gone away or moved
+        for (Background* w : backgrounds.keys()) {
+            if (!screens.contains(backgrounds.value(w))) {
+                backgrounds.remove(w);
+                w->deleteLater();
+            }
+        }
+    }
+
+    QList<QRect> existing = backgrounds.values();
+    for (QRect geometry : screens) {
+        if (existing.contains(geometry)) continue;
+
+        Background* w = new Background(MainWin, firstBackground == nullptr, geometry);
         w->setWindowFlags(Qt::FramelessWindowHint | Qt::WindowStaysOnBottomHint);
         w->setAttribute(Qt::WA_ShowWithoutActivating, true);
         w->show();
-        w->setGeometry(QApplication::desktop()->screenGeometry(i));
+        w->setGeometry(geometry);
         w->showFullScreen();
-        connect(this, SIGNAL(removeBackgrounds()), w, SLOT(deleteLater()));
         connect(this, SIGNAL(changeBackgrounds()), w, SLOT(changeBackground()));
-        if (i == 0) {
+        if (firstBackground == nullptr) {
             firstBackground = w;
             connect(w, SIGNAL(reloadBackground()), this, SLOT(reloadBackgrounds()));
         } else {
             connect(firstBackground, SIGNAL(setAllBackgrounds(QString)), w, SLOT(setCommunityBackground(QString)));
+            if (firstBackground->communityBackground() != "") {
+                w->setCommunityBackground(firstBackground->communityBackground());
+            }
         }
+        backgrounds.insert(w, geometry);
     }
 }
 
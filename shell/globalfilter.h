@@ -27,6 +27,7 @@
 #include <QSound>
 #include <QSettings>
 #include "background.h"
+#include "screentopology.h"
 
 class GlobalFilter : public QObject
 {
@@ -35,7 +36,6 @@ public:
     explicit GlobalFilter(QApplication *application, QObject *parent = 0);
 
 signals:
-    void removeBackgrounds();
     void changeBackgrounds();
 
 public slots:
@@ -47,6 +47,7 @@ private:
     bool eventFilter(QObject *object, QEvent *event);
 
     QSound* clickSound;
+    QMap<Background*, QRect> backgrounds;
 };
 
 #endif // GLOBALFILTER_H
@@ -19,8 +19,11 @@
  * *************************************/
 
 #include "infopanedropdown.h"
+#include "startuptrace.h"
 #include "ui_infopanedropdown.h"
 #include "internationalisation.h"
+#include "soundeffects.h"
+#include "shellsettings.h"
 
 extern void playSound(QUrl, bool = false);
 extern QIcon getIconFromTheme(QString name, QColor textColor);
@@ -43,6 +46,7 @@ InfoPaneDropdown::InfoPaneDropdown(WId MainWindowId, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::InfoPaneDropdown)
 {
+    TRACE_SPAN("InfoPaneDropdown");
     if (false) {
         Q_UNUSED(QT_TR_NOOP("Location"));
     }
@@ -102,7 +106,7 @@ InfoPaneDropdown::InfoPaneDropdown(WId MainWindowId, QWidget *parent) :
     connect(updbus, &UPowerDBus::powerStretchChanged, [=](bool isOn) {
         ui->PowerStretchSwitch->setChecked(isOn);
         emit batteryStretchChanged(isOn);
-        doNetworkCheck();
+        ConnectivityMonitor::instance()->setPaused(isOn);
 
         if (isOn) {
             slice1.pause();
@@ -117,7 +121,6 @@ InfoPaneDropdown::InfoPaneDropdown(WId MainWindowId, QWidget *parent) :
 
     ui->label_7->setVisible(false);
     ui->pushButton_3->setVisible(false);
-    ui->BatteryChargeScrollBar->setVisible(false);
     ui->appNotificationsConfigureLock->setVisible(false);
     ui->dstPanel->setVisible(false);
     ui->quietModeExtras->setFixedHeight(0);
@@ -159,6 +162,32 @@ InfoPaneDropdown::InfoPaneDropdown(WId MainWindowId, QWidget *parent) :
     batteryChartView->setRenderHint(QPainter::Antialiasing);
     ((QBoxLayout*) ui->batteryGraph->layout())->insertWidget(1, batteryChartView);
 
+    //The series and axes live as long as the chart; refreshing only replaces their points
+    batteryChartData = new QLineSeries;
+    batteryChartTimeRemainingData = new QLineSeries;
+    batteryChart->addSeries(batteryChartData);
+    batteryChart->addSeries(batteryChartTimeRemainingData);
+
+    xAxis = new QDateTimeAxis;
+    xAxis->setFormat("hh:mm");
+    xAxis->setTickCount(9);
+    batteryChart->addAxis(xAxis, Qt::AlignBottom);
+    batteryChartData->attachAxis(xAxis);
+    batteryChartTimeRemainingData->attachAxis(xAxis);
+
+    yAxis = new QValueAxis;
+    yAxis->setMin(0);
+    batteryChart->addAxis(yAxis, Qt::AlignLeft);
+    batteryChartData->attachAxis(yAxis);
+    batteryChartTimeRemainingData->attachAxis(yAxis);
+
+    connect(BatteryHistory::instance(), &BatteryHistory::historyChanged, this, [=](BatteryHistory::Kind kind) {
+        if (ui->appsGraphButton->isChecked() || kind != (ui->chargeGraphButton->isChecked() ? BatteryHistory::Charge : BatteryHistory::Rate)) return;
+
+        //Keep following the present unless the user has panned back
+        renderBatteryChart(ui->BatteryChargeScrollBar->value() == ui->BatteryChargeScrollBar->maximum());
+    });
+
     updateBatteryChart();
 
     //Check Redshift
@@ -201,6 +230,7 @@ InfoPaneDropdown::InfoPaneDropdown(WId MainWindowId, QWidget *parent) :
     //Set up networking
     QDBusInterface networkInterface("org.freedesktop.NetworkManager", "/org/freedesktop/NetworkManager", "org.freedesktop.NetworkManager", QDBusConnection::systemBus(), this);
     connect(ui->NetworkManager, SIGNAL(updateBarDisplay(QString,QIcon)), this, SIGNAL(networkLabelChanged(QString,QIcon)));
+    connect(ui->NetworkManager, SIGNAL(barRateChanged(QString)), this, SIGNAL(networkRateChanged(QString)));
 
     ui->WifiSwitch->setChecked(networkInterface.property("WirelessEnabled").toBool());
 
@@ -367,32 +397,32 @@ InfoPaneDropdown::InfoPaneDropdown(WId MainWindowId, QWidget *parent) :
     ui->lockScreenBackground->setText(lockScreenSettings->value("background", "/usr/share/tsscreenlock/triangles.svg").toString());
     //ui->lineEdit_2->setText(settings.value("startup/autostart", "").toString());
     ui->redshiftPause->setChecked(!settings.value("display/redshiftPaused", true).toBool());
-    ui->TouchFeedbackSwitch->setChecked(settings.value("input/touchFeedbackSound", false).toBool());
+    ui->TouchFeedbackSwitch->setChecked(ShellSettings::instance()->touchFeedbackSound());
     ui->SuperkeyGatewaySwitch->setChecked(settings.value("input/superkeyGateway", true).toBool());
-    ui->TextSwitch->setChecked(settings.value("bar/showText", true).toBool());
+    ui->TextSwitch->setChecked(ShellSettings::instance()->barShowText());
     ui->windowManager->setText(settings.value("startup/WindowManagerCommand", "kwin_x11").toString());
-    ui->barDesktopsSwitch->setChecked(settings.value("bar/showWindowsFromOtherDesktops", true).toBool());
+    ui->barDesktopsSwitch->setChecked(ShellSettings::instance()->barShowWindowsFromOtherDesktops());
     ui->MediaSwitch->setChecked(settings.value("notifications/mediaInsert", true).toBool());
-    ui->StatusBarSwitch->setChecked(settings.value("bar/statusBar", false).toBool());
+    ui->StatusBarSwitch->setChecked(ShellSettings::instance()->barStatusBar());
     ui->TouchInputSwitch->setChecked(settings.value("input/touch", false).toBool());
     ui->SuspendLockScreen->setChecked(settings.value("lockScreen/showOnSuspend", true).toBool());
     ui->LargeTextSwitch->setChecked(themeSettings->value("accessibility/largeText", false).toBool());
     ui->HighContrastSwitch->setChecked(themeSettings->value("accessibility/highcontrast", false).toBool());
     ui->systemAnimationsAccessibilitySwitch->setChecked(themeSettings->value("accessibility/systemAnimations", true).toBool());
     ui->CapsNumLockBellSwitch->setChecked(themeSettings->value("accessibility/bellOnCapsNumLock", false).toBool());
-    ui->TwentyFourHourSwitch->setChecked(settings.value("time/use24hour", true).toBool());
+    ui->TwentyFourHourSwitch->setChecked(ShellSettings::instance()->use24Hour());
     ui->AttenuateSwitch->setChecked(settings.value("notifications/attenuate", true).toBool());
-    ui->BarOnBottom->setChecked(!settings.value("bar/onTop", true).toBool());
-    ui->AutoShowBarSwitch->setChecked(settings.value("bar/autoshow", true).toBool());
-    ui->SoundFeedbackSoundSwitch->setChecked(settings.value("sound/feedbackSound", true).toBool());
-    ui->VolumeOverdriveSwitch->setChecked(settings.value("sound/volumeOverdrive", true).toBool());
+    ui->BarOnBottom->setChecked(!ShellSettings::instance()->barOnTop());
+    ui->AutoShowBarSwitch->setChecked(ShellSettings::instance()->barAutoshow());
+    ui->SoundFeedbackSoundSwitch->setChecked(ShellSettings::instance()->feedbackSound());
+    ui->VolumeOverdriveSwitch->setChecked(ShellSettings::instance()->volumeOverdrive());
     ui->batteryScreenOff->setValue(settings.value("power/batteryScreenOff", 15).toInt());
     ui->batterySuspend->setValue(settings.value("power/batterySuspend", 30).toInt());
     ui->powerScreenOff->setValue(settings.value("power/powerScreenOff", 30).toInt());
     ui->powerSuspend->setValue(settings.value("power/powerSuspend", 90).toInt());
     ui->sunlightRedshift->setChecked(settings.value("display/redshiftSunlightCycle", false).toBool());
     ui->EmphasiseAppSwitch->setChecked(settings.value("notifications/emphasiseApp", true).toBool());
-    ui->CompactBarSwitch->setChecked(settings.value("bar/compact", false).toBool());
+    ui->CompactBarSwitch->setChecked(ShellSettings::instance()->barCompact());
     ui->LocationMasterSwitch->setChecked(locationSettings->value("master/master", true).toBool());
     updateAccentColourBox();
     updateRedshiftTime();
@@ -424,11 +454,15 @@ InfoPaneDropdown::InfoPaneDropdown(WId MainWindowId, QWidget *parent) :
     connect(eventTimer, SIGNAL(timeout()), this, SLOT(processTimer()));
     eventTimer->start();
 
-    networkCheckTimer = new QTimer(this);
-    networkCheckTimer->setInterval(60000);
-    connect(networkCheckTimer, SIGNAL(timeout()), this, SLOT(doNetworkCheck()));
-    networkCheckTimer->start();
-    doNetworkCheck();
+    ConnectivityMonitor::instance()->setPaused(updbus->powerStretch());
+    connect(ConnectivityMonitor::instance(), SIGNAL(portalDetected()), this, SLOT(promptNetworkLogin()));
+    connect(ndbus, &NotificationsDBusAdaptor::ActionInvoked, this, [=](uint id, QString key) {
+        if (networkLoginNotification != 0 && id == networkLoginNotification && key == "login") {
+            networkLoginNotification = 0;
+            QProcess::startDetached("xdg-open http://nmcheck.gnome.org/");
+        }
+    });
+    connect(ShellSettings::instance(), SIGNAL(changed(QString,QVariant)), this, SLOT(shellSettingChanged(QString)));
 
     QObjectList allObjects;
     allObjects.append(this);
@@ -677,6 +711,10 @@ InfoPaneDropdown::InfoPaneDropdown(WId MainWindowId, QWidget *parent) :
     updateStruts();
     updateAutostart();
     updateDSTNotification();
+
+    if (SessionState::instance()->isRestored()) {
+        restoreTimerState();
+    }
 }
 
 InfoPaneDropdown::~InfoPaneDropdown()
@@ -712,24 +750,6 @@ void InfoPaneDropdown::bluetoothEnabledChanged() {
     ui->BluetoothSwitch->setChecked(QDBusInterface("org.thesuite.tsbt", "/org/thesuite/tsbt", "org.thesuite.tsbt", QDBusConnection::sessionBus()).property("BluetoothEnabled").toBool());
 }
 
-void InfoPaneDropdown::newNetworkDevice(QDBusObjectPath device) {
-    QDBusInterface *i = new QDBusInterface("org.freedesktop.NetworkManager", device.path(), "org.freedesktop.NetworkManager.Device", QDBusConnection::systemBus(), this);
-    if (i->property("DeviceType").toInt() == 2) { //WiFi Device
-        QDBusConnection::systemBus().connect("org.freedesktop.NetworkManager", device.path(), "org.freedesktop.NetworkManager.Device.Wireless", "AccessPointAdded", this, SLOT(getNetworks()));
-        QDBusConnection::systemBus().connect("org.freedesktop.NetworkManager", device.path(), "org.freedesktop.NetworkManager.Device.Wireless", "AccessPointRemoved", this, SLOT(getNetworks()));
-        QDBusConnection::systemBus().connect("org.freedesktop.NetworkManager", device.path(), "org.freedesktop.NetworkManager.Device", "StateChanged", this, SLOT(getNetworks()));
-    } else if (i->property("DeviceType").toInt() == 1) { //Wired Device
-        QDBusConnection::systemBus().connect("org.freedesktop.NetworkManager", device.path(), "org.freedesktop.NetworkManager.Device.Wired", "PropertiesChanged", this, SLOT(getNetworks()));
-    }
-    QDBusConnection::systemBus().connect("org.freedesktop.NetworkManager", device.path(), "org.freedesktop.DBus.Properties", "PropertiesChanged", this, SLOT(getNetworks()));
-
-    QDBusInterface *stats = new QDBusInterface("org.freedesktop.NetworkManager", device.path(), "org.freedesktop.NetworkManager.Device.Statistics", QDBusConnection::systemBus(), this);
-    stats->setProperty("RefreshRateMs", (uint) 1000);
-    getNetworks();
-    stats->deleteLater();
-    i->deleteLater();
-}
-
 void InfoPaneDropdown::on_WifiSwitch_toggled(bool checked)
 {
     QDBusInterface *i = new QDBusInterface("org.freedesktop.NetworkManager", "/org/freedesktop/NetworkManager", "org.freedesktop.NetworkManager", QDBusConnection::systemBus(), this);
@@ -998,7 +1018,7 @@ void InfoPaneDropdown::show(dropdownType showWith) {
     if (!this->isVisible()) {
         QRect screenGeometry = QApplication::desktop()->screenGeometry();
 
-        if (settings.value("bar/onTop", true).toBool()) {
+        if (ShellSettings::instance()->barOnTop()) {
             this->setGeometry(screenGeometry.x(), screenGeometry.y() - screenGeometry.height(), screenGeometry.width(), screenGeometry.height() + 1);
         } else {
             this->setGeometry(screenGeometry.x(), screenGeometry.bottom(), screenGeometry.width(), screenGeometry.height() + 1);
@@ -1017,7 +1037,7 @@ void InfoPaneDropdown::show(dropdownType showWith) {
         this->setFixedWidth(screenGeometry.width());
         this->setFixedHeight(screenGeometry.height() + 1);
 
-        if (settings.value("bar/onTop", true).toBool()) {
+        if (ShellSettings::instance()->barOnTop()) {
             previousDragY = -1;
         } else {
             previousDragY = screenGeometry.bottom();
@@ -1038,6 +1058,15 @@ void InfoPaneDropdown::show(dropdownType showWith) {
     ((RemindersListModel*) ui->RemindersList->model())->updateData();
 }
 
+void InfoPaneDropdown::reloadScreens() {
+    if (!this->isVisible()) return;
+
+    QRect screenGeometry = QApplication::desktop()->screenGeometry();
+    this->setFixedWidth(screenGeometry.width());
+    this->setFixedHeight(screenGeometry.height() + 1);
+    this->move(screenGeometry.x(), screenGeometry.y() - (ShellSettings::instance()->barOnTop() ? 0 : 1));
+}
+
 void InfoPaneDropdown::showNoAnimation() {
     QDialog::show();
     previousDragY = -1;
@@ -1049,7 +1078,7 @@ void InfoPaneDropdown::close() {
     tPropertyAnimation* a = new tPropertyAnimation(this, "geometry");
     a->setStartValue(this->geometry());
 
-    if (settings.value("bar/onTop", true).toBool()) {
+    if (ShellSettings::instance()->barOnTop()) {
         a->setEndValue(QRect(screenGeometry.x(), screenGeometry.y() - screenGeometry.height() + 1, this->width(), this->height()));
     } else {
         a->setEndValue(QRect(screenGeometry.x(), screenGeometry.bottom() + 1, this->width(), this->height()));
@@ -1106,6 +1135,14 @@ void InfoPaneDropdown::changeDropDown(dropdownType changeTo, bool doAnimation) {
             setHeaderColour(QColor(50, 50, 100));
         }
         break;
+    case Mixer:
+        ui->pageStack->setCurrentWidget(ui->mixerFrame, doAnimation);
+        if (ui->lightColorThemeRadio->isChecked()) {
+            setHeaderColour(QColor(0, 150, 150));
+        } else {
+            setHeaderColour(QColor(0, 50, 50));
+        }
+        break;
     case KDEConnect:
         ui->pageStack->setCurrentWidget(ui->kdeConnectFrame, doAnimation);
         if (ui->lightColorThemeRadio->isChecked()) {
@@ -1171,11 +1208,20 @@ void InfoPaneDropdown::on_batteryLabel_clicked()
     changeDropDown(Battery);
 }
 
+void InfoPaneDropdown::setNetworkRateVisible(bool visible) {
+    ui->NetworkManager->setBarRateVisible(visible);
+}
+
 void InfoPaneDropdown::on_networkLabel_clicked()
 {
     changeDropDown(Network);
 }
 
+void InfoPaneDropdown::on_mixerLabel_clicked()
+{
+    changeDropDown(Mixer);
+}
+
 void InfoPaneDropdown::on_notificationsLabel_clicked()
 {
     changeDropDown(Notifications);
@@ -1259,9 +1305,10 @@ void InfoPaneDropdown::startTimer(QTime time) {
                 ringtone->setPlaylist(playlist);
                 ringtone->play();
 
-                AudioMan->attenuateStreams();
+                AudioMan->duck(AudioManager::duckNotification);
             }
             updateTimers();
+            saveTimerState();
         } else {
             ui->label_7->setText(timeUntilTimeout.toString("HH:mm:ss"));
             updateTimers();
@@ -1269,6 +1316,7 @@ void InfoPaneDropdown::startTimer(QTime time) {
     });
     timer->start();
     updateTimers();
+    saveTimerState();
 }
 
 void InfoPaneDropdown::updateTimers() {
@@ -1296,7 +1344,7 @@ void InfoPaneDropdown::notificationClosed(uint id, uint reason) {
     Q_UNUSED(reason)
     if (id == timerNotificationId) {
         ringtone->stop();
-        AudioMan->restoreStreams();
+        AudioMan->unduck(AudioManager::duckNotification);
         timerNotificationId = 0;
     }
 }
@@ -1319,6 +1367,7 @@ void InfoPaneDropdown::on_pushButton_2_clicked()
             ui->pushButton_2->setText(tr("Pause"));
             ui->pushButton_2->setIcon(QIcon::fromTheme("chronometer-pause"));
         }
+        saveTimerState();
     }
 }
 
@@ -1334,6 +1383,7 @@ void InfoPaneDropdown::on_pushButton_3_clicked()
     ui->pushButton_3->setVisible(false);
     emit timerVisibleChanged(false);
     emit timerEnabledChanged(true);
+    saveTimerState();
 }
 
 void InfoPaneDropdown::on_pushButton_7_clicked()
@@ -1552,7 +1602,7 @@ void InfoPaneDropdown::mouseMoveEvent(QMouseEvent *event) {
 
         //innerRect.translate(event->localPos().toPoint().y() - mouseClickPoint, 0);
 
-        if (settings.value("bar/onTop", true).toBool()) {
+        if (ShellSettings::instance()->barOnTop()) {
             if (dragRect.bottom() >= screenGeometry.bottom()) {
                 dragRect.moveTo(screenGeometry.left(), screenGeometry.top());
             }
@@ -1574,20 +1624,20 @@ void InfoPaneDropdown::mouseReleaseEvent(QMouseEvent *event) {
         if (initialPoint - 5 > mouseClickPoint && initialPoint + 5 < mouseClickPoint) {
             tPropertyAnimation* a = new tPropertyAnimation(this, "geometry");
             a->setStartValue(this->geometry());
-            a->setEndValue(QRect(screenGeometry.x(), screenGeometry.y() - (settings.value("bar/onTop", true).toBool() ? 0 : 1), this->width(), this->height()));
+            a->setEndValue(QRect(screenGeometry.x(), screenGeometry.y() - (ShellSettings::instance()->barOnTop() ? 0 : 1), this->width(), this->height()));
             a->setEasingCurve(QEasingCurve::OutCubic);
             a->setDuration(500);
             connect(a, SIGNAL(finished()), a, SLOT(deleteLater()));
             a->start();
         } else {
-            /*if ((mouseMovedUp && settings.value("bar/onTop", true).toBool()) ||
-                    (!mouseMovedUp && !settings.value("bar/onTop", true).toBool())) {*/
-            if (mouseMovedUp == settings.value("bar/onTop", true).toBool()) {
+            /*if ((mouseMovedUp && ShellSettings::instance()->barOnTop()) ||
+                    (!mouseMovedUp && !ShellSettings::instance()->barOnTop())) {*/
+            if (mouseMovedUp == ShellSettings::instance()->barOnTop()) {
                 this->close();
             } else {
                 tPropertyAnimation* a = new tPropertyAnimation(this, "geometry");
                 a->setStartValue(this->geometry());
-                a->setEndValue(QRect(screenGeometry.x(), screenGeometry.y() - (settings.value("bar/onTop", true).toBool() ? 0 : 1), this->width(), this->height()));
+                a->setEndValue(QRect(screenGeometry.x(), screenGeometry.y() - (ShellSettings::instance()->barOnTop() ? 0 : 1), this->width(), this->height()));
                 a->setEasingCurve(QEasingCurve::OutCubic);
                 a->setDuration(500);
                 connect(a, SIGNAL(finished()), a, SLOT(deleteLater()));
@@ -1602,7 +1652,7 @@ void InfoPaneDropdown::mouseReleaseEvent(QMouseEvent *event) {
 
 void InfoPaneDropdown::on_TouchFeedbackSwitch_toggled(bool checked)
 {
-    settings.setValue("input/touchFeedbackSound", checked);
+    ShellSettings::instance()->setValue("input/touchFeedbackSound", checked);
 }
 
 void InfoPaneDropdown::on_brightnessSlider_sliderMoved(int position)
@@ -1674,7 +1724,7 @@ void InfoPaneDropdown::on_lockScreenBackground_textEdited(const QString &arg1)
 
 void InfoPaneDropdown::on_TextSwitch_toggled(bool checked)
 {
-    settings.setValue("bar/showText", checked);
+    ShellSettings::instance()->setValue("bar/showText", checked);
 }
 
 void InfoPaneDropdown::on_windowManager_textEdited(const QString &arg1)
@@ -1684,7 +1734,7 @@ void InfoPaneDropdown::on_windowManager_textEdited(const QString &arg1)
 
 void InfoPaneDropdown::on_barDesktopsSwitch_toggled(bool checked)
 {
-    settings.setValue("bar/showWindowsFromOtherDesktops", checked);
+    ShellSettings::instance()->setValue("bar/showWindowsFromOtherDesktops", checked);
 }
 
 void InfoPaneDropdown::on_BluetoothSwitch_toggled(bool checked)
@@ -1727,6 +1777,7 @@ void InfoPaneDropdown::on_pageStack_switchingFrame(int switchTo)
     ui->batteryLabel->setShowDisabled(true);
     ui->notificationsLabel->setShowDisabled(true);
     ui->networkLabel->setShowDisabled(true);
+    ui->mixerLabel->setShowDisabled(true);
     //ui->printLabel->setShowDisabled(true);
     ui->kdeconnectLabel->setShowDisabled(true);
 
@@ -1738,6 +1789,8 @@ void InfoPaneDropdown::on_pageStack_switchingFrame(int switchTo)
         ui->notificationsLabel->setShowDisabled(false);
     } else if (switchingWidget == ui->networkFrame) {
         ui->networkLabel->setShowDisabled(false);
+    } else if (switchingWidget == ui->mixerFrame) {
+        ui->mixerLabel->setShowDisabled(false);
     /*} else if (switchingWidget == ui->printFrame) {
         ui->printLabel->setShowDisabled(false);*/
     } else if (switchingWidget == ui->kdeConnectFrame) {
@@ -1783,11 +1836,66 @@ void InfoPaneDropdown::on_stopwatchStart_clicked()
         ui->stopwatchStart->setText(tr("Stop"));
         ui->stopwatchStart->setIcon(QIcon::fromTheme("chronometer-pause"));
     }
+    saveTimerState();
 }
 
 void InfoPaneDropdown::on_stopwatchReset_clicked()
 {
     stopwatchTimeAdd = 0;
+    saveTimerState();
+}
+
+void InfoPaneDropdown::saveTimerState() {
+    //Store wall clock times so the timer and stopwatch keep counting while theShell is down
+    SessionState::Timers state;
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (timer != NULL) {
+        qint64 remaining = QTime(0, 0).msecsTo(timeUntilTimeout);
+        if (timer->isActive()) {
+            state.timer = SessionState::Timers::Running;
+            state.timerDeadline = now + remaining;
+        } else {
+            state.timer = SessionState::Timers::Paused;
+            state.timerRemaining = remaining;
+        }
+    }
+    state.lastTimer = lastTimer;
+
+    state.stopwatchRunning = stopwatchRunning;
+    state.stopwatchElapsed = stopwatchTimeAdd;
+    if (stopwatchRunning) {
+        state.stopwatchStarted = now - stopwatchTime.elapsed();
+    }
+    SessionState::instance()->setTimers(state);
+}
+
+void InfoPaneDropdown::restoreTimerState() {
+    SessionState::Timers state = SessionState::instance()->timers();
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    if (state.timer != SessionState::Timers::Stopped) {
+        qint64 remaining = state.timer == SessionState::Timers::Running ? state.timerDeadline - now : state.timerRemaining;
+
+        //The timer counts down in whole seconds; if it ran out while theShell was down, let it go off straight away
+        QTime time = QTime(0, 0).addSecs(qMax((remaining + 999) / 1000, (qint64) 1));
+        startTimer(time);
+        ui->label_7->setText(time.toString("HH:mm:ss"));
+        if (state.timer == SessionState::Timers::Paused) {
+            on_pushButton_2_clicked();
+        }
+    }
+
+    if (state.lastTimer.isValid()) {
+        lastTimer = state.lastTimer;
+        ui->timeEdit->setTime(lastTimer);
+    }
+
+    stopwatchTimeAdd = state.stopwatchElapsed;
+    if (state.stopwatchRunning) {
+        stopwatchTimeAdd += now - state.stopwatchStarted;
+        on_stopwatchStart_clicked();
+    }
+    saveTimerState();
 }
 
 void InfoPaneDropdown::on_calendarTodayButton_clicked()
@@ -1839,234 +1947,130 @@ void InfoPaneDropdown::on_batteryChartUpdateButton_clicked()
     updateBatteryChart();
 }
 
-//DBus Battery Info Structure
-struct BatteryInfo {
-    uint time, state;
-    double value;
-};
-Q_DECLARE_METATYPE(BatteryInfo)
-
-const QDBusArgument &operator<<(QDBusArgument &argument, const BatteryInfo &info) {
-    argument.beginStructure();
-    argument << info.time << info.value << info.state;
-    argument.endStructure();
-    return argument;
-}
-
-const QDBusArgument &operator>>(const QDBusArgument &argument, BatteryInfo &info) {
-    argument.beginStructure();
-    argument >> info.time >> info.value >> info.state;
-    argument.endStructure();
-    return argument;
-}
-
-//DBus WakeupsInfo Structure
-struct WakeupsInfo {
-    bool process = false;
-    uint pid;
-    double wakeups;
-    QString path, description;
-};
-Q_DECLARE_METATYPE(WakeupsInfo)
-
-const QDBusArgument &operator<<(QDBusArgument &argument, const WakeupsInfo &info) {
-    argument.beginStructure();
-    argument << info.process << info.pid << info.wakeups << info.path << info.description;
-    argument.endStructure();
-    return argument;
-}
-
-const QDBusArgument &operator>>(const QDBusArgument &argument, WakeupsInfo &info) {
-    argument.beginStructure();
-    argument >> info.process >> info.pid >> info.wakeups >> info.path >> info.description;
-    argument.endStructure();
-    return argument;
-}
-
 void InfoPaneDropdown::updateBatteryChart() {
     if (ui->appsGraphButton->isChecked()) {
-        QDBusMessage dataMessage = QDBusMessage::createMethodCall("org.freedesktop.UPower", "/org/freedesktop/UPower/Wakeups", "org.freedesktop.UPower.Wakeups", "GetData");
-
-        QDBusReply<QDBusArgument> dataMessageArgument = QDBusConnection::systemBus().call(dataMessage);
-        QList<WakeupsInfo> wakeups;
-
-        if (dataMessageArgument.isValid()) {
-            QDBusArgument arrayArgument = dataMessageArgument.value();
-            arrayArgument.beginArray();
-            while (!arrayArgument.atEnd()) {
-                WakeupsInfo info;
-                arrayArgument >> info;
-
-                if (info.process) {
-                    int min = 0, max = wakeups.count();
-                    int insertIndex;
-
-                    while (max != min) {
-                        insertIndex = ((max - min) / 2) + min;
-                        if (wakeups.at(insertIndex).wakeups == info.wakeups) { //Goes here
-                            break;
-                        } else if (wakeups.at(insertIndex).wakeups < info.wakeups) { //Needs to go on left hand side
-                            max = insertIndex - 1;
-                        } else if (wakeups.at(insertIndex).wakeups > info.wakeups) { //Needs to go on right hand side
-                            min = insertIndex + 1;
-                        }
-                    }
-
-                    wakeups.insert(insertIndex, info);
-                }
-            }
-            arrayArgument.endArray();
-
-            ui->appsGraph->clear();
-            for (WakeupsInfo wakeup : wakeups) {
-                QListWidgetItem* item = new QListWidgetItem;
-                item->setText("[" + QString::number(wakeup.pid) + "] " + wakeup.path + " (" + wakeup.description + ")");
-                ui->appsGraph->insertItem(0, item);
-            }
-        }
-
+        ui->appsGraph->refresh();
     } else {
-        for (QAbstractAxis* axis : batteryChart->axes()) {
-            batteryChart->removeAxis(axis);
-            axis->deleteLater();
+        //Draw what we already have straight away; anything new arrives through historyChanged
+        renderBatteryChart(true);
+        BatteryHistory::instance()->refresh();
+    }
+}
+
+void InfoPaneDropdown::renderBatteryChart(bool resetView) {
+    bool charge = ui->chargeGraphButton->isChecked();
+    QVector<BatteryHistory::Sample> history = BatteryHistory::instance()->samples(charge ? BatteryHistory::Charge : BatteryHistory::Rate);
+
+    QVector<QPointF> points;
+    points.reserve(history.count() + 1);
+    qint64 msecsSinceFull = -1;
+    uint lastState = -1;
+    bool takeNextSinceLastFull = false;
+    for (BatteryHistory::Sample info : history) {
+        qint64 msecs = info.time;
+        msecs = msecs * 1000;
+
+        if (info.value >= 90 && info.state == 2 && lastState == 1 && msecsSinceFull < msecs) {
+            takeNextSinceLastFull = true;
+        } else if (takeNextSinceLastFull) {
+            takeNextSinceLastFull = false;
+            msecsSinceFull = msecs;
         }
+        lastState = info.state;
 
-        QDBusMessage historyMessage = QDBusMessage::createMethodCall("org.freedesktop.UPower", updbus->defaultBattery().path(), "org.freedesktop.UPower.Device", "GetHistory");
-        QVariantList historyMessageArguments;
-
-        if (ui->chargeGraphButton->isChecked()) {
-            historyMessageArguments.append("charge");
-        } else {
-            historyMessageArguments.append("rate");
+        if (info.value != 0 && info.state != 0) {
+            points.append(QPointF(msecs, info.value));
         }
+    }
+    if (!points.isEmpty()) points.append(QPointF(QDateTime::currentMSecsSinceEpoch(), points.last().y()));
+    batteryChartPoints = points;
+
+    QPen dataPen;
+    dataPen.setColor(this->palette().color(QPalette::Highlight));
+    dataPen.setWidth(2 * getDPIScaling());
+    batteryChartData->setPen(dataPen);
+
+    batteryChartTimeRemainingData->setBrush(QBrush(this->palette().color(QPalette::Disabled, QPalette::WindowText)));
+    QPen remainingTimePen;
+    remainingTimePen.setColor(this->palette().color(QPalette::Disabled, QPalette::Highlight));
+    remainingTimePen.setDashPattern(QVector<qreal>() << 3 << 3);
+    remainingTimePen.setDashOffset(3);
+    remainingTimePen.setWidth(2 * getDPIScaling());
+    batteryChartTimeRemainingData->setPen(remainingTimePen);
+
+    QDateTime remainingTime = updbus->batteryTimeRemaining();
+    QVector<QPointF> projected;
+    if (!points.isEmpty() && remainingTime.isValid() && ui->batteryChartShowProjected->isChecked() && charge) {
+        projected.append(points.last());
+        projected.append(QPointF(points.last().x() + remainingTime.toMSecsSinceEpoch(), updbus->charging() ? 100 : 0));
+    }
+    batteryChartTimeRemainingData->replace(projected);
+
+    xAxis->setLabelsColor(this->palette().color(QPalette::WindowText));
+    yAxis->setLabelsColor(this->palette().color(QPalette::WindowText));
+    if (charge) {
+        yAxis->setLabelFormat("%i%%");
+        yAxis->setMax(100);
+    } else {
+        yAxis->setLabelFormat("%i W");
+        yAxis->setMax(40);
+    }
 
-        historyMessageArguments.append((uint) 0); //Get surplus data so we can plot some data off the left of the graph
-        historyMessageArguments.append((uint) 10000);
-        historyMessage.setArguments(historyMessageArguments);
-
-        QDBusReply<QDBusArgument> historyArgument = QDBusConnection::systemBus().call(historyMessage);
-
-        QLineSeries* batteryChartData = new QLineSeries;
-        QPen dataPen;
-        dataPen.setColor(this->palette().color(QPalette::Highlight));
-        dataPen.setWidth(2 * getDPIScaling());
-        batteryChartData->setPen(dataPen);
-
-        QLineSeries* batteryChartTimeRemainingData = new QLineSeries;
-        //batteryChartTimeRemainingData->setColor(this->palette().color(QPalette::Disabled, QPalette::WindowText));
-        batteryChartTimeRemainingData->setBrush(QBrush(this->palette().color(QPalette::Disabled, QPalette::WindowText)));
-
-        QPen remainingTimePen;
-        remainingTimePen.setColor(this->palette().color(QPalette::Disabled, QPalette::Highlight));
-        remainingTimePen.setDashPattern(QVector<qreal>() << 3 << 3);
-        remainingTimePen.setDashOffset(3);
-        remainingTimePen.setWidth(2 * getDPIScaling());
-        batteryChartTimeRemainingData->setPen(remainingTimePen);
-
-        QDateTime remainingTime = updbus->batteryTimeRemaining();
-
-        int firstDateTime = QDateTime::currentSecsSinceEpoch() / 60;
-        qint64 msecsSinceFull = -1;
-        uint lastState = -1;
-        bool takeNextSinceLastFull = false;
-        if (historyArgument.isValid()) {
-            QDBusArgument arrayArgument = historyArgument.value();
-            arrayArgument.beginArray();
-            while (!arrayArgument.atEnd()) {
-                BatteryInfo info;
-                arrayArgument >> info;
-
-                qint64 msecs = info.time;
-                msecs = msecs * 1000;
-
-                if (info.value >= 90 && info.state == 2 && lastState == 1 && msecsSinceFull < msecs) {
-                    takeNextSinceLastFull = true;
-                } else if (takeNextSinceLastFull) {
-                    takeNextSinceLastFull = false;
-                    msecsSinceFull = msecs;
-                }
-                lastState = info.state;
-
-                if (info.value != 0 && info.state != 0) {
-                    batteryChartData->append(msecs, info.value);
-                    if (firstDateTime > info.time / 60) {
-                        firstDateTime = info.time / 60;
-                    }
-                }
-            }
-            arrayArgument.endArray();
-            batteryChartData->append(QDateTime::currentMSecsSinceEpoch(), batteryChartData->at(batteryChartData->count() - 1).y());
-
-            if (remainingTime.isValid() && ui->batteryChartShowProjected->isChecked() && ui->chargeGraphButton->isChecked()) {
-                QDateTime lastDateTime = QDateTime::fromMSecsSinceEpoch(batteryChartData->at(batteryChartData->count() - 1).x());
-                batteryChartTimeRemainingData->append(batteryChartData->at(batteryChartData->count() - 1));
-                QDateTime endDateTime = lastDateTime.addMSecs(remainingTime.toMSecsSinceEpoch());
-                if (updbus->charging()) {
-                    batteryChartTimeRemainingData->append(endDateTime.toMSecsSinceEpoch(), 100);
-                } else {
-                    batteryChartTimeRemainingData->append(endDateTime.toMSecsSinceEpoch(), 0);
-                }
-            }
-        }
-
-        batteryChart->removeAllSeries();
-        batteryChart->addSeries(batteryChartData);
-        batteryChart->addSeries(batteryChartTimeRemainingData);
-
-        xAxis = new QDateTimeAxis;
-        if (ui->chargeGraphButton->isChecked()) {
-            if (remainingTime.isValid() && ui->batteryChartShowProjected->isChecked()) {
-                xAxis->setMax(QDateTime::fromMSecsSinceEpoch(batteryChartData->at(batteryChartData->count() - 1).x()).addMSecs(remainingTime.toMSecsSinceEpoch()));
-            } else {
-                xAxis->setMax(QDateTime::currentDateTime());
-            }
+    if (resetView) {
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        qint64 min;
+        if (charge) {
+            batteryChartEnd = projected.isEmpty() ? now : (qint64) projected.last().x();
 
-            QDateTime oneDay = xAxis->max().addDays(-1);
-            if (msecsSinceFull == -1 || msecsSinceFull < oneDay.toMSecsSinceEpoch()) {
-                xAxis->setMin(oneDay);
+            qint64 oneDay = batteryChartEnd - 86400000;
+            if (msecsSinceFull == -1 || msecsSinceFull < oneDay) {
+                min = oneDay;
             } else {
-                xAxis->setMin(QDateTime::fromMSecsSinceEpoch(msecsSinceFull));
+                min = msecsSinceFull;
             }
         } else {
-            xAxis->setMax(QDateTime::currentDateTime());
-            xAxis->setMin(xAxis->max().addSecs(-43200)); //Half a day
+            batteryChartEnd = now;
+            min = batteryChartEnd - 43200000; //Half a day
         }
-        batteryChart->addAxis(xAxis, Qt::AlignBottom);
-        xAxis->setLabelsColor(this->palette().color(QPalette::WindowText));
-        xAxis->setFormat("hh:mm");
-        xAxis->setTickCount(9);
-        batteryChartData->attachAxis(xAxis);
-        batteryChartTimeRemainingData->attachAxis(xAxis);
-
-        /*connect(xAxis, &QDateTimeAxis::rangeChanged, [=](QDateTime min, QDateTime max) {
-            ui->BatteryChargeScrollBar->setMaximum(max.toMSecsSinceEpoch() - min.toMSecsSinceEpoch());
-        });*/
+        batteryChartWindow = batteryChartEnd - min;
 
+        //The scroll bar counts minutes back from the newest view to the oldest sample we have
+        qint64 first = points.isEmpty() ? min : qMin(min, (qint64) points.first().x());
         chartScrolling = true;
-        int currentSecsSinceEpoch = QDateTime::currentSecsSinceEpoch();
         ui->BatteryChargeScrollBar->setMinimum(0);
-        ui->BatteryChargeScrollBar->setMaximum(currentSecsSinceEpoch / 60 - firstDateTime);
-        ui->BatteryChargeScrollBar->setValue(currentSecsSinceEpoch / 60 - firstDateTime);
-        startValue = currentSecsSinceEpoch / 60 - firstDateTime;
+        ui->BatteryChargeScrollBar->setMaximum((min - first) / 60000);
+        ui->BatteryChargeScrollBar->setPageStep(batteryChartWindow / 60000);
+        ui->BatteryChargeScrollBar->setValue(ui->BatteryChargeScrollBar->maximum());
         chartScrolling = false;
+    }
 
-        QValueAxis* yAxis = new QValueAxis;
-        if (ui->chargeGraphButton->isChecked()) {
-            yAxis->setLabelFormat("%i%%");
-            yAxis->setMax(100);
-        } else {
-            yAxis->setLabelFormat("%i W");
-            yAxis->setMax(40);
-        }
+    showBatteryChartRange();
+    ui->batteryChartLastUpdate->setText(tr("Last updated %1").arg(QDateTime::currentDateTime().toString("hh:mm:ss")));
+}
 
-        yAxis->setMin(0);
-        yAxis->setLabelsColor(this->palette().color(QPalette::WindowText));
-        batteryChart->addAxis(yAxis, Qt::AlignLeft);
-        batteryChartData->attachAxis(yAxis);
-        batteryChartTimeRemainingData->attachAxis(yAxis);
+void InfoPaneDropdown::showBatteryChartRange() {
+    qint64 viewMax = batteryChartEnd - (qint64) (ui->BatteryChargeScrollBar->maximum() - ui->BatteryChargeScrollBar->value()) * 60000;
+    qint64 viewMin = viewMax - batteryChartWindow;
+    xAxis->setRange(QDateTime::fromMSecsSinceEpoch(viewMin), QDateTime::fromMSecsSinceEpoch(viewMax));
 
-        ui->batteryChartLastUpdate->setText(tr("Last updated %1").arg(QDateTime::currentDateTime().toString("hh:mm:ss")));
+    //Only hand the chart what it can show: the visible samples and one either side, reduced to about a point per pixel
+    auto begin = std::lower_bound(batteryChartPoints.constBegin(), batteryChartPoints.constEnd(), viewMin, [](const QPointF& point, qint64 time) {
+        return point.x() < time;
+    });
+    auto end = std::upper_bound(begin, batteryChartPoints.constEnd(), viewMax, [](qint64 time, const QPointF& point) {
+        return time < point.x();
+    });
+    if (begin != batteryChartPoints.constBegin()) begin--;
+    if (end != batteryChartPoints.constEnd()) end++;
+
+    QVector<QPointF> visible;
+    visible.reserve(end - begin);
+    for (auto i = begin; i != end; i++) {
+        visible.append(*i);
     }
+
+    int width = batteryChart->plotArea().width() > 0 ? batteryChart->plotArea().width() : 500;
+    batteryChartData->replace(BatteryHistory::downsample(visible, width));
 }
 
 void InfoPaneDropdown::on_batteryChartShowProjected_toggled(bool checked)
@@ -2086,87 +2090,32 @@ void InfoPaneDropdown::on_PowerStretchSwitch_toggled(bool checked)
     emit batteryStretchChanged(checked);
 }
 
-void InfoPaneDropdown::doNetworkCheck() {
-    if (updbus->powerStretch()) {
-        //Always set networkOk to ok because we don't update when power stretch is on
-        networkOk = Ok;
-    } else {
-        //Do some network checks to see if network is working
-
-        QDBusInterface i("org.freedesktop.NetworkManager", "/org/freedesktop/NetworkManager", "org.freedesktop.NetworkManager", QDBusConnection::systemBus(), this);
-        int connectivity = i.property("Connectivity").toUInt();
-        if (connectivity == 2) {
-            if (networkOk != BehindPortal) {
-                //Notify user that they are behind a portal.
-                //Wait 10 seconds for startup or for connection notification
-
-                QTimer::singleShot(10000, [=] {
-                    QStringList actions;
-                    actions.append("login");
-                    actions.append(tr("Log in to network"));
-
-                    QVariantMap hints;
-                    hints.insert("category", "network.connected");
-                    hints.insert("transient", true);
-
-                    uint notificationId = ndbus->Notify("theShell", 0, "", tr("Network Login"),
-                                               tr("Your connection to the internet is blocked by a login page."),
-                                               actions, hints, 30000);
-                    connect(ndbus, &NotificationsDBusAdaptor::ActionInvoked, [=](uint id, QString key) {
-                        if (notificationId == id && key == "login") {
-                            QProcess::startDetached("xdg-open http://nmcheck.gnome.org/");
-                        }
-                    });
-                });
-            }
-
-            networkOk = BehindPortal;
-
-            //Reload the connectivity status
-            i.asyncCall("CheckConnectivity");
-            return;
-        } else if (connectivity == 3) {
-            networkOk = Unspecified;
-
-            //Reload the connectivity status
-            i.asyncCall("CheckConnectivity");
-            return;
-        } else {
-            networkOk = Ok;
-        }
-
-        QNetworkAccessManager* manager = new QNetworkAccessManager;
-        if (manager->networkAccessible() == QNetworkAccessManager::NotAccessible) {
-            networkOk = Unspecified;
-            manager->deleteLater();
+void InfoPaneDropdown::promptNetworkLogin() {
+    //Notify user that they are behind a portal.
+    //Wait 10 seconds for startup or for connection notification
+    QTimer::singleShot(10000, this, [=] {
+        if (ConnectivityMonitor::instance()->connectivity() != ConnectivityMonitor::Portal) return;
 
-            //Reload the connectivity status
-            i.asyncCall("CheckConnectivity");
-            return;
-        }
-        manager->deleteLater();
+        QStringList actions;
+        actions.append("login");
+        actions.append(tr("Log in to network"));
 
-        //For some reason this crashes theShell so let's not do this (for now)
-        /*connect(manager, &QNetworkAccessManager::finished, [=](QNetworkReply* reply) {
-            if (reply->error() != QNetworkReply::NoError) {
-                networkOk = false;
-            } else {
-                networkOk = true;
-            }
-            manager->deleteLater();
-        });
-        manager->get(QNetworkRequest(QUrl("http://vicr123.github.io/")));*/
+        QVariantMap hints;
+        hints.insert("category", "network.connected");
+        hints.insert("transient", true);
 
-        //Reload the connectivity status
-        i.asyncCall("CheckConnectivity");
-    }
+        //Replace any earlier prompt rather than stacking them up
+        networkLoginNotification = ndbus->Notify("theShell", networkLoginNotification, "", tr("Network Login"),
+                                   tr("Your connection to the internet is blocked by a login page."),
+                                   actions, hints, 30000);
+    });
 }
 
 void InfoPaneDropdown::dragDown(dropdownType showWith, int y) {
     changeDropDown(showWith, false);
     QRect screenGeometry = QApplication::desktop()->screenGeometry();
 
-    if (settings.value("bar/onTop", true).toBool()) {
+    if (ShellSettings::instance()->barOnTop()) {
         this->setGeometry(screenGeometry.x(), screenGeometry.y() - screenGeometry.height() + y, screenGeometry.width(), screenGeometry.height() + 1);
     } else {
         this->setGeometry(screenGeometry.x(), screenGeometry.top() + y + screenGeometry.y(), screenGeometry.width(), screenGeometry.height() + 1);
@@ -2201,13 +2150,13 @@ void InfoPaneDropdown::dragDown(dropdownType showWith, int y) {
 void InfoPaneDropdown::completeDragDown() {
     QRect screenGeometry = QApplication::desktop()->screenGeometry();
 
-    if ((QCursor::pos().y() - screenGeometry.top() < previousDragY && settings.value("bar/onTop", true).toBool()) ||
-            (QCursor::pos().y() - screenGeometry.top() > previousDragY && !settings.value("bar/onTop", true).toBool())) {
+    if ((QCursor::pos().y() - screenGeometry.top() < previousDragY && ShellSettings::instance()->barOnTop()) ||
+            (QCursor::pos().y() - screenGeometry.top() > previousDragY && !ShellSettings::instance()->barOnTop())) {
         this->close();
     } else {
         tPropertyAnimation* a = new tPropertyAnimation(this, "geometry");
         a->setStartValue(this->geometry());
-        a->setEndValue(QRect(screenGeometry.x(), screenGeometry.y() - (settings.value("bar/onTop", true).toBool() ? 0 : 1), this->width(), screenGeometry.height() + 1));
+        a->setEndValue(QRect(screenGeometry.x(), screenGeometry.y() - (ShellSettings::instance()->barOnTop() ? 0 : 1), this->width(), screenGeometry.height() + 1));
         a->setEasingCurve(QEasingCurve::OutCubic);
         a->setDuration(500);
         connect(a, SIGNAL(finished()), a, SLOT(deleteLater()));
@@ -2217,23 +2166,18 @@ void InfoPaneDropdown::completeDragDown() {
 
 void InfoPaneDropdown::on_notificationSoundBox_currentIndexChanged(int index)
 {
-    QSoundEffect* sound = new QSoundEffect();
     switch (index) {
         case 0:
             settings.setValue("notifications/sound", "tripleping");
-            sound->setSource(QUrl("qrc:/sounds/notifications/tripleping.wav"));
             break;
         case 1:
             settings.setValue("notifications/sound", "upsidedown");
-            sound->setSource(QUrl("qrc:/sounds/notifications/upsidedown.wav"));
             break;
         case 2:
             settings.setValue("notifications/sound", "echo");
-            sound->setSource(QUrl("qrc:/sounds/notifications/echo.wav"));
             break;
     }
-    sound->play();
-    connect(sound, SIGNAL(playingChanged()), sound, SLOT(deleteLater()));
+    SoundEffects::instance()->play(SoundEffects::notificationSound(settings.value("notifications/sound", "tripleping").toString()));
 }
 
 void InfoPaneDropdown::setupUsersSettingsPane() {
@@ -2634,8 +2578,7 @@ void InfoPaneDropdown::on_localeList_currentRowChanged(int currentRow)
 
 void InfoPaneDropdown::on_StatusBarSwitch_toggled(bool checked)
 {
-    settings.setValue("bar/statusBar", checked);
-    updateStruts();
+    ShellSettings::instance()->setValue("bar/statusBar", checked);
 
     ui->AutoShowBarLabel->setEnabled(checked);
     ui->AutoShowBarSwitch->setEnabled(checked);
@@ -2818,11 +2761,9 @@ void InfoPaneDropdown::on_SuspendLockScreen_toggled(bool checked)
 
 void InfoPaneDropdown::on_BatteryChargeScrollBar_valueChanged(int value)
 {
+    Q_UNUSED(value)
     if (!chartScrolling) {
-        chartScrolling = true;
-        batteryChart->scroll(value - startValue, 0);
-        startValue = value;
-        chartScrolling = false;
+        showBatteryChartRange();
     }
 }
 
@@ -2914,7 +2855,7 @@ void InfoPaneDropdown::on_FlightSwitch_toggled(bool checked)
 
 void InfoPaneDropdown::on_TwentyFourHourSwitch_toggled(bool checked)
 {
-    settings.setValue("time/use24hour", checked);
+    ShellSettings::instance()->setValue("time/use24hour", checked);
 }
 
 void InfoPaneDropdown::on_systemIconTheme_currentIndexChanged(int index)
@@ -3007,14 +2948,54 @@ void InfoPaneDropdown::on_AttenuateSwitch_toggled(bool checked)
 
 void InfoPaneDropdown::on_BarOnBottom_toggled(bool checked)
 {
-    settings.setValue("bar/onTop", !checked);
-    updateStruts();
+    ShellSettings::instance()->setValue("bar/onTop", !checked);
+}
+
+void InfoPaneDropdown::shellSettingChanged(QString key) {
+    //Keep the switches in step with changes made elsewhere, like onboarding or another process
+    if (key == "bar/onTop") {
+        QSignalBlocker blocker(ui->BarOnBottom);
+        ui->BarOnBottom->setChecked(!ShellSettings::instance()->barOnTop());
+        updateStruts();
+    } else if (key == "bar/statusBar") {
+        QSignalBlocker blocker(ui->StatusBarSwitch);
+        bool statusBar = ShellSettings::instance()->barStatusBar();
+        ui->StatusBarSwitch->setChecked(statusBar);
+        ui->AutoShowBarLabel->setEnabled(statusBar);
+        ui->AutoShowBarSwitch->setEnabled(statusBar);
+        ui->AutoShowBarExplanation->setEnabled(statusBar);
+        updateStruts();
+    } else if (key == "bar/autoshow") {
+        QSignalBlocker blocker(ui->AutoShowBarSwitch);
+        ui->AutoShowBarSwitch->setChecked(ShellSettings::instance()->barAutoshow());
+    } else if (key == "bar/compact") {
+        QSignalBlocker blocker(ui->CompactBarSwitch);
+        ui->CompactBarSwitch->setChecked(ShellSettings::instance()->barCompact());
+    } else if (key == "bar/showText") {
+        QSignalBlocker blocker(ui->TextSwitch);
+        ui->TextSwitch->setChecked(ShellSettings::instance()->barShowText());
+    } else if (key == "bar/showWindowsFromOtherDesktops") {
+        QSignalBlocker blocker(ui->barDesktopsSwitch);
+        ui->barDesktopsSwitch->setChecked(ShellSettings::instance()->barShowWindowsFromOtherDesktops());
+    } else if (key == "time/use24hour") {
+        QSignalBlocker blocker(ui->TwentyFourHourSwitch);
+        ui->TwentyFourHourSwitch->setChecked(ShellSettings::instance()->use24Hour());
+    } else if (key == "sound/feedbackSound") {
+        QSignalBlocker blocker(ui->SoundFeedbackSoundSwitch);
+        ui->SoundFeedbackSoundSwitch->setChecked(ShellSettings::instance()->feedbackSound());
+    } else if (key == "sound/volumeOverdrive") {
+        QSignalBlocker blocker(ui->VolumeOverdriveSwitch);
+        ui->VolumeOverdriveSwitch->setChecked(ShellSettings::instance()->volumeOverdrive());
+    } else if (key == "input/touchFeedbackSound") {
+        QSignalBlocker blocker(ui->TouchFeedbackSwitch);
+        ui->TouchFeedbackSwitch->setChecked(ShellSettings::instance()->touchFeedbackSound());
+    }
 }
 
 void InfoPaneDropdown::updateStruts() {
     emit updateStrutsSignal();
 
-    if (settings.value("bar/onTop", true).toBool()) {
+    if (ShellSettings::instance()->barOnTop()) {
         ((QBoxLayout*) this->layout())->setDirection(QBoxLayout::TopToBottom);
         ((QBoxLayout*) ui->partFrame->layout())->setDirection(QBoxLayout::TopToBottom);
         ((QBoxLayout*) ui->settingsFrame->layout())->setDirection(QBoxLayout::TopToBottom);
@@ -3049,11 +3030,11 @@ void InfoPaneDropdown::on_decorativeColorThemeRadio_toggled(bool checked)
 }
 
 void InfoPaneDropdown::on_SoundFeedbackSoundSwitch_toggled(bool checked) {
-    settings.setValue("sound/feedbackSound", checked);
+    ShellSettings::instance()->setValue("sound/feedbackSound", checked);
 }
 
 void InfoPaneDropdown::on_VolumeOverdriveSwitch_toggled(bool checked) {
-    settings.setValue("sound/volumeOverdrive", checked);
+    ShellSettings::instance()->setValue("sound/volumeOverdrive", checked);
 }
 
 void InfoPaneDropdown::updateAccentColourBox() {
@@ -3107,7 +3088,7 @@ void InfoPaneDropdown::on_dpi300_toggled(bool checked)
 
 void InfoPaneDropdown::on_AutoShowBarSwitch_toggled(bool checked)
 {
-    settings.setValue("bar/autoshow", checked);
+    ShellSettings::instance()->setValue("bar/autoshow", checked);
 }
 
 void InfoPaneDropdown::on_userSettingsAdminAccount_toggled(bool checked)
@@ -3132,7 +3113,7 @@ void InfoPaneDropdown::notificationAction(uint id, QString action) {
         QTime lastTimer = this->lastTimer;
 
         ringtone->stop();
-        AudioMan->restoreStreams();
+        AudioMan->unduck(AudioManager::duckNotification);
         timerNotificationId = 0;
 
         if (action == "+0.5") {
@@ -3707,7 +3688,7 @@ void InfoPaneDropdown::updateGeoclueLocation() {
 void InfoPaneDropdown::paintEvent(QPaintEvent *event) {
     QPainter painter(this);
     painter.setPen(this->palette().color(QPalette::WindowText));
-    if (settings.value("bar/onTop", true).toBool()) {
+    if (ShellSettings::instance()->barOnTop()) {
         painter.drawLine(0, this->height() - 1, this->width(), this->height() - 1);
     } else {
         painter.drawLine(0, 0, this->width(), 0);
@@ -3774,6 +3755,7 @@ void InfoPaneDropdown::setHeaderColour(QColor col) {
             ui->clockLabel->setShowDisabled(ui->clockLabel->showDisabled());
             ui->batteryLabel->setShowDisabled(ui->batteryLabel->showDisabled());
             ui->networkLabel->setShowDisabled(ui->networkLabel->showDisabled());
+            ui->mixerLabel->setShowDisabled(ui->mixerLabel->showDisabled());
             ui->notificationsLabel->setShowDisabled(ui->notificationsLabel->showDisabled());
             ui->kdeconnectLabel->setShowDisabled(ui->kdeconnectLabel->showDisabled());
         });
@@ -3840,8 +3822,8 @@ void InfoPaneDropdown::on_EmphasiseAppSwitch_toggled(bool checked)
 
 void InfoPaneDropdown::on_CompactBarSwitch_toggled(bool checked)
 {
-    if (settings.value("bar/compact") != checked) {
-        settings.setValue("bar/compact", checked);
+    if (ShellSettings::instance()->barCompact() != checked) {
+        ShellSettings::instance()->setValue("bar/compact", checked);
 
         QMap<QString, QString> actions;
         actions.insert("logout", tr("Log Out Now"));
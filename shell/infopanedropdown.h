@@ -68,6 +68,9 @@
 #include "apps/appslistmodel.h"
 #include <QSpinBox>
 #include <polkit-qt5-1/PolkitQt1/Authority>
+#include "sessionstate.h"
+#include "networkmanager/connectivitymonitor.h"
+#include "batteryhistory.h"
 
 class UPowerDBus;
 
@@ -93,15 +96,10 @@ class InfoPaneDropdown : public QDialog
             Clock = 0,
             Battery = 1,
             Network = 2,
-            Notifications = 3,
-            KDEConnect = 4 //,
-            //Print = 5
-        };
-
-        enum networkAvailability {
-            Unspecified = 0,
-            Ok = 1,
-            BehindPortal = 2
+            Mixer = 3,
+            Notifications = 4,
+            KDEConnect = 5 //,
+            //Print = 6
         };
 
         void show(dropdownType showWith);
@@ -110,9 +108,12 @@ class InfoPaneDropdown : public QDialog
         void close();
         bool isTimerRunning();
         void completeDragDown();
+        void reloadScreens();
+        void setNetworkRateVisible(bool visible);
 
     signals:
         void networkLabelChanged(QString label, QIcon icon);
+        void networkRateChanged(QString rate);
         void closeNotification(int id);
         void numNotificationsChanged(int notifications);
         void timerChanged(QString timer);
@@ -127,6 +128,8 @@ class InfoPaneDropdown : public QDialog
         void newKeyboardLayoutMenuAvailable(QMenu* menu);
 
     private slots:
+        void shellSettingChanged(QString key);
+
         void on_pushButton_clicked();
 
         void on_pushButton_5_clicked();
@@ -139,6 +142,8 @@ class InfoPaneDropdown : public QDialog
 
         void on_networkLabel_clicked();
 
+        void on_mixerLabel_clicked();
+
         void on_notificationsLabel_clicked();
 
         void on_pushButton_2_clicked();
@@ -193,8 +198,6 @@ class InfoPaneDropdown : public QDialog
 
         void notificationClosed(uint id, uint reason);
 
-        void newNetworkDevice(QDBusObjectPath device);
-
         void on_TextSwitch_toggled(bool checked);
 
         void on_windowManager_textEdited(const QString &arg1);
@@ -243,6 +246,10 @@ class InfoPaneDropdown : public QDialog
 
         void updateBatteryChart();
 
+        void renderBatteryChart(bool resetView);
+
+        void showBatteryChartRange();
+
         void on_batteryChartUpdateButton_clicked();
 
         void on_batteryChartShowProjected_toggled(bool checked);
@@ -251,7 +258,7 @@ class InfoPaneDropdown : public QDialog
 
         void on_PowerStretchSwitch_toggled(bool checked);
 
-        void doNetworkCheck();
+        void promptNetworkLogin();
 
         void on_notificationSoundBox_currentIndexChanged(int index);
 
@@ -548,13 +555,14 @@ class InfoPaneDropdown : public QDialog
         QTimer* timer = NULL;
         int timerNotificationId = 0;
         QTimer* eventTimer;
+        uint networkLoginNotification = 0;
         QTime timeUntilTimeout;
         QTime lastTimer = QTime(0, 0);
         QTime startTime;
         void reject();
+        void saveTimerState();
+        void restoreTimerState();
 
-        QTimer* networkCheckTimer;
-        networkAvailability networkOk = Ok;
 
         QTime stopwatchTime;
         int stopwatchTimeAdd = 0;
@@ -575,9 +583,13 @@ class InfoPaneDropdown : public QDialog
         QMediaPlayer* ringtone;
 
         QChart* batteryChart;
+        QLineSeries* batteryChartData;
+        QLineSeries* batteryChartTimeRemainingData;
         QDateTimeAxis* xAxis;
+        QValueAxis* yAxis;
+        QVector<QPointF> batteryChartPoints;
+        qint64 batteryChartEnd = 0, batteryChartWindow = 0;
         bool chartScrolling = false;
-        int startValue;
 
         int previousDragY;
         WId MainWindowId;
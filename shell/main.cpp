@@ -18,8 +18,6 @@
  *
  * *************************************/
 
-#define UNW_LOCAL_ONLY
-
 #include "mainwindow.h"
 #include "background.h"
 #include "segfaultdialog.h"
@@ -28,13 +26,19 @@
 #include "onboarding.h"
 #include "tutorialwindow.h"
 #include "audiomanager.h"
+#include "soundeffects.h"
 #include "dbussignals.h"
 #include "screenrecorder.h"
+#include "startupmanager.h"
+#include "startuptrace.h"
+#include "sessionstate.h"
+#include "crashcapture.h"
 #include <iostream>
 //#include "dbusmenuregistrar.h"
 #include <nativeeventfilter.h>
 #include <QApplication>
 #include <QDBusServiceWatcher>
+#include <QDBusPendingCallWatcher>
 #include <QDesktopWidget>
 #include <QProcess>
 #include <QThread>
@@ -47,9 +51,8 @@
 #include <unistd.h>
 #include <X11/Xlib.h>
 #include <X11/extensions/dpms.h>
-#include <libunwind.h>
-#include <cxxabi.h>
 #include <QFile>
+#include <QDateTime>
 
 MainWindow* MainWin = NULL;
 NativeEventFilter* NativeFilter = NULL;
@@ -87,67 +90,6 @@ void raise_signal(QString message) {
     raise(SIGKILL);
 }
 
-QString getCallLocation(long pc) {
-    QProcess p;
-    p.start("addr2line -s -e \"" + QApplication::applicationFilePath() + "\" 0x" + QString::number(pc, 16));
-    p.waitForFinished();
-    return p.readAll();
-}
-
-void export_backtrace(QString header) {
-    unw_cursor_t cur;
-    unw_context_t ctx;
-
-    unw_getcontext(&ctx);
-    unw_init_local(&cur, &ctx);
-
-    //Start unwinding
-
-    QFile f(QDir::homePath() + "/.tsbacktrace");
-    f.open(QFile::WriteOnly);
-    f.write(header.toUtf8());
-
-
-    while (unw_step(&cur) > 0) {
-        unw_word_t offset;
-        unw_word_t pc;
-        unw_get_reg(&cur, UNW_REG_IP, &pc);
-        if (pc == 0) break;
-
-        char sym[256];
-        if (unw_get_proc_name(&cur, sym, sizeof(sym), &offset) == 0) {
-            char* nameptr = sym;
-            int status;
-            char* demangled = abi::__cxa_demangle(sym, nullptr, nullptr, &status);
-            if (status == 0) nameptr = demangled;
-
-            f.write(QString("0x" + QString::number(pc, 16) + ": " + QString::fromLocal8Bit(nameptr) + " " + getCallLocation(pc)).toUtf8());
-
-            std::free(demangled);
-        } else {
-            f.write(QString("0x" + QString::number(pc, 16) + ": ??\n").toUtf8());
-        }
-    }
-
-    f.close();
-}
-
-void catch_signal(int sig) {
-    if (sig == SIGSEGV) {
-        export_backtrace("Signal Received: SIGSEGV (Segmentation Fault)\n\n");
-    } else if (sig == SIGBUS) {
-        export_backtrace("Signal Received: SIGBUS (Bus Error)\n\n");
-    } else if (sig == SIGABRT) {
-        export_backtrace("Signal Received: SIGABRT (Aborted)\n\n");
-    } else if (sig == SIGILL) {
-        export_backtrace("Signal Received: SIGILL (Illegal Instruction)\n\n");
-    } else if (sig == SIGFPE) {
-        export_backtrace("Signal Received: SIGFPE (Floating Point Exception)\n\n");
-    }
-    signal(sig, SIG_DFL);
-    raise(sig);
-}
-
 void QtHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg) {
     switch (type) {
     case QtDebugMsg:
@@ -164,11 +106,7 @@ void QtHandler(QtMsgType type, const QMessageLogContext &context, const QString
 
 int main(int argc, char *argv[])
 {
-    signal(SIGSEGV, *catch_signal); //Catch SIGSEGV
-    signal(SIGBUS, *catch_signal); //Catch SIGBUS
-    signal(SIGABRT, *catch_signal); //Catch SIGABRT
-    signal(SIGILL, *catch_signal); //Catch SIGILL
-    signal(SIGFPE, *catch_signal); //Catch SIGFPE
+    CrashCapture::install(QDir::homePath() + "/.tscrashreport"); //Catch SIGSEGV, SIGBUS, SIGABRT, SIGILL and SIGFPE
 
     QSettings settings("theSuite", "theShell");
     //qputenv("GTK_THEME", settings.value("theme/gtktheme", "Contemporary").toByteArray());
@@ -178,7 +116,10 @@ int main(int argc, char *argv[])
 
     qInstallMessageHandler(QtHandler);
 
+    StartupTrace::mark("main");
+    StartupTrace::Span* applicationSpan = new StartupTrace::Span("QApplication");
     QApplication a(argc, argv);
+    delete applicationSpan;
 
     a.setOrganizationName("theSuite");
     a.setOrganizationDomain("");
@@ -244,6 +185,8 @@ int main(int argc, char *argv[])
     bool startWm = true;
     bool tutorialDoSettings = false;
     bool sessionStarter = false;
+    bool profileStartup = false;
+    bool restoreSession = false;
 
     QStringList args = a.arguments();
     args.removeFirst();
@@ -257,6 +200,8 @@ int main(int argc, char *argv[])
             qDebug() << "      --onboard                Start with onboarding screen";
             qDebug() << "      --tutorial               Show all tutorials";
             qDebug() << "      --debug                  Allows you to quit theShell instead of powering off";
+            qDebug() << "      --profile-startup        Write a startup trace to ~/.theshell-startup.json";
+            qDebug() << "      --restore-session        Pick up where a crashed theShell left off";
             qDebug() << "  -h, --help                   Show this help output";
             return 0;
         } else if (arg == "-a" || arg == "--no-autostart") {
@@ -271,10 +216,20 @@ int main(int argc, char *argv[])
             tutorialDoSettings = true;
         } else if (arg == "--session-starter-running") {
             sessionStarter = true;
+        } else if (arg == "--profile-startup") {
+            profileStartup = true;
+        } else if (arg == "--restore-session") {
+            restoreSession = true;
         }
     }
 
-    QEventLoop waiter;
+    //Components read whatever was restored as they're constructed
+    if (restoreSession && SessionState::instance()->restore()) {
+        //The window manager outlives theShell, so don't try to start another one
+        startWm = false;
+    } else {
+        SessionState::instance()->clear();
+    }
 
     if (QDBusConnection::sessionBus().interface()->registeredServiceNames().value().contains("org.thesuite.theshell")) {
         QString messageTitle = a.translate("main", "theShell already running");
@@ -304,6 +259,9 @@ int main(int argc, char *argv[])
     QDBusConnection dbus = QDBusConnection::sessionBus();
     dbus.registerService("org.thesuite.theshell");
 
+    //Notifications and duck requests can arrive as soon as we're on the bus, and both go straight to the audio manager
+    AudioMan = new AudioManager;
+
     QObject* notificationParent = new QObject();
     ndbus = new NotificationsDBusAdaptor(notificationParent);
 
@@ -312,119 +270,185 @@ int main(int argc, char *argv[])
 
     dbusSignals = new DBusSignals();
 
+    StartupManager* startup = new StartupManager();
+    startup->setProfiling(profileStartup);
+    auto loadKdedModule = [=](QString module) {
+        return [=](StartupManager::TaskFunction done) {
+            QDBusMessage message = QDBusMessage::createMethodCall("org.kde.kded5", "/kded", "org.kde.kded5", "loadModule");
+            message.setArguments(QVariantList() << module);
+            QDBusPendingCallWatcher* watcher = new QDBusPendingCallWatcher(QDBusConnection::sessionBus().asyncCall(message));
+            QObject::connect(watcher, &QDBusPendingCallWatcher::finished, [=] {
+                watcher->deleteLater();
+                done();
+            });
+        };
+    };
+
+    //kded modules load concurrently; anything that depends on screen layout copes with it changing later
     if (startKscreen) {
-        QDBusMessage kscreen = QDBusMessage::createMethodCall("org.kde.kded5", "/kded", "org.kde.kded5", "loadModule");
-        QVariantList args;
-        args.append("kscreen");
-        kscreen.setArguments(args);
-        QDBusConnection::sessionBus().call(kscreen);
-    }
-
-    {
-        QDBusMessage touchpad = QDBusMessage::createMethodCall("org.kde.kded5", "/kded", "org.kde.kded5", "loadModule");
-        QVariantList args;
-        args.append("touchpad");
-        touchpad.setArguments(args);
-        QDBusConnection::sessionBus().call(touchpad);
-    }
-
-    {
-        QDBusMessage sni = QDBusMessage::createMethodCall("org.kde.kded5", "/kded", "org.kde.kded5", "loadModule");
-        QVariantList args;
-        args.append("statusnotifierwatcher");
-        sni.setArguments(args);
-        QDBusConnection::sessionBus().call(sni);
+        startup->addAsyncTask("kscreen", QStringList(), loadKdedModule("kscreen"));
     }
-
-    QString windowManager = settings.value("startup/WindowManagerCommand", "kwin_x11").toString();
-
-    if (startWm) {
-        while (!QProcess::startDetached(windowManager)) {
-
-            QString messageTitle = a.translate("main", "Window Manager couldn't start");
-            QString messageBody = a.translate("main", "The window manager \"%1\" could not start. \n\n"
-                                                      "Enter the name or path of a window manager to attempt to start a different window"
-                                                      "manager, or hit 'Cancel' to start theShell without a window manager.").arg(windowManager);
-            if (sessionStarter) {
-                QFile out;
-                out.open(stdout, QFile::WriteOnly);
-                out.write(QString("PROMPT:%1:%2").arg(messageTitle, messageBody.replace("\n", "[newln]")).toLocal8Bit());
-                out.flush();
-                out.close();
-
-                std::string response;
-                std::cin >> response;
-
-                windowManager = QString::fromStdString(response).trimmed();
-            } else {
-                windowManager = QInputDialog::getText(0, messageTitle, messageBody);
-            }
-
-            if (windowManager == "" || windowManager == "[can]") {
-                break;
+    startup->addAsyncTask("touchpad", QStringList(), loadKdedModule("touchpad"));
+    startup->addAsyncTask("statusnotifierwatcher", QStringList(), loadKdedModule("statusnotifierwatcher"));
+
+    startup->addTask("wm", QStringList(), [=, &a, &settings] {
+        TRACE_SPAN("Window Manager");
+        QString windowManager = settings.value("startup/WindowManagerCommand", "kwin_x11").toString();
+
+        if (startWm) {
+            while (!QProcess::startDetached(windowManager)) {
+
+                QString messageTitle = a.translate("main", "Window Manager couldn't start");
+                QString messageBody = a.translate("main", "The window manager \"%1\" could not start. \n\n"
+                                                          "Enter the name or path of a window manager to attempt to start a different window"
+                                                          "manager, or hit 'Cancel' to start theShell without a window manager.").arg(windowManager);
+                if (sessionStarter) {
+                    QFile out;
+                    out.open(stdout, QFile::WriteOnly);
+                    out.write(QString("PROMPT:%1:%2").arg(messageTitle, messageBody.replace("\n", "[newln]")).toLocal8Bit());
+                    out.flush();
+                    out.close();
+
+                    std::string response;
+                    std::cin >> response;
+
+                    windowManager = QString::fromStdString(response).trimmed();
+                } else {
+                    windowManager = QInputDialog::getText(0, messageTitle, messageBody);
+                }
+
+                if (windowManager == "" || windowManager == "[can]") {
+                    break;
+                }
             }
         }
-    }
-
-    TutorialWin = new TutorialWindow(tutorialDoSettings);
-    AudioMan = new AudioManager;
-    screenRecorder = new ScreenRecorder;
-
-    if (!QDBusConnection::sessionBus().interface()->registeredServiceNames().value().contains("org.kde.kdeconnect") && QFile("/usr/lib/kdeconnectd").exists()) {
-        //Start KDE Connect if it is not running and it is existant on the PC
-        QProcess::startDetached("/usr/lib/kdeconnectd");
-    }
-
-    QProcess btProcess;
-    btProcess.start("ts-bt");
-    QObject::connect(&btProcess, SIGNAL(started()), &waiter, SLOT(quit()));
-    waiter.exec();
-    //Wait for ts-bt to start so that the Bluetooth toggle will work properly
-
-    locationServices = new LocationServices();
-
-    NativeFilter = new NativeEventFilter();
-    a.installNativeEventFilter(NativeFilter);
-
-    if (settings.value("startup/lastOnboarding", 0) < ONBOARDING_VERSION || startOnboarding) {
-        emit dbusSignals->Ready();
-        Onboarding* onboardingWindow = new Onboarding();
-        onboardingWindow->showFullScreen();
-        if (onboardingWindow->exec() == QDialog::Accepted) {
-            settings.setValue("startup/lastOnboarding", ONBOARDING_VERSION);
+    });
+
+    startup->addTask("audio", QStringList(), [=] {
+        TutorialWin = new TutorialWindow(tutorialDoSettings);
+        SoundEffects::instance();
+        screenRecorder = new ScreenRecorder;
+    });
+
+    startup->addTask("nativefilter", QStringList() << "audio", [=, &a] {
+        NativeFilter = new NativeEventFilter();
+        a.installNativeEventFilter(NativeFilter);
+    });
+
+    startup->addAsyncTask("onboarding", QStringList() << "wm" << "nativefilter", [=, &settings](StartupManager::TaskFunction done) {
+        if (settings.value("startup/lastOnboarding", 0) < ONBOARDING_VERSION || startOnboarding) {
+            emit dbusSignals->Ready();
+            Onboarding* onboardingWindow = new Onboarding();
+
+            //Don't spin a nested event loop here; the rest of startup carries on around the dialog
+            QObject::connect(onboardingWindow, &Onboarding::finished, [=, &settings](int result) {
+                onboardingWindow->deleteLater();
+                if (result == QDialog::Accepted) {
+                    settings.setValue("startup/lastOnboarding", ONBOARDING_VERSION);
+                } else {
+                    //Log out; quitting the event loop stops anything that depends on onboarding from starting
+                    QApplication::exit(0);
+                }
+                done();
+            });
+            onboardingWindow->showFullScreen();
         } else {
-            //Log out
-            return 0;
+            done();
+        }
+    });
+
+    startup->addTask("upower", QStringList(), [=] {
+        updbus = new UPowerDBus();
+    });
+
+    startup->addTask("bar", QStringList() << "audio" << "nativefilter" << "onboarding" << "upower" << "statusnotifierwatcher", [=] {
+        MainWin = new MainWindow();
+
+        qDBusRegisterMetaType<QList<QVariantMap>>();
+        qDBusRegisterMetaType<QMap<QString, QVariantMap>>();
+
+        QRect screenGeometry = QApplication::desktop()->screenGeometry();
+
+        MainWin->setWindowFlags(Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint | Qt::WindowDoesNotAcceptFocus);
+        MainWin->setGeometry(screenGeometry.x() - 1, screenGeometry.y(), screenGeometry.width() + 1, MainWin->height());
+        MainWin->show();
+    });
+
+    startup->addTask("backgrounds", QStringList() << "bar", [=, &a] {
+        new GlobalFilter(&a);
+    });
+
+    startup->addAsyncTask("firstpaint", QStringList() << "bar" << "backgrounds", [=](StartupManager::TaskFunction done) {
+        //Let the bar and backgrounds paint before we consider the session visible
+        QTimer::singleShot(0, [=] {
+            StartupTrace::mark("Ready");
+            emit dbusSignals->Ready();
+            done();
+        });
+    });
+    startup->setFirstPaintTask("firstpaint");
+
+    startup->addDeferredTask("kdeconnect", QStringList(), [=] {
+        if (!QDBusConnection::sessionBus().interface()->registeredServiceNames().value().contains("org.kde.kdeconnect") && QFile("/usr/lib/kdeconnectd").exists()) {
+            //Start KDE Connect if it is not running and it is existant on the PC
+            QProcess::startDetached("/usr/lib/kdeconnectd");
         }
+    });
+
+    startup->addDeferredTask("bluetooth", QStringList(), [=] {
+        //The Bluetooth toggle watches for ts-bt on the bus, so there's no need to wait for it
+        QProcess* btProcess = new QProcess(QApplication::instance());
+        btProcess->start("ts-bt");
+    });
+
+    startup->addDeferredTask("location", QStringList(), [=] {
+        locationServices = new LocationServices();
+    });
+
+    if (restoreSession) {
+        startup->addDeferredTask("crashreport", QStringList(), [=] {
+            //ts-startsession set the report aside when it brought us back; let the user know it's there
+            QString reportPath = QDir::homePath() + "/.tscrashreport.1";
+            CrashCapture::Report report = CrashCapture::load(reportPath);
+            if (report.valid && QDateTime::currentMSecsSinceEpoch() / 1000 - report.time < 300) {
+                ndbus->Notify("theShell", 0, "theshell", QApplication::translate("main", "theShell recovered from a crash"),
+                              QApplication::translate("main", "theShell was restarted after it stopped unexpectedly. A crash report has been saved to %1.").arg(reportPath),
+                              QStringList(), QVariantMap(), -1);
+            }
+        });
     }
 
-    updbus = new UPowerDBus();
-    MainWin = new MainWindow();
-
-    new GlobalFilter(&a);
-
-    qDBusRegisterMetaType<QList<QVariantMap>>();
-    qDBusRegisterMetaType<QMap<QString, QVariantMap>>();
-
-    QRect screenGeometry = QApplication::desktop()->screenGeometry();
-
-    MainWin->setWindowFlags(Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint | Qt::WindowDoesNotAcceptFocus);
-    MainWin->setGeometry(screenGeometry.x() - 1, screenGeometry.y(), screenGeometry.width() + 1, MainWin->height());
-    MainWin->show();
-
-    QTimer::singleShot(0, dbusSignals, SIGNAL(Ready()));
+    QObject::connect(startup, SIGNAL(finished()), startup, SLOT(deleteLater()));
+    if (profileStartup) {
+        QObject::connect(startup, &StartupManager::finished, [=] {
+            QString traceFile = QDir::homePath() + "/.theshell-startup.json";
+            StartupTrace::dump(traceFile);
+            std::cerr << "Startup trace written to " << traceFile.toStdString() << "\n";
+            std::cerr << StartupTrace::summary().toStdString();
+        });
+    }
+    QTimer::singleShot(0, startup, SLOT(start()));
 
     return a.exec();
 }
 
 void playSound(QUrl location, bool uncompressed = false) {
-    if (uncompressed) {
+    if (SoundEffects::instance()->isBundled(location)) {
+        SoundEffects::instance()->play(location);
+    } else if (uncompressed) {
         QSoundEffect* sound = new QSoundEffect();
         sound->setSource(location);
+        QObject::connect(sound, &QSoundEffect::playingChanged, sound, [=] {
+            if (!sound->isPlaying()) sound->deleteLater();
+        });
         sound->play();
     } else {
         QMediaPlayer* sound = new QMediaPlayer();
         sound->setMedia(location);
+        QObject::connect(sound, &QMediaPlayer::stateChanged, sound, [=](QMediaPlayer::State state) {
+            if (state == QMediaPlayer::StoppedState) sound->deleteLater();
+        });
+        QObject::connect(sound, static_cast<void (QMediaPlayer::*)(QMediaPlayer::Error)>(&QMediaPlayer::error), sound, &QMediaPlayer::deleteLater);
         sound->play();
     }
 }
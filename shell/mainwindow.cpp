@@ -20,6 +20,8 @@
 
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "soundeffects.h"
+#include "shellsettings.h"
 
 extern void playSound(QUrl, bool = false);
 extern QIcon getIconFromTheme(QString name, QColor textColor);
@@ -65,9 +67,7 @@ MainWindow::MainWindow(QWidget *parent) :
     });
 
     //Connect signals related to multiple monitor management
-    connect(QApplication::desktop(), SIGNAL(screenCountChanged(int)), this, SLOT(reloadScreens()));
-    connect(QApplication::desktop(), SIGNAL(resized(int)), this, SLOT(reloadScreens()));
-    connect(QApplication::desktop(), SIGNAL(primaryScreenChanged()), this, SLOT(reloadScreens()));
+    connect(ScreenTopology::instance(), SIGNAL(screensChanged()), this, SLOT(reloadScreens()));
 
     //Create the gateway and set required flags
     gatewayMenu = new Menu(this);
@@ -92,8 +92,21 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(timer, SIGNAL(timeout()), taskbarManager, SLOT(ReloadWindows()));
     timer->start();
 
+    //Keep the player that was selected before the restart rather than whichever one is found first
+    if (SessionState::instance()->isRestored() && SessionState::instance()->mprisPlayer() != "") {
+        setMprisCurrentApp(SessionState::instance()->mprisPlayer());
+    }
+
     infoPane = new InfoPaneDropdown(this->winId());
     connect(infoPane, SIGNAL(networkLabelChanged(QString,QIcon)), this, SLOT(internetLabelChanged(QString,QIcon)));
+    connect(infoPane, SIGNAL(networkRateChanged(QString)), this, SLOT(networkRateChanged(QString)));
+    connect(AudioMan, &AudioManager::masterVolumeChanged, this, [=](int volume) {
+        if (ui->volumeSlider->isVisible() && !ui->volumeSlider->isSliderDown()) {
+            ui->volumeSlider->blockSignals(true);
+            ui->volumeSlider->setValue(volume);
+            ui->volumeSlider->blockSignals(false);
+        }
+    });
     connect(infoPane, SIGNAL(numNotificationsChanged(int)), this, SLOT(numNotificationsChanged(int)));
     connect(infoPane, SIGNAL(timerChanged(QString)), this, SLOT(setTimer(QString)));
     connect(infoPane, SIGNAL(timerVisibleChanged(bool)), this, SLOT(setTimerVisible(bool)));
@@ -309,6 +322,13 @@ MainWindow::MainWindow(QWidget *parent) :
             ui->screenRecordingFrame->setVisible(false);
         }
     });
+    connect(screenRecorder, &ScreenRecorder::statsChanged, [=](ScreenRecorder::Stats stats) {
+        QString statsText = tr("%n fps", nullptr, qRound(stats.fps)) + " · " +
+                tr("%n dropped", nullptr, stats.droppedFrames) + " · " +
+                tr("%1 Mbps").arg(QString::number(stats.bitrate / 1000000, 'f', 1));
+        ui->screenRecordingActiveLabel->setText(tr("Recording Screen") + " · " + statsText);
+        ui->StatusBarRecording->setToolTip(statsText);
+    });
 
     ui->StatusBarFrame->setVisible(false);
     ui->StatusBarHoverFrame->setVisible(false);
@@ -385,7 +405,7 @@ void MainWindow::updateWindow(WmWindow window) {
 
     button->setProperty("windowid", QVariant::fromValue(window.WID()));
     button->setProperty("desktop", QVariant::fromValue(window.desktop()));
-    if (settings.value("bar/showText", true).toBool()) {
+    if (ShellSettings::instance()->barShowText()) {
         button->setFullText(window.title().replace("&", "&&"));
     } else {
         button->setFullText("");
@@ -550,6 +570,13 @@ void MainWindow::on_openMenu_clicked()
 
 void MainWindow::doUpdate() {
     QRect screenGeometry = QApplication::desktop()->screenGeometry();
+
+    //Only measure network throughput while the bar's network text is actually on screen
+    bool rateVisible = ui->networkLabel->isVisible() && screenGeometry.contains(QRect(ui->networkLabel->mapToGlobal(QPoint(0, 0)), ui->networkLabel->size()));
+    if (rateVisible != networkRateVisible) {
+        networkRateVisible = rateVisible;
+        infoPane->setNetworkRateVisible(rateVisible);
+    }
     Display* d = QX11Info::display();
 
     //Get the current desktop
@@ -885,7 +912,7 @@ void MainWindow::doUpdate() {
                 }
 
                 if (!skipTaskbar) {
-                    if (settings.value("bar/showWindowsFromOtherDesktops", true).toBool() ||
+                    if (ShellSettings::instance()->barShowWindowsFromOtherDesktops() ||
                                      w.desktop() == currentDesktop) {
                         if (!w.isMinimized() && windowx >= this->x() &&
                                 windowy - 50 <= screenGeometry.y() + this->height() &&
@@ -928,7 +955,7 @@ void MainWindow::doUpdate() {
 
             button->setProperty("windowid", QVariant::fromValue(w.WID()));
             button->setProperty("desktop", QVariant::fromValue(w.desktop()));
-            if (settings.value("bar/showText", true).toBool()) {
+            if (ShellSettings::instance()->barShowText()) {
                 button->setFullText(w.title().replace("&", "&&"));
             }
             button->setContextMenuPolicy(Qt::CustomContextMenu);
@@ -1026,8 +1053,8 @@ void MainWindow::doUpdate() {
 
     if (!lockHide && !this->property("animating").toBool()) { //Check for move lock
         int highestWindow, dockTop;
-        if (settings.value("bar/onTop", true).toBool()) {
-            if (settings.value("bar/statusBar", false).toBool()) {
+        if (ShellSettings::instance()->barOnTop()) {
+            if (ShellSettings::instance()->barStatusBar()) {
                 dockTop = screenGeometry.y() + 24 * getDPIScaling();
             } else {
                 dockTop = screenGeometry.y();
@@ -1044,7 +1071,7 @@ void MainWindow::doUpdate() {
                 }
             }
         } else {
-            if (settings.value("bar/statusBar", false).toBool()) {
+            if (ShellSettings::instance()->barStatusBar()) {
                 dockTop = screenGeometry.bottom() - 24 * getDPIScaling();
             } else {
                 dockTop = screenGeometry.bottom() + 1;
@@ -1070,9 +1097,9 @@ void MainWindow::doUpdate() {
         anim->setEasingCurve(QEasingCurve::OutCubic);
 
         int finalTop;
-        if (settings.value("bar/onTop", true).toBool()) {
+        if (ShellSettings::instance()->barOnTop()) {
             if (this->geometry().adjusted(0, 0, 0, 1).contains(QCursor::pos())) {
-                if (settings.value("bar/statusBar").toBool() && !settings.value("bar/autoshow").toBool()) {
+                if (ShellSettings::instance()->barStatusBar() && !ShellSettings::instance()->barAutoshow()) {
                     //Don't move bar; wait for click
                     doAnim = false;
                 } else {
@@ -1097,7 +1124,7 @@ void MainWindow::doUpdate() {
             }
         } else {
             if (this->geometry().adjusted(0, -1, 0, 0).contains(QCursor::pos())) {
-                if (settings.value("bar/statusBar").toBool() && !settings.value("bar/autoshow").toBool()) {
+                if (ShellSettings::instance()->barStatusBar() && !ShellSettings::instance()->barAutoshow()) {
                     //Don't move bar; wait for click
                     doAnim = false;
                 } else {
@@ -1136,7 +1163,7 @@ void MainWindow::doUpdate() {
             }
 
 
-            if (settings.value("bar/statusBar", false).toBool()) {
+            if (ShellSettings::instance()->barStatusBar()) {
                 //if (finalTop == dockTop - this->height() || finalTop == screenGeometry.height() - dockTop) {
                 if (finalTop == dockTop - this->height() || finalTop == dockTop) {
                     if (!statusBarVisible) {
@@ -1172,7 +1199,7 @@ void MainWindow::doUpdate() {
 
         /*
         if (hideTop < dockTop - this->height()) {
-            if (attentionDemandingWindows > 0 && !settings.value("bar/statusBar", false).toBool()) {
+            if (attentionDemandingWindows > 0 && !ShellSettings::instance()->barStatusBar()) {
                 hideTop = dockTop - this->height() + 2;
             } else {
                 hideTop = dockTop - this->height();
@@ -1254,7 +1281,7 @@ void MainWindow::doUpdate() {
         }*/
     }
 
-    if (settings.value("bar/onTop", true).toBool()) {
+    if (ShellSettings::instance()->barOnTop()) {
         ((QBoxLayout*) ui->centralWidget->layout())->setDirection(QBoxLayout::TopToBottom);
     } else {
         ((QBoxLayout*) ui->centralWidget->layout())->setDirection(QBoxLayout::BottomToTop);
@@ -1262,13 +1289,13 @@ void MainWindow::doUpdate() {
     forceWindowMove = false;
 
     //Update date and time
-    if (settings.value("bar/compact", false).toBool()) {
+    if (ShellSettings::instance()->barCompact()) {
         ui->date->setText(QLocale().toString(QDateTime::currentDateTime().date(), QLocale::ShortFormat /*"dd/mm/yy"*/));
     } else {
         ui->date->setText(QLocale().toString(QDateTime::currentDateTime(), "ddd dd MMM yyyy"));
     }
 
-    if (settings.value("time/use24hour", true).toBool()) {
+    if (ShellSettings::instance()->use24Hour()) {
         ui->time->setText(QDateTime::currentDateTime().time().toString("HH:mm:ss"));
         ui->ampmLabel->setVisible(false);
     } else {
@@ -1346,6 +1373,7 @@ void MainWindow::setMprisCurrentApp(QString app) {
         QDBusConnection::sessionBus().disconnect(mprisCurrentAppName, "/org/mpris/MediaPlayer2", "org.freedesktop.DBus.Properties", "PropertiesChanged", this, SLOT(updateMpris(QString,QMap<QString, QVariant>,QStringList)));
     }
     mprisCurrentAppName = app;
+    SessionState::instance()->setMprisPlayer(app);
     QDBusConnection::sessionBus().connect(mprisCurrentAppName, "/org/mpris/MediaPlayer2", "org.freedesktop.DBus.Properties", "PropertiesChanged", this, SLOT(updateMpris(QString,QMap<QString, QVariant>,QStringList)));
     updateMpris();
 }
@@ -1485,7 +1513,7 @@ void MainWindow::setGeometry(int x, int y, int w, int h) { //Use wmctrl command
     this->setFixedSize(w, this->sizeHint().height());
     ui->infoScrollArea->setFixedWidth(w - this->centralWidget()->layout()->margin());
 
-    if (settings.value("bar/onTop", true).toBool()) {
+    if (ShellSettings::instance()->barOnTop()) {
         ui->StatusBarFrame->move(0, this->height() - 25 * getDPIScaling());
     } else {
         ui->StatusBarFrame->move(0, 1);
@@ -1559,11 +1587,24 @@ void MainWindow::internetLabelChanged(QString text, QIcon icon) {
         ui->StatusBarNetwork->setPixmap(icon.pixmap(16 * getDPIScaling(), 16 * getDPIScaling()));
     }
 
+    networkText = text;
     if (text == "") {
         ui->networkLabel->setVisible(false);
     } else {
         ui->networkLabel->setVisible(true);
-        ui->networkLabel->setText(text);
+        networkRateChanged(networkRate);
+    }
+}
+
+void MainWindow::networkRateChanged(QString rate) {
+    //Throughput ticks only touch the label text; the icons stay as they are
+    networkRate = rate;
+    if (networkText == "") return;
+
+    if (rate == "") {
+        ui->networkLabel->setText(networkText);
+    } else {
+        ui->networkLabel->setText(tr("%1 · %2").arg(networkText, rate));
     }
 }
 
@@ -1693,11 +1734,8 @@ void MainWindow::on_brightnessSlider_valueChanged(int value)
 void MainWindow::on_volumeSlider_sliderReleased()
 {
     //Check if the user has feedback sound on
-    if (settings.value("sound/feedbackSound", true).toBool()) {
-        QSoundEffect* volumeSound = new QSoundEffect();
-        volumeSound->setSource(QUrl("qrc:/sounds/volfeedback.wav"));
-        volumeSound->play();
-        connect(volumeSound, SIGNAL(playingChanged()), volumeSound, SLOT(deleteLater()));
+    if (ShellSettings::instance()->feedbackSound()) {
+        SoundEffects::instance()->play(SoundEffects::VolumeFeedback);
     }
 }
 
@@ -1730,7 +1768,7 @@ void MainWindow::paintEvent(QPaintEvent *event) {
         } else {
             painter.setPen(this->palette().color(QPalette::WindowText));
 
-            if (settings.value("bar/onTop", true).toBool()) {
+            if (ShellSettings::instance()->barOnTop()) {
                 painter.drawLine(0, this->height() - 1, this->width(), this->height() - 1);
             } else {
                 painter.drawLine(0, 0, this->width(), 0);
@@ -1807,8 +1845,11 @@ void MainWindow::on_mprisSongName_clicked()
 }
 
 void MainWindow::reloadScreens() {
+    //Move the bar, struts and Status Center to the new primary screen in one go
     forceWindowMove = true;
     updateStruts();
+    infoPane->reloadScreens();
+    doUpdate();
 }
 
 void MainWindow::show() {
@@ -1891,7 +1932,7 @@ void MainWindow::openMenu() {
     }
 
     //gatewayMenu->setGeometry(availableGeometry.x(), availableGeometry.y(), gatewayMenu->width(), availableGeometry.height());
-    if (settings.value("bar/onTop", true).toBool()) {
+    if (ShellSettings::instance()->barOnTop()) {
         gatewayMenu->setGeometry(left, this->y() + this->height() - 1, gatewayMenu->width(), availableGeometry.height() - (this->height() + (this->y() - availableGeometry.y())) + 1);
     } else {
         int height;
@@ -2012,14 +2053,14 @@ void MainWindow::on_notifications_mouseReleased()
 void MainWindow::updateStruts() {
     long* struts = (long*) malloc(sizeof(long) * 12);
     QRect screenGeometry = QApplication::desktop()->screenGeometry();
-    if (settings.value("bar/statusBar", false).toBool()) {
+    if (ShellSettings::instance()->barStatusBar()) {
         struts[0] = 0;
         struts[1] = 0;
         struts[4] = 0;
         struts[5] = 0;
         struts[6] = 0;
         struts[7] = 0;
-        if (settings.value("bar/onTop", true).toBool()) {
+        if (ShellSettings::instance()->barOnTop()) {
             struts[2] = screenGeometry.top() + 24 * getDPIScaling();
             struts[3] = 0;
             struts[8] = screenGeometry.left();
@@ -2061,7 +2102,7 @@ void MainWindow::updateStruts() {
 
     this->repaint();
 
-    if (settings.value("bar/onTop", true).toBool()) {
+    if (ShellSettings::instance()->barOnTop()) {
         ui->StatusBarFrame->move(0, this->height() - 25 * getDPIScaling());
         ui->openStatusCenterButton->setIcon(QIcon::fromTheme("go-down"));
     } else {
@@ -2097,7 +2138,7 @@ bool MainWindow::eventFilter(QObject *watched, QEvent *event) {
 
             //Completely extend the bar
             int finalTop;
-            if (settings.value("bar/onTop", true).toBool()) {
+            if (ShellSettings::instance()->barOnTop()) {
                 finalTop = screenGeometry.y();
             } else {
                 finalTop = screenGeometry.bottom() - this->height() + 1;
@@ -2115,7 +2156,7 @@ bool MainWindow::eventFilter(QObject *watched, QEvent *event) {
             TutorialWin->hideScreen(TutorialWindow::BarLocation);
 
             //Hide status bar
-            if (settings.value("bar/statusBar", false).toBool() && statusBarVisible) {
+            if (ShellSettings::instance()->barStatusBar() && statusBarVisible) {
                 tPropertyAnimation* statAnim = new tPropertyAnimation(statusBarOpacityEffect, "opacity");
                 statAnim->setStartValue((float) statusBarOpacityEffect->opacity());
                 statAnim->setEndValue((float) 0);
@@ -2124,7 +2165,7 @@ bool MainWindow::eventFilter(QObject *watched, QEvent *event) {
                 connect(statAnim, &tPropertyAnimation::finished, [=]() {
                     ui->StatusBarFrame->setVisible(false);
 
-                    if (settings.value("bar/onTop", true).toBool()) {
+                    if (ShellSettings::instance()->barOnTop()) {
                         ui->StatusBarHoverFrame->move(0, ui->StatusBarFrame->y() - ui->StatusBarFrame->height());
                     } else {
                         ui->StatusBarHoverFrame->move(0, ui->StatusBarFrame->y() + ui->StatusBarFrame->height());
@@ -2138,7 +2179,7 @@ bool MainWindow::eventFilter(QObject *watched, QEvent *event) {
 
             return true;
         } else if (event->type() == QEvent::Enter) {
-            if (!settings.value("bar/autoshow").toBool()) {
+            if (!ShellSettings::instance()->barAutoshow()) {
                 /*ui->StatusBarHoverFrame->setParent(ui->StatusBarFrame);
                 ui->StatusBarHoverFrame->resize(ui->StatusBarFrame->size());
                 ui->StatusBarHoverFrame->move(0, -ui->StatusBarHoverFrame->height());*/
@@ -2155,10 +2196,10 @@ bool MainWindow::eventFilter(QObject *watched, QEvent *event) {
             doUpdate();
             return true;
         } else if (event->type() == QEvent::Leave) {
-            if (!settings.value("bar/autoshow").toBool() && statusBarVisible) {
+            if (!ShellSettings::instance()->barAutoshow() && statusBarVisible) {
                 tPropertyAnimation* anim = new tPropertyAnimation(ui->StatusBarHoverFrame, "geometry");
                 anim->setStartValue(ui->StatusBarHoverFrame->geometry());
-                if (settings.value("bar/onTop", true).toBool()) {
+                if (ShellSettings::instance()->barOnTop()) {
                     anim->setEndValue(QRect(0, ui->StatusBarFrame->y() - ui->StatusBarFrame->height(), ui->StatusBarFrame->width(), ui->StatusBarFrame->height()));
                 } else {
                     anim->setEndValue(QRect(0, ui->StatusBarFrame->y() + ui->StatusBarFrame->height(), ui->StatusBarFrame->width(), ui->StatusBarFrame->height()));
@@ -2207,14 +2248,14 @@ void MainWindow::on_MainWindow_customContextMenuRequested(const QPoint &pos)
 {
     QMenu* menu = new QMenu();
     menu->addSection(tr("For Bar"));
-    if (settings.value("bar/onTop").toBool()) {
+    if (ShellSettings::instance()->barOnTop()) {
         menu->addAction(QIcon::fromTheme("go-down"), tr("Move to bottom"), [=] {
-            settings.setValue("bar/onTop", false);
+            ShellSettings::instance()->setValue("bar/onTop", false);
             infoPane->updateStruts();
         });
     } else {
         menu->addAction(QIcon::fromTheme("go-up"), tr("Move to top"), [=] {
-            settings.setValue("bar/onTop", true);
+            ShellSettings::instance()->setValue("bar/onTop", true);
             infoPane->updateStruts();
         });
     }
@@ -2243,7 +2284,7 @@ void MainWindow::on_openMenu_customContextMenuRequested(const QPoint &pos)
 
 void MainWindow::reloadBar() {
     ui->lowerBarLayout->setParent(nullptr);
-    if (settings.value("bar/compact", false).toBool()) {
+    if (ShellSettings::instance()->barCompact()) {
         ui->topBarLayout->insertLayout(6, ui->lowerBarLayout);
         ui->openStatusCenterButton->setVisible(true);
         ui->openMenu->setVisible(false);
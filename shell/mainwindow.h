@@ -48,10 +48,12 @@
 #include "tutorialwindow.h"
 #include "audiomanager.h"
 #include "taskbarmanager.h"
+#include "screentopology.h"
 #include <systemd/sd-login.h>
 #include <systemd/sd-daemon.h>
 #include "location/locationservices.h"
 #include "screenrecorder.h"
+#include "sessionstate.h"
 
 class Menu;
 
@@ -102,6 +104,8 @@ private slots:
 
     void internetLabelChanged(QString text, QIcon icon);
 
+    void networkRateChanged(QString rate);
+
     void on_networkLabel_clicked();
 
     void on_notifications_clicked();
@@ -253,6 +257,9 @@ private:
 
     QGraphicsOpacityEffect* statusBarOpacityEffect;
     bool statusBarVisible = false;
+
+    QString networkText, networkRate;
+    bool networkRateVisible = false;
 };
 
 #endif // MAINWINDOW_H
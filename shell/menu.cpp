@@ -19,6 +19,7 @@
  * *************************************/
 
 #include "menu.h"
+#include "startuptrace.h"
 #include "ui_menu.h"
 
 extern void EndSession(EndSessionWait::shutdownType type);
@@ -33,6 +34,7 @@ Menu::Menu(QWidget *parent) :
     QDialog(parent),
     ui(new Ui::Menu)
 {
+    TRACE_SPAN("Menu");
     ui->setupUi(this);
 
     QRect screenGeometry = QApplication::desktop()->screenGeometry();
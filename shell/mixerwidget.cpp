@@ -0,0 +1,246 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#include "mixerwidget.h"
+
+#include <QPainter>
+#include <QIcon>
+
+extern float getDPIScaling();
+extern AudioManager* AudioMan;
+
+MixerWidget::MixerWidget(QWidget* parent) : QWidget(parent) {
+    QBoxLayout* layout = new QBoxLayout(QBoxLayout::TopToBottom);
+    layout->setContentsMargins(9, 9, 9, 9);
+
+    QLabel* titleLabel = new QLabel();
+    titleLabel->setText(tr("Sound"));
+    QFont titleFont = titleLabel->font();
+    titleFont.setPointSize(15);
+    titleLabel->setFont(titleFont);
+    layout->addWidget(titleLabel);
+
+    emptyLabel = new QLabel();
+    emptyLabel->setText(tr("No apps are playing sound right now."));
+    emptyLabel->setEnabled(false);
+    layout->addWidget(emptyLabel);
+
+    QScrollArea* scrollArea = new QScrollArea();
+    scrollArea->setWidgetResizable(true);
+    scrollArea->setFrameShape(QFrame::NoFrame);
+    layout->addWidget(scrollArea);
+
+    QWidget* streamsWidget = new QWidget();
+    streamsLayout = new QBoxLayout(QBoxLayout::TopToBottom);
+    streamsLayout->setContentsMargins(0, 0, 0, 0);
+    streamsLayout->addStretch();
+    streamsWidget->setLayout(streamsLayout);
+    scrollArea->setWidget(streamsWidget);
+
+    this->setLayout(layout);
+
+    connect(AudioMan, SIGNAL(sinkInputChanged(uint32_t)), this, SLOT(sinkInputChanged(uint32_t)));
+    connect(AudioMan, SIGNAL(sinkInputRemoved(uint32_t)), this, SLOT(sinkInputRemoved(uint32_t)));
+    connect(AudioMan, SIGNAL(clientChanged(uint32_t)), this, SLOT(clientChanged(uint32_t)));
+    connect(AudioMan, SIGNAL(peakChanged(uint32_t,float)), this, SLOT(peakChanged(uint32_t,float)));
+
+    for (uint32_t index : AudioMan->sinkInputs().keys()) {
+        sinkInputChanged(index);
+    }
+    emptyLabel->setVisible(rows.isEmpty());
+}
+
+void MixerWidget::sinkInputChanged(uint32_t index) {
+    AudioManager::SinkInput input = AudioMan->sinkInputs().value(index);
+    if (AudioMan->isShellClient(input.client)) {
+        //Our own sounds can show up before their client does
+        sinkInputRemoved(index);
+        return;
+    }
+
+    if (rows.contains(index)) {
+        rows.value(index)->updateInfo();
+    } else {
+        MixerStreamRow* row = new MixerStreamRow(index);
+        streamsLayout->insertWidget(streamsLayout->count() - 1, row);
+        rows.insert(index, row);
+        emptyLabel->setVisible(false);
+
+        if (sampling) AudioMan->startPeakMonitor(index);
+    }
+}
+
+void MixerWidget::sinkInputRemoved(uint32_t index) {
+    if (!rows.contains(index)) return;
+
+    AudioMan->stopPeakMonitor(index);
+    rows.take(index)->deleteLater();
+    emptyLabel->setVisible(rows.isEmpty());
+}
+
+void MixerWidget::clientChanged(uint32_t index) {
+    //Names and icons can come from the client when the stream does not set them itself
+    QMap<uint32_t, AudioManager::SinkInput> inputs = AudioMan->sinkInputs();
+    for (uint32_t input : rows.keys()) {
+        if (inputs.value(input).client == index) sinkInputChanged(input);
+    }
+}
+
+void MixerWidget::peakChanged(uint32_t index, float peak) {
+    if (rows.contains(index)) rows.value(index)->setPeak(peak);
+}
+
+void MixerWidget::showEvent(QShowEvent* event) {
+    if (!sampling) {
+        sampling = true;
+        for (uint32_t index : rows.keys()) {
+            AudioMan->startPeakMonitor(index);
+        }
+    }
+    QWidget::showEvent(event);
+}
+
+void MixerWidget::hideEvent(QHideEvent* event) {
+    //Meters cost a record stream each, so nothing runs while the pane is out of sight
+    if (sampling) {
+        sampling = false;
+        for (uint32_t index : rows.keys()) {
+            AudioMan->stopPeakMonitor(index);
+            rows.value(index)->resetPeak();
+        }
+    }
+    QWidget::hideEvent(event);
+}
+
+MixerStreamRow::MixerStreamRow(uint32_t index, QWidget* parent) : QWidget(parent) {
+    this->index = index;
+
+    QBoxLayout* rowLayout = new QBoxLayout(QBoxLayout::LeftToRight);
+
+    iconLabel = new QLabel();
+    rowLayout->addWidget(iconLabel);
+
+    QBoxLayout* infoLayout = new QBoxLayout(QBoxLayout::TopToBottom);
+    rowLayout->addLayout(infoLayout);
+
+    nameLabel = new QLabel();
+    infoLayout->addWidget(nameLabel);
+
+    mediaLabel = new QLabel();
+    mediaLabel->setEnabled(false);
+    infoLayout->addWidget(mediaLabel);
+
+    QBoxLayout* volumeLayout = new QBoxLayout(QBoxLayout::LeftToRight);
+    infoLayout->addLayout(volumeLayout);
+
+    volumeSlider = new QSlider(Qt::Horizontal);
+    volumeSlider->setMaximum(100);
+    connect(volumeSlider, &QSlider::valueChanged, [=](int value) {
+        AudioMan->setSinkInputVolume(this->index, value);
+    });
+    volumeLayout->addWidget(volumeSlider);
+
+    muteButton = new QPushButton();
+    muteButton->setFlat(true);
+    muteButton->setCheckable(true);
+    connect(muteButton, &QPushButton::toggled, [=](bool checked) {
+        AudioMan->setSinkInputMute(this->index, checked);
+    });
+    volumeLayout->addWidget(muteButton);
+
+    meter = new PeakMeter();
+    infoLayout->addWidget(meter);
+
+    this->setLayout(rowLayout);
+
+    updateInfo();
+}
+
+void MixerStreamRow::updateInfo() {
+    AudioManager::SinkInput input = AudioMan->sinkInputs().value(index);
+    AudioManager::Client client = AudioMan->clients().value(input.client);
+
+    QString name = input.applicationName;
+    if (name == "") name = client.applicationName;
+    if (name == "") name = client.name;
+    nameLabel->setText(name);
+    mediaLabel->setText(input.name);
+    mediaLabel->setVisible(input.name != "" && input.name != name);
+
+    QIcon icon;
+    for (QString iconName : QStringList() << input.iconName << client.iconName << input.binary << client.binary) {
+        if (iconName != "" && QIcon::hasThemeIcon(iconName)) {
+            icon = QIcon::fromTheme(iconName);
+            break;
+        }
+    }
+    if (icon.isNull()) icon = QIcon::fromTheme("application-x-executable");
+    iconLabel->setPixmap(icon.pixmap(32 * getDPIScaling(), 32 * getDPIScaling()));
+
+    //Don't echo the server's own change back to it
+    volumeSlider->blockSignals(true);
+    if (!volumeSlider->isSliderDown()) {
+        volumeSlider->setValue(((float) (pa_cvolume_avg(&input.volume) - PA_VOLUME_MUTED) / (float) PA_VOLUME_NORM) * 100);
+    }
+    volumeSlider->blockSignals(false);
+
+    muteButton->blockSignals(true);
+    muteButton->setChecked(input.mute);
+    muteButton->setIcon(QIcon::fromTheme(input.mute ? "audio-volume-muted" : "audio-volume-high"));
+    muteButton->blockSignals(false);
+}
+
+void MixerStreamRow::setPeak(float peak) {
+    meter->setPeak(peak);
+}
+
+void MixerStreamRow::resetPeak() {
+    meter->reset();
+}
+
+PeakMeter::PeakMeter(QWidget* parent) : QWidget(parent) {
+    this->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+}
+
+void PeakMeter::setPeak(float peak) {
+    //Fall back gradually so short bursts stay visible at the low sample rate
+    this->peak = qMax(qBound(0.0f, peak, 1.0f), this->peak * 0.7f);
+    this->update();
+}
+
+void PeakMeter::reset() {
+    this->peak = 0;
+    this->update();
+}
+
+QSize PeakMeter::sizeHint() const {
+    return QSize(100 * getDPIScaling(), 4 * getDPIScaling());
+}
+
+void PeakMeter::paintEvent(QPaintEvent* event) {
+    Q_UNUSED(event)
+
+    QPainter painter(this);
+    painter.setPen(Qt::transparent);
+    painter.setBrush(this->palette().color(QPalette::Disabled, QPalette::WindowText));
+    painter.drawRect(0, 0, this->width(), this->height());
+    painter.setBrush(this->palette().color(QPalette::Highlight));
+    painter.drawRect(0, 0, this->width() * peak, this->height());
+}
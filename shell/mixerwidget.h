@@ -0,0 +1,93 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#ifndef MIXERWIDGET_H
+#define MIXERWIDGET_H
+
+#include <QWidget>
+#include <QLabel>
+#include <QSlider>
+#include <QPushButton>
+#include <QBoxLayout>
+#include <QScrollArea>
+#include <QMap>
+#include "audiomanager.h"
+
+class PeakMeter : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit PeakMeter(QWidget* parent = 0);
+
+    void setPeak(float peak);
+    void reset();
+    QSize sizeHint() const;
+
+private:
+    void paintEvent(QPaintEvent* event);
+
+    float peak = 0;
+};
+
+class MixerStreamRow : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit MixerStreamRow(uint32_t index, QWidget* parent = 0);
+
+public slots:
+    void updateInfo();
+    void setPeak(float peak);
+    void resetPeak();
+
+private:
+    uint32_t index;
+    QLabel *iconLabel, *nameLabel, *mediaLabel;
+    QSlider* volumeSlider;
+    QPushButton* muteButton;
+    PeakMeter* meter;
+};
+
+class MixerWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit MixerWidget(QWidget* parent = 0);
+
+private slots:
+    void sinkInputChanged(uint32_t index);
+    void sinkInputRemoved(uint32_t index);
+    void clientChanged(uint32_t index);
+    void peakChanged(uint32_t index, float peak);
+
+private:
+    void showEvent(QShowEvent* event);
+    void hideEvent(QHideEvent* event);
+
+    QBoxLayout* streamsLayout;
+    QLabel* emptyLabel;
+    QMap<uint32_t, MixerStreamRow*> rows;
+    bool sampling = false;
+};
+
+#endif // MIXERWIDGET_H
@@ -19,6 +19,7 @@
  * *************************************/
 
 #include "mousescrollwidget.h"
+#include "shellsettings.h"
 
 MouseScrollWidget::MouseScrollWidget(QWidget *parent) : QScrollArea(parent)
 {
@@ -182,7 +183,7 @@ bool MouseScrollWidget::eventFilter(QObject *object, QEvent *event) {
             qreal ratio = (qreal) this->horizontalScrollBar()->value() / (qreal) this->horizontalScrollBar()->maximum();
             left = this->horizontalScrollBar()->value() * ratio;
 
-            if (settings.value("bar/onTop").toBool()) {
+            if (ShellSettings::instance()->barOnTop()) {
                 painter.drawRect(leftStart + left, 0, width, 4);
             } else {
                 painter.drawRect(leftStart + left, this->height() - 4, width, 4);
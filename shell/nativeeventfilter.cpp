@@ -19,6 +19,8 @@
  * *************************************/
 
 #include "nativeeventfilter.h"
+#include "soundeffects.h"
+#include "shellsettings.h"
 
 extern void EndSession(EndSessionWait::shutdownType type);
 extern DbusEvents* DBusEvents;
@@ -171,11 +173,8 @@ bool NativeEventFilter::nativeEventFilter(const QByteArray &eventType, void *mes
                             AudioMan->changeVolume(5);
 
                             //Check if the user has feedback sound on
-                            if (settings.value("sound/feedbackSound", true).toBool()) {
-                            QSoundEffect* volumeSound = new QSoundEffect();
-                            volumeSound->setSource(QUrl("qrc:/sounds/volfeedback.wav"));
-                            volumeSound->play();
-                            connect(volumeSound, SIGNAL(playingChanged()), volumeSound, SLOT(deleteLater()));
+                            if (ShellSettings::instance()->feedbackSound()) {
+                                SoundEffects::instance()->play(SoundEffects::VolumeFeedback);
                             }
 
                             Hotkeys->show(QIcon::fromTheme("audio-volume-high"), tr("Volume"), volume);
@@ -189,11 +188,8 @@ bool NativeEventFilter::nativeEventFilter(const QByteArray &eventType, void *mes
                         AudioMan->changeVolume(-5);
 
                         //Check if the user has feedback sound on
-                        if (settings.value("sound/feedbackSound", true).toBool()) {
-                        QSoundEffect* volumeSound = new QSoundEffect();
-                        volumeSound->setSource(QUrl("qrc:/sounds/volfeedback.wav"));
-                        volumeSound->play();
-                        connect(volumeSound, SIGNAL(playingChanged()), volumeSound, SLOT(deleteLater()));
+                        if (ShellSettings::instance()->feedbackSound()) {
+                            SoundEffects::instance()->play(SoundEffects::VolumeFeedback);
                         }
 
                         Hotkeys->show(QIcon::fromTheme("audio-volume-high"), tr("Volume"), volume);
@@ -316,10 +312,7 @@ bool NativeEventFilter::nativeEventFilter(const QByteArray &eventType, void *mes
                 ignoreSuper = true;
             } else if (button->detail == XKeysymToKeycode(QX11Info::display(), XK_Num_Lock) || button->detail == XKeysymToKeycode(QX11Info::display(), XK_Caps_Lock)) {
                 if (themeSettings->value("accessibility/bellOnCapsNumLock", false).toBool()) {
-                    QSoundEffect* sound = new QSoundEffect();
-                    sound->setSource(QUrl("qrc:/sounds/keylocks.wav"));
-                    sound->play();
-                    connect(sound, SIGNAL(playingChanged()), sound, SLOT(deleteLater()));
+                    SoundEffects::instance()->play(SoundEffects::KeyLocks);
                 }
             }
         }/* else if (event->response_type == XCB_MAP_WINDOW) {
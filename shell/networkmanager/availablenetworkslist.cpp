@@ -25,13 +25,25 @@ extern float getDPIScaling();
 AvailableNetworksList::AvailableNetworksList(QDBusObjectPath devicePath, QObject *parent)
     : QAbstractListModel(parent)
 {
-    deviceInterface = new QDBusInterface("org.freedesktop.NetworkManager", devicePath.path(), "org.freedesktop.NetworkManager.Device.Wireless", QDBusConnection::systemBus());
-    QDBusConnection::systemBus().connect(deviceInterface->service(), devicePath.path(), deviceInterface->interface(), "AccessPointAdded", this, SLOT(reloadAP()));
-    QDBusConnection::systemBus().connect(deviceInterface->service(), devicePath.path(), deviceInterface->interface(), "AccessPointRemoved", this, SLOT(reloadAP()));
+    device = devicePath;
+    client = NetworkManagerClient::instance();
+
+    QDBusConnection::systemBus().connect("org.freedesktop.NetworkManager", devicePath.path(), "org.freedesktop.NetworkManager.Device.Wireless", "AccessPointAdded", this, SLOT(accessPointAdded(QDBusObjectPath)));
+    QDBusConnection::systemBus().connect("org.freedesktop.NetworkManager", devicePath.path(), "org.freedesktop.NetworkManager.Device.Wireless", "AccessPointRemoved", this, SLOT(accessPointRemoved(QDBusObjectPath)));
+    connect(client, &NetworkManagerClient::accessPointAdded, this, [=](QDBusObjectPath path) {
+        if (pendingAccessPoints.remove(path.path())) {
+            addAccessPoint(path);
+        }
+    });
+    connect(client, SIGNAL(accessPointChanged(QDBusObjectPath,QStringList)), this, SLOT(accessPointChanged(QDBusObjectPath,QStringList)));
+    connect(client, SIGNAL(savedConnectionsChanged()), this, SLOT(savedConnectionsChanged()));
+    connect(client, SIGNAL(reloaded()), this, SLOT(reset()));
 
-    deviceInterface->call("RequestScan", QVariantMap());
+    QDBusMessage scan = QDBusMessage::createMethodCall("org.freedesktop.NetworkManager", devicePath.path(), "org.freedesktop.NetworkManager.Device.Wireless", "RequestScan");
+    scan.setArguments(QVariantList() << QVariantMap());
+    QDBusConnection::systemBus().asyncCall(scan);
 
-    reloadAP();
+    reset();
 }
 
 int AvailableNetworksList::rowCount(const QModelIndex &parent) const
@@ -42,107 +54,178 @@ int AvailableNetworksList::rowCount(const QModelIndex &parent) const
         return 0;
     }
 
-    return accessPoints.count();
+    return rows.count();
 }
 
-void AvailableNetworksList::reloadAP() {
-    if (reloadingNetworks) {
-        return;
+void AvailableNetworksList::reset() {
+    beginResetModel();
+    rows.clear();
+    strongest.clear();
+    ssidAccessPoints.clear();
+    accessPointSsids.clear();
+    pendingAccessPoints.clear();
+
+    for (NetworkManagerClient::AccessPoint ap : client->accessPoints(device)) {
+        accessPointSsids.insert(ap.path.path(), ap.ssid);
+        if (ap.ssid == "") continue;
+
+        ssidAccessPoints.insert(ap.ssid, ap.path.path());
+        if (!strongest.contains(ap.ssid)) {
+            rows.append(ap.ssid);
+        } else if (strongest.value(ap.ssid).strength >= ap.strength) {
+            continue;
+        }
+
+        AccessPoint accessPoint;
+        accessPoint.ssid = ap.ssid;
+        accessPoint.strength = ap.strength;
+        accessPoint.WpaFlags = ap.wpaFlags;
+        accessPoint.RsnFlags = ap.rsnFlags;
+        accessPoint.path = ap.path;
+        accessPoint.security = securityType(ap);
+        accessPoint.known = false;
+        strongest.insert(ap.ssid, accessPoint);
     }
-    reloadingNetworks = true;
+    endResetModel();
+}
 
-    int capabilities = deviceInterface->property("WirelessCapabilities").toInt();
-    QList<QDBusObjectPath> ap = deviceInterface->property("AccessPoints").value<QList<QDBusObjectPath>>();
+void AvailableNetworksList::accessPointAdded(QDBusObjectPath path) {
+    if (client->accessPoint(path).isValid()) {
+        addAccessPoint(path);
+    } else {
+        pendingAccessPoints.insert(path.path());
+    }
+}
 
-    QStringList knownSsids;
+void AvailableNetworksList::addAccessPoint(QDBusObjectPath path) {
+    if (accessPointSsids.contains(path.path())) return;
 
-    QList<AccessPoint> accessPoints;
+    QString ssid = client->accessPoint(path).ssid;
+    accessPointSsids.insert(path.path(), ssid);
+    if (ssid == "") return;
 
-    for (QDBusObjectPath p : ap) {
-        QDBusInterface apInterface(deviceInterface->service(), p.path(), "org.freedesktop.NetworkManager.AccessPoint", QDBusConnection::systemBus());
+    ssidAccessPoints.insert(ssid, path.path());
+    updateSsid(ssid);
+}
 
-        QString ssid = apInterface.property("Ssid").toString();
-        if (!knownSsids.contains(ssid) && ssid != "") {
-            knownSsids.append(ssid);
+void AvailableNetworksList::accessPointRemoved(QDBusObjectPath path) {
+    pendingAccessPoints.remove(path.path());
+    if (!accessPointSsids.contains(path.path())) return;
 
-            AccessPoint accessPoint;
-            accessPoint.ssid = ssid;
-            accessPoint.strength = apInterface.property("Strength").toInt();
-            accessPoint.WpaFlags = (NmApSecurityFlags) apInterface.property("WpaFlags").toInt();
-            accessPoint.RsnFlags = (NmApSecurityFlags) apInterface.property("RsnFlags").toInt();
-            accessPoint.path = p;
-            accessPoint.known = false;
+    QString ssid = accessPointSsids.take(path.path());
+    if (ssid == "") return;
 
-            if ((accessPoint.RsnFlags & PairTkip) && (capabilities & TkipCipher)) {
-                if (accessPoint.WpaFlags & KeyMgmt8021X || accessPoint.RsnFlags & KeyMgmt8021X) {
-                    accessPoint.security = Wpa2Enterprise;
-                } else {
-                    accessPoint.security = Wpa2Psk;
-                }
-            } else if ((accessPoint.RsnFlags & PairCcmp) && (capabilities & CcmpCipher)) {
-                if (accessPoint.WpaFlags & KeyMgmt8021X || accessPoint.RsnFlags & KeyMgmt8021X) {
-                    accessPoint.security = Wpa2Enterprise;
-                } else {
-                    accessPoint.security = Wpa2Psk;
-                }
-            } else if ((accessPoint.WpaFlags & KeyMgmtPsk) && (accessPoint.WpaFlags & PairTkip) && (capabilities & TkipCipher)) {
-                if (accessPoint.WpaFlags & KeyMgmt8021X || accessPoint.RsnFlags & KeyMgmt8021X) {
-                    accessPoint.security = WpaEnterprise;
-                } else {
-                    accessPoint.security = WpaPsk;
-                }
-            } else if ((accessPoint.WpaFlags & KeyMgmtPsk) && (accessPoint.WpaFlags & PairCcmp) && (capabilities & CcmpCipher)) {
-                if (accessPoint.WpaFlags & KeyMgmt8021X || accessPoint.RsnFlags & KeyMgmt8021X) {
-                    accessPoint.security = WpaEnterprise;
-                } else {
-                    accessPoint.security = WpaPsk;
-                }
-            } else if (accessPoint.WpaFlags == NoneSecurityFlags && accessPoint.RsnFlags == NoneSecurityFlags) {
-                accessPoint.security = NoSecurity;
-            } else if ((capabilities & Wep40Cipher) || (capabilities & Wep104Cipher)) {
-                accessPoint.security = StaticWep;
+    ssidAccessPoints.remove(ssid, path.path());
+    updateSsid(ssid);
+}
+
+void AvailableNetworksList::accessPointChanged(QDBusObjectPath path, QStringList properties) {
+    if (!accessPointSsids.contains(path.path())) return;
+
+    QString oldSsid = accessPointSsids.value(path.path());
+    if (properties.contains("Ssid")) {
+        //Hidden networks can reveal their name after the access point is first seen
+        QString newSsid = client->accessPoint(path).ssid;
+        if (newSsid != oldSsid) {
+            accessPointSsids.insert(path.path(), newSsid);
+            if (oldSsid != "") {
+                ssidAccessPoints.remove(oldSsid, path.path());
+                updateSsid(oldSsid);
             }
+            if (newSsid != "") {
+                ssidAccessPoints.insert(newSsid, path.path());
+                updateSsid(newSsid);
+            }
+            return;
+        }
+    }
 
-            QDBusInterface settings(deviceInterface->service(), "/org/freedesktop/NetworkManager/Settings", "org.freedesktop.NetworkManager.Settings", QDBusConnection::systemBus());
-            QList<QDBusObjectPath> connectionSettings = settings.property("Connections").value<QList<QDBusObjectPath>>();
+    if (oldSsid != "" && (properties.contains("Strength") || properties.contains("WpaFlags") || properties.contains("RsnFlags"))) {
+        updateSsid(oldSsid);
+    }
+}
 
-            for (QDBusObjectPath settingsPath : connectionSettings) {
-                QDBusMessage msg = QDBusMessage::createMethodCall(deviceInterface->service(), settingsPath.path(), "org.freedesktop.NetworkManager.Settings.Connection", "GetSettings");
-                QDBusPendingCall msgReply = QDBusConnection::systemBus().asyncCall(msg);
+void AvailableNetworksList::updateSsid(QString ssid) {
+    NetworkManagerClient::AccessPoint best;
+    for (QString path : ssidAccessPoints.values(ssid)) {
+        NetworkManagerClient::AccessPoint ap = client->accessPoint(QDBusObjectPath(path));
+        if (ap.isValid() && (!best.isValid() || ap.strength > best.strength)) {
+            best = ap;
+        }
+    }
 
-                QEventLoop* loop = new QEventLoop();
-                QDBusPendingCallWatcher* watcher = new QDBusPendingCallWatcher(msgReply);
-                connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), loop, SLOT(quit()));
+    int row = rows.indexOf(ssid);
+    if (!best.isValid()) {
+        if (row != -1) {
+            beginRemoveRows(QModelIndex(), row, row);
+            rows.removeAt(row);
+            strongest.remove(ssid);
+            endRemoveRows();
+        }
+        return;
+    }
 
-                loop->exec();
-                loop->deleteLater();
-                watcher->deleteLater();
+    AccessPoint accessPoint;
+    accessPoint.ssid = ssid;
+    accessPoint.strength = best.strength;
+    accessPoint.WpaFlags = best.wpaFlags;
+    accessPoint.RsnFlags = best.rsnFlags;
+    accessPoint.path = best.path;
+    accessPoint.security = securityType(best);
+    accessPoint.known = false;
+
+    if (row == -1) {
+        beginInsertRows(QModelIndex(), rows.count(), rows.count());
+        rows.append(ssid);
+        strongest.insert(ssid, accessPoint);
+        endInsertRows();
+    } else {
+        AccessPoint current = strongest.value(ssid);
+        if (current.path == accessPoint.path && current.strength == accessPoint.strength && current.security == accessPoint.security) return;
 
-                if (msgReply.reply().arguments().count() != 0) {
-                    QMap<QString, QVariantMap> settings;
+        strongest.insert(ssid, accessPoint);
+        emit dataChanged(index(row), index(row));
+    }
+}
 
-                    QDBusArgument arg1 = msgReply.reply().arguments().first().value<QDBusArgument>();
-                    arg1 >> settings;
+void AvailableNetworksList::savedConnectionsChanged() {
+    if (rows.count() != 0) {
+        emit dataChanged(index(0), index(rows.count() - 1));
+    }
+}
 
-                    for (QString key : settings.keys()) {
-                        if (key == "802-11-wireless") {
-                            QVariantMap wireless = settings.value("802-11-wireless");
-                            if (wireless.value("ssid") == ssid) {
-                                accessPoint.known = true;
-                                break;
-                            }
-                        }
-                    }
-                }
-            }
+SecurityType AvailableNetworksList::securityType(NetworkManagerClient::AccessPoint ap) {
+    int capabilities = client->device(device).wirelessCapabilities;
 
-            accessPoints.append(accessPoint);
+    if ((ap.rsnFlags & PairTkip) && (capabilities & TkipCipher)) {
+        if (ap.wpaFlags & KeyMgmt8021X || ap.rsnFlags & KeyMgmt8021X) {
+            return Wpa2Enterprise;
+        } else {
+            return Wpa2Psk;
+        }
+    } else if ((ap.rsnFlags & PairCcmp) && (capabilities & CcmpCipher)) {
+        if (ap.wpaFlags & KeyMgmt8021X || ap.rsnFlags & KeyMgmt8021X) {
+            return Wpa2Enterprise;
+        } else {
+            return Wpa2Psk;
         }
+    } else if ((ap.wpaFlags & KeyMgmtPsk) && (ap.wpaFlags & PairTkip) && (capabilities & TkipCipher)) {
+        if (ap.wpaFlags & KeyMgmt8021X || ap.rsnFlags & KeyMgmt8021X) {
+            return WpaEnterprise;
+        } else {
+            return WpaPsk;
+        }
+    } else if ((ap.wpaFlags & KeyMgmtPsk) && (ap.wpaFlags & PairCcmp) && (capabilities & CcmpCipher)) {
+        if (ap.wpaFlags & KeyMgmt8021X || ap.rsnFlags & KeyMgmt8021X) {
+            return WpaEnterprise;
+        } else {
+            return WpaPsk;
+        }
+    } else if (ap.wpaFlags == NoneSecurityFlags && ap.rsnFlags == NoneSecurityFlags) {
+        return NoSecurity;
+    } else {
+        return StaticWep;
     }
-
-    this->accessPoints = accessPoints;
-    this->dataChanged(this->index(0), this->index(this->rowCount()));
-    reloadingNetworks = false;
 }
 
 QVariant AvailableNetworksList::data(const QModelIndex &index, int role) const
@@ -151,7 +234,8 @@ QVariant AvailableNetworksList::data(const QModelIndex &index, int role) const
         return QVariant();
     }
 
-    AccessPoint ap = accessPoints.at(index.row());
+    AccessPoint ap = strongest.value(rows.at(index.row()));
+    ap.known = client->isSaved(ap.ssid);
 
     switch (role) {
         case Qt::DisplayRole:
@@ -260,5 +344,5 @@ QSize AvailableNetworksListDelegate::sizeHint(const QStyleOptionViewItem &option
 }
 
 QDBusObjectPath AvailableNetworksList::devicePath() {
-    return QDBusObjectPath(deviceInterface->path());
+    return device;
 }
@@ -29,77 +29,9 @@
 #include <QPainter>
 #include <QDBusArgument>
 #include <QDBusPendingCall>
-#include <QEventLoop>
-
-enum NmDeviceType {
-    UnknownType = 0,
-    Ethernet,
-    Wifi,
-    Unused1,
-    Unused2,
-    Bluetooth,
-    OlpcMesh,
-    Wimax,
-    Modem,
-    Infiniband,
-    Bond,
-    Vlan,
-    Adsl,
-    Bridge,
-    Generic,
-    Team,
-    Tun,
-    IpTunnel,
-    MacVlan,
-    Vxlan,
-    Macsec,
-    Dummy
-};
-
-enum NmDeviceState {
-    UnknownState = 0,
-    Unmanaged = 10,
-    Unavailable = 20,
-    Disconnected = 30,
-    Prepare = 40,
-    Config = 50,
-    NeedAuth = 60,
-    IpConfig = 70,
-    IpCheck = 80,
-    Secondaries = 90,
-    Activated = 100,
-    Deactivating = 110,
-    Failed = 120,
-};
-
-enum NmDeviceCapabilities {
-    NoneCapabilities = 0,
-    Wep40Cipher = 0x1,
-    Wep104Cipher = 0x2,
-    TkipCipher = 0x4,
-    CcmpCipher = 0x8,
-    Wpa = 0x10,
-    Rsh = 0x20,
-    Ap = 0x40,
-    Adhoc = 0x80,
-    FreqValid = 0x100,
-    Freq2Ghz = 0x200,
-    Freq5Ghz = 0x400
-};
-
-enum NmApSecurityFlags {
-    NoneSecurityFlags = 0,
-    PairWep40 = 0x1,
-    PairWep104 = 0x2,
-    PairTkip = 0x4,
-    PairCcmp = 0x8,
-    GroupWep40 = 0x10,
-    GroupWep104 = 0x20,
-    GroupTkip = 0x40,
-    GroupCcmp = 0x80,
-    KeyMgmtPsk = 0x100,
-    KeyMgmt8021X = 0x200
-};
+#include <QHash>
+#include <QSet>
+#include "networkmanagerclient.h"
 
 enum SecurityType {
     NoSecurity,
@@ -135,13 +67,25 @@ public:
     QDBusObjectPath devicePath();
 
 private slots:
-    void reloadAP();
+    void reset();
+    void accessPointAdded(QDBusObjectPath path);
+    void accessPointRemoved(QDBusObjectPath path);
+    void accessPointChanged(QDBusObjectPath path, QStringList properties);
+    void savedConnectionsChanged();
 
 private:
-    QDBusInterface* deviceInterface;
-
-    QList<AccessPoint> accessPoints;
-    bool reloadingNetworks = false;
+    void addAccessPoint(QDBusObjectPath path);
+    void updateSsid(QString ssid);
+    SecurityType securityType(NetworkManagerClient::AccessPoint ap);
+
+    QDBusObjectPath device;
+    NetworkManagerClient* client;
+
+    QStringList rows; //SSIDs in display order
+    QHash<QString, AccessPoint> strongest; //SSID -> strongest access point broadcasting it
+    QMultiHash<QString, QString> ssidAccessPoints; //SSID -> access point paths
+    QHash<QString, QString> accessPointSsids; //Access point path -> SSID
+    QSet<QString> pendingAccessPoints; //Announced by the device before the object reached the cache
 };
 
 Q_DECLARE_METATYPE(AvailableNetworksList::AccessPoint)
@@ -0,0 +1,140 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#include "connectivitymonitor.h"
+#include "networkmanagerclient.h"
+
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+
+#define RECHECK_INITIAL 5000
+#define RECHECK_MAX 300000
+
+ConnectivityMonitor* ConnectivityMonitor::instance() {
+    static ConnectivityMonitor* monitor = new ConnectivityMonitor();
+    return monitor;
+}
+
+ConnectivityMonitor::ConnectivityMonitor(QObject *parent) : QObject(parent)
+{
+    client = NetworkManagerClient::instance();
+    connect(client, SIGNAL(managerChanged(QStringList)), this, SLOT(managerChanged(QStringList)));
+    connect(client, &NetworkManagerClient::reloaded, this, [=] {
+        managerChanged(QStringList() << "PrimaryConnection" << "Connectivity");
+    });
+
+    recheckInterval = RECHECK_INITIAL;
+    recheckTimer = new QTimer(this);
+    recheckTimer->setSingleShot(true);
+    connect(recheckTimer, SIGNAL(timeout()), this, SLOT(probe()));
+
+    primaryConnection = client->property("PrimaryConnection").value<QDBusObjectPath>();
+    current = (Connectivity) client->property("Connectivity").toUInt();
+    scheduleRecheck();
+}
+
+ConnectivityMonitor::Connectivity ConnectivityMonitor::connectivity() {
+    return current;
+}
+
+bool ConnectivityMonitor::isPaused() {
+    return paused;
+}
+
+void ConnectivityMonitor::setPaused(bool paused) {
+    this->paused = paused;
+    if (paused) {
+        recheckTimer->stop();
+    } else {
+        scheduleRecheck();
+    }
+}
+
+void ConnectivityMonitor::managerChanged(QStringList properties) {
+    if (properties.contains("PrimaryConnection")) {
+        QDBusObjectPath newPrimary = client->property("PrimaryConnection").value<QDBusObjectPath>();
+        if (newPrimary != primaryConnection) {
+            //The network changed underneath us, so whatever we knew about reachability is stale
+            primaryConnection = newPrimary;
+            recheckInterval = RECHECK_INITIAL;
+            if (!paused && primaryConnection.path() != "/") probe();
+        }
+    }
+
+    if (properties.contains("Connectivity")) {
+        setConnectivity((Connectivity) client->property("Connectivity").toUInt());
+    }
+}
+
+void ConnectivityMonitor::setConnectivity(Connectivity connectivity) {
+    if (connectivity == current) return;
+
+    Connectivity old = current;
+    current = connectivity;
+
+    if (connectivity == Portal && old != Portal) {
+        emit portalDetected();
+    }
+    emit connectivityChanged(connectivity);
+
+    //Keep backing off while a connection flaps between degraded states
+    if (connectivity == Full) recheckInterval = RECHECK_INITIAL;
+    scheduleRecheck();
+}
+
+void ConnectivityMonitor::scheduleRecheck() {
+    //NetworkManager only re-probes a degraded connection on its own schedule, which can be slow to notice a portal login
+    if (paused || (current != Portal && current != Limited)) {
+        recheckTimer->stop();
+        return;
+    }
+
+    if (!recheckTimer->isActive()) {
+        recheckTimer->start(recheckInterval);
+    }
+}
+
+void ConnectivityMonitor::checkConnectivity() {
+    //Someone asked; start backing off from the beginning again
+    recheckInterval = RECHECK_INITIAL;
+    recheckTimer->stop();
+    probe();
+}
+
+void ConnectivityMonitor::probe() {
+    QDBusMessage message = QDBusMessage::createMethodCall("org.freedesktop.NetworkManager", "/org/freedesktop/NetworkManager", "org.freedesktop.NetworkManager", "CheckConnectivity");
+    QDBusPendingCallWatcher* watcher = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(message), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, [=] {
+        watcher->deleteLater();
+
+        QDBusPendingReply<uint> reply = *watcher;
+        if (!reply.isError()) {
+            setConnectivity((Connectivity) reply.value());
+        }
+
+        //Back off while the connection stays degraded
+        if (current == Portal || current == Limited) {
+            recheckInterval = qMin(recheckInterval * 2, RECHECK_MAX);
+        }
+        scheduleRecheck();
+    });
+}
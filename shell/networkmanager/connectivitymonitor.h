@@ -0,0 +1,74 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#ifndef CONNECTIVITYMONITOR_H
+#define CONNECTIVITYMONITOR_H
+
+#include <QObject>
+#include <QTimer>
+#include <QDBusObjectPath>
+
+class NetworkManagerClient;
+
+class ConnectivityMonitor : public QObject
+{
+        Q_OBJECT
+    public:
+        //Values match NetworkManager's NMConnectivityState
+        enum Connectivity {
+            Unknown = 0,
+            NoConnectivity = 1,
+            Portal = 2,
+            Limited = 3,
+            Full = 4
+        };
+
+        static ConnectivityMonitor* instance();
+
+        Connectivity connectivity();
+        bool isPaused();
+
+    signals:
+        void connectivityChanged(ConnectivityMonitor::Connectivity connectivity);
+        void portalDetected();
+
+    public slots:
+        void setPaused(bool paused);
+        void checkConnectivity();
+
+    private slots:
+        void managerChanged(QStringList properties);
+        void probe();
+
+    private:
+        explicit ConnectivityMonitor(QObject *parent = nullptr);
+
+        void setConnectivity(Connectivity connectivity);
+        void scheduleRecheck();
+
+        NetworkManagerClient* client;
+        QTimer* recheckTimer;
+        Connectivity current = Unknown;
+        QDBusObjectPath primaryConnection;
+        int recheckInterval;
+        bool paused = false;
+};
+
+#endif // CONNECTIVITYMONITOR_H
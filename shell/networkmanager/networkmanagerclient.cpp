@@ -0,0 +1,419 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#include "networkmanagerclient.h"
+
+#include <QDBusConnection>
+#include <QDBusArgument>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDebug>
+
+#define NM_SERVICE "org.freedesktop.NetworkManager"
+#define NM_PATH "/org/freedesktop/NetworkManager"
+#define NM_INTERFACE "org.freedesktop.NetworkManager"
+
+namespace {
+    //Convert container values that QtDBus leaves as QDBusArgument so they can be read more than once
+    QVariant normalise(QVariant value) {
+        if (value.userType() != qMetaTypeId<QDBusArgument>()) return value;
+
+        const QDBusArgument arg = value.value<QDBusArgument>();
+        QString signature = arg.currentSignature();
+        if (signature == "ao") {
+            return QVariant::fromValue(qdbus_cast<QList<QDBusObjectPath>>(arg));
+        } else if (signature == "as") {
+            return qdbus_cast<QStringList>(arg);
+        } else if (signature == "a{sv}") {
+            return qdbus_cast<QVariantMap>(arg);
+        } else if (signature == "aa{sv}") {
+            return QVariant::fromValue(qdbus_cast<QList<QVariantMap>>(arg));
+        }
+        return value;
+    }
+
+    QVariantMap normalise(QVariantMap properties) {
+        for (QVariantMap::iterator i = properties.begin(); i != properties.end(); i++) {
+            i.value() = normalise(i.value());
+        }
+        return properties;
+    }
+}
+
+NetworkManagerClient* NetworkManagerClient::instance() {
+    static NetworkManagerClient* client = new NetworkManagerClient();
+    return client;
+}
+
+NetworkManagerClient::NetworkManagerClient(QObject *parent) : QObject(parent)
+{
+    QDBusConnection bus = QDBusConnection::systemBus();
+
+    bus.connect(NM_SERVICE, "/org/freedesktop", "org.freedesktop.DBus.ObjectManager", "InterfacesAdded", this, SLOT(interfacesAdded(QDBusMessage)));
+    bus.connect(NM_SERVICE, "/org/freedesktop", "org.freedesktop.DBus.ObjectManager", "InterfacesRemoved", this, SLOT(interfacesRemoved(QDBusMessage)));
+
+    //An empty path matches the signal on every object NetworkManager exports
+    bus.connect(NM_SERVICE, "", "org.freedesktop.DBus.Properties", "PropertiesChanged", this, SLOT(propertiesChanged(QDBusMessage)));
+
+    bus.connect(NM_SERVICE, NM_PATH "/Settings", NM_INTERFACE ".Settings", "NewConnection", this, SLOT(loadSavedConnection(QDBusObjectPath)));
+    bus.connect(NM_SERVICE, NM_PATH "/Settings", NM_INTERFACE ".Settings", "ConnectionRemoved", this, SLOT(savedConnectionRemoved(QDBusObjectPath)));
+    bus.connect(NM_SERVICE, "", NM_INTERFACE ".Settings.Connection", "Updated", this, SLOT(savedConnectionUpdated(QDBusMessage)));
+
+    watcher = new QDBusServiceWatcher(NM_SERVICE, bus, QDBusServiceWatcher::WatchForOwnerChange, this);
+    connect(watcher, SIGNAL(serviceRegistered(QString)), this, SLOT(reload()));
+    connect(watcher, &QDBusServiceWatcher::serviceUnregistered, [=] {
+        reloadGeneration++;
+        objects.clear();
+        savedSsids.clear();
+        valid = false;
+        emit reloaded();
+    });
+
+    reload();
+}
+
+void NetworkManagerClient::reload() {
+    //NetworkManager can take a while to answer while it's starting, so never wait on it
+    quint64 generation = ++reloadGeneration;
+    QDBusMessage message = QDBusMessage::createMethodCall(NM_SERVICE, "/org/freedesktop", "org.freedesktop.DBus.ObjectManager", "GetManagedObjects");
+    QDBusPendingCallWatcher* callWatcher = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(message), this);
+    connect(callWatcher, &QDBusPendingCallWatcher::finished, [=] {
+        callWatcher->deleteLater();
+        if (generation != reloadGeneration) return; //A newer reload or the service going away superseded this one
+
+        QDBusMessage reply = callWatcher->reply();
+        objects.clear();
+        if (reply.type() != QDBusMessage::ReplyMessage || reply.arguments().count() == 0) {
+            qWarning() << "Could not enumerate NetworkManager objects:" << reply.errorMessage();
+            valid = false;
+        } else {
+            const QDBusArgument arg = reply.arguments().first().value<QDBusArgument>();
+            arg.beginMap();
+            while (!arg.atEnd()) {
+                QDBusObjectPath path;
+                QMap<QString, QVariantMap> interfaces;
+                arg.beginMapEntry();
+                arg >> path >> interfaces;
+                arg.endMapEntry();
+
+                mergeInterfaces(path.path(), interfaces);
+            }
+            arg.endMap();
+            valid = true;
+
+            reloadSavedConnections();
+        }
+
+        emit reloaded();
+    });
+}
+
+void NetworkManagerClient::reloadSavedConnections() {
+    savedSsids.clear();
+
+    QDBusMessage message = QDBusMessage::createMethodCall(NM_SERVICE, NM_PATH "/Settings", NM_INTERFACE ".Settings", "ListConnections");
+    QDBusPendingCallWatcher* watcher = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(message), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, [=] {
+        watcher->deleteLater();
+
+        QDBusPendingReply<QList<QDBusObjectPath>> reply = *watcher;
+        if (reply.isError()) return;
+
+        for (QDBusObjectPath path : reply.value()) {
+            loadSavedConnection(path);
+        }
+    });
+}
+
+void NetworkManagerClient::loadSavedConnection(QDBusObjectPath path) {
+    //Settings are not properties, so they are fetched when a connection appears or is edited and kept until it goes away
+    pendingSavedConnections++;
+
+    QDBusMessage message = QDBusMessage::createMethodCall(NM_SERVICE, path.path(), NM_INTERFACE ".Settings.Connection", "GetSettings");
+    QDBusPendingCallWatcher* watcher = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(message), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, [=] {
+        watcher->deleteLater();
+        pendingSavedConnections--;
+
+        QDBusMessage reply = watcher->reply();
+        if (reply.type() == QDBusMessage::ReplyMessage && reply.arguments().count() != 0) {
+            QMap<QString, QVariantMap> settings;
+            reply.arguments().first().value<QDBusArgument>() >> settings;
+
+            QString ssid = QString::fromUtf8(settings.value("802-11-wireless").value("ssid").toByteArray());
+            if (ssid.isEmpty()) {
+                savedSsids.remove(path.path());
+            } else {
+                savedSsids.insert(path.path(), ssid);
+            }
+        }
+
+        if (pendingSavedConnections == 0) {
+            emit savedConnectionsChanged();
+        }
+    });
+}
+
+void NetworkManagerClient::savedConnectionRemoved(QDBusObjectPath path) {
+    if (savedSsids.remove(path.path()) != 0) {
+        emit savedConnectionsChanged();
+    }
+}
+
+void NetworkManagerClient::savedConnectionUpdated(QDBusMessage message) {
+    loadSavedConnection(QDBusObjectPath(message.path()));
+}
+
+void NetworkManagerClient::mergeInterfaces(QString path, QMap<QString, QVariantMap> interfaces) {
+    Interfaces& object = objects[path];
+    for (QString interface : interfaces.keys()) {
+        object.insert(interface, normalise(interfaces.value(interface)));
+    }
+}
+
+void NetworkManagerClient::interfacesAdded(QDBusMessage message) {
+    if (message.arguments().count() < 2) return;
+
+    QString path = message.arguments().at(0).value<QDBusObjectPath>().path();
+    QMap<QString, QVariantMap> interfaces;
+    message.arguments().at(1).value<QDBusArgument>() >> interfaces;
+
+    bool existed = objects.contains(path);
+    mergeInterfaces(path, interfaces);
+
+    if (interfaces.contains(NM_INTERFACE ".Device")) {
+        if (existed) {
+            emit deviceChanged(QDBusObjectPath(path));
+        } else {
+            emit deviceAdded(QDBusObjectPath(path));
+        }
+    } else if (interfaces.contains(NM_INTERFACE ".AccessPoint")) {
+        emit accessPointAdded(QDBusObjectPath(path));
+    } else if (interfaces.contains(NM_INTERFACE ".Connection.Active")) {
+        emit activeConnectionsChanged();
+    }
+}
+
+void NetworkManagerClient::interfacesRemoved(QDBusMessage message) {
+    if (message.arguments().count() < 2) return;
+
+    QString path = message.arguments().at(0).value<QDBusObjectPath>().path();
+    QStringList interfaces = message.arguments().at(1).toStringList();
+    if (!objects.contains(path)) return;
+
+    Interfaces& object = objects[path];
+    for (QString interface : interfaces) {
+        object.remove(interface);
+    }
+    if (object.isEmpty()) objects.remove(path);
+
+    if (interfaces.contains(NM_INTERFACE ".Device")) {
+        emit deviceRemoved(QDBusObjectPath(path));
+    } else if (interfaces.contains(NM_INTERFACE ".AccessPoint")) {
+        emit accessPointRemoved(QDBusObjectPath(path));
+    } else if (interfaces.contains(NM_INTERFACE ".Connection.Active")) {
+        emit activeConnectionsChanged();
+    }
+}
+
+void NetworkManagerClient::propertiesChanged(QDBusMessage message) {
+    if (message.arguments().count() < 3) return;
+
+    QString path = message.path();
+    QString interface = message.arguments().at(0).toString();
+    QVariantMap changed;
+    message.arguments().at(1).value<QDBusArgument>() >> changed;
+    QStringList invalidated = message.arguments().at(2).toStringList();
+
+    //Objects we were never told about belong to a snapshot we have not loaded yet
+    if (!objects.contains(path)) return;
+
+    QVariantMap& properties = objects[path][interface];
+    for (QString property : changed.keys()) {
+        properties.insert(property, normalise(changed.value(property)));
+    }
+    for (QString property : invalidated) {
+        properties.remove(property);
+    }
+
+    notify(path, interface, changed.keys() + invalidated);
+}
+
+void NetworkManagerClient::notify(QString path, QString interface, QStringList properties) {
+    if (interface == NM_INTERFACE) {
+        emit managerChanged(properties);
+        if (properties.contains("ActiveConnections") || properties.contains("PrimaryConnection")) {
+            emit activeConnectionsChanged();
+        }
+    } else if (interface.startsWith(NM_INTERFACE ".Device")) {
+        emit deviceChanged(QDBusObjectPath(path));
+    } else if (interface == NM_INTERFACE ".AccessPoint") {
+        emit accessPointChanged(QDBusObjectPath(path), properties);
+    } else if (interface == NM_INTERFACE ".Connection.Active") {
+        emit activeConnectionsChanged();
+    } else if (interface == NM_INTERFACE ".IP4Config" || interface == NM_INTERFACE ".IP6Config") {
+        for (QString devicePath : objects.keys()) {
+            if (value(devicePath, NM_INTERFACE ".Device", "Ip4Config").value<QDBusObjectPath>().path() == path ||
+                    value(devicePath, NM_INTERFACE ".Device", "Ip6Config").value<QDBusObjectPath>().path() == path) {
+                emit deviceChanged(QDBusObjectPath(devicePath));
+            }
+        }
+    }
+}
+
+QVariant NetworkManagerClient::value(QString path, QString interface, QString property) {
+    return objects.value(path).value(interface).value(property);
+}
+
+bool NetworkManagerClient::isValid() {
+    return valid;
+}
+
+QVariant NetworkManagerClient::property(QString name) {
+    return value(NM_PATH, NM_INTERFACE, name);
+}
+
+QList<NetworkManagerClient::Device> NetworkManagerClient::devices() {
+    QList<Device> devices;
+    for (QDBusObjectPath path : property("AllDevices").value<QList<QDBusObjectPath>>()) {
+        Device d = device(path);
+        if (d.isValid()) devices.append(d);
+    }
+    return devices;
+}
+
+NetworkManagerClient::Device NetworkManagerClient::device(QDBusObjectPath path) {
+    Device device;
+    Interfaces object = objects.value(path.path());
+    if (!object.contains(NM_INTERFACE ".Device")) return device;
+
+    QVariantMap base = object.value(NM_INTERFACE ".Device");
+    device.path = path;
+    device.interface = base.value("Interface").toString();
+    device.type = (NmDeviceType) base.value("DeviceType").toInt();
+    device.state = (NmDeviceState) base.value("State").toInt();
+    device.mtu = base.value("Mtu").toUInt();
+    device.hwAddress = base.value("HwAddress").toString();
+    device.ip4Config = base.value("Ip4Config").value<QDBusObjectPath>();
+    device.ip6Config = base.value("Ip6Config").value<QDBusObjectPath>();
+
+    switch (device.type) {
+        case Ethernet: {
+            QVariantMap wired = object.value(NM_INTERFACE ".Device.Wired");
+            if (wired.contains("HwAddress")) device.hwAddress = wired.value("HwAddress").toString();
+            break;
+        }
+        case Wifi: {
+            QVariantMap wireless = object.value(NM_INTERFACE ".Device.Wireless");
+            if (wireless.contains("HwAddress")) device.hwAddress = wireless.value("HwAddress").toString();
+            device.wirelessCapabilities = wireless.value("WirelessCapabilities").toInt();
+            device.activeAccessPoint = wireless.value("ActiveAccessPoint").value<QDBusObjectPath>();
+            device.accessPoints = wireless.value("AccessPoints").value<QList<QDBusObjectPath>>();
+            break;
+        }
+        case Bluetooth:
+            device.bluetoothName = value(path.path(), NM_INTERFACE ".Device.Bluetooth", "Name").toString();
+            break;
+        default:
+            break;
+    }
+
+    return device;
+}
+
+NetworkManagerClient::AccessPoint NetworkManagerClient::accessPoint(QDBusObjectPath path) {
+    AccessPoint ap;
+    Interfaces object = objects.value(path.path());
+    if (!object.contains(NM_INTERFACE ".AccessPoint")) return ap;
+
+    QVariantMap properties = object.value(NM_INTERFACE ".AccessPoint");
+    ap.path = path;
+    ap.ssid = QString::fromUtf8(properties.value("Ssid").toByteArray());
+    ap.strength = properties.value("Strength").toInt();
+    ap.frequency = properties.value("Frequency").toUInt();
+    ap.hwAddress = properties.value("HwAddress").toString();
+    ap.wpaFlags = (NmApSecurityFlags) properties.value("WpaFlags").toInt();
+    ap.rsnFlags = (NmApSecurityFlags) properties.value("RsnFlags").toInt();
+    return ap;
+}
+
+QList<NetworkManagerClient::AccessPoint> NetworkManagerClient::accessPoints(QDBusObjectPath device) {
+    QList<AccessPoint> accessPoints;
+    for (QDBusObjectPath path : this->device(device).accessPoints) {
+        AccessPoint ap = accessPoint(path);
+        if (ap.isValid()) accessPoints.append(ap);
+    }
+    return accessPoints;
+}
+
+QList<NetworkManagerClient::ActiveConnection> NetworkManagerClient::activeConnections() {
+    QList<ActiveConnection> connections;
+    for (QDBusObjectPath path : property("ActiveConnections").value<QList<QDBusObjectPath>>()) {
+        ActiveConnection c = activeConnection(path);
+        if (c.isValid()) connections.append(c);
+    }
+    return connections;
+}
+
+NetworkManagerClient::ActiveConnection NetworkManagerClient::activeConnection(QDBusObjectPath path) {
+    ActiveConnection connection;
+    Interfaces object = objects.value(path.path());
+    if (!object.contains(NM_INTERFACE ".Connection.Active")) return connection;
+
+    QVariantMap properties = object.value(NM_INTERFACE ".Connection.Active");
+    connection.path = path;
+    connection.id = properties.value("Id").toString();
+    connection.type = properties.value("Type").toString();
+    connection.state = properties.value("State").toUInt();
+    connection.connection = properties.value("Connection").value<QDBusObjectPath>();
+    connection.specificObject = properties.value("SpecificObject").value<QDBusObjectPath>();
+    connection.devices = properties.value("Devices").value<QList<QDBusObjectPath>>();
+    return connection;
+}
+
+NetworkManagerClient::ActiveConnection NetworkManagerClient::primaryConnection() {
+    return activeConnection(property("PrimaryConnection").value<QDBusObjectPath>());
+}
+
+NetworkManagerClient::IpConfig NetworkManagerClient::ipConfig(QDBusObjectPath path) {
+    IpConfig config;
+    Interfaces object = objects.value(path.path());
+
+    QVariantMap properties = object.value(NM_INTERFACE ".IP4Config");
+    if (properties.isEmpty()) properties = object.value(NM_INTERFACE ".IP6Config");
+
+    for (QVariantMap address : properties.value("AddressData").value<QList<QVariantMap>>()) {
+        config.addresses.append(address.value("address").toString());
+    }
+    config.gateway = properties.value("Gateway").toString();
+    return config;
+}
+
+bool NetworkManagerClient::isSaved(QString ssid) {
+    return !savedSsids.keys(ssid).isEmpty();
+}
+
+QList<QDBusObjectPath> NetworkManagerClient::savedConnections(QString ssid) {
+    QList<QDBusObjectPath> connections;
+    for (QString path : savedSsids.keys(ssid)) {
+        connections.append(QDBusObjectPath(path));
+    }
+    return connections;
+}
@@ -0,0 +1,209 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#ifndef NETWORKMANAGERCLIENT_H
+#define NETWORKMANAGERCLIENT_H
+
+#include <QObject>
+#include <QHash>
+#include <QVariantMap>
+#include <QDBusObjectPath>
+#include <QDBusMessage>
+#include <QDBusServiceWatcher>
+
+enum NmDeviceType {
+    UnknownType = 0,
+    Ethernet,
+    Wifi,
+    Unused1,
+    Unused2,
+    Bluetooth,
+    OlpcMesh,
+    Wimax,
+    Modem,
+    Infiniband,
+    Bond,
+    Vlan,
+    Adsl,
+    Bridge,
+    Generic,
+    Team,
+    Tun,
+    IpTunnel,
+    MacVlan,
+    Vxlan,
+    Macsec,
+    Dummy
+};
+
+enum NmDeviceState {
+    UnknownState = 0,
+    Unmanaged = 10,
+    Unavailable = 20,
+    Disconnected = 30,
+    Prepare = 40,
+    Config = 50,
+    NeedAuth = 60,
+    IpConfig = 70,
+    IpCheck = 80,
+    Secondaries = 90,
+    Activated = 100,
+    Deactivating = 110,
+    Failed = 120,
+};
+
+enum NmDeviceCapabilities {
+    NoneCapabilities = 0,
+    Wep40Cipher = 0x1,
+    Wep104Cipher = 0x2,
+    TkipCipher = 0x4,
+    CcmpCipher = 0x8,
+    Wpa = 0x10,
+    Rsh = 0x20,
+    Ap = 0x40,
+    Adhoc = 0x80,
+    FreqValid = 0x100,
+    Freq2Ghz = 0x200,
+    Freq5Ghz = 0x400
+};
+
+enum NmApSecurityFlags {
+    NoneSecurityFlags = 0,
+    PairWep40 = 0x1,
+    PairWep104 = 0x2,
+    PairTkip = 0x4,
+    PairCcmp = 0x8,
+    GroupWep40 = 0x10,
+    GroupWep104 = 0x20,
+    GroupTkip = 0x40,
+    GroupCcmp = 0x80,
+    KeyMgmtPsk = 0x100,
+    KeyMgmt8021X = 0x200
+};
+
+class NetworkManagerClient : public QObject
+{
+        Q_OBJECT
+    public:
+        struct Device {
+            QDBusObjectPath path;
+            QString interface;
+            NmDeviceType type = UnknownType;
+            NmDeviceState state = UnknownState;
+            uint mtu = 0;
+            QString hwAddress;
+            QDBusObjectPath ip4Config, ip6Config;
+
+            //Wireless devices
+            int wirelessCapabilities = 0;
+            QDBusObjectPath activeAccessPoint;
+            QList<QDBusObjectPath> accessPoints;
+
+            //Bluetooth devices
+            QString bluetoothName;
+
+            bool isValid() const { return !path.path().isEmpty(); }
+        };
+
+        struct AccessPoint {
+            QDBusObjectPath path;
+            QString ssid;
+            int strength = 0;
+            uint frequency = 0;
+            QString hwAddress;
+            NmApSecurityFlags wpaFlags = NoneSecurityFlags, rsnFlags = NoneSecurityFlags;
+
+            bool isValid() const { return !path.path().isEmpty(); }
+        };
+
+        struct ActiveConnection {
+            QDBusObjectPath path;
+            QString id, type;
+            uint state = 0;
+            QDBusObjectPath connection, specificObject;
+            QList<QDBusObjectPath> devices;
+
+            bool isValid() const { return !path.path().isEmpty(); }
+        };
+
+        struct IpConfig {
+            QStringList addresses;
+            QString gateway;
+        };
+
+        static NetworkManagerClient* instance();
+
+        bool isValid();
+        QVariant property(QString name);
+
+        QList<Device> devices();
+        Device device(QDBusObjectPath path);
+        AccessPoint accessPoint(QDBusObjectPath path);
+        QList<AccessPoint> accessPoints(QDBusObjectPath device);
+        QList<ActiveConnection> activeConnections();
+        ActiveConnection activeConnection(QDBusObjectPath path);
+        ActiveConnection primaryConnection();
+        IpConfig ipConfig(QDBusObjectPath path);
+
+        bool isSaved(QString ssid);
+        QList<QDBusObjectPath> savedConnections(QString ssid);
+
+    signals:
+        void reloaded();
+        void managerChanged(QStringList properties);
+        void deviceAdded(QDBusObjectPath path);
+        void deviceRemoved(QDBusObjectPath path);
+        void deviceChanged(QDBusObjectPath path);
+        void accessPointAdded(QDBusObjectPath path);
+        void accessPointRemoved(QDBusObjectPath path);
+        void accessPointChanged(QDBusObjectPath path, QStringList properties);
+        void activeConnectionsChanged();
+        void savedConnectionsChanged();
+
+    public slots:
+        void reload();
+
+    private slots:
+        void interfacesAdded(QDBusMessage message);
+        void interfacesRemoved(QDBusMessage message);
+        void propertiesChanged(QDBusMessage message);
+        void reloadSavedConnections();
+        void loadSavedConnection(QDBusObjectPath path);
+        void savedConnectionRemoved(QDBusObjectPath path);
+        void savedConnectionUpdated(QDBusMessage message);
+
+    private:
+        explicit NetworkManagerClient(QObject *parent = nullptr);
+
+        typedef QHash<QString, QVariantMap> Interfaces;
+
+        void mergeInterfaces(QString path, QMap<QString, QVariantMap> interfaces);
+        void notify(QString path, QString interface, QStringList properties);
+        QVariant value(QString path, QString interface, QString property);
+
+        QHash<QString, Interfaces> objects;
+        QHash<QString, QString> savedSsids;
+        int pendingSavedConnections = 0;
+        QDBusServiceWatcher* watcher;
+        bool valid = false;
+        quint64 reloadGeneration = 0;
+};
+
+#endif // NETWORKMANAGERCLIENT_H
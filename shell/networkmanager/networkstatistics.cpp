@@ -0,0 +1,187 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#include "networkstatistics.h"
+#include "networkmanagerclient.h"
+
+#include <QDateTime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+
+#define SAMPLE_INTERVAL 1000
+#define HISTORY_SIZE 60
+#define SMOOTHING 0.4
+
+namespace {
+    int openCounter(QString interface, QString counter) {
+        QByteArray path = QString("/sys/class/net/%1/statistics/%2").arg(interface, counter).toLocal8Bit();
+        return ::open(path.constData(), O_RDONLY | O_CLOEXEC);
+    }
+
+    bool readCounter(int fd, quint64& value) {
+        //sysfs regenerates the attribute on every read from offset 0, so one pread gets a fresh value
+        char buf[32];
+        ssize_t len = pread(fd, buf, sizeof(buf) - 1, 0);
+        if (len <= 0) return false;
+        buf[len] = '\0';
+        value = strtoull(buf, nullptr, 10);
+        return true;
+    }
+}
+
+NetworkStatistics* NetworkStatistics::instance() {
+    static NetworkStatistics* statistics = new NetworkStatistics();
+    return statistics;
+}
+
+NetworkStatistics::NetworkStatistics(QObject *parent) : QObject(parent)
+{
+    sampleTimer = new QTimer(this);
+    sampleTimer->setInterval(SAMPLE_INTERVAL);
+    connect(sampleTimer, SIGNAL(timeout()), this, SLOT(sample()));
+
+    NetworkManagerClient* client = NetworkManagerClient::instance();
+    connect(client, SIGNAL(deviceAdded(QDBusObjectPath)), this, SLOT(reopen()));
+    connect(client, SIGNAL(deviceRemoved(QDBusObjectPath)), this, SLOT(reopen()));
+    connect(client, SIGNAL(reloaded()), this, SLOT(reopen()));
+}
+
+NetworkStatistics::~NetworkStatistics() {
+    for (Interface& interface : interfaces) {
+        close(interface);
+    }
+}
+
+void NetworkStatistics::acquire() {
+    users++;
+    if (users == 1) {
+        reopen();
+        sample();
+        sampleTimer->start();
+    }
+}
+
+void NetworkStatistics::release() {
+    if (users == 0) return;
+
+    users--;
+    if (users == 0) {
+        //Nothing is showing the numbers, so stop waking up and drop the file descriptors
+        sampleTimer->stop();
+        for (Interface& interface : interfaces) {
+            close(interface);
+        }
+        interfaces.clear();
+    }
+}
+
+void NetworkStatistics::reopen() {
+    if (users == 0) return;
+
+    QStringList current;
+    for (NetworkManagerClient::Device device : NetworkManagerClient::instance()->devices()) {
+        if (device.interface != "") current.append(device.interface);
+    }
+
+    for (QString name : interfaces.keys()) {
+        if (!current.contains(name)) {
+            close(interfaces[name]);
+            interfaces.remove(name);
+        }
+    }
+
+    for (QString name : current) {
+        if (interfaces.contains(name)) continue;
+
+        Interface interface;
+        interface.rxFd = openCounter(name, "rx_bytes");
+        interface.txFd = openCounter(name, "tx_bytes");
+        if (interface.rxFd == -1 || interface.txFd == -1) {
+            close(interface);
+            continue;
+        }
+        interface.history.resize(HISTORY_SIZE);
+        interfaces.insert(name, interface);
+    }
+}
+
+void NetworkStatistics::close(Interface& interface) {
+    if (interface.rxFd != -1) ::close(interface.rxFd);
+    if (interface.txFd != -1) ::close(interface.txFd);
+    interface.rxFd = -1;
+    interface.txFd = -1;
+}
+
+void NetworkStatistics::sample() {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    double elapsed = (now - lastSample) / 1000.0;
+    lastSample = now;
+
+    for (Interface& interface : interfaces) {
+        quint64 rx, tx;
+        if (!readCounter(interface.rxFd, rx) || !readCounter(interface.txFd, tx)) continue;
+
+        if (interface.primed && elapsed > 0) {
+            //Counters can go backwards when a driver resets them; treat that as no traffic
+            double rxRate = rx >= interface.lastRx ? (rx - interface.lastRx) / elapsed : 0;
+            double txRate = tx >= interface.lastTx ? (tx - interface.lastTx) / elapsed : 0;
+
+            interface.rate.rx = SMOOTHING * rxRate + (1 - SMOOTHING) * interface.rate.rx;
+            interface.rate.tx = SMOOTHING * txRate + (1 - SMOOTHING) * interface.rate.tx;
+
+            interface.history[interface.head] = interface.rate;
+            interface.head = (interface.head + 1) % HISTORY_SIZE;
+            if (interface.count < HISTORY_SIZE) interface.count++;
+        }
+
+        interface.lastRx = rx;
+        interface.lastTx = tx;
+        interface.primed = true;
+    }
+
+    emit sampled();
+}
+
+NetworkStatistics::Rate NetworkStatistics::rate(QString interface) {
+    return interfaces.value(interface).rate;
+}
+
+QVector<NetworkStatistics::Rate> NetworkStatistics::history(QString interface) {
+    QVector<Rate> history;
+    if (!interfaces.contains(interface)) return history;
+
+    const Interface& i = interfaces[interface];
+    history.reserve(i.count);
+    for (int n = 0; n < i.count; n++) {
+        history.append(i.history.at((i.head - i.count + n + HISTORY_SIZE) % HISTORY_SIZE));
+    }
+    return history;
+}
+
+QString NetworkStatistics::formatRate(double bytesPerSecond) {
+    if (bytesPerSecond < 1024) {
+        return tr("%1 B/s").arg((int) bytesPerSecond);
+    } else if (bytesPerSecond < 1024 * 1024) {
+        return tr("%1 KB/s").arg(bytesPerSecond / 1024, 0, 'f', 1);
+    } else {
+        return tr("%1 MB/s").arg(bytesPerSecond / (1024 * 1024), 0, 'f', 1);
+    }
+}
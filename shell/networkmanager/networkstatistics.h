@@ -0,0 +1,77 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#ifndef NETWORKSTATISTICS_H
+#define NETWORKSTATISTICS_H
+
+#include <QObject>
+#include <QTimer>
+#include <QHash>
+#include <QVector>
+
+class NetworkStatistics : public QObject
+{
+        Q_OBJECT
+    public:
+        struct Rate {
+            double rx = 0, tx = 0; //Bytes per second
+        };
+
+        static NetworkStatistics* instance();
+        ~NetworkStatistics();
+
+        Rate rate(QString interface);
+        QVector<Rate> history(QString interface);
+
+        static QString formatRate(double bytesPerSecond);
+
+    signals:
+        void sampled();
+
+    public slots:
+        void acquire();
+        void release();
+
+    private slots:
+        void sample();
+        void reopen();
+
+    private:
+        explicit NetworkStatistics(QObject *parent = nullptr);
+
+        struct Interface {
+            int rxFd = -1, txFd = -1;
+            quint64 lastRx = 0, lastTx = 0;
+            bool primed = false;
+
+            Rate rate;
+            QVector<Rate> history;
+            int head = 0, count = 0;
+        };
+
+        void close(Interface& interface);
+
+        QHash<QString, Interface> interfaces;
+        QTimer* sampleTimer;
+        qint64 lastSample = 0;
+        int users = 0;
+};
+
+#endif // NETWORKSTATISTICS_H
@@ -33,9 +33,27 @@ NetworkWidget::NetworkWidget(QWidget *parent) :
 
     ui->knownNetworksDeleteButton->setProperty("type", "destructive");
 
-    QDBusConnection::systemBus().connect(nmInterface->service(), nmInterface->path(), nmInterface->interface(), "DeviceAdded", this, SLOT(updateDevices()));
-    QDBusConnection::systemBus().connect(nmInterface->service(), nmInterface->path(), nmInterface->interface(), "DeviceRemoved", this, SLOT(updateDevices()));
-    QDBusConnection::systemBus().connect(nmInterface->service(), nmInterface->path(), "org.freedesktop.DBus.Properties", "PropertiesChanged", this, SLOT(updateGlobals()));
+    client = NetworkManagerClient::instance();
+    connect(client, SIGNAL(deviceAdded(QDBusObjectPath)), this, SLOT(updateDevices()));
+    connect(client, SIGNAL(deviceRemoved(QDBusObjectPath)), this, SLOT(updateDevices()));
+    connect(client, &NetworkManagerClient::reloaded, this, [=] {
+        updateDevices();
+        updateGlobals();
+    });
+    connect(client, SIGNAL(managerChanged(QStringList)), this, SLOT(updateGlobals()));
+    connect(client, SIGNAL(activeConnectionsChanged()), this, SLOT(updateGlobals()));
+    connect(client, SIGNAL(deviceChanged(QDBusObjectPath)), this, SLOT(updateGlobals()));
+    connect(ConnectivityMonitor::instance(), SIGNAL(connectivityChanged(ConnectivityMonitor::Connectivity)), this, SLOT(updateGlobals()));
+    connect(client, &NetworkManagerClient::accessPointChanged, this, [=](QDBusObjectPath path, QStringList properties) {
+        //Scan results change constantly; only the access point we are connected to shows up in the bar
+        if (!properties.contains("Strength") && !properties.contains("Ssid")) return;
+        for (NetworkManagerClient::Device device : client->devices()) {
+            if (device.activeAccessPoint == path) {
+                updateGlobals();
+                return;
+            }
+        }
+    });
 
     updateDevices();
     updateGlobals();
@@ -75,9 +93,8 @@ void NetworkWidget::updateDevices() {
         i = layout->takeAt(0);
     }
 
-    QList<QDBusObjectPath> devices = nmInterface->property("AllDevices").value<QList<QDBusObjectPath>>();
-    for (QDBusObjectPath device : devices) {
-        DevicePanel* panel = new DevicePanel(device);
+    for (NetworkManagerClient::Device device : client->devices()) {
+        DevicePanel* panel = new DevicePanel(device.path);
         layout->addWidget(panel);
         connect(panel, SIGNAL(connectToWirelessDevice(QDBusObjectPath)), this, SLOT(connectToWirelessDevice(QDBusObjectPath)));
         connect(panel, SIGNAL(getInformationAboutDevice(QDBusObjectPath)), this, SLOT(getInformationAboutDevice(QDBusObjectPath)));
@@ -102,31 +119,7 @@ void NetworkWidget::on_AvailableNetworksList_clicked(const QModelIndex &index)
     QString ssid = index.data(Qt::DisplayRole).toString();
     AvailableNetworksList::AccessPoint ap = index.data(Qt::UserRole).value<AvailableNetworksList::AccessPoint>();
 
-    QDBusInterface settings(nmInterface->service(), "/org/freedesktop/NetworkManager/Settings", "org.freedesktop.NetworkManager.Settings", QDBusConnection::systemBus());
-    QList<QDBusObjectPath> connectionSettings = settings.property("Connections").value<QList<QDBusObjectPath>>();
-    QList<QDBusObjectPath> availableSettings;
-
-    for (QDBusObjectPath settingsPath : connectionSettings) {
-        //QDBusInterface settingsInterface(nmInterface->service(), settingsPath.path(), "org.freedesktop.NetworkManager.Settings.Connection");
-        QDBusMessage msg = QDBusMessage::createMethodCall(nmInterface->service(), settingsPath.path(), "org.freedesktop.NetworkManager.Settings.Connection", "GetSettings");
-        QDBusMessage msgReply = QDBusConnection::systemBus().call(msg);
-
-        if (msgReply.arguments().count() != 0) {
-            QMap<QString, QVariantMap> settings;
-
-            QDBusArgument arg1 = msgReply.arguments().first().value<QDBusArgument>();
-            arg1 >> settings;
-
-            for (QString key : settings.keys()) {
-                if (key == "802-11-wireless") {
-                    QVariantMap wireless = settings.value("802-11-wireless");
-                    if (wireless.value("ssid") == ssid) {
-                        availableSettings.append(settingsPath);
-                    }
-                }
-            }
-        }
-    }
+    QList<QDBusObjectPath> availableSettings = client->savedConnections(ssid);
 
     //Try to connect using all matching settings
     if (availableSettings.count() == 0) {
@@ -227,81 +220,58 @@ QList<QTreeWidgetItem*> getInfoChildren(QVariantMap parent) {
 void NetworkWidget::getInformationAboutDevice(QDBusObjectPath device) {
     ui->stackedWidget->setCurrentIndex(4);
 
-    QDBusInterface deviceInterface("org.freedesktop.NetworkManager", device.path(), "org.freedesktop.NetworkManager.Device", QDBusConnection::systemBus());
+    NetworkManagerClient::Device deviceInfo = client->device(device);
 
     QVariantMap data;
-    data.insert("Interface", deviceInterface.property("Interface"));
-    data.insert("MTU Value", deviceInterface.property("Mtu").toString());
+    data.insert("Interface", deviceInfo.interface);
+    data.insert("MTU Value", QString::number(deviceInfo.mtu));
 
-    QDBusObjectPath ipv4Path = deviceInterface.property("Ip4Config").value<QDBusObjectPath>();
-    if (ipv4Path.path() != "/") {
+    if (deviceInfo.ip4Config.path() != "/" && deviceInfo.ip4Config.path() != "") {
+        NetworkManagerClient::IpConfig config = client->ipConfig(deviceInfo.ip4Config);
         QVariantMap ip4Conf;
-        QDBusInterface ip4(deviceInterface.service(), ipv4Path.path(), "org.freedesktop.NetworkManager.IP4Config", QDBusConnection::systemBus());
-
-        QDBusMessage addressesMessage = QDBusMessage::createMethodCall(deviceInterface.service(), ipv4Path.path(), "org.freedesktop.DBus.Properties", "Get");
-        addressesMessage.setArguments(QList<QVariant>() << ip4.interface() << "AddressData");
-        QDBusMessage addressReplyMessage = QDBusConnection::systemBus().call(addressesMessage);
-
-        QDBusArgument addressArg = addressReplyMessage.arguments().first().value<QDBusVariant>().variant().value<QDBusArgument>();
-        QList<QVariantMap> addresses;
-
-        addressArg >> addresses;
 
         QVariantMap addressMap;
-        for (QVariantMap addressData : addresses) {
-            addressMap.insert(addressData.value("address").toString(), "");
+        for (QString address : config.addresses) {
+            addressMap.insert(address, "");
         }
         ip4Conf.insert("Addresses", addressMap);
-        ip4Conf.insert("Gateway", ip4.property("Gateway"));
+        ip4Conf.insert("Gateway", config.gateway);
 
         data.insert("IPv4", ip4Conf);
     }
 
-    QDBusObjectPath ipv6Path = deviceInterface.property("Ip6Config").value<QDBusObjectPath>();
-    if (ipv6Path.path() != "/") {
+    if (deviceInfo.ip6Config.path() != "/" && deviceInfo.ip6Config.path() != "") {
+        NetworkManagerClient::IpConfig config = client->ipConfig(deviceInfo.ip6Config);
         QVariantMap ip6Conf;
-        QDBusInterface ip6(deviceInterface.service(), ipv6Path.path(), "org.freedesktop.NetworkManager.IP6Config", QDBusConnection::systemBus());
-
-        QDBusMessage addressesMessage = QDBusMessage::createMethodCall(deviceInterface.service(), ipv6Path.path(), "org.freedesktop.DBus.Properties", "Get");
-        addressesMessage.setArguments(QList<QVariant>() << ip6.interface() << "AddressData");
-        QDBusMessage addressReplyMessage = QDBusConnection::systemBus().call(addressesMessage);
-
-        QDBusArgument addressArg = addressReplyMessage.arguments().first().value<QDBusVariant>().variant().value<QDBusArgument>();
-        QList<QVariantMap> addresses;
-
-        addressArg >> addresses;
 
         QVariantMap addressMap;
-        for (QVariantMap addressData : addresses) {
-            addressMap.insert(addressData.value("address").toString(), "");
+        for (QString address : config.addresses) {
+            addressMap.insert(address, "");
         }
         ip6Conf.insert("Addresses", addressMap);
-        ip6Conf.insert("Gateway", ip6.property("Gateway"));
+        ip6Conf.insert("Gateway", config.gateway);
 
         data.insert("IPv6", ip6Conf);
     }
 
-    switch (deviceInterface.property("DeviceType").toInt()) {
-        case Ethernet: {
-            QDBusInterface wiredInterface("org.freedesktop.NetworkManager", device.path(), "org.freedesktop.NetworkManager.Device.Wired", QDBusConnection::systemBus());
-            data.insert("MAC Address", wiredInterface.property("HwAddress"));
+    switch (deviceInfo.type) {
+        case Ethernet:
+            data.insert("MAC Address", deviceInfo.hwAddress);
             break;
-        }
         case Wifi: {
-            QDBusInterface wifiInterface("org.freedesktop.NetworkManager", device.path(), "org.freedesktop.NetworkManager.Device.Wireless", QDBusConnection::systemBus());
-            data.insert("MAC Address", wifiInterface.property("HwAddress"));
-
-            QDBusObjectPath ActiveApPath = wifiInterface.property("ActiveAccessPoint").value<QDBusObjectPath>();
-            if (ActiveApPath.path() != "/") {
-                QDBusInterface activeApInterface("org.freedesktop.NetworkManager", ActiveApPath.path(), "org.freedesktop.NetworkManager.AccessPoint", QDBusConnection::systemBus());
-                data.insert("Frequency", QString::number(activeApInterface.property("Frequency").toFloat() / 1000).append(" GHz"));
-                data.insert("Remote MAC Address", activeApInterface.property("HwAddress"));
-                data.insert("Signal Strength", QString::number(activeApInterface.property("Strength").toInt()) + "%");
-                data.insert("SSID", activeApInterface.property("Ssid").toString());
+            data.insert("MAC Address", deviceInfo.hwAddress);
+
+            NetworkManagerClient::AccessPoint activeAp = client->accessPoint(deviceInfo.activeAccessPoint);
+            if (activeAp.isValid()) {
+                data.insert("Frequency", QString::number((float) activeAp.frequency / 1000).append(" GHz"));
+                data.insert("Remote MAC Address", activeAp.hwAddress);
+                data.insert("Signal Strength", QString::number(activeAp.strength) + "%");
+                data.insert("SSID", activeAp.ssid);
             }
             break;
         }
-
+        default:
+            break;
     }
 
     ui->InformationTable->clear();
@@ -309,9 +279,14 @@ void NetworkWidget::getInformationAboutDevice(QDBusObjectPath device) {
 }
 
 DevicePanel::DevicePanel(QDBusObjectPath device, QWidget* parent) : QWidget(parent) {
-    deviceInterface = new QDBusInterface("org.freedesktop.NetworkManager", device.path(), "org.freedesktop.NetworkManager.Device", QDBusConnection::systemBus());
+    client = NetworkManagerClient::instance();
     this->device = device;
-    QDBusConnection::systemBus().connect(deviceInterface->service(), device.path(), "org.freedesktop.DBus.Properties", "PropertiesChanged", this, SLOT(updateInfo()));
+    connect(client, &NetworkManagerClient::deviceChanged, this, [=](QDBusObjectPath path) {
+        if (path == device) updateInfo();
+    });
+    connect(client, &NetworkManagerClient::accessPointChanged, this, [=](QDBusObjectPath path) {
+        if (path == client->device(device).activeAccessPoint) updateInfo();
+    });
 
     QBoxLayout* infoLayout = new QBoxLayout(QBoxLayout::LeftToRight);
 
@@ -337,6 +312,9 @@ DevicePanel::DevicePanel(QDBusObjectPath device, QWidget* parent) : QWidget(pare
     connectionSubNameLabel->setEnabled(false);
     textLayout->addWidget(connectionSubNameLabel);
 
+    sparkline = new ThroughputSparkline();
+    infoLayout->addWidget(sparkline);
+
     buttonLayout = new QBoxLayout(QBoxLayout::LeftToRight);
     buttonLayout->setSpacing(0);
     infoLayout->addLayout(buttonLayout);
@@ -347,8 +325,34 @@ DevicePanel::DevicePanel(QDBusObjectPath device, QWidget* parent) : QWidget(pare
 }
 
 DevicePanel::~DevicePanel() {
-    deviceInterface->deleteLater();
-    nmInterface->deleteLater();
+    if (sampling) NetworkStatistics::instance()->release();
+}
+
+void DevicePanel::showEvent(QShowEvent *event) {
+    if (!sampling) {
+        sampling = true;
+        NetworkStatistics::instance()->acquire();
+    }
+    QWidget::showEvent(event);
+}
+
+void DevicePanel::hideEvent(QHideEvent *event) {
+    if (sampling) {
+        sampling = false;
+        NetworkStatistics::instance()->release();
+    }
+    QWidget::hideEvent(event);
+}
+
+void DevicePanel::activateDevice() {
+    QDBusMessage message = QDBusMessage::createMethodCall("org.freedesktop.NetworkManager", "/org/freedesktop/NetworkManager", "org.freedesktop.NetworkManager", "ActivateConnection");
+    message.setArguments(QVariantList() << QVariant::fromValue(QDBusObjectPath("/")) << QVariant::fromValue(device) << QVariant::fromValue(QDBusObjectPath("/")));
+    QDBusConnection::systemBus().asyncCall(message);
+}
+
+void DevicePanel::disconnectDevice() {
+    QDBusMessage message = QDBusMessage::createMethodCall("org.freedesktop.NetworkManager", device.path(), "org.freedesktop.NetworkManager.Device", "Disconnect");
+    QDBusConnection::systemBus().asyncCall(message);
 }
 
 void DevicePanel::updateInfo() {
@@ -361,11 +365,15 @@ void DevicePanel::updateInfo() {
         i = buttonLayout->takeAt(0);
     }
 
-    NmDeviceState state = (NmDeviceState) deviceInterface->property("State").toInt();
+    NetworkManagerClient::Device deviceInfo = client->device(device);
+    NmDeviceState state = deviceInfo.state;
+
+    sparkline->setInterface(deviceInfo.interface);
+    sparkline->setVisible(state == Activated);
 
     QIcon icon;
 
-    switch (deviceInterface->property("DeviceType").toInt()) {
+    switch (deviceInfo.type) {
         case Ethernet: { //Ethernet
             if (state == Disconnected || state == Failed || state == Unavailable) {
                 icon = QIcon::fromTheme("network-wired-unavailable");
@@ -381,7 +389,7 @@ void DevicePanel::updateInfo() {
                     networksButton->setText(tr("Connect"));
                     networksButton->setIcon(QIcon::fromTheme("network-connect"));
                     connect(networksButton, &QPushButton::clicked, [=] {
-                        nmInterface->call("ActivateConnection", QVariant::fromValue(QDBusObjectPath("/")), QVariant::fromValue(device), QVariant::fromValue(QDBusObjectPath("/")));
+                        activateDevice();
                     });
                     buttonLayout->addWidget(networksButton);
                 }
@@ -395,8 +403,7 @@ void DevicePanel::updateInfo() {
                 disconnectButton->setIcon(QIcon::fromTheme("network-disconnect"));
                 disconnectButton->setProperty("type", "destructive");
                 connect(disconnectButton, &QPushButton::clicked, [=] {
-                    QDBusInterface deviceInterface(nmInterface->service(), device.path(), "org.freedesktop.NetworkManager.Device", QDBusConnection::systemBus());
-                    deviceInterface.call("Disconnect");
+                    disconnectDevice();
                 });
                 buttonLayout->addWidget(disconnectButton);
             }
@@ -404,10 +411,9 @@ void DevicePanel::updateInfo() {
         }
 
         case Wifi: {
-            QDBusInterface wirelessInterface(nmInterface->service(), device.path(), "org.freedesktop.NetworkManager.Device.Wireless", QDBusConnection::systemBus());
-            QDBusObjectPath activeNetwork = wirelessInterface.property("ActiveAccessPoint").value<QDBusObjectPath>();
+            NetworkManagerClient::AccessPoint activeNetwork = client->accessPoint(deviceInfo.activeAccessPoint);
 
-            if (state == Disconnected || state == Failed || state == Unavailable || activeNetwork.path() == "/" || activeNetwork.path() == "") {
+            if (state == Disconnected || state == Failed || state == Unavailable || !activeNetwork.isValid()) {
                 icon = QIcon::fromTheme("network-wireless-disconnected");
                 connectionNameLabel->setText(tr("Wi-Fi"));
 
@@ -422,9 +428,7 @@ void DevicePanel::updateInfo() {
                     connectionSubNameLabel->setText(tr("Disconnected"));
                 }
             } else {
-                QDBusInterface activeNetworkInterface(nmInterface->service(), activeNetwork.path(), "org.freedesktop.NetworkManager.AccessPoint", QDBusConnection::systemBus());
-
-                int strength = activeNetworkInterface.property("Strength").toInt();
+                int strength = activeNetwork.strength;
                 if (strength < 15) {
                     icon = QIcon::fromTheme("network-wireless-connected-00");
                 } else if (strength < 35) {
@@ -437,7 +441,7 @@ void DevicePanel::updateInfo() {
                     icon = QIcon::fromTheme("network-wireless-connected-100");
                 }
 
-                connectionNameLabel->setText(activeNetworkInterface.property("Ssid").toString());
+                connectionNameLabel->setText(activeNetwork.ssid);
 
                 if (state == Activated) {
                     connectionSubNameLabel->setText(tr("Connected"));
@@ -454,8 +458,7 @@ void DevicePanel::updateInfo() {
                 disconnectButton->setIcon(QIcon::fromTheme("network-disconnect"));
                 disconnectButton->setProperty("type", "destructive");
                 connect(disconnectButton, &QPushButton::clicked, [=] {
-                    QDBusInterface deviceInterface(nmInterface->service(), device.path(), "org.freedesktop.NetworkManager.Device", QDBusConnection::systemBus());
-                    deviceInterface.call("Disconnect");
+                    disconnectDevice();
                 });
                 buttonLayout->addWidget(disconnectButton);
             }
@@ -473,9 +476,8 @@ void DevicePanel::updateInfo() {
         }
 
         case Bluetooth: {
-            QDBusInterface btInterface(nmInterface->service(), device.path(), "org.freedesktop.NetworkManager.Device.Bluetooth", QDBusConnection::systemBus());
             icon = QIcon::fromTheme("network-bluetooth");
-            connectionNameLabel->setText(btInterface.property("Name").toString());
+            connectionNameLabel->setText(deviceInfo.bluetoothName);
 
 
             if (state == Disconnected || state == Failed) {
@@ -485,7 +487,7 @@ void DevicePanel::updateInfo() {
                 networksButton->setText(tr("Connect"));
                 networksButton->setIcon(QIcon::fromTheme("network-connect"));
                 connect(networksButton, &QPushButton::clicked, [=] {
-                    nmInterface->call("ActivateConnection", QVariant::fromValue(QDBusObjectPath("/")), QVariant::fromValue(device), QVariant::fromValue(QDBusObjectPath("/")));
+                    activateDevice();
                 });
                 buttonLayout->addWidget(networksButton);
             } else if (state == Unavailable) {
@@ -498,8 +500,7 @@ void DevicePanel::updateInfo() {
                 disconnectButton->setIcon(QIcon::fromTheme("network-disconnect"));
                 disconnectButton->setProperty("type", "destructive");
                 connect(disconnectButton, &QPushButton::clicked, [=] {
-                    QDBusInterface deviceInterface(nmInterface->service(), device.path(), "org.freedesktop.NetworkManager.Device", QDBusConnection::systemBus());
-                    deviceInterface.call("Disconnect");
+                    disconnectDevice();
                 });
                 buttonLayout->addWidget(disconnectButton);
             } else {
@@ -510,8 +511,7 @@ void DevicePanel::updateInfo() {
                 disconnectButton->setIcon(QIcon::fromTheme("network-disconnect"));
                 disconnectButton->setProperty("type", "destructive");
                 connect(disconnectButton, &QPushButton::clicked, [=] {
-                    QDBusInterface deviceInterface(nmInterface->service(), device.path(), "org.freedesktop.NetworkManager.Device", QDBusConnection::systemBus());
-                    deviceInterface.call("Disconnect");
+                    disconnectDevice();
                 });
                 buttonLayout->addWidget(disconnectButton);
             }
@@ -527,28 +527,31 @@ void DevicePanel::updateInfo() {
 
 void NetworkWidget::connectToWirelessDevice(QDBusObjectPath device) {
     ui->stackedWidget->setCurrentIndex(2);
-    ui->AvailableNetworksList->setModel(new AvailableNetworksList(device));
+
+    QAbstractItemModel* oldModel = ui->AvailableNetworksList->model();
+    ui->AvailableNetworksList->setModel(new AvailableNetworksList(device, this));
+    if (oldModel != nullptr) oldModel->deleteLater();
 }
 
 void NetworkWidget::updateGlobals() {
     QString text;
     QIcon icon;
-    QDBusObjectPath primaryConnection = nmInterface->property("PrimaryConnection").value<QDBusObjectPath>();
+    NetworkManagerClient::ActiveConnection primaryConnection = client->primaryConnection();
     NmDeviceType deviceType;
+    QString primaryInterface;
 
-    if (primaryConnection.path() == "/") {
+    if (!primaryConnection.isValid()) {
         text = tr("Disconnected");
         icon = QIcon::fromTheme("network-wired-unavailable");
         deviceType = Generic;
     } else {
-        QDBusInterface activeConnection(nmInterface->service(), primaryConnection.path(), "org.freedesktop.NetworkManager.Connection.Active", QDBusConnection::systemBus());
-        QList<QDBusObjectPath> devices = activeConnection.property("Devices").value<QList<QDBusObjectPath>>();
+        QList<QDBusObjectPath> devices = primaryConnection.devices;
 
         if (devices.length() != 0) {
-            QDBusObjectPath firstDevice = devices.first();
-            QDBusInterface deviceInterface("org.freedesktop.NetworkManager", firstDevice.path(), "org.freedesktop.NetworkManager.Device", QDBusConnection::systemBus());
-            NmDeviceState state = (NmDeviceState) deviceInterface.property("State").toInt();
-            deviceType = (NmDeviceType) deviceInterface.property("DeviceType").toInt();
+            NetworkManagerClient::Device firstDevice = client->device(devices.first());
+            NmDeviceState state = firstDevice.state;
+            deviceType = firstDevice.type;
+            if (state == Activated) primaryInterface = firstDevice.interface;
 
             switch (deviceType) {
                 case Ethernet:
@@ -561,16 +564,13 @@ void NetworkWidget::updateGlobals() {
                     }
                     break;
                 case Wifi: {
-                    QDBusInterface wirelessInterface(nmInterface->service(), devices.first().path(), "org.freedesktop.NetworkManager.Device.Wireless", QDBusConnection::systemBus());
-                    QDBusObjectPath activeNetwork = wirelessInterface.property("ActiveAccessPoint").value<QDBusObjectPath>();
+                    NetworkManagerClient::AccessPoint activeNetwork = client->accessPoint(firstDevice.activeAccessPoint);
 
-                    if (state == Disconnected || state == Failed || activeNetwork.path() == "/" || activeNetwork.path() == "") {
+                    if (state == Disconnected || state == Failed || !activeNetwork.isValid()) {
                         text = tr("Disconnected");
                         icon = QIcon::fromTheme("network-wireless-disconnected");
                     } else {
-                        QDBusInterface activeNetworkInterface(nmInterface->service(), activeNetwork.path(), "org.freedesktop.NetworkManager.AccessPoint", QDBusConnection::systemBus());
-
-                        int strength = activeNetworkInterface.property("Strength").toInt();
+                        int strength = activeNetwork.strength;
                         if (strength < 15) {
                             icon = QIcon::fromTheme("network-wireless-connected-00");
                         } else if (strength < 35) {
@@ -583,18 +583,16 @@ void NetworkWidget::updateGlobals() {
                             icon = QIcon::fromTheme("network-wireless-connected-100");
                         }
 
-                        text = activeNetworkInterface.property("Ssid").toString();
+                        text = activeNetwork.ssid;
                     }
                     break;
                 }
                 case Bluetooth: {
-                    QDBusInterface btInterface(nmInterface->service(), devices.first().path(), "org.freedesktop.NetworkManager.Device.Bluetooth", QDBusConnection::systemBus());
-
                     if (state == Disconnected || state == Failed || state == Unavailable) {
                         text = tr("Disconnected");
                         icon = QIcon::fromTheme("network-bluetooth");
                     } else {
-                        text = btInterface.property("Name").toString();
+                        text = firstDevice.bluetoothName;
                         icon = QIcon::fromTheme("network-bluetooth");
                     }
                     break;
@@ -603,6 +601,23 @@ void NetworkWidget::updateGlobals() {
         }
     }
 
+    if (text != "" && text != tr("Disconnected")) {
+        switch (ConnectivityMonitor::instance()->connectivity()) {
+            case ConnectivityMonitor::Portal:
+                text = tr("%1 (Login Required)").arg(text);
+                break;
+            case ConnectivityMonitor::NoConnectivity:
+            case ConnectivityMonitor::Limited:
+                text = tr("%1 (No Internet)").arg(text);
+                break;
+            default:
+                break;
+        }
+    }
+
+    barInterface = primaryInterface;
+    updateBarSampling();
+
     if (text == tr("Disconnected") && flightMode) {
         icon = QIcon();
         text = tr("Flight Mode");
@@ -611,6 +626,39 @@ void NetworkWidget::updateGlobals() {
     emit updateBarDisplay(text, icon);
 }
 
+void NetworkWidget::setBarRateVisible(bool visible) {
+    barRateVisible = visible;
+    updateBarSampling();
+}
+
+void NetworkWidget::updateBarSampling() {
+    //Only keep the counters running while the bar is showing its text and there's a connection to measure
+    bool sample = barRateVisible && barInterface != "";
+    if (sample && !barSampling) {
+        barSampling = true;
+        NetworkStatistics::instance()->acquire();
+        connect(NetworkStatistics::instance(), SIGNAL(sampled()), this, SLOT(updateBarRate()));
+    } else if (!sample && barSampling) {
+        barSampling = false;
+        disconnect(NetworkStatistics::instance(), SIGNAL(sampled()), this, SLOT(updateBarRate()));
+        NetworkStatistics::instance()->release();
+    }
+    updateBarRate();
+}
+
+void NetworkWidget::updateBarRate() {
+    QString rate;
+    if (barSampling) {
+        NetworkStatistics::Rate current = NetworkStatistics::instance()->rate(barInterface);
+        rate = tr("↓%1 ↑%2").arg(NetworkStatistics::formatRate(current.rx), NetworkStatistics::formatRate(current.tx));
+    }
+
+    if (rate != barRate) {
+        barRate = rate;
+        emit barRateChanged(rate);
+    }
+}
+
 void NetworkWidget::on_SecurityConnectButton_clicked()
 {
     QMap<QString, QVariantMap> settings;
@@ -872,14 +920,9 @@ void NetworkWidget::on_tetheringEnableTetheringButton_clicked()
     settings.insert("802-11-wireless-security", security);
 
     QDBusObjectPath devPath("/");
-    QList<QDBusObjectPath> devices = nmInterface->property("AllDevices").value<QList<QDBusObjectPath>>();
-    if (devices.length() != 0) {
-        for (QDBusObjectPath device : devices) {
-            QDBusInterface deviceInterface("org.freedesktop.NetworkManager", device.path(), "org.freedesktop.NetworkManager.Device", QDBusConnection::systemBus());
-
-            if (deviceInterface.property("DeviceType").toInt() == Wifi) {
-                devPath = device;
-            }
+    for (NetworkManagerClient::Device device : client->devices()) {
+        if (device.type == Wifi) {
+            devPath = device.path;
         }
     }
 
@@ -924,3 +967,42 @@ void NetworkWidget::changeEvent(QEvent *event) {
     }
     QWidget::changeEvent(event);
 }
+
+ThroughputSparkline::ThroughputSparkline(QWidget* parent) : QWidget(parent) {
+    connect(NetworkStatistics::instance(), SIGNAL(sampled()), this, SLOT(update()));
+}
+
+void ThroughputSparkline::setInterface(QString interface) {
+    this->interface = interface;
+    this->update();
+}
+
+QSize ThroughputSparkline::sizeHint() const {
+    return QSize(80 * getDPIScaling(), 32 * getDPIScaling());
+}
+
+void ThroughputSparkline::paintEvent(QPaintEvent *event) {
+    Q_UNUSED(event)
+
+    QVector<NetworkStatistics::Rate> history = NetworkStatistics::instance()->history(interface);
+    if (history.count() < 2) return;
+
+    double peak = 1024;
+    for (NetworkStatistics::Rate rate : history) {
+        peak = qMax(peak, qMax(rate.rx, rate.tx));
+    }
+
+    QPolygonF rx, tx;
+    double step = (double) (this->width() - 1) / (history.count() - 1);
+    for (int i = 0; i < history.count(); i++) {
+        rx.append(QPointF(i * step, this->height() - 1 - history.at(i).rx / peak * (this->height() - 1)));
+        tx.append(QPointF(i * step, this->height() - 1 - history.at(i).tx / peak * (this->height() - 1)));
+    }
+
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(this->palette().color(QPalette::Highlight));
+    painter.drawPolyline(rx);
+    painter.setPen(this->palette().color(QPalette::Disabled, QPalette::WindowText));
+    painter.drawPolyline(tx);
+}
@@ -34,6 +34,9 @@
 #include <QDebug>
 #include "availablenetworkslist.h"
 #include "savednetworkslist.h"
+#include "networkmanagerclient.h"
+#include "connectivitymonitor.h"
+#include "networkstatistics.h"
 #include "nativeeventfilter.h"
 #include <ttoast.h>
 #include "infopanedropdown.h"
@@ -42,6 +45,22 @@ namespace Ui {
 class NetworkWidget;
 }
 
+class ThroughputSparkline : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit ThroughputSparkline(QWidget* parent = 0);
+
+    void setInterface(QString interface);
+    QSize sizeHint() const;
+
+private:
+    void paintEvent(QPaintEvent* event);
+
+    QString interface;
+};
+
 class DevicePanel : public QWidget
 {
     Q_OBJECT
@@ -58,8 +77,14 @@ signals:
     void getInformationAboutDevice(QDBusObjectPath device);
 
 private:
-    QDBusInterface* deviceInterface;
-    QDBusInterface* nmInterface = new QDBusInterface("org.freedesktop.NetworkManager", "/org/freedesktop/NetworkManager", "org.freedesktop.NetworkManager", QDBusConnection::systemBus());
+    void activateDevice();
+    void disconnectDevice();
+    void showEvent(QShowEvent* event);
+    void hideEvent(QHideEvent* event);
+
+    NetworkManagerClient* client;
+    ThroughputSparkline* sparkline;
+    bool sampling = false;
     QLabel *iconLabel, *connectionNameLabel, *connectionSubNameLabel;
     QDBusObjectPath device;
     QBoxLayout* buttonLayout;
@@ -117,19 +142,29 @@ class NetworkWidget : public QWidget
 
         void on_tetheringButton_clicked();
 
+        void updateBarRate();
+
     public slots:
         void updateGlobals();
+        void setBarRateVisible(bool visible);
 
     signals:
         void updateBarDisplay(QString text, QIcon icon);
+        void barRateChanged(QString rate);
 
     private:
         Ui::NetworkWidget *ui;
 
         void changeEvent(QEvent* event);
+        void updateBarSampling();
 
         QDBusInterface* nmInterface = new QDBusInterface("org.freedesktop.NetworkManager", "/org/freedesktop/NetworkManager", "org.freedesktop.NetworkManager", QDBusConnection::systemBus());
+        NetworkManagerClient* client;
         bool flightMode = false;
+        bool barSampling = false;
+        bool barRateVisible = false;
+        QString barInterface;
+        QString barRate;
 };
 
 #endif // NETWORKWIDGET_H
@@ -19,6 +19,7 @@
  * *************************************/
 
 #include "notificationobject.h"
+#include "soundeffects.h"
 
 int NotificationObject::currentId = 0;
 extern AudioManager* AudioMan;
@@ -37,11 +38,15 @@ const QDBusArgument &operator>>(const QDBusArgument &argument, ImageData &d) {
     return argument;
 }
 
-NotificationObject::NotificationObject(QString app_name, QString app_icon, QString summary, QString body, QStringList actions, QVariantMap hints, int expire_timeout, QObject *parent) : QObject(parent) {
-    currentId++;
-    this->id = currentId;
+NotificationObject::NotificationObject(QString app_name, QString app_icon, QString summary, QString body, QStringList actions, QVariantMap hints, int expire_timeout, QObject *parent) :
+    NotificationObject(++currentId, app_name, app_icon, summary, body, actions, hints, expire_timeout, parent) {
 
-    dialog = new NotificationPopup(currentId);
+}
+
+NotificationObject::NotificationObject(uint id, QString app_name, QString app_icon, QString summary, QString body, QStringList actions, QVariantMap hints, int expire_timeout, QObject *parent) : QObject(parent) {
+    this->id = id;
+
+    dialog = new NotificationPopup(id);
     connect(dialog, SIGNAL(actionClicked(QString)), this, SIGNAL(actionClicked(QString)));
     connect(dialog, &NotificationPopup::notificationClosed, [=](uint reason) {
         emit closed((NotificationCloseReason) reason);
@@ -201,43 +206,40 @@ void NotificationObject::post() {
 
     //Play sounds if requested
     if (!hints.value("suppress-sound", false).toBool() && !(AudioMan->QuietMode() == AudioManager::notifications || AudioMan->QuietMode() == AudioManager::mute) && notificationAppSettings->value(appName + "/sounds", true).toBool()) {
-        if (settings.value("notifications/attenuate", true).toBool()) {
-            AudioMan->attenuateStreams();
+        bool attenuate = settings.value("notifications/attenuate", true).toBool();
+        if (attenuate) {
+            AudioMan->duck(AudioManager::duckNotification);
         }
 
-        if (hints.contains("sound-file")) {
+        QString soundFile = hints.value("sound-file").toString();
+        if (hints.contains("sound-file") && !SoundEffects::instance()->isBundled(QUrl(soundFile))) {
             QMediaPlayer* player = new QMediaPlayer();
-            if (hints.value("sound-file").toString().startsWith("qrc:")) {
-                player->setMedia(QMediaContent(QUrl(hints.value("sound-file").toString())));
+            if (soundFile.startsWith("qrc:")) {
+                player->setMedia(QMediaContent(QUrl(soundFile)));
             } else {
-                player->setMedia(QMediaContent(QUrl::fromLocalFile(hints.value("sound-file").toString())));
+                player->setMedia(QMediaContent(QUrl::fromLocalFile(soundFile)));
             }
             player->play();
             connect(player, &QMediaPlayer::stateChanged, [=](QMediaPlayer::State state) {
                 if (state == QMediaPlayer::StoppedState) {
                     player->deleteLater();
-                    if (settings.value("notifications/attenuate", true).toBool()) {
-                        AudioMan->restoreStreams();
+                    if (attenuate) {
+                        AudioMan->unduck(AudioManager::duckNotification);
                     }
                 }
             });
         } else {
-            QSoundEffect* sound = new QSoundEffect();
-
-            QString notificationSound = settings.value("notifications/sound", "tripleping").toString();
-            if (notificationSound == "tripleping") {
-                sound->setSource(QUrl("qrc:/sounds/notifications/tripleping.wav"));
-            } else if (notificationSound == "upsidedown") {
-                sound->setSource(QUrl("qrc:/sounds/notifications/upsidedown.wav"));
-            } else if (notificationSound == "echo") {
-                sound->setSource(QUrl("qrc:/sounds/notifications/echo.wav"));
+            int length;
+            if (hints.contains("sound-file")) {
+                length = SoundEffects::instance()->play(QUrl(soundFile));
+            } else {
+                length = SoundEffects::instance()->play(SoundEffects::notificationSound(settings.value("notifications/sound", "tripleping").toString()));
             }
-            sound->play();
-            connect(sound, SIGNAL(playingChanged()), sound, SLOT(deleteLater()));
 
-            if (settings.value("notifications/attenuate", true).toBool()) {
-                connect(sound, &QSoundEffect::playingChanged, [=]() {
-                    AudioMan->restoreStreams();
+            //Pooled sounds have no player to watch, so release the duck once the sound has run its length
+            if (attenuate) {
+                QTimer::singleShot(length, AudioMan, [=] {
+                    AudioMan->unduck(AudioManager::duckNotification);
                 });
             }
         }
@@ -282,3 +284,23 @@ QString NotificationObject::getBody() {
 QDateTime NotificationObject::getDate() {
     return this->date;
 }
+
+QString NotificationObject::getAppIconName() {
+    return this->appIcon;
+}
+
+QStringList NotificationObject::getActions() {
+    return this->actions;
+}
+
+QVariantMap NotificationObject::getHints() {
+    return this->hints;
+}
+
+int NotificationObject::getTimeout() {
+    return this->timeout;
+}
+
+void NotificationObject::setDate(QDateTime date) {
+    this->date = date;
+}
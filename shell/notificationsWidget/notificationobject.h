@@ -41,6 +41,7 @@ public:
     };
 
     explicit NotificationObject(QString app_name, QString app_icon, QString summary, QString body, QStringList actions, QVariantMap hints, int expire_timeout, QObject *parent = nullptr);
+    explicit NotificationObject(uint id, QString app_name, QString app_icon, QString summary, QString body, QStringList actions, QVariantMap hints, int expire_timeout, QObject *parent = nullptr);
     static int currentId;
 
     uint getId();
@@ -51,6 +52,12 @@ public:
     QString getSummary();
     QString getBody();
     QDateTime getDate();
+    QString getAppIconName();
+    QStringList getActions();
+    QVariantMap getHints();
+    int getTimeout();
+
+    void setDate(QDateTime date);
 
 signals:
     void parametersUpdated();
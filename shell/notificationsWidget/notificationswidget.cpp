@@ -19,6 +19,8 @@
  * *************************************/
 
 #include "notificationswidget.h"
+#include "../startuptrace.h"
+#include "../sessionstate.h"
 #include "ui_notificationswidget.h"
 
 extern NotificationsDBusAdaptor* ndbus;
@@ -28,12 +30,22 @@ NotificationsWidget::NotificationsWidget(QWidget *parent) :
     QWidget(parent),
     ui(new Ui::NotificationsWidget)
 {
+    TRACE_SPAN("NotificationsWidget");
     ui->setupUi(this);
 
     ndbus->setParentWidget(this);
 
     ui->scrollArea->installEventFilter(this);
 
+    if (SessionState::instance()->isRestored()) {
+        //Bring back notifications from before the restart under their old IDs, without popping them up again
+        for (SessionState::Notification n : SessionState::instance()->notifications()) {
+            NotificationObject* object = new NotificationObject(n.id, n.appName, n.appIcon, n.summary, n.body, n.actions, n.hints, n.timeout);
+            object->setDate(n.date);
+            addNotification(object);
+        }
+    }
+
     QTimer* t = new QTimer();
     t->setInterval(1000);
     connect(t, &QTimer::timeout, [=] {
@@ -84,6 +96,7 @@ void NotificationsWidget::addNotification(NotificationObject *object) {
     connect(object, &NotificationObject::closed, [=](NotificationObject::NotificationCloseReason reason) {
         emit ndbus->NotificationClosed(object->getId(), reason);
         notifications.remove(object->getId());
+        saveSessionState();
 
         if (notifications.count() == 0 && mediaPlayers.count() == 0) {
             ui->noNotificationsFrame->setVisible(true);
@@ -113,6 +126,7 @@ void NotificationsWidget::addNotification(NotificationObject *object) {
     }
 
     nGroup->AddNotification(object);
+    saveSessionState();
 }
 
 bool NotificationsWidget::hasNotificationId(uint id) {
@@ -150,6 +164,24 @@ void NotificationsWidget::updateNotificationCount() {
 }
 
 
+void NotificationsWidget::saveSessionState() {
+    QList<SessionState::Notification> state;
+    for (NotificationObject* object : notifications.values()) {
+        SessionState::Notification n;
+        n.id = object->getId();
+        n.appName = object->getAppName();
+        n.appIcon = object->getAppIconName();
+        n.summary = object->getSummary();
+        n.body = object->getBody();
+        n.actions = object->getActions();
+        n.hints = object->getHints();
+        n.timeout = object->getTimeout();
+        n.date = object->getDate();
+        state.append(n);
+    }
+    SessionState::instance()->setNotifications(state);
+}
+
 void NotificationsWidget::changeEvent(QEvent *event) {
     if (event->type() == QEvent::LanguageChange) {
         ui->retranslateUi(this);
@@ -59,6 +59,7 @@ private:
 
     bool eventFilter(QObject *watched, QEvent *event);
     void changeEvent(QEvent* event);
+    void saveSessionState();
 
     QMap<int, NotificationObject*> notifications;
     QList<NotificationAppGroup*> notificationGroups;
@@ -19,6 +19,7 @@
  * *************************************/
 
 #include "onboarding.h"
+#include "shellsettings.h"
 #include "ui_onboarding.h"
 #include "internationalisation.h"
 
@@ -336,14 +337,14 @@ void Onboarding::on_localeList_currentRowChanged(int currentRow)
 
 void Onboarding::on_enableStatusBarButton_clicked()
 {
-    settings.setValue("bar/statusBar", true);
+    ShellSettings::instance()->setValue("bar/statusBar", true);
     ui->stackedWidget->setCurrentIndex(ui->stackedWidget->currentIndex() + 1);
 
 }
 
 void Onboarding::on_disableStatusBarButton_clicked()
 {
-    settings.setValue("bar/statusBar", false);
+    ShellSettings::instance()->setValue("bar/statusBar", false);
     ui->stackedWidget->setCurrentIndex(ui->stackedWidget->currentIndex() + 1);
 }
 
@@ -398,13 +399,13 @@ void Onboarding::changeEvent(QEvent *event) {
 
 void Onboarding::on_enableCompactBarButton_clicked()
 {
-    settings.setValue("bar/compact", true);
+    ShellSettings::instance()->setValue("bar/compact", true);
     ui->stackedWidget->setCurrentIndex(ui->stackedWidget->currentIndex() + 1);
 }
 
 void Onboarding::on_disableCompactBarButton_clicked()
 {
-    settings.setValue("bar/compact", false);
+    ShellSettings::instance()->setValue("bar/compact", false);
     ui->stackedWidget->setCurrentIndex(ui->stackedWidget->currentIndex() + 1);
 }
 
@@ -1,52 +1,148 @@
 #include "screenrecorder.h"
+#include "screenrecorderthreads.h"
 #include <QDebug>
+#include <QFileInfo>
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
 
 extern NotificationsDBusAdaptor* ndbus;
 
 ScreenRecorder::ScreenRecorder(QObject *parent) : QObject(parent)
 {
-    recorderProcess = new QProcess();
-    //recorderProcess->setProcessChannelMode(QProcess::ForwardedChannels);
-    connect(recorderProcess, SIGNAL(finished(int)), this, SLOT(recorderFinished(int)));
+    statsTimer = new QTimer(this);
+    statsTimer->setInterval(1000);
+    connect(statsTimer, SIGNAL(timeout()), this, SLOT(updateStats()));
 }
 
 void ScreenRecorder::start() {
-    if (!recording()) {
+    QString area = settings.value("screenrecorder/area", "screen").toString();
+    if (area == "all") {
+        start(AllScreens);
+    } else if (area == "window") {
+        start(ActiveWindow);
+    } else if (area == "region") {
+        start(Region, settings.value("screenrecorder/region").toRect());
+    } else {
+        start(CurrentScreen);
+    }
+}
+
+void ScreenRecorder::start(CaptureArea area, QRect region) {
+    if (s == Idle) {
         if (!QFile("/usr/bin/ffmpeg").exists()) {
             ndbus->Notify("theShell", 0, "", tr("Screen Recorder"), tr("To record your screen, you'll need to install ffmpeg"), QStringList(), QVariantMap(), -1);
             return;
         }
 
-        //Build command
-        QScreen* currentScreen = NULL;
-        for (QScreen* screen : QApplication::screens()) {
-            if (screen->geometry().contains(QCursor::pos())) {
-                currentScreen = screen;
-            }
+        QRect rect = captureRect(area, region);
+        if (!rect.isValid()) {
+            ndbus->Notify("theShell", 0, "", tr("Screen Recorder"), tr("Couldn't start screen recording"), QStringList(), QVariantMap(), -1);
+            return;
         }
 
-        if (currentScreen != NULL) {
-            QString command = "ffmpeg -y -video_size %1 -f x11grab -i %2.0+%3,%4 %5/.screenRecording.mp4";
-            command = command.arg(QString::number(currentScreen->geometry().width()) + "x" + QString::number(currentScreen->geometry().height()));
-            command = command.arg(QString(qgetenv("DISPLAY")));
-            command = command.arg(QString::number(currentScreen->geometry().left()));
-            command = command.arg(QString::number(currentScreen->geometry().top()));
-            command = command.arg(QDir::homePath());
-            //command = command.arg("~");
-
-            recorderProcess->start(command);
-            s = Recording;
-            emit stateChanged(Recording);
-        } else {
-            ndbus->Notify("theShell", 0, "", tr("Screen Recorder"), tr("Couldn't start screen recording"), QStringList(), QVariantMap(), -1);
+        int framerate = qBound(1, settings.value("screenrecorder/framerate", 30).toInt(), 120);
+        int frameSize = rect.width() * rect.height() * 4;
+
+        //Keep at most ~256 MiB of raw frames waiting on the encoder
+        int capacity = qBound(2, (256 * 1024 * 1024) / frameSize, 16);
+
+        frameQueue = new RecorderFrameQueue(capacity, frameSize);
+        captureThread = new RecorderCaptureThread(rect, framerate, frameQueue);
+        encoderThread = new RecorderEncoderThread(encoderArguments(rect, framerate), frameQueue);
+        connect(captureThread, &RecorderCaptureThread::error, [=](QString message) {
+            qWarning() << "Screen recorder:" << message;
+        });
+        connect(encoderThread, SIGNAL(encoderFinished(int)), this, SLOT(recorderFinished(int)), Qt::QueuedConnection);
+
+        lastEncodedFrames = 0;
+        lastFileSize = 0;
+        encoderThread->start();
+        captureThread->start();
+        statsTimer->start();
+
+        s = Recording;
+        emit stateChanged(Recording);
+        emit statsChanged(Stats());
+    }
+}
+
+QRect ScreenRecorder::captureRect(CaptureArea area, QRect region) {
+    QRect rect;
+    switch (area) {
+        case CurrentScreen:
+            for (QScreen* screen : QApplication::screens()) {
+                if (screen->geometry().contains(QCursor::pos())) {
+                    rect = screen->geometry();
+                }
+            }
+            break;
+        case AllScreens:
+            rect = QApplication::desktop()->geometry();
+            break;
+        case ActiveWindow: {
+            Display* d = QX11Info::display();
+            Window* activeWin;
+            unsigned long items, bytes;
+            int format;
+            Atom ReturnType;
+
+            int retval = XGetWindowProperty(d, DefaultRootWindow(d), XInternAtom(d, "_NET_ACTIVE_WINDOW", False), 0, 1024, False,
+                                            AnyPropertyType, &ReturnType, &format, &items, &bytes, (unsigned char**) &activeWin);
+            if (retval == 0 && activeWin != 0) {
+                XWindowAttributes attributes;
+                Window child;
+                int x, y;
+                if (*activeWin != 0 && XGetWindowAttributes(d, *activeWin, &attributes) &&
+                        XTranslateCoordinates(d, *activeWin, DefaultRootWindow(d), 0, 0, &x, &y, &child)) {
+                    rect = QRect(x, y, attributes.width, attributes.height);
+                }
+                XFree(activeWin);
+            }
+            break;
         }
+        case Region:
+            rect = region;
+            break;
+    }
+
+    //Clip to the screen and round down to even dimensions for yuv420p
+    rect = rect.intersected(QApplication::desktop()->geometry());
+    rect.setWidth(rect.width() & ~1);
+    rect.setHeight(rect.height() & ~1);
+    return rect;
+}
 
+QStringList ScreenRecorder::encoderArguments(QRect rect, int framerate) {
+    QStringList args;
+    args << "-y" << "-loglevel" << "error";
+
+    //Raw BGRX frames from the capture thread; timestamp on arrival so dropped frames don't speed up the video
+    args << "-f" << "rawvideo" << "-pix_fmt" << "bgr0"
+         << "-video_size" << QString("%1x%2").arg(rect.width()).arg(rect.height())
+         << "-framerate" << QString::number(framerate)
+         << "-use_wallclock_as_timestamps" << "1"
+         << "-i" << "-";
+
+    if (settings.value("screenrecorder/audio", false).toBool()) {
+        args << "-f" << "pulse" << "-i" << settings.value("screenrecorder/audioSource", "default").toString();
+        args << "-c:a" << "aac";
     }
+
+    args << "-c:v" << "libx264"
+         << "-preset" << settings.value("screenrecorder/preset", "veryfast").toString()
+         << "-crf" << QString::number(settings.value("screenrecorder/crf", 23).toInt())
+         << "-pix_fmt" << "yuv420p"
+         << "-vsync" << "cfr" << "-r" << QString::number(framerate);
+
+    args << QDir::homePath() + "/.screenRecording.mp4";
+    return args;
 }
 
 void ScreenRecorder::stop() {
     if (s == Recording) {
-        recorderProcess->terminate();
+        //The encoder thread finishes once the capture thread closes the queue
+        captureThread->requestInterruption();
+        statsTimer->stop();
 
         s = Processing;
         emit stateChanged(Processing);
@@ -57,7 +153,38 @@ bool ScreenRecorder::recording() {
     return s == Recording;
 }
 
+void ScreenRecorder::updateStats() {
+    if (encoderThread == nullptr) return;
+
+    Stats stats;
+    quint64 encoded = encoderThread->encoded();
+    stats.fps = encoded - lastEncodedFrames;
+    stats.droppedFrames = frameQueue->dropped();
+    lastEncodedFrames = encoded;
+
+    qint64 fileSize = QFileInfo(QDir::homePath() + "/.screenRecording.mp4").size();
+    stats.bitrate = qMax<qint64>(0, fileSize - lastFileSize) * 8;
+    lastFileSize = fileSize;
+
+    emit statsChanged(stats);
+}
+
 void ScreenRecorder::recorderFinished(int returnCode) {
+    if (s == Recording) {
+        //The encoder died underneath us
+        statsTimer->stop();
+    }
+
+    captureThread->requestInterruption();
+    captureThread->wait();
+    encoderThread->wait();
+    captureThread->deleteLater();
+    encoderThread->deleteLater();
+    delete frameQueue;
+    captureThread = nullptr;
+    encoderThread = nullptr;
+    frameQueue = nullptr;
+
     s = Idle;
     emit stateChanged(Idle);
 
@@ -10,8 +10,14 @@
 #include <QFile>
 #include <QDir>
 #include <QDateTime>
+#include <QTimer>
+#include <QSettings>
 #include "notificationsWidget/notificationsdbusadaptor.h"
 
+class RecorderFrameQueue;
+class RecorderCaptureThread;
+class RecorderEncoderThread;
+
 class ScreenRecorder : public QObject
 {
         Q_OBJECT
@@ -24,20 +30,46 @@ class ScreenRecorder : public QObject
             Processing
         };
 
+        enum CaptureArea {
+            CurrentScreen,
+            AllScreens,
+            ActiveWindow,
+            Region
+        };
+
+        struct Stats {
+            double fps = 0;
+            quint64 droppedFrames = 0;
+            double bitrate = 0; //Bits per second
+        };
+
     signals:
         void stateChanged(State state);
+        void statsChanged(ScreenRecorder::Stats stats);
 
 
     public slots:
         void start();
+        void start(CaptureArea area, QRect region = QRect());
         void stop();
         bool recording();
 
     private slots:
         void recorderFinished(int returnCode);
+        void updateStats();
 
     private:
-        QProcess* recorderProcess;
+        QRect captureRect(CaptureArea area, QRect region);
+        QStringList encoderArguments(QRect rect, int framerate);
+
+        RecorderFrameQueue* frameQueue = nullptr;
+        RecorderCaptureThread* captureThread = nullptr;
+        RecorderEncoderThread* encoderThread = nullptr;
+        QTimer* statsTimer;
+        QSettings settings;
+
+        quint64 lastEncodedFrames = 0;
+        qint64 lastFileSize = 0;
         State s = Idle;
 };
 
@@ -0,0 +1,247 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#include "screenrecorderthreads.h"
+
+#include <QProcess>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+RecorderFrameQueue::RecorderFrameQueue(int capacity, int frameSize) {
+    this->capacity = capacity;
+    this->frameSize = frameSize;
+}
+
+QByteArray RecorderFrameQueue::acquire() {
+    QMutexLocker locker(&mutex);
+    if (!freeFrames.isEmpty()) return freeFrames.takeLast();
+    locker.unlock();
+
+    return QByteArray(frameSize, Qt::Uninitialized);
+}
+
+void RecorderFrameQueue::release(QByteArray frame) {
+    QMutexLocker locker(&mutex);
+    if (freeFrames.count() < capacity) freeFrames.append(frame);
+}
+
+void RecorderFrameQueue::push(QByteArray frame) {
+    QMutexLocker locker(&mutex);
+    if (closed) {
+        if (freeFrames.count() < capacity) freeFrames.append(frame);
+        return;
+    }
+    if (frames.count() >= capacity) {
+        //The encoder can't keep up; drop this frame rather than growing without bound
+        droppedFrames++;
+        if (freeFrames.count() < capacity) freeFrames.append(frame);
+        return;
+    }
+    frames.enqueue(frame);
+    framesAvailable.wakeOne();
+}
+
+bool RecorderFrameQueue::pop(QByteArray& frame) {
+    QMutexLocker locker(&mutex);
+    while (frames.isEmpty()) {
+        if (closed) return false;
+        framesAvailable.wait(&mutex);
+    }
+    frame = frames.dequeue();
+    return true;
+}
+
+void RecorderFrameQueue::close() {
+    QMutexLocker locker(&mutex);
+    closed = true;
+    framesAvailable.wakeAll();
+}
+
+bool RecorderFrameQueue::isClosed() {
+    QMutexLocker locker(&mutex);
+    return closed;
+}
+
+void RecorderFrameQueue::countDropped() {
+    droppedFrames++;
+}
+
+quint64 RecorderFrameQueue::dropped() {
+    return droppedFrames.load();
+}
+
+RecorderCaptureThread::RecorderCaptureThread(QRect captureRect, int framerate, RecorderFrameQueue* queue, QObject *parent) : QThread(parent) {
+    this->captureRect = captureRect;
+    this->framerate = framerate;
+    this->queue = queue;
+}
+
+quint64 RecorderCaptureThread::captured() {
+    return capturedFrames.load();
+}
+
+void RecorderCaptureThread::run() {
+    //Use a private X connection so that capturing never contends with the GUI thread
+    Display* dpy = XOpenDisplay(nullptr);
+    if (dpy == nullptr) {
+        emit error(tr("Couldn't connect to the X server"));
+        queue->close();
+        return;
+    }
+
+    int screen = DefaultScreen(dpy);
+    XShmSegmentInfo shmInfo;
+    XImage* image = nullptr;
+    if (XShmQueryExtension(dpy)) {
+        image = XShmCreateImage(dpy, DefaultVisual(dpy, screen), DefaultDepth(dpy, screen), ZPixmap, nullptr, &shmInfo, captureRect.width(), captureRect.height());
+    }
+
+    if (image != nullptr) {
+        shmInfo.shmid = shmget(IPC_PRIVATE, image->bytes_per_line * image->height, IPC_CREAT | 0600);
+        shmInfo.shmaddr = shmInfo.shmid == -1 ? (char*) -1 : (char*) shmat(shmInfo.shmid, nullptr, 0);
+        if (shmInfo.shmaddr == (char*) -1) {
+            //Out of shared memory segments; copy frames over the socket instead
+            qWarning() << "Screen recorder: couldn't allocate shared memory, falling back to XGetImage";
+            if (shmInfo.shmid != -1) shmctl(shmInfo.shmid, IPC_RMID, nullptr);
+            XDestroyImage(image);
+            image = nullptr;
+        } else {
+            image->data = shmInfo.shmaddr;
+            shmInfo.readOnly = False;
+            XShmAttach(dpy, &shmInfo);
+            XSync(dpy, False);
+            shmctl(shmInfo.shmid, IPC_RMID, nullptr); //Mark for removal once both sides detach
+        }
+    }
+
+    const int rowSize = captureRect.width() * 4;
+    const qint64 interval = 1000000000 / framerate;
+    QElapsedTimer timer;
+    timer.start();
+    qint64 nextFrame = 0;
+
+    //Stop when asked to, or when the encoder closes the queue because it went away
+    while (!isInterruptionRequested() && !queue->isClosed()) {
+        XImage* frameImage;
+        if (image != nullptr) {
+            XShmGetImage(dpy, RootWindow(dpy, screen), image, captureRect.x(), captureRect.y(), AllPlanes);
+            frameImage = image;
+        } else {
+            frameImage = XGetImage(dpy, RootWindow(dpy, screen), captureRect.x(), captureRect.y(), captureRect.width(), captureRect.height(), AllPlanes, ZPixmap);
+        }
+
+        if (frameImage == nullptr || frameImage->bits_per_pixel != 32) {
+            emit error(tr("Unsupported screen format"));
+            if (frameImage != nullptr && frameImage != image) XDestroyImage(frameImage);
+            break;
+        }
+
+        QByteArray frame = queue->acquire();
+        if (frameImage->bytes_per_line == rowSize) {
+            memcpy(frame.data(), frameImage->data, rowSize * captureRect.height());
+        } else {
+            for (int i = 0; i < captureRect.height(); i++) {
+                memcpy(frame.data() + i * rowSize, frameImage->data + i * frameImage->bytes_per_line, rowSize);
+            }
+        }
+        if (frameImage != image) XDestroyImage(frameImage);
+
+        queue->push(frame);
+        capturedFrames++;
+
+        nextFrame += interval;
+        qint64 now = timer.nsecsElapsed();
+        if (now > nextFrame + interval) {
+            //We fell behind; skip the frames we missed instead of trying to catch up
+            qint64 missed = (now - nextFrame) / interval;
+            for (qint64 i = 0; i < missed; i++) queue->countDropped();
+            nextFrame += missed * interval;
+        } else if (now < nextFrame) {
+            QThread::usleep((nextFrame - now) / 1000);
+        }
+    }
+
+    queue->close();
+
+    if (image != nullptr) {
+        XShmDetach(dpy, &shmInfo);
+        XDestroyImage(image);
+        shmdt(shmInfo.shmaddr);
+    }
+    XCloseDisplay(dpy);
+}
+
+RecorderEncoderThread::RecorderEncoderThread(QStringList arguments, RecorderFrameQueue* queue, QObject *parent) : QThread(parent) {
+    this->arguments = arguments;
+    this->queue = queue;
+}
+
+quint64 RecorderEncoderThread::encoded() {
+    return encodedFrames.load();
+}
+
+void RecorderEncoderThread::run() {
+    //The process lives on this thread and is only driven with blocking calls, so no event loop is needed
+    QProcess encoder;
+    encoder.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    encoder.start("ffmpeg", arguments);
+    if (!encoder.waitForStarted()) {
+        //Drain the queue so the capture thread never blocks on us
+        QByteArray frame;
+        queue->close();
+        while (queue->pop(frame)) queue->release(frame);
+        emit encoderFinished(-1);
+        return;
+    }
+
+    QByteArray frame;
+    while (queue->pop(frame)) {
+        if (encoder.state() != QProcess::Running) {
+            //ffmpeg went away before we were done; stop capturing and report it rather than discarding frames
+            queue->release(frame);
+            queue->close();
+            while (queue->pop(frame)) queue->release(frame);
+            encoder.waitForFinished(-1);
+            emit encoderFinished(-1);
+            return;
+        }
+
+        const char* data = frame.constData();
+        qint64 remaining = frame.size();
+        while (remaining > 0 && encoder.state() == QProcess::Running) {
+            qint64 written = encoder.write(data, remaining);
+            if (written < 0) break;
+            data += written;
+            remaining -= written;
+            encoder.waitForBytesWritten(-1);
+        }
+        queue->release(frame);
+        encodedFrames++;
+    }
+
+    encoder.closeWriteChannel();
+    encoder.waitForFinished(-1);
+    emit encoderFinished(encoder.exitStatus() == QProcess::NormalExit ? encoder.exitCode() : -1);
+}
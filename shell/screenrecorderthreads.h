@@ -0,0 +1,99 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#ifndef SCREENRECORDERTHREADS_H
+#define SCREENRECORDERTHREADS_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QRect>
+#include <QAtomicInteger>
+#include <QStringList>
+
+class RecorderFrameQueue
+{
+    public:
+        explicit RecorderFrameQueue(int capacity, int frameSize);
+
+        QByteArray acquire();
+        void release(QByteArray frame);
+
+        void push(QByteArray frame);
+        bool pop(QByteArray& frame);
+        void close();
+        bool isClosed();
+
+        void countDropped();
+        quint64 dropped();
+
+    private:
+        QMutex mutex;
+        QWaitCondition framesAvailable;
+        QQueue<QByteArray> frames;
+        QList<QByteArray> freeFrames;
+
+        int capacity;
+        int frameSize;
+        bool closed = false;
+        QAtomicInteger<quint64> droppedFrames;
+};
+
+class RecorderCaptureThread : public QThread
+{
+        Q_OBJECT
+    public:
+        explicit RecorderCaptureThread(QRect captureRect, int framerate, RecorderFrameQueue* queue, QObject *parent = nullptr);
+
+        quint64 captured();
+
+    signals:
+        void error(QString message);
+
+    private:
+        void run() override;
+
+        QRect captureRect;
+        int framerate;
+        RecorderFrameQueue* queue;
+        QAtomicInteger<quint64> capturedFrames;
+};
+
+class RecorderEncoderThread : public QThread
+{
+        Q_OBJECT
+    public:
+        explicit RecorderEncoderThread(QStringList arguments, RecorderFrameQueue* queue, QObject *parent = nullptr);
+
+        quint64 encoded();
+
+    signals:
+        void encoderFinished(int returnCode);
+
+    private:
+        void run() override;
+
+        QStringList arguments;
+        RecorderFrameQueue* queue;
+        QAtomicInteger<quint64> encodedFrames;
+};
+
+#endif // SCREENRECORDERTHREADS_H
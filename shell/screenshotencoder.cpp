@@ -0,0 +1,250 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#include "screenshotencoder.h"
+
+#include <QBuffer>
+#include <QImageWriter>
+#include <QSaveFile>
+#include <QSettings>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QtConcurrent>
+
+ScreenshotEncoder::ScreenshotEncoder(QObject *parent) : QObject(parent)
+{
+    watcher = new QFutureWatcher<QPair<bool, QString>>(this);
+    connect(watcher, &QFutureWatcher<QPair<bool, QString>>::finished, [=] {
+        QPair<bool, QString> result = watcher->result();
+        if (result.first) {
+            emit saved(result.second);
+        } else {
+            emit failed(result.second);
+        }
+    });
+}
+
+ScreenshotEncoder::Format ScreenshotEncoder::formatFromSettings() {
+    QString format = QSettings("theSuite", "theShell").value("screenshot/format", "png").toString();
+    if (format == "png-max") {
+        return PngMax;
+    } else if (format == "webp") {
+        return WebpLossless;
+    } else if (format == "qoi") {
+        return Qoi;
+    } else {
+        return PngFast;
+    }
+}
+
+ScreenshotEncoder::Format ScreenshotEncoder::effectiveFormat(Format format) {
+    //Fall back to fast PNG if the WebP image plugin isn't installed
+    if (format == WebpLossless && !QImageWriter::supportedImageFormats().contains("webp")) return PngFast;
+    return format;
+}
+
+QString ScreenshotEncoder::extension(Format format) {
+    switch (effectiveFormat(format)) {
+        case WebpLossless:
+            return "webp";
+        case Qoi:
+            return "qoi";
+        case PngFast:
+        case PngMax:
+        default:
+            return "png";
+    }
+}
+
+void ScreenshotEncoder::save(QImage image, Format format) {
+    save(image, QDir::homePath() + "/screenshot" + QDateTime::currentDateTime().toString("hh-mm-ss-yyyy-MM-dd") + "." + extension(format), format);
+}
+
+void ScreenshotEncoder::save(QImage image, QString filename, Format format) {
+    //QImage is safe to share across threads; QPixmap is not, so callers convert before getting here
+    watcher->setFuture(QtConcurrent::run(&ScreenshotEncoder::writeFile, image, filename, format));
+}
+
+QPair<bool, QString> ScreenshotEncoder::writeFile(QImage image, QString filename, Format format) {
+    QByteArray data = encode(image, format);
+    if (data.isEmpty()) {
+        return qMakePair(false, tr("Couldn't encode the screenshot"));
+    }
+
+    //QSaveFile writes to a temporary file and renames it over the target on commit
+    //so a half written screenshot never shows up in the file manager
+    QSaveFile file(filename);
+    if (!file.open(QSaveFile::WriteOnly)) {
+        return qMakePair(false, file.errorString());
+    }
+    file.write(data);
+    if (!file.commit()) {
+        return qMakePair(false, file.errorString());
+    }
+    return qMakePair(true, QFileInfo(filename).absoluteFilePath());
+}
+
+QByteArray ScreenshotEncoder::encode(const QImage& image, Format format) {
+    format = effectiveFormat(format);
+    if (format == Qoi) return encodeQoi(image);
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QBuffer::WriteOnly);
+
+    QImageWriter writer(&buffer, extension(format).toLatin1());
+    switch (format) {
+        case PngFast:
+            //For PNG, Qt maps quality to zlib compression; 80 gives level 1
+            writer.setQuality(80);
+            break;
+        case PngMax:
+            writer.setQuality(0);
+            break;
+        case WebpLossless:
+            //The WebP plugin switches to lossless encoding at quality 100
+            writer.setQuality(100);
+            break;
+        default:
+            break;
+    }
+
+    if (!writer.write(image)) return QByteArray();
+    return data;
+}
+
+QByteArray ScreenshotEncoder::encodeQoi(const QImage& image) {
+    //Encoder for the "Quite OK Image" format (https://qoiformat.org/qoi-specification.pdf)
+    QImage rgba = image.convertToFormat(QImage::Format_RGBA8888);
+    const quint32 width = rgba.width();
+    const quint32 height = rgba.height();
+    if (width == 0 || height == 0) return QByteArray();
+
+    struct Pixel {
+        uchar r, g, b, a;
+        bool operator==(const Pixel& other) const {
+            return r == other.r && g == other.g && b == other.b && a == other.a;
+        }
+    };
+
+    QByteArray out;
+    out.reserve(14 + width * height * 5 + 8);
+
+    auto writeUint32 = [&](quint32 value) {
+        out.append((char) (value >> 24));
+        out.append((char) (value >> 16));
+        out.append((char) (value >> 8));
+        out.append((char) value);
+    };
+
+    out.append("qoif", 4);
+    writeUint32(width);
+    writeUint32(height);
+    out.append((char) 4); //RGBA
+    out.append((char) 0); //sRGB with linear alpha
+
+    Pixel index[64] = {};
+    Pixel previous = {0, 0, 0, 255};
+    int run = 0;
+
+    for (quint32 y = 0; y < height; y++) {
+        const Pixel* line = reinterpret_cast<const Pixel*>(rgba.constScanLine(y));
+        for (quint32 x = 0; x < width; x++) {
+            Pixel px = line[x];
+            bool lastPixel = (y == height - 1 && x == width - 1);
+
+            if (px == previous) {
+                run++;
+                if (run == 62 || lastPixel) {
+                    out.append((char) (0xC0 | (run - 1)));
+                    run = 0;
+                }
+                continue;
+            }
+
+            if (run > 0) {
+                out.append((char) (0xC0 | (run - 1)));
+                run = 0;
+            }
+
+            int hash = (px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) % 64;
+            if (index[hash] == px) {
+                out.append((char) hash);
+            } else {
+                index[hash] = px;
+
+                if (px.a == previous.a) {
+                    signed char vr = px.r - previous.r;
+                    signed char vg = px.g - previous.g;
+                    signed char vb = px.b - previous.b;
+                    signed char vgr = vr - vg;
+                    signed char vgb = vb - vg;
+
+                    if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                        out.append((char) (0x40 | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2)));
+                    } else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8) {
+                        out.append((char) (0x80 | (vg + 32)));
+                        out.append((char) ((vgr + 8) << 4 | (vgb + 8)));
+                    } else {
+                        out.append((char) 0xFE);
+                        out.append((char) px.r);
+                        out.append((char) px.g);
+                        out.append((char) px.b);
+                    }
+                } else {
+                    out.append((char) 0xFF);
+                    out.append((char) px.r);
+                    out.append((char) px.g);
+                    out.append((char) px.b);
+                    out.append((char) px.a);
+                }
+            }
+            previous = px;
+        }
+    }
+
+    out.append(QByteArray(7, 0));
+    out.append((char) 1);
+    return out;
+}
+
+ScreenshotMimeData::ScreenshotMimeData(QImage image) : QMimeData() {
+    this->image = image;
+}
+
+QStringList ScreenshotMimeData::formats() const {
+    return QStringList() << "image/png" << "application/x-qt-image";
+}
+
+bool ScreenshotMimeData::hasFormat(const QString &mimeType) const {
+    return formats().contains(mimeType);
+}
+
+QVariant ScreenshotMimeData::retrieveData(const QString &mimeType, QVariant::Type type) const {
+    //Only encode when another application actually pastes the screenshot
+    if (mimeType == "image/png") {
+        if (encodedPng.isEmpty()) encodedPng = ScreenshotEncoder::encode(image, ScreenshotEncoder::PngFast);
+        return encodedPng;
+    } else if (mimeType == "application/x-qt-image") {
+        return image;
+    }
+    return QMimeData::retrieveData(mimeType, type);
+}
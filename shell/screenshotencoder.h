@@ -0,0 +1,80 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#ifndef SCREENSHOTENCODER_H
+#define SCREENSHOTENCODER_H
+
+#include <QObject>
+#include <QImage>
+#include <QMimeData>
+#include <QFutureWatcher>
+#include <QPair>
+
+class ScreenshotEncoder : public QObject
+{
+        Q_OBJECT
+    public:
+        explicit ScreenshotEncoder(QObject *parent = nullptr);
+
+        enum Format {
+            PngFast,
+            PngMax,
+            WebpLossless,
+            Qoi
+        };
+
+        static Format formatFromSettings();
+        static Format effectiveFormat(Format format);
+        static QString extension(Format format);
+        static QByteArray encode(const QImage& image, Format format);
+
+    signals:
+        void saved(QString filename);
+        void failed(QString error);
+
+    public slots:
+        void save(QImage image, QString filename, Format format);
+        void save(QImage image, Format format = formatFromSettings());
+
+    private:
+        static QByteArray encodeQoi(const QImage& image);
+        static QPair<bool, QString> writeFile(QImage image, QString filename, Format format);
+
+        QFutureWatcher<QPair<bool, QString>>* watcher;
+};
+
+class ScreenshotMimeData : public QMimeData
+{
+        Q_OBJECT
+    public:
+        explicit ScreenshotMimeData(QImage image);
+
+        QStringList formats() const override;
+        bool hasFormat(const QString &mimeType) const override;
+
+    protected:
+        QVariant retrieveData(const QString &mimeType, QVariant::Type type) const override;
+
+    private:
+        QImage image;
+        mutable QByteArray encodedPng;
+};
+
+#endif // SCREENSHOTENCODER_H
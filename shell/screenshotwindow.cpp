@@ -20,8 +20,12 @@
 
 #include "screenshotwindow.h"
 #include "ui_screenshotwindow.h"
+#include "screenshotencoder.h"
+#include "soundeffects.h"
+#include "notificationsWidget/notificationsdbusadaptor.h"
 
 extern float getDPIScaling();
+extern NotificationsDBusAdaptor* ndbus;
 
 screenshotWindow::screenshotWindow(QWidget *parent) :
     QDialog(parent),
@@ -62,10 +66,7 @@ screenshotWindow::screenshotWindow(QWidget *parent) :
         savePixmap = screenshotPixmap;
         selectedRegion.setCoords(0, 0, originalPixmap.width(), originalPixmap.height());
 
-        QSoundEffect* takeScreenshot = new QSoundEffect();
-        takeScreenshot->setSource(QUrl("qrc:/sounds/screenshot.wav"));
-        takeScreenshot->play();
-        connect(takeScreenshot, SIGNAL(playingChanged()), takeScreenshot, SLOT(deleteLater()));
+        SoundEffects::instance()->play(SoundEffects::Screenshot);
 
 
         this->setGeometry(currentScreen->geometry());
@@ -191,7 +192,7 @@ void screenshotWindow::on_discardButton_clicked()
 void screenshotWindow::on_copyButton_clicked()
 {
     QClipboard* clipboard = QApplication::clipboard();
-    clipboard->setPixmap(savePixmap);
+    clipboard->setMimeData(new ScreenshotMimeData(savePixmap.toImage()));
 
     QRect newGeometry = ui->label->geometry();
     newGeometry.moveTop(-this->height() / 2);
@@ -219,8 +220,14 @@ void screenshotWindow::on_copyButton_clicked()
 
 void screenshotWindow::on_saveButton_clicked()
 {
-    QFile screenshotFile(QDir::homePath() + "/screenshot" + QDateTime::currentDateTime().toString("hh-mm-ss-yyyy-MM-dd") + ".png");
-    savePixmap.save(&screenshotFile, "PNG");
+    //Encode on a worker thread so the window can animate away straight away
+    ScreenshotEncoder* encoder = new ScreenshotEncoder();
+    connect(encoder, &ScreenshotEncoder::saved, encoder, &ScreenshotEncoder::deleteLater);
+    connect(encoder, &ScreenshotEncoder::failed, [=](QString error) {
+        ndbus->Notify("theShell", 0, "", tr("Screenshot"), tr("Couldn't save screenshot: %1").arg(error), QStringList(), QVariantMap(), -1);
+        encoder->deleteLater();
+    });
+    encoder->save(savePixmap.toImage());
     QRect newGeometry = ui->label->geometry();
     newGeometry.moveTop(-this->height() / 2);
 
@@ -0,0 +1,96 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#include "screentopology.h"
+
+#include <QApplication>
+#include <QDesktopWidget>
+#include <QX11Info>
+#include <xcb/xcb.h>
+#include <X11/Xlib.h>
+#include <X11/extensions/Xrandr.h>
+
+ScreenTopology* ScreenTopology::instance() {
+    static ScreenTopology* topology = new ScreenTopology();
+    return topology;
+}
+
+ScreenTopology::ScreenTopology(QObject *parent) : QObject(parent)
+{
+    //Docking or undocking produces a burst of RandR notifications while KScreen applies
+    //the new configuration, so wait for things to settle before telling anyone
+    debounceTimer = new QTimer(this);
+    debounceTimer->setInterval(300);
+    debounceTimer->setSingleShot(true);
+    connect(debounceTimer, SIGNAL(timeout()), this, SLOT(checkTopology()));
+
+    int errorBase;
+    if (XRRQueryExtension(QX11Info::display(), &randrEventBase, &errorBase)) {
+        //This replaces the RandR mask Qt selected on the root window over the same connection, so ask for
+        //everything Qt does: screen, CRTC, output and output property changes
+        XRRSelectInput(QX11Info::display(), DefaultRootWindow(QX11Info::display()),
+                       RRScreenChangeNotifyMask | RRCrtcChangeNotifyMask | RROutputChangeNotifyMask | RROutputPropertyNotifyMask);
+        QApplication::instance()->installNativeEventFilter(this);
+    } else {
+        randrEventBase = -1;
+    }
+
+    //Qt's own signals are a fallback when RandR isn't available, and are debounced the same way
+    connect(QApplication::desktop(), SIGNAL(screenCountChanged(int)), debounceTimer, SLOT(start()));
+    connect(QApplication::desktop(), SIGNAL(resized(int)), debounceTimer, SLOT(start()));
+    connect(QApplication::desktop(), SIGNAL(primaryScreenChanged()), debounceTimer, SLOT(start()));
+
+    currentScreens = screens();
+}
+
+bool ScreenTopology::nativeEventFilter(const QByteArray &eventType, void *message, long *result) {
+    Q_UNUSED(result)
+    if (eventType == "xcb_generic_event_t" && randrEventBase != -1) {
+        xcb_generic_event_t* event = static_cast<xcb_generic_event_t*>(message);
+        int type = event->response_type & ~0x80;
+        if (type == randrEventBase + RRScreenChangeNotify || type == randrEventBase + RRNotify) {
+            debounceTimer->start();
+        }
+    }
+    return false;
+}
+
+QList<QRect> ScreenTopology::screens() {
+    //The primary screen always comes first
+    QList<QRect> screens;
+    screens.append(primaryScreen());
+    for (int i = 0; i < QApplication::desktop()->screenCount(); i++) {
+        QRect geometry = QApplication::desktop()->screenGeometry(i);
+        if (!screens.contains(geometry)) screens.append(geometry);
+    }
+    return screens;
+}
+
+QRect ScreenTopology::primaryScreen() {
+    return QApplication::desktop()->screenGeometry();
+}
+
+void ScreenTopology::checkTopology() {
+    QList<QRect> newScreens = screens();
+    if (newScreens != currentScreens) {
+        currentScreens = newScreens;
+        emit screensChanged();
+    }
+}
@@ -0,0 +1,53 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#ifndef SCREENTOPOLOGY_H
+#define SCREENTOPOLOGY_H
+
+#include <QObject>
+#include <QAbstractNativeEventFilter>
+#include <QTimer>
+#include <QRect>
+
+class ScreenTopology : public QObject, public QAbstractNativeEventFilter
+{
+        Q_OBJECT
+    public:
+        static ScreenTopology* instance();
+
+        QList<QRect> screens();
+        QRect primaryScreen();
+
+    signals:
+        void screensChanged();
+
+    private slots:
+        void checkTopology();
+
+    private:
+        explicit ScreenTopology(QObject *parent = nullptr);
+        bool nativeEventFilter(const QByteArray &eventType, void *message, long *result) override;
+
+        QTimer* debounceTimer;
+        QList<QRect> currentScreens;
+        int randrEventBase = -1;
+};
+
+#endif // SCREENTOPOLOGY_H
@@ -45,13 +45,7 @@ void SegfaultDialog::on_pushButton_clicked()
 
 void SegfaultDialog::on_pushButton_2_clicked()
 {
-    void* buffer[50];
-    int size = backtrace(buffer, 50);
-    char** charBt = backtrace_symbols(buffer, size);
-    QString trace;
-    for (int i = 0; i < size && charBt != NULL; i++) {
-        trace.append(QString(charBt[i]) + "\n");
-    }
+    QString trace = CrashCapture::symbolize(CrashCapture::capture());
     QMessageBox::information(this, "Backtrace", trace, QMessageBox::Ok, QMessageBox::Ok);
 }
 
@@ -22,10 +22,10 @@
 #define SEGFAULTDIALOG_H
 
 #include <QDialog>
-#include <execinfo.h>
 #include <QMessageBox>
 #include <QSettings>
 #include <QPushButton>
+#include "crashcapture.h"
 
 namespace Ui {
 class SegfaultDialog;
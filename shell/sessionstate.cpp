@@ -0,0 +1,273 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+
+#include "sessionstate.h"
+#include "notificationsWidget/notificationobject.h"
+#include <QStandardPaths>
+#include <QDataStream>
+#include <QDebug>
+#include <atomic>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define SESSIONSTATE_MAGIC 0x54535332
+#define SESSIONSTATE_SLOT_SIZE (256 * 1024)
+#define SESSIONSTATE_MAX_NOTIFICATIONS 50
+
+//The state file holds two slots so that a crash part way through a write
+//always leaves the previous snapshot intact
+struct SlotHeader {
+    quint32 magic;
+    quint32 length;
+    quint64 sequence;
+    quint16 checksum;
+};
+
+SessionState* SessionState::instance() {
+    static SessionState* state = new SessionState();
+    return state;
+}
+
+SessionState::SessionState(QObject *parent) : QObject(parent)
+{
+    flushTimer = new QTimer(this);
+    flushTimer->setInterval(500);
+    flushTimer->setSingleShot(true);
+    connect(flushTimer, SIGNAL(timeout()), this, SLOT(flush()));
+
+    QString path = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation) + "/theshell-session.state";
+    int fd = open(path.toLocal8Bit().constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        qWarning() << "Can't open session state file" << path;
+        return;
+    }
+
+    if (ftruncate(fd, SESSIONSTATE_SLOT_SIZE * 2) == 0) {
+        void* mapped = mmap(nullptr, SESSIONSTATE_SLOT_SIZE * 2, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapped != MAP_FAILED) {
+            map = (uchar*) mapped;
+        }
+    }
+    close(fd);
+
+    if (map == nullptr) {
+        qWarning() << "Can't map session state file" << path;
+    }
+}
+
+bool SessionState::restore() {
+    if (map == nullptr) return false;
+
+    const SlotHeader* newest = nullptr;
+    for (int i = 0; i < 2; i++) {
+        const SlotHeader* header = (const SlotHeader*) (map + i * SESSIONSTATE_SLOT_SIZE);
+        if (header->magic != SESSIONSTATE_MAGIC || header->length > SESSIONSTATE_SLOT_SIZE - sizeof(SlotHeader)) continue;
+        if (qChecksum((const char*) (header + 1), header->length) != header->checksum) continue;
+
+        if (newest == nullptr || header->sequence > newest->sequence) {
+            newest = header;
+        }
+    }
+
+    if (newest == nullptr) return false;
+
+    QByteArray payload((const char*) (newest + 1), newest->length);
+    if (!deserialise(payload)) {
+        clear();
+        return false;
+    }
+
+    sequence = newest->sequence;
+    lastPayload = payload;
+    restored = true;
+
+    //Notifications come back under their old IDs, so new ones have to be numbered after them
+    for (Notification notification : currentNotifications) {
+        if ((int) notification.id > NotificationObject::currentId) NotificationObject::currentId = notification.id;
+    }
+    return true;
+}
+
+bool SessionState::isRestored() {
+    return restored;
+}
+
+void SessionState::clear() {
+    flushTimer->stop();
+    if (map != nullptr) {
+        for (int i = 0; i < 2; i++) {
+            ((SlotHeader*) (map + i * SESSIONSTATE_SLOT_SIZE))->magic = 0;
+        }
+    }
+
+    sequence = 0;
+    restored = false;
+    lastPayload.clear();
+    currentQuietMode = 0;
+    currentQuietModeReset = QDateTime();
+    currentMprisPlayer.clear();
+    currentNotifications.clear();
+    currentTimers = Timers();
+}
+
+int SessionState::quietMode() {
+    return currentQuietMode;
+}
+
+QDateTime SessionState::quietModeResetTime() {
+    return currentQuietModeReset;
+}
+
+QString SessionState::mprisPlayer() {
+    return currentMprisPlayer;
+}
+
+QList<SessionState::Notification> SessionState::notifications() {
+    return currentNotifications;
+}
+
+SessionState::Timers SessionState::timers() {
+    return currentTimers;
+}
+
+void SessionState::setQuietMode(int mode) {
+    if (currentQuietMode == mode) return;
+    currentQuietMode = mode;
+    scheduleFlush();
+}
+
+void SessionState::setQuietModeResetTime(QDateTime time) {
+    if (currentQuietModeReset == time) return;
+    currentQuietModeReset = time;
+    scheduleFlush();
+}
+
+void SessionState::setMprisPlayer(QString player) {
+    if (currentMprisPlayer == player) return;
+    currentMprisPlayer = player;
+    scheduleFlush();
+}
+
+void SessionState::setNotifications(QList<Notification> notifications) {
+    while (notifications.count() > SESSIONSTATE_MAX_NOTIFICATIONS) {
+        notifications.removeFirst();
+    }
+
+    //Hints such as image-data are D-Bus types that can't be streamed; the icon is looked up again anyway
+    for (Notification& notification : notifications) {
+        for (QString hint : notification.hints.keys()) {
+            if (notification.hints.value(hint).userType() >= QMetaType::User) {
+                notification.hints.remove(hint);
+            }
+        }
+    }
+
+    currentNotifications = notifications;
+    scheduleFlush();
+}
+
+void SessionState::setTimers(Timers timers) {
+    currentTimers = timers;
+    scheduleFlush();
+}
+
+void SessionState::scheduleFlush() {
+    if (!flushTimer->isActive()) {
+        flushTimer->start();
+    }
+}
+
+void SessionState::flush() {
+    flushTimer->stop();
+    if (map == nullptr) return;
+
+    QByteArray payload = serialise();
+    if (payload == lastPayload) return;
+    if ((uint) payload.length() > SESSIONSTATE_SLOT_SIZE - sizeof(SlotHeader)) {
+        qWarning() << "Session state is too large to snapshot";
+        return;
+    }
+
+    sequence++;
+    SlotHeader* header = (SlotHeader*) (map + (sequence % 2) * SESSIONSTATE_SLOT_SIZE);
+
+    //Invalidate the slot first so a half written snapshot is never picked up
+    header->magic = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header + 1, payload.constData(), payload.length());
+    header->length = payload.length();
+    header->sequence = sequence;
+    header->checksum = qChecksum(payload.constData(), payload.length());
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = SESSIONSTATE_MAGIC;
+
+    lastPayload = payload;
+}
+
+QByteArray SessionState::serialise() {
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_6);
+
+    out << (qint64) getppid() << (qint32) currentQuietMode << currentQuietModeReset << currentMprisPlayer;
+    out << (qint32) currentTimers.timer << currentTimers.timerDeadline << currentTimers.timerRemaining << currentTimers.lastTimer
+        << currentTimers.stopwatchRunning << currentTimers.stopwatchElapsed << currentTimers.stopwatchStarted;
+
+    out << (quint32) currentNotifications.count();
+    for (Notification notification : currentNotifications) {
+        out << notification.id << notification.appName << notification.appIcon << notification.summary << notification.body
+            << notification.actions << notification.hints << (qint32) notification.timeout << notification.date;
+    }
+
+    return payload;
+}
+
+bool SessionState::deserialise(QByteArray payload) {
+    QDataStream in(payload);
+    in.setVersion(QDataStream::Qt_5_6);
+
+    //Only pick up state left behind by a theShell in this session
+    qint64 parent;
+    in >> parent;
+    if (parent != getppid()) return false;
+
+    qint32 quietMode, timerState;
+    in >> quietMode >> currentQuietModeReset >> currentMprisPlayer;
+    in >> timerState >> currentTimers.timerDeadline >> currentTimers.timerRemaining >> currentTimers.lastTimer
+       >> currentTimers.stopwatchRunning >> currentTimers.stopwatchElapsed >> currentTimers.stopwatchStarted;
+    currentQuietMode = quietMode;
+    currentTimers.timer = (Timers::TimerState) timerState;
+
+    quint32 count;
+    in >> count;
+    currentNotifications.clear();
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+        Notification notification;
+        qint32 timeout;
+        in >> notification.id >> notification.appName >> notification.appIcon >> notification.summary >> notification.body
+           >> notification.actions >> notification.hints >> timeout >> notification.date;
+        notification.timeout = timeout;
+        currentNotifications.append(notification);
+    }
+
+    return in.status() == QDataStream::Ok;
+}
@@ -0,0 +1,101 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+
+#ifndef SESSIONSTATE_H
+#define SESSIONSTATE_H
+
+#include <QObject>
+#include <QTimer>
+#include <QDateTime>
+#include <QVariantMap>
+
+class SessionState : public QObject
+{
+        Q_OBJECT
+    public:
+        struct Notification {
+            uint id;
+            QString appName, appIcon, summary, body;
+            QStringList actions;
+            QVariantMap hints;
+            int timeout;
+            QDateTime date;
+        };
+
+        struct Timers {
+            enum TimerState {
+                Stopped,
+                Running,
+                Paused
+            };
+
+            TimerState timer = Stopped;
+            qint64 timerDeadline = 0; //Milliseconds since epoch when the timer is running
+            qint64 timerRemaining = 0; //Milliseconds left when the timer is paused
+            QTime lastTimer;
+
+            bool stopwatchRunning = false;
+            qint64 stopwatchElapsed = 0; //Milliseconds accumulated before the current run
+            qint64 stopwatchStarted = 0; //Milliseconds since epoch the current run began
+        };
+
+        static SessionState* instance();
+
+        bool restore();
+        bool isRestored();
+        void clear();
+
+        int quietMode();
+        QDateTime quietModeResetTime();
+        QString mprisPlayer();
+        QList<Notification> notifications();
+        Timers timers();
+
+    public slots:
+        void setQuietMode(int mode);
+        void setQuietModeResetTime(QDateTime time);
+        void setMprisPlayer(QString player);
+        void setNotifications(QList<SessionState::Notification> notifications);
+        void setTimers(SessionState::Timers timers);
+
+        void flush();
+
+    private:
+        explicit SessionState(QObject *parent = nullptr);
+
+        void scheduleFlush();
+        QByteArray serialise();
+        bool deserialise(QByteArray payload);
+
+        uchar* map = nullptr;
+        quint64 sequence = 0;
+        bool restored = false;
+        QTimer* flushTimer;
+        QByteArray lastPayload;
+
+        int currentQuietMode = 0;
+        QDateTime currentQuietModeReset;
+        QString currentMprisPlayer;
+        QList<Notification> currentNotifications;
+        Timers currentTimers;
+};
+
+#endif // SESSIONSTATE_H
@@ -10,7 +10,7 @@ LIBS     += -lcrypt
 
 unix {
     CONFIG += link_pkgconfig
-    PKGCONFIG += glib-2.0 x11 x11-xcb xcb-keysyms xscrnsaver xext libpulse libpulse-mainloop-glib libsystemd libunwind polkit-qt5-1
+    PKGCONFIG += glib-2.0 x11 x11-xcb xcb-keysyms xscrnsaver xext xrandr libpulse libpulse-mainloop-glib alsa libsystemd libudev libunwind polkit-qt5-1
 }
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
@@ -49,9 +49,7 @@ location.files = org.freedesktop.GeoClue2.Agent.xml
 location.header_flags = -l LocationServices -i location/locationservices.h
 location.source_flags = -l LocationServices -i location/locationservices.h
 
-dsig.files = org.thesuite.theshell.xml
-
-DBUS_ADAPTORS += power dsig
+DBUS_ADAPTORS += power
 
 SOURCES += main.cpp\
         mainwindow.cpp \
@@ -59,6 +57,8 @@ SOURCES += main.cpp\
     menu.cpp \
     endsessionwait.cpp \
     background.cpp \
+    backgroundrenderer.cpp \
+    backgroundprefetcher.cpp \
     upowerdbus.cpp \
     infopanedropdown.cpp \
     clickablelabel.cpp \
@@ -68,6 +68,7 @@ SOURCES += main.cpp\
     FlowLayout/flowlayout.cpp \
     segfaultdialog.cpp \
     globalfilter.cpp \
+    screentopology.cpp \
     systrayicons.cpp \
     nativeeventfilter.cpp \
     hotkeyhud.cpp \
@@ -81,9 +82,22 @@ SOURCES += main.cpp\
     bthandsfree.cpp \
     tutorialwindow.cpp \
     screenshotwindow.cpp \
+    screenshotencoder.cpp \
     audiomanager.cpp \
+    alsamixer.cpp \
     taskbarmanager.cpp \
     dbussignals.cpp \
+    startupmanager.cpp \
+    startuptrace.cpp \
+    sessionstate.cpp \
+    crashcapture.cpp \
+    shutdowncoordinator.cpp \
+    mixerwidget.cpp \
+    soundeffects.cpp \
+    batteryhistory.cpp \
+    wakeupsprofiler.cpp \
+    shellsettings.cpp \
+    devicemonitor.cpp \
     networkmanager/networkwidget.cpp \
     networkmanager/availablenetworkslist.cpp \
     notificationsWidget/notificationswidget.cpp \
@@ -95,7 +109,11 @@ SOURCES += main.cpp\
     apps/appslistmodel.cpp \
     apps/app.cpp \
     networkmanager/savednetworkslist.cpp \
+    networkmanager/networkmanagerclient.cpp \
+    networkmanager/connectivitymonitor.cpp \
+    networkmanager/networkstatistics.cpp \
     screenrecorder.cpp \
+    screenrecorderthreads.cpp \
     kdeconnect/kdeconnectwidget.cpp \
     kdeconnect/kdeconnectdevicesmodel.cpp \
     location/locationservices.cpp \
@@ -109,6 +127,8 @@ HEADERS  += mainwindow.h \
     menu.h \
     endsessionwait.h \
     background.h \
+    backgroundrenderer.h \
+    backgroundprefetcher.h \
     upowerdbus.h \
     infopanedropdown.h \
     clickablelabel.h \
@@ -118,6 +138,7 @@ HEADERS  += mainwindow.h \
     FlowLayout/flowlayout.h \
     segfaultdialog.h \
     globalfilter.h \
+    screentopology.h \
     systrayicons.h \
     nativeeventfilter.h \
     hotkeyhud.h \
@@ -131,10 +152,23 @@ HEADERS  += mainwindow.h \
     bthandsfree.h \
     tutorialwindow.h \
     screenshotwindow.h \
+    screenshotencoder.h \
     audiomanager.h \
+    alsamixer.h \
     internationalisation.h \
     taskbarmanager.h \
     dbussignals.h \
+    startupmanager.h \
+    startuptrace.h \
+    sessionstate.h \
+    crashcapture.h \
+    shutdowncoordinator.h \
+    mixerwidget.h \
+    soundeffects.h \
+    batteryhistory.h \
+    wakeupsprofiler.h \
+    shellsettings.h \
+    devicemonitor.h \
     networkmanager/networkwidget.h \
     networkmanager/availablenetworkslist.h \
     notificationsWidget/notificationswidget.h \
@@ -146,7 +180,11 @@ HEADERS  += mainwindow.h \
     apps/appslistmodel.h \
     apps/app.h \
     networkmanager/savednetworkslist.h \
+    networkmanager/networkmanagerclient.h \
+    networkmanager/connectivitymonitor.h \
+    networkmanager/networkstatistics.h \
     screenrecorder.h \
+    screenrecorderthreads.h \
     kdeconnect/kdeconnectwidget.h \
     kdeconnect/kdeconnectdevicesmodel.h \
     location/locationservices.h \
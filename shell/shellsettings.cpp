@@ -0,0 +1,142 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#include "shellsettings.h"
+
+#include <QFileInfo>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+    //Values read back from the file come in as strings, so compare what they say rather than their types
+    bool sameValue(QVariant first, QVariant second) {
+        if (first == second) return true;
+        if (first.canConvert<QString>() && second.canConvert<QString>()) return first.toString() == second.toString();
+        return false;
+    }
+}
+
+ShellSettings* ShellSettings::instance() {
+    static ShellSettings* shellSettings = new ShellSettings();
+    return shellSettings;
+}
+
+ShellSettings::ShellSettings(QObject *parent) : QObject(parent)
+{
+    for (QString key : settings.allKeys()) {
+        cache.insert(key, settings.value(key));
+    }
+    updateValues();
+
+    //Coalesce bursts of writes, like dragging a slider, into one write to disk
+    writeTimer = new QTimer(this);
+    writeTimer->setSingleShot(true);
+    writeTimer->setInterval(500);
+    connect(writeTimer, SIGNAL(timeout()), this, SLOT(sync()));
+
+    reloadTimer = new QTimer(this);
+    reloadTimer->setSingleShot(true);
+    reloadTimer->setInterval(100);
+    connect(reloadTimer, SIGNAL(timeout()), this, SLOT(reload()));
+
+    //QSettings replaces the file instead of rewriting it, so watch the directory for the new copy landing
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd >= 0) {
+        QByteArray directory = QFileInfo(settings.fileName()).absolutePath().toLocal8Bit();
+        if (inotify_add_watch(inotifyFd, directory.constData(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            close(inotifyFd);
+            inotifyFd = -1;
+        } else {
+            notifier = new QSocketNotifier(inotifyFd, QSocketNotifier::Read, this);
+            connect(notifier, SIGNAL(activated(int)), this, SLOT(fileChanged()));
+        }
+    }
+}
+
+QVariant ShellSettings::value(QString key, QVariant defaultValue) const {
+    return cache.value(key, defaultValue);
+}
+
+void ShellSettings::setValue(QString key, QVariant value) {
+    if (cache.contains(key) && sameValue(cache.value(key), value)) return;
+
+    cache.insert(key, value);
+    settings.setValue(key, value);
+    updateValues();
+    emit changed(key, value);
+
+    writeTimer->start();
+}
+
+void ShellSettings::sync() {
+    writeTimer->stop();
+    settings.sync();
+}
+
+void ShellSettings::fileChanged() {
+    QByteArray name = QFileInfo(settings.fileName()).fileName().toLocal8Bit();
+    char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+    ssize_t length;
+    while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+        for (char* event = buffer; event < buffer + length; event += sizeof(struct inotify_event) + ((struct inotify_event*) event)->len) {
+            struct inotify_event* info = (struct inotify_event*) event;
+            if (info->len > 0 && name == info->name) reloadTimer->start();
+        }
+    }
+}
+
+void ShellSettings::reload() {
+    settings.sync();
+
+    QHash<QString, QVariant> fresh;
+    for (QString key : settings.allKeys()) {
+        fresh.insert(key, settings.value(key));
+    }
+
+    //Our own writes come back through here too, but they already match the cache
+    QStringList changedKeys;
+    for (QString key : fresh.keys()) {
+        if (!cache.contains(key) || !sameValue(cache.value(key), fresh.value(key))) changedKeys.append(key);
+    }
+    for (QString key : cache.keys()) {
+        if (!fresh.contains(key)) changedKeys.append(key);
+    }
+    if (changedKeys.isEmpty()) return;
+
+    cache = fresh;
+    updateValues();
+    for (QString key : changedKeys) {
+        emit changed(key, cache.value(key));
+    }
+}
+
+void ShellSettings::updateValues() {
+    current.barOnTop = cache.value("bar/onTop", true).toBool();
+    current.barStatusBar = cache.value("bar/statusBar", false).toBool();
+    current.barCompact = cache.value("bar/compact", false).toBool();
+    current.barAutoshow = cache.value("bar/autoshow", false).toBool();
+    current.barShowText = cache.value("bar/showText", true).toBool();
+    current.barShowWindowsFromOtherDesktops = cache.value("bar/showWindowsFromOtherDesktops", true).toBool();
+    current.use24Hour = cache.value("time/use24hour", true).toBool();
+    current.volumeOverdrive = cache.value("sound/volumeOverdrive", true).toBool();
+    current.feedbackSound = cache.value("sound/feedbackSound", true).toBool();
+    current.touchFeedbackSound = cache.value("input/touchFeedbackSound", false).toBool();
+}
@@ -0,0 +1,86 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#ifndef SHELLSETTINGS_H
+#define SHELLSETTINGS_H
+
+#include <QObject>
+#include <QSettings>
+#include <QHash>
+#include <QTimer>
+#include <QSocketNotifier>
+
+class ShellSettings : public QObject
+{
+    Q_OBJECT
+public:
+    static ShellSettings* instance();
+
+    QVariant value(QString key, QVariant defaultValue = QVariant()) const;
+
+    bool barOnTop() const { return current.barOnTop; }
+    bool barStatusBar() const { return current.barStatusBar; }
+    bool barCompact() const { return current.barCompact; }
+    bool barAutoshow() const { return current.barAutoshow; }
+    bool barShowText() const { return current.barShowText; }
+    bool barShowWindowsFromOtherDesktops() const { return current.barShowWindowsFromOtherDesktops; }
+    bool use24Hour() const { return current.use24Hour; }
+    bool volumeOverdrive() const { return current.volumeOverdrive; }
+    bool feedbackSound() const { return current.feedbackSound; }
+    bool touchFeedbackSound() const { return current.touchFeedbackSound; }
+
+signals:
+    void changed(QString key, QVariant value);
+
+public slots:
+    void setValue(QString key, QVariant value);
+    void sync();
+
+private slots:
+    void fileChanged();
+    void reload();
+
+private:
+    explicit ShellSettings(QObject *parent = 0);
+
+    void updateValues();
+
+    struct Values {
+        bool barOnTop;
+        bool barStatusBar;
+        bool barCompact;
+        bool barAutoshow;
+        bool barShowText;
+        bool barShowWindowsFromOtherDesktops;
+        bool use24Hour;
+        bool volumeOverdrive;
+        bool feedbackSound;
+        bool touchFeedbackSound;
+    } current;
+
+    QSettings settings;
+    QHash<QString, QVariant> cache;
+    QTimer* writeTimer;
+    QTimer* reloadTimer;
+    int inotifyFd = -1;
+    QSocketNotifier* notifier = NULL;
+};
+
+#endif // SHELLSETTINGS_H
@@ -0,0 +1,319 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+
+#include "shutdowncoordinator.h"
+
+#include <QApplication>
+#include <QX11Info>
+#include <QImage>
+#include <QIcon>
+#include <xcb/xcb.h>
+#include <X11/Xlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <string.h>
+
+namespace {
+    xcb_atom_t atom(const char* name) {
+        return XInternAtom(QX11Info::display(), name, False);
+    }
+
+    QString propertyString(xcb_get_property_reply_t* reply) {
+        if (reply == nullptr || xcb_get_property_value_length(reply) == 0) return "";
+        return QString::fromUtf8((const char*) xcb_get_property_value(reply), xcb_get_property_value_length(reply));
+    }
+
+    QIcon propertyIcon(xcb_get_property_reply_t* reply) {
+        if (reply == nullptr || reply->format != 32) return QIcon();
+
+        //_NET_WM_ICON is a list of width, height and ARGB pixels; use the smallest icon that's still at least 16px
+        const quint32* data = (const quint32*) xcb_get_property_value(reply);
+        int length = xcb_get_property_value_length(reply) / 4;
+        QImage best;
+        for (int i = 0; i + 2 <= length;) {
+            int width = data[i];
+            int height = data[i + 1];
+            if (width <= 0 || height <= 0 || i + 2 + width * height > length) break;
+
+            if (best.isNull() || (width >= 16 && width < best.width()) || (best.width() < 16 && width > best.width())) {
+                best = QImage((const uchar*) (data + i + 2), width, height, QImage::Format_ARGB32).copy();
+            }
+            i += 2 + width * height;
+        }
+
+        if (best.isNull()) return QIcon();
+        return QIcon(QPixmap::fromImage(best.scaled(16, 16, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)));
+    }
+}
+
+ShutdownCoordinator::ShutdownCoordinator(QObject *parent) : QObject(parent)
+{
+    //Unmaps and client list changes come in bursts as apps close; check them together
+    reconcileTimer = new QTimer(this);
+    reconcileTimer->setInterval(0);
+    reconcileTimer->setSingleShot(true);
+    connect(reconcileTimer, SIGNAL(timeout()), this, SLOT(reconcile()));
+
+    killTimer = new QTimer(this);
+    killTimer->setInterval(100);
+    connect(killTimer, SIGNAL(timeout()), this, SLOT(checkKilled()));
+
+    QApplication::instance()->installNativeEventFilter(this);
+}
+
+ShutdownCoordinator::~ShutdownCoordinator() {
+    QApplication::instance()->removeNativeEventFilter(this);
+}
+
+QList<WmWindow> ShutdownCoordinator::windows() {
+    return trackedWindows.values();
+}
+
+int ShutdownCoordinator::count() {
+    return trackedWindows.count();
+}
+
+QList<Window> ShutdownCoordinator::clientList() {
+    xcb_connection_t* connection = QX11Info::connection();
+    xcb_get_property_reply_t* reply = xcb_get_property_reply(connection,
+        xcb_get_property(connection, false, QX11Info::appRootWindow(), atom("_NET_CLIENT_LIST"), XCB_ATOM_WINDOW, 0, 4096), nullptr);
+
+    QList<Window> windows;
+    if (reply != nullptr) {
+        const xcb_window_t* data = (const xcb_window_t*) xcb_get_property_value(reply);
+        int length = xcb_get_property_value_length(reply) / sizeof(xcb_window_t);
+        for (int i = 0; i < length; i++) {
+            windows.append(data[i]);
+        }
+        free(reply);
+    }
+    return windows;
+}
+
+void ShutdownCoordinator::refresh() {
+    xcb_connection_t* connection = QX11Info::connection();
+    QList<Window> clients = clientList();
+
+    //Send every request before reading any replies so the whole list costs a single round trip
+    struct Request {
+        Window window;
+        xcb_get_property_cookie_t pid, netName, name, icon;
+        xcb_get_window_attributes_cookie_t attributes;
+    };
+    QVector<Request> requests;
+    for (Window window : clients) {
+        Request request;
+        request.window = window;
+        request.pid = xcb_get_property(connection, false, window, atom("_NET_WM_PID"), XCB_ATOM_CARDINAL, 0, 1);
+        request.netName = xcb_get_property(connection, false, window, atom("_NET_WM_NAME"), atom("UTF8_STRING"), 0, 1024);
+        request.name = xcb_get_property(connection, false, window, XCB_ATOM_WM_NAME, XCB_ATOM_ANY, 0, 1024);
+        request.icon = xcb_get_property(connection, false, window, atom("_NET_WM_ICON"), XCB_ATOM_CARDINAL, 0, 16384);
+        request.attributes = xcb_get_window_attributes(connection, window);
+        requests.append(request);
+    }
+
+    trackedWindows.clear();
+    processWindows.clear();
+    for (Request request : requests) {
+        xcb_get_property_reply_t* pid = xcb_get_property_reply(connection, request.pid, nullptr);
+        xcb_get_property_reply_t* netName = xcb_get_property_reply(connection, request.netName, nullptr);
+        xcb_get_property_reply_t* name = xcb_get_property_reply(connection, request.name, nullptr);
+        xcb_get_property_reply_t* icon = xcb_get_property_reply(connection, request.icon, nullptr);
+        xcb_get_window_attributes_reply_t* attributes = xcb_get_window_attributes_reply(connection, request.attributes, nullptr);
+
+        //Closing is tracked through DestroyNotify and UnmapNotify on the window itself; keep whatever else we already listen for
+        if (attributes != nullptr) {
+            quint32 mask = attributes->your_event_mask | XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+            xcb_change_window_attributes(connection, request.window, XCB_CW_EVENT_MASK, &mask);
+            free(attributes);
+        }
+
+        WmWindow window;
+        window.setWID(request.window);
+        if (pid != nullptr && xcb_get_property_value_length(pid) >= 4) {
+            window.setPID(*(const quint32*) xcb_get_property_value(pid));
+        }
+        window.setTitle(propertyString(netName));
+        if (window.title() == "") {
+            window.setTitle(propertyString(name));
+        }
+        window.setIcon(propertyIcon(icon));
+
+        free(pid);
+        free(netName);
+        free(name);
+        free(icon);
+
+        if (window.PID() != (unsigned long) QCoreApplication::applicationPid()) {
+            trackedWindows.insert(request.window, window);
+            processWindows.insert(window.PID(), request.window);
+        }
+    }
+
+    emit windowsChanged();
+}
+
+void ShutdownCoordinator::closeAll(QStringList spareTitles) {
+    refresh();
+
+    xcb_connection_t* connection = QX11Info::connection();
+    xcb_atom_t closeWindow = atom("_NET_CLOSE_WINDOW");
+    for (WmWindow window : trackedWindows.values()) {
+        bool spare = false;
+        for (QString title : spareTitles) {
+            if (window.title().toLower().contains(title)) spare = true;
+        }
+
+        if (spare) {
+            //Windows we leave open shouldn't hold up the end of the session
+            removeWindow(window.WID());
+            continue;
+        }
+
+        xcb_client_message_event_t event;
+        memset(&event, 0, sizeof(event));
+        event.response_type = XCB_CLIENT_MESSAGE;
+        event.format = 32;
+        event.window = window.WID();
+        event.type = closeWindow;
+        event.data.data32[0] = XCB_CURRENT_TIME;
+        event.data.data32[1] = 2; //Source indication: pager
+        xcb_send_event(connection, false, QX11Info::appRootWindow(),
+                       XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT | XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY, (const char*) &event);
+    }
+    xcb_flush(connection);
+
+    closing = true;
+}
+
+void ShutdownCoordinator::killAll(int grace) {
+    //Ask nicely first and only force whatever is still around once the grace period is up
+    killTargets.clear();
+    for (unsigned long pid : processWindows.uniqueKeys()) {
+        pid_t target;
+        bool group = processGroup(pid, &target);
+        if (target == 0) continue;
+
+        killTargets.insert(target, group);
+        if (group) {
+            killpg(target, SIGTERM);
+        } else {
+            kill(target, SIGTERM);
+        }
+    }
+
+    killGrace = grace;
+    killElapsed.start();
+    killTimer->start();
+    checkKilled();
+}
+
+void ShutdownCoordinator::signalProcess(unsigned long pid, int sig) {
+    pid_t target;
+    if (processGroup(pid, &target)) {
+        killpg(target, sig);
+    } else if (target != 0) {
+        kill(target, sig);
+    }
+}
+
+bool ShutdownCoordinator::processGroup(unsigned long pid, pid_t* target) {
+    *target = 0;
+    if (pid == 0) return false;
+
+    //Apps get their own process group when they're launched, so take their helpers down with them
+    pid_t group = getpgid(pid);
+    if (group > 1 && group != getpgrp()) {
+        *target = group;
+        return true;
+    } else {
+        *target = pid;
+        return false;
+    }
+}
+
+void ShutdownCoordinator::checkKilled() {
+    for (pid_t target : killTargets.keys()) {
+        int alive = killTargets.value(target) ? killpg(target, 0) : kill(target, 0);
+        if (alive != 0) killTargets.remove(target);
+    }
+
+    if (!killTargets.isEmpty() && killElapsed.elapsed() < killGrace) return;
+
+    for (pid_t target : killTargets.keys()) {
+        if (killTargets.value(target)) {
+            killpg(target, SIGKILL);
+        } else {
+            kill(target, SIGKILL);
+        }
+    }
+    killTargets.clear();
+    killTimer->stop();
+    emit allKilled();
+}
+
+void ShutdownCoordinator::reconcile() {
+    QList<Window> clients = clientList();
+    for (Window window : trackedWindows.keys()) {
+        if (!clients.contains(window)) {
+            removeWindow(window);
+        }
+    }
+}
+
+void ShutdownCoordinator::removeWindow(Window window) {
+    if (!trackedWindows.contains(window)) return;
+
+    processWindows.remove(trackedWindows.value(window).PID(), window);
+    trackedWindows.remove(window);
+    emit windowsChanged();
+
+    if (closing && trackedWindows.isEmpty()) {
+        closing = false;
+        emit allClosed();
+    }
+}
+
+bool ShutdownCoordinator::nativeEventFilter(const QByteArray &eventType, void *message, long *result) {
+    Q_UNUSED(result)
+    if (eventType == "xcb_generic_event_t") {
+        xcb_generic_event_t* event = static_cast<xcb_generic_event_t*>(message);
+        switch (event->response_type & ~0x80) {
+            case XCB_DESTROY_NOTIFY:
+                removeWindow(((xcb_destroy_notify_event_t*) event)->window);
+                break;
+            case XCB_UNMAP_NOTIFY:
+                //Minimising can unmap a window too, so let the client list decide
+                if (trackedWindows.contains(((xcb_unmap_notify_event_t*) event)->window)) {
+                    reconcileTimer->start();
+                }
+                break;
+            case XCB_PROPERTY_NOTIFY: {
+                xcb_property_notify_event_t* property = (xcb_property_notify_event_t*) event;
+                if (property->window == QX11Info::appRootWindow() && property->atom == atom("_NET_CLIENT_LIST") && !trackedWindows.isEmpty()) {
+                    reconcileTimer->start();
+                }
+                break;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,74 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+
+#ifndef SHUTDOWNCOORDINATOR_H
+#define SHUTDOWNCOORDINATOR_H
+
+#include <QObject>
+#include <QAbstractNativeEventFilter>
+#include <QMap>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <sys/types.h>
+#include "window.h"
+
+class ShutdownCoordinator : public QObject, public QAbstractNativeEventFilter
+{
+        Q_OBJECT
+    public:
+        explicit ShutdownCoordinator(QObject *parent = nullptr);
+        ~ShutdownCoordinator();
+
+        QList<WmWindow> windows();
+        int count();
+
+        void refresh();
+        void closeAll(QStringList spareTitles = QStringList());
+        void killAll(int grace = 3000);
+        void signalProcess(unsigned long pid, int sig);
+
+    signals:
+        void windowsChanged();
+        void allClosed();
+        void allKilled();
+
+    private slots:
+        void reconcile();
+        void checkKilled();
+
+    private:
+        bool nativeEventFilter(const QByteArray &eventType, void *message, long *result) override;
+
+        QList<Window> clientList();
+        void removeWindow(Window window);
+        bool processGroup(unsigned long pid, pid_t* target);
+
+        QMap<Window, WmWindow> trackedWindows;
+        QMultiMap<unsigned long, Window> processWindows;
+        QTimer* reconcileTimer;
+        QTimer* killTimer;
+        QElapsedTimer killElapsed;
+        QMap<pid_t, bool> killTargets;
+        int killGrace = 0;
+        bool closing = false;
+};
+
+#endif // SHUTDOWNCOORDINATOR_H
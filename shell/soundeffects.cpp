@@ -0,0 +1,279 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#include "soundeffects.h"
+#include "startuptrace.h"
+
+#include <QFile>
+#include <QSoundEffect>
+#include <QDebug>
+#include <QtEndian>
+#include <string.h>
+
+#define SOUND_EFFECT_VOICES 4
+
+namespace {
+    void releaseOperation(pa_operation* operation) {
+        if (operation != NULL) pa_operation_unref(operation);
+    }
+}
+
+SoundEffects* SoundEffects::instance() {
+    static SoundEffects* effects = new SoundEffects();
+    return effects;
+}
+
+SoundEffects::SoundEffects(QObject *parent) : QObject(parent)
+{
+    TRACE_SPAN("SoundEffects");
+
+    //Every bundled sound is 16 bit 44.1kHz, so one stereo format serves them all
+    spec.format = PA_SAMPLE_S16LE;
+    spec.rate = 44100;
+    spec.channels = 2;
+
+    resources.insert(VolumeFeedback, ":/sounds/volfeedback.wav");
+    resources.insert(Click, ":/sounds/click.wav");
+    resources.insert(KeyLocks, ":/sounds/keylocks.wav");
+    resources.insert(Screenshot, ":/sounds/screenshot.wav");
+    resources.insert(MediaInsert, ":/sounds/media-insert.wav");
+    resources.insert(MediaRemove, ":/sounds/media-remove.wav");
+    resources.insert(Charging, ":/sounds/charging.wav");
+    resources.insert(PowerLow, ":/sounds/powerlow.wav");
+    resources.insert(TriplePing, ":/sounds/notifications/tripleping.wav");
+    resources.insert(UpsideDown, ":/sounds/notifications/upsidedown.wav");
+    resources.insert(Echo, ":/sounds/notifications/echo.wav");
+    resources.insert(Reminder, ":/sounds/notifications/reminder.wav");
+
+    for (Sound sound : resources.keys()) {
+        decode(sound, resources.value(sound));
+    }
+
+    pa_proplist* propList = pa_proplist_new();
+    pa_proplist_sets(propList, PA_PROP_APPLICATION_NAME, "theShell");
+    pa_proplist_sets(propList, PA_PROP_APPLICATION_ID, "org.thesuite.theshell");
+    pa_proplist_sets(propList, PA_PROP_APPLICATION_ICON_NAME, "theshell");
+
+    pulseContext = pa_context_new_with_proplist(pa_glib_mainloop_get_api(pa_glib_mainloop_new(NULL)), NULL, propList);
+    pa_proplist_free(propList);
+    pa_context_set_state_callback(pulseContext, &SoundEffects::pulseStateChanged, this);
+    pa_context_connect(pulseContext, NULL, PA_CONTEXT_NOFLAGS, NULL);
+}
+
+void SoundEffects::decode(Sound sound, QString resource) {
+    QFile file(resource);
+    if (!file.open(QFile::ReadOnly)) return;
+
+    QByteArray wav = file.readAll();
+    const uchar* data = (const uchar*) wav.constData();
+    if (wav.length() < 12 || !wav.startsWith("RIFF") || wav.mid(8, 4) != "WAVE") {
+        qWarning() << resource << "is not a WAV file";
+        return;
+    }
+
+    int format = 0, channels = 0, rate = 0, bits = 0;
+    int position = 12;
+    while (position + 8 <= wav.length()) {
+        QByteArray chunk = wav.mid(position, 4);
+        int length = qMin((int) qFromLittleEndian<quint32>(data + position + 4), wav.length() - position - 8);
+        position += 8;
+
+        if (chunk == "fmt " && length >= 16) {
+            format = qFromLittleEndian<quint16>(data + position);
+            channels = qFromLittleEndian<quint16>(data + position + 2);
+            rate = qFromLittleEndian<quint32>(data + position + 4);
+            bits = qFromLittleEndian<quint16>(data + position + 14);
+        } else if (chunk == "data") {
+            if (format != 1 || bits != 16 || rate != (int) spec.rate || channels < 1 || channels > 2) {
+                qWarning() << resource << "is not 16 bit 44.1kHz PCM";
+                return;
+            }
+
+            QByteArray pcm = wav.mid(position, length - length % (2 * channels));
+            if (channels == 1) {
+                //Copy each mono sample into both channels
+                QByteArray stereo(pcm.length() * 2, Qt::Uninitialized);
+                for (int i = 0; i < pcm.length(); i += 2) {
+                    memcpy(stereo.data() + i * 2, pcm.constData() + i, 2);
+                    memcpy(stereo.data() + i * 2 + 2, pcm.constData() + i, 2);
+                }
+                pcm = stereo;
+            }
+            buffers.insert(sound, pcm);
+            return;
+        }
+
+        //Chunks are padded to an even length
+        position += length + (length & 1);
+    }
+}
+
+void SoundEffects::pulseStateChanged(pa_context *c, void *userdata) {
+    SoundEffects* effects = (SoundEffects*) userdata;
+    switch (pa_context_get_state(c)) {
+        case PA_CONTEXT_READY:
+            effects->openVoices();
+            break;
+        case PA_CONTEXT_FAILED:
+        case PA_CONTEXT_TERMINATED:
+            for (Voice* voice : effects->voices) {
+                pa_stream_set_write_callback(voice->stream, NULL, NULL);
+                pa_stream_set_underflow_callback(voice->stream, NULL, NULL);
+                pa_stream_unref(voice->stream);
+                delete voice;
+            }
+            effects->voices.clear();
+            break;
+        default:
+            break;
+    }
+}
+
+void SoundEffects::openVoices() {
+    pa_proplist* propList = pa_proplist_new();
+    pa_proplist_sets(propList, PA_PROP_MEDIA_ROLE, "event");
+
+    //Keep the queue short so a stolen voice switches sounds quickly, and don't prebuffer
+    //so that sounds shorter than the queue still start
+    pa_buffer_attr attr;
+    attr.maxlength = (uint32_t) -1;
+    attr.tlength = pa_usec_to_bytes(40 * PA_USEC_PER_MSEC, &spec);
+    attr.prebuf = 0;
+    attr.minreq = (uint32_t) -1;
+    attr.fragsize = (uint32_t) -1;
+
+    for (int i = 0; i < SOUND_EFFECT_VOICES; i++) {
+        pa_stream* stream = pa_stream_new_with_proplist(pulseContext, "Sound Effect", &spec, NULL, propList);
+        if (stream == NULL) continue;
+
+        Voice* voice = new Voice();
+        voice->owner = this;
+        voice->stream = stream;
+        voice->buffer = NULL;
+        voice->offset = 0;
+        voice->started = 0;
+        voice->playing = false;
+
+        pa_stream_set_write_callback(stream, &SoundEffects::pulseWrite, voice);
+        pa_stream_set_underflow_callback(stream, &SoundEffects::pulseUnderflow, voice);
+        if (pa_stream_connect_playback(stream, NULL, &attr, (pa_stream_flags_t) (PA_STREAM_START_CORKED | PA_STREAM_ADJUST_LATENCY), NULL, NULL) < 0) {
+            pa_stream_unref(stream);
+            delete voice;
+            continue;
+        }
+        voices.append(voice);
+    }
+
+    pa_proplist_free(propList);
+}
+
+int SoundEffects::play(Sound sound) {
+    if (!buffers.contains(sound)) return 0;
+
+    Voice* voice = NULL;
+    for (Voice* candidate : voices) {
+        if (pa_stream_get_state(candidate->stream) == PA_STREAM_READY && !candidate->playing) {
+            voice = candidate;
+            break;
+        }
+    }
+
+    if (voice == NULL) {
+        //Every voice is busy, so steal the one that started longest ago
+        for (Voice* candidate : voices) {
+            if (pa_stream_get_state(candidate->stream) != PA_STREAM_READY) continue;
+            if (voice == NULL || candidate->started < voice->started) voice = candidate;
+        }
+    }
+
+    if (voice == NULL) {
+        //PulseAudio isn't available yet
+        QSoundEffect* effect = new QSoundEffect();
+        effect->setSource(QUrl("qrc" + resources.value(sound)));
+        connect(effect, &QSoundEffect::playingChanged, effect, [=] {
+            if (!effect->isPlaying()) effect->deleteLater();
+        });
+        effect->play();
+        return duration(sound);
+    }
+
+    voice->buffer = &buffers[sound];
+    voice->offset = 0;
+    voice->started = ++playCount;
+    voice->playing = true;
+
+    //Throw away whatever the voice still had queued and start the new sound straight away
+    releaseOperation(pa_stream_flush(voice->stream, NULL, NULL));
+    size_t writable = pa_stream_writable_size(voice->stream);
+    if (writable != (size_t) -1) feed(voice, writable);
+    releaseOperation(pa_stream_cork(voice->stream, 0, NULL, NULL));
+
+    return duration(sound);
+}
+
+int SoundEffects::play(QUrl url) {
+    if (!isBundled(url)) return 0;
+    return play(resources.key(":" + url.path()));
+}
+
+bool SoundEffects::isBundled(QUrl url) {
+    return url.scheme() == "qrc" && buffers.contains(resources.key(":" + url.path(), (Sound) -1));
+}
+
+void SoundEffects::feed(Voice* voice, size_t length) {
+    if (!voice->playing || voice->buffer == NULL) return;
+
+    length = qMin(length, (size_t) (voice->buffer->length() - voice->offset));
+    if (length == 0) return;
+
+    //Pulse copies the samples, so every play shares the one decoded buffer
+    pa_stream_write(voice->stream, voice->buffer->constData() + voice->offset, length, NULL, 0, PA_SEEK_RELATIVE);
+    voice->offset += length;
+}
+
+void SoundEffects::pulseWrite(pa_stream *s, size_t length, void *userdata) {
+    Q_UNUSED(s)
+    Voice* voice = (Voice*) userdata;
+    voice->owner->feed(voice, length);
+}
+
+void SoundEffects::pulseUnderflow(pa_stream *s, void *userdata) {
+    Voice* voice = (Voice*) userdata;
+
+    //Running dry part way through just means we were late; only a finished sound frees the voice
+    if (voice->playing && voice->buffer != NULL && voice->offset >= voice->buffer->length()) {
+        voice->playing = false;
+        releaseOperation(pa_stream_cork(s, 1, NULL, NULL));
+    }
+}
+
+int SoundEffects::duration(Sound sound) {
+    return buffers.value(sound).length() * 1000LL / pa_bytes_per_second(&spec);
+}
+
+SoundEffects::Sound SoundEffects::notificationSound(QString name) {
+    if (name == "upsidedown") {
+        return UpsideDown;
+    } else if (name == "echo") {
+        return Echo;
+    } else {
+        return TriplePing;
+    }
+}
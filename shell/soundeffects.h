@@ -0,0 +1,92 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#ifndef SOUNDEFFECTS_H
+#define SOUNDEFFECTS_H
+
+#include <QObject>
+#include <QMap>
+#include <QList>
+#include <QUrl>
+#include <pulse/context.h>
+#include <pulse/glib-mainloop.h>
+#include <pulse/stream.h>
+
+class SoundEffects : public QObject
+{
+    Q_OBJECT
+public:
+    enum Sound {
+        VolumeFeedback,
+        Click,
+        KeyLocks,
+        Screenshot,
+        MediaInsert,
+        MediaRemove,
+        Charging,
+        PowerLow,
+        TriplePing,
+        UpsideDown,
+        Echo,
+        Reminder
+    };
+
+    static SoundEffects* instance();
+
+    static Sound notificationSound(QString name);
+    bool isBundled(QUrl url);
+    int duration(Sound sound);
+
+signals:
+
+public slots:
+    int play(Sound sound);
+    int play(QUrl url);
+
+private:
+    explicit SoundEffects(QObject *parent = 0);
+
+    struct Voice {
+        SoundEffects* owner;
+        pa_stream* stream;
+        const QByteArray* buffer;
+        int offset;
+        quint64 started;
+        bool playing;
+    };
+
+    static void pulseStateChanged(pa_context *c, void *userdata);
+    static void pulseWrite(pa_stream *s, size_t length, void *userdata);
+    static void pulseUnderflow(pa_stream *s, void *userdata);
+
+    void decode(Sound sound, QString resource);
+    void openVoices();
+    void feed(Voice* voice, size_t length);
+
+    pa_context* pulseContext = NULL;
+    pa_sample_spec spec;
+
+    QMap<Sound, QString> resources;
+    QMap<Sound, QByteArray> buffers;
+    QList<Voice*> voices;
+    quint64 playCount = 0;
+};
+
+#endif // SOUNDEFFECTS_H
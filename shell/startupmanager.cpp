@@ -0,0 +1,125 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#include "startupmanager.h"
+#include "startuptrace.h"
+
+#include <QTimer>
+#include <QDebug>
+
+StartupManager::StartupManager(QObject *parent) : QObject(parent)
+{
+
+}
+
+void StartupManager::addTask(QString name, QStringList dependencies, TaskFunction task) {
+    addAsyncTask(name, dependencies, [=](TaskFunction done) {
+        task();
+        done();
+    });
+}
+
+void StartupManager::addAsyncTask(QString name, QStringList dependencies, AsyncTaskFunction task) {
+    Task t;
+    t.name = name;
+    t.dependencies = dependencies;
+    t.function = task;
+    tasks.insert(name, t);
+    taskOrder.append(name);
+}
+
+void StartupManager::addDeferredTask(QString name, QStringList dependencies, TaskFunction task) {
+    //Deferred tasks wait until the bar has been painted so they don't delay it
+    if (firstPaintTask != "" && !dependencies.contains(firstPaintTask)) dependencies.append(firstPaintTask);
+    addTask(name, dependencies, task);
+}
+
+void StartupManager::setFirstPaintTask(QString name) {
+    firstPaintTask = name;
+}
+
+void StartupManager::setProfiling(bool profiling) {
+    this->profiling = profiling;
+}
+
+void StartupManager::start() {
+    timer.start();
+    running = true;
+    runReadyTasks();
+}
+
+void StartupManager::runReadyTasks() {
+    scheduled = false;
+
+    //Start every task whose dependencies have completed. Async tasks (D-Bus calls,
+    //processes) keep running in the background while the next ones start
+    bool startedTask = true;
+    while (startedTask) {
+        startedTask = false;
+        for (QString name : taskOrder) {
+            Task& task = tasks[name];
+            if (task.started) continue;
+
+            bool ready = true;
+            for (QString dependency : task.dependencies) {
+                if (!tasks.contains(dependency)) {
+                    qWarning() << "Startup task" << name << "depends on unknown task" << dependency;
+                } else if (!tasks.value(dependency).done) {
+                    ready = false;
+                }
+            }
+            if (!ready) continue;
+
+            task.started = true;
+            task.startTime = timer.elapsed();
+            task.traceStart = StartupTrace::now();
+            startedTask = true;
+            task.function([=] {
+                taskDone(name);
+            });
+        }
+    }
+}
+
+void StartupManager::taskDone(QString name) {
+    Task& task = tasks[name];
+    if (task.done) return;
+
+    task.done = true;
+    task.duration = timer.elapsed() - task.startTime;
+    StartupTrace::record(QString("Task: " + name).toUtf8().constData(), task.traceStart, StartupTrace::now());
+    emit taskFinished(name, task.duration);
+    if (profiling) qDebug() << "Startup:" << name << "finished in" << task.duration << "ms" << "(at" << timer.elapsed() << "ms)";
+
+    for (Task t : tasks) {
+        if (!t.done) {
+            //Start newly unblocked tasks from the event loop to avoid deep recursion
+            if (!scheduled) {
+                scheduled = true;
+                QTimer::singleShot(0, this, &StartupManager::runReadyTasks);
+            }
+            return;
+        }
+    }
+
+    running = false;
+    if (profiling) qDebug() << "Startup: all tasks finished in" << timer.elapsed() << "ms";
+    emit finished();
+}
@@ -0,0 +1,77 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#ifndef STARTUPMANAGER_H
+#define STARTUPMANAGER_H
+
+#include <QObject>
+#include <QMap>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <functional>
+
+class StartupManager : public QObject
+{
+        Q_OBJECT
+    public:
+        explicit StartupManager(QObject *parent = nullptr);
+
+        typedef std::function<void()> TaskFunction;
+        typedef std::function<void(TaskFunction done)> AsyncTaskFunction;
+
+        void addTask(QString name, QStringList dependencies, TaskFunction task);
+        void addAsyncTask(QString name, QStringList dependencies, AsyncTaskFunction task);
+        void addDeferredTask(QString name, QStringList dependencies, TaskFunction task);
+
+        void setFirstPaintTask(QString name);
+        void setProfiling(bool profiling);
+
+    signals:
+        void taskFinished(QString name, qint64 msecs);
+        void finished();
+
+    public slots:
+        void start();
+
+    private:
+        struct Task {
+            QString name;
+            QStringList dependencies;
+            AsyncTaskFunction function;
+            bool started = false;
+            bool done = false;
+            qint64 startTime = 0;
+            qint64 traceStart = 0;
+            qint64 duration = 0;
+        };
+
+        void runReadyTasks();
+        void taskDone(QString name);
+
+        QMap<QString, Task> tasks;
+        QStringList taskOrder;
+        QString firstPaintTask;
+        QElapsedTimer timer;
+        bool running = false;
+        bool scheduled = false;
+        bool profiling = false;
+};
+
+#endif // STARTUPMANAGER_H
@@ -0,0 +1,146 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#include "startuptrace.h"
+
+#include <QAtomicInteger>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QFile>
+#include <QTextStream>
+#include <time.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define TRACE_BUFFER_SIZE 4096
+#define TRACE_NAME_LENGTH 64
+
+namespace {
+    struct Event {
+        char name[TRACE_NAME_LENGTH];
+        qint64 start;
+        qint64 end;
+        qint64 thread;
+    };
+
+    Event events[TRACE_BUFFER_SIZE];
+    QAtomicInteger<quint32> nextEvent;
+    const qint64 processStart = StartupTrace::now();
+}
+
+qint64 StartupTrace::now() {
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000000LL + time.tv_nsec;
+}
+
+void StartupTrace::record(const char* name, qint64 start, qint64 end) {
+    Event& event = events[nextEvent.fetchAndAddRelaxed(1) % TRACE_BUFFER_SIZE];
+    strncpy(event.name, name, TRACE_NAME_LENGTH - 1);
+    event.name[TRACE_NAME_LENGTH - 1] = 0;
+    event.start = start;
+    event.end = end;
+    event.thread = syscall(SYS_gettid);
+}
+
+void StartupTrace::mark(const char* name) {
+    qint64 time = now();
+    record(name, time, time);
+}
+
+static QList<Event> recordedEvents() {
+    QList<Event> list;
+    quint32 count = nextEvent.load();
+    quint32 first = count > TRACE_BUFFER_SIZE ? count - TRACE_BUFFER_SIZE : 0;
+    for (quint32 i = first; i < count; i++) {
+        list.append(events[i % TRACE_BUFFER_SIZE]);
+    }
+    return list;
+}
+
+QByteArray StartupTrace::chromeTrace() {
+    //Chrome's trace event format; load it in chrome://tracing or Perfetto
+    QJsonArray traceEvents;
+    for (Event event : recordedEvents()) {
+        QJsonObject obj;
+        obj.insert("name", QString::fromUtf8(event.name));
+        obj.insert("pid", (qint64) getpid());
+        obj.insert("tid", event.thread);
+        obj.insert("ts", (event.start - processStart) / 1000.0);
+        if (event.start == event.end) {
+            obj.insert("ph", "i");
+            obj.insert("s", "p");
+        } else {
+            obj.insert("ph", "X");
+            obj.insert("dur", (event.end - event.start) / 1000.0);
+        }
+        traceEvents.append(obj);
+    }
+
+    QJsonObject root;
+    root.insert("traceEvents", traceEvents);
+    root.insert("displayTimeUnit", "ms");
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+QString StartupTrace::summary() {
+    struct Totals {
+        int count = 0;
+        qint64 total = 0;
+        qint64 max = 0;
+        qint64 firstEnd = -1;
+    };
+
+    QMap<QString, Totals> totals;
+    for (Event event : recordedEvents()) {
+        Totals& t = totals[QString::fromUtf8(event.name)];
+        qint64 duration = event.end - event.start;
+        t.count++;
+        t.total += duration;
+        t.max = qMax(t.max, duration);
+        if (t.firstEnd == -1) t.firstEnd = event.end - processStart;
+    }
+
+    QStringList names = totals.keys();
+    std::sort(names.begin(), names.end(), [&](const QString& first, const QString& second) {
+        return totals.value(first).total > totals.value(second).total;
+    });
+
+    QString output;
+    QTextStream stream(&output);
+    stream << QString("%1 %2 %3 %4 %5\n").arg("Span", -48).arg("Count", 6).arg("Total ms", 10).arg("Max ms", 10).arg("At ms", 10);
+    for (QString name : names) {
+        Totals t = totals.value(name);
+        stream << QString("%1 %2 %3 %4 %5\n").arg(name.left(48), -48).arg(t.count, 6)
+                  .arg(t.total / 1000000.0, 10, 'f', 2).arg(t.max / 1000000.0, 10, 'f', 2).arg(t.firstEnd / 1000000.0, 10, 'f', 2);
+    }
+    return output;
+}
+
+bool StartupTrace::dump(QString filename) {
+    QFile file(filename);
+    if (!file.open(QFile::WriteOnly)) return false;
+    file.write(chromeTrace());
+    file.close();
+    return true;
+}
@@ -0,0 +1,54 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <QString>
+#include <QByteArray>
+
+//Records timed spans into a fixed size ring buffer. Recording is cheap enough to
+//leave in all the time; the buffer is only written out when asked for.
+namespace StartupTrace {
+    qint64 now();
+    void record(const char* name, qint64 start, qint64 end);
+    void mark(const char* name);
+
+    QByteArray chromeTrace();
+    QString summary();
+    bool dump(QString filename);
+
+    class Span {
+        public:
+            explicit Span(const char* name) : name(name), start(now()) {}
+            ~Span() { record(name, start, now()); }
+
+        private:
+            const char* name;
+            qint64 start;
+    };
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SPAN(name) StartupTrace::Span TRACE_CONCAT(traceSpan, __LINE__)(name)
+#define TRACE_FUNCTION() TRACE_SPAN(Q_FUNC_INFO)
+
+#endif // STARTUPTRACE_H
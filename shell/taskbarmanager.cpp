@@ -19,6 +19,7 @@
  * *************************************/
 
 #include "taskbarmanager.h"
+#include "shellsettings.h"
 
 TaskbarManager::TaskbarManager(QObject *parent) : QObject(parent)
 {
@@ -224,7 +225,7 @@ bool TaskbarManager::updateInternalWindow(Window window) {
             //theShell window. Ignore.
             return false;
         } else {
-            if (settings.value("bar/showWindowsFromOtherDesktops", true).toBool() ||
+            if (ShellSettings::instance()->barShowWindowsFromOtherDesktops() ||
                              serialised.desktop() == currentDesktop) {
                 knownWindows.insert(window, serialised);
                 emit updateWindow(serialised);
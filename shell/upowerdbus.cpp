@@ -19,6 +19,8 @@
  * *************************************/
 
 #include "upowerdbus.h"
+#include "startuptrace.h"
+#include "devicemonitor.h"
 #include "power_adaptor.h"
 
 extern void EndSession(EndSessionWait::shutdownType type);
@@ -26,6 +28,7 @@ extern NotificationsDBusAdaptor* ndbus;
 
 UPowerDBus::UPowerDBus(QObject *parent) : QObject(parent)
 {
+    TRACE_SPAN("UPowerDBus");
     new PowerAdaptor(this);
     QDBusConnection::sessionBus().registerObject("/org/thesuite/Power", "org.thesuite.Power", this);
 
@@ -278,16 +281,10 @@ void UPowerDBus::DeviceChanged() {
             //Get the model of this media player
             QString model = i->property("Model").toString();
 
-            if (i->property("Serial").toString().length() == 40 && i->property("Vendor").toString().contains("Apple") && QFile("/usr/bin/idevice_id").exists()) { //This is probably an iOS device
-                //Get the name of the iOS device
-                QProcess iosName;
-                iosName.start("idevice_id " + i->property("Serial").toString());
-                iosName.waitForFinished();
-
-                QString name(iosName.readAll());
-                name = name.trimmed();
-
-                if (name != "" && !name.startsWith("ERROR:")) {
+            if (i->property("Vendor").toString().contains("Apple")) { //This is probably an iOS device
+                //The name was looked up once when the device was plugged in
+                QString name = DeviceMonitor::instance()->iosDeviceName(i->property("Serial").toString());
+                if (name != "") {
                     model = name;
                 }
             }
@@ -0,0 +1,330 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#include "wakeupsprofiler.h"
+
+#include <QtConcurrent>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusReply>
+#include <QDBusArgument>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QDir>
+#include <QIcon>
+#include <QSet>
+
+#define WAKEUPS_WINDOW 30000
+
+//DBus WakeupsInfo Structure
+struct WakeupsInfo {
+    bool process = false;
+    uint pid;
+    double wakeups;
+    QString path, description;
+};
+Q_DECLARE_METATYPE(WakeupsInfo)
+
+const QDBusArgument &operator<<(QDBusArgument &argument, const WakeupsInfo &info) {
+    argument.beginStructure();
+    argument << info.process << info.pid << info.wakeups << info.path << info.description;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, WakeupsInfo &info) {
+    argument.beginStructure();
+    argument >> info.process >> info.pid >> info.wakeups >> info.path >> info.description;
+    argument.endStructure();
+    return argument;
+}
+
+namespace {
+    void accumulate(QMap<QString, WakeupsSample> &samples, QString key, QString path, QString description, bool process, double rate) {
+        WakeupsSample& sample = samples[key];
+        if (sample.key.isEmpty()) {
+            sample.key = key;
+            sample.path = path;
+            sample.description = description;
+            sample.process = process;
+            sample.processes = 0;
+            sample.rate = 0;
+        }
+        if (process) sample.processes++;
+        sample.rate += rate;
+    }
+}
+
+WakeupsModel::WakeupsModel(QObject* parent) : QAbstractListModel(parent) {
+    pollTimer = new QTimer(this);
+    pollTimer->setInterval(2000);
+    connect(pollTimer, SIGNAL(timeout()), this, SLOT(poll()));
+
+    watcher = new QFutureWatcher<WakeupsSnapshot>(this);
+    connect(watcher, SIGNAL(finished()), this, SLOT(sampled()));
+}
+
+void WakeupsModel::start() {
+    if (pollTimer->isActive()) return;
+    pollTimer->start();
+    poll();
+}
+
+void WakeupsModel::stop() {
+    pollTimer->stop();
+}
+
+void WakeupsModel::poll() {
+    //Reading every process can take a while, so never queue up a second pass behind a slow one
+    if (watcher->isRunning()) return;
+    watcher->setFuture(QtConcurrent::run(&WakeupsModel::sample, counters, countersTime));
+}
+
+void WakeupsModel::sampled() {
+    apply(watcher->result());
+}
+
+WakeupsSnapshot WakeupsModel::sample(QMap<QString, quint64> previousCounters, qint64 previousTime) {
+    WakeupsSnapshot snapshot;
+    snapshot.time = QDateTime::currentMSecsSinceEpoch();
+    if (!sampleUPower(snapshot)) {
+        sampleProc(snapshot, previousCounters, previousTime);
+    }
+    return snapshot;
+}
+
+bool WakeupsModel::sampleUPower(WakeupsSnapshot &snapshot) {
+    QDBusMessage dataMessage = QDBusMessage::createMethodCall("org.freedesktop.UPower", "/org/freedesktop/UPower/Wakeups", "org.freedesktop.UPower.Wakeups", "GetData");
+    QDBusReply<QDBusArgument> dataMessageArgument = QDBusConnection::systemBus().call(dataMessage);
+    if (!dataMessageArgument.isValid()) return false;
+
+    //UPower already reports a rate for each process, so add up every process running the same executable
+    QMap<QString, WakeupsSample> samples;
+    QDBusArgument arrayArgument = dataMessageArgument.value();
+    arrayArgument.beginArray();
+    while (!arrayArgument.atEnd()) {
+        WakeupsInfo info;
+        arrayArgument >> info;
+
+        if (info.process) {
+            accumulate(samples, info.path, info.path, info.description, true, info.wakeups);
+        } else {
+            accumulate(samples, "irq:" + info.description, info.path, info.description, false, info.wakeups);
+        }
+    }
+    arrayArgument.endArray();
+
+    snapshot.samples = samples.values();
+    return true;
+}
+
+void WakeupsModel::sampleProc(WakeupsSnapshot &snapshot, QMap<QString, quint64> previousCounters, qint64 previousTime) {
+    QMap<QString, WakeupsSample> samples;
+    double seconds = (snapshot.time - previousTime) / 1000.0;
+
+    //Without UPower, count context switches per process and interrupts per line, and rate them against the last pass
+    for (QString pid : QDir("/proc").entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        bool isPid;
+        pid.toUInt(&isPid);
+        if (!isPid) continue;
+
+        QFile status("/proc/" + pid + "/status");
+        if (!status.open(QFile::ReadOnly)) continue;
+
+        quint64 switches = 0;
+        for (QByteArray line : status.readAll().split('\n')) {
+            if (line.startsWith("voluntary_ctxt_switches:") || line.startsWith("nonvoluntary_ctxt_switches:")) {
+                switches += line.mid(line.indexOf(':') + 1).trimmed().toULongLong();
+            }
+        }
+
+        QString path = QFileInfo("/proc/" + pid + "/exe").symLinkTarget();
+        if (path.isEmpty()) {
+            //Kernel threads and other users' processes have no readable executable; fall back to the name in stat
+            QFile stat("/proc/" + pid + "/stat");
+            if (stat.open(QFile::ReadOnly)) {
+                QByteArray statLine = stat.readAll();
+                int start = statLine.indexOf('(');
+                int end = statLine.lastIndexOf(')');
+                if (start != -1 && end > start) path = "[" + QString::fromLocal8Bit(statLine.mid(start + 1, end - start - 1)) + "]";
+            }
+        }
+        if (path.isEmpty()) continue;
+
+        QString counter = "pid:" + pid;
+        snapshot.counters.insert(counter, switches);
+        if (previousCounters.contains(counter) && seconds > 0 && switches >= previousCounters.value(counter)) {
+            accumulate(samples, path, path, "", true, (switches - previousCounters.value(counter)) / seconds);
+        }
+    }
+
+    QFile interrupts("/proc/interrupts");
+    if (interrupts.open(QFile::ReadOnly)) {
+        QList<QByteArray> lines = interrupts.readAll().split('\n');
+        int cpus = lines.isEmpty() ? 0 : lines.first().simplified().split(' ').count();
+        for (int i = 1; i < lines.count(); i++) {
+            QList<QByteArray> parts = lines.at(i).simplified().split(' ');
+            if (parts.count() < 2 || !parts.first().endsWith(':')) continue;
+
+            QString irq = parts.first().left(parts.first().length() - 1);
+            quint64 count = 0;
+            int column = 1;
+            for (; column <= cpus && column < parts.count(); column++) {
+                count += parts.at(column).toULongLong();
+            }
+
+            QStringList descriptionParts;
+            for (; column < parts.count(); column++) {
+                descriptionParts.append(parts.at(column));
+            }
+            QString description = descriptionParts.isEmpty() ? irq : descriptionParts.last();
+
+            QString counter = "irq:" + irq;
+            snapshot.counters.insert(counter, count);
+            if (previousCounters.contains(counter) && seconds > 0 && count >= previousCounters.value(counter)) {
+                accumulate(samples, counter, "", description, false, (count - previousCounters.value(counter)) / seconds);
+            }
+        }
+    }
+
+    snapshot.samples = samples.values();
+}
+
+void WakeupsModel::apply(WakeupsSnapshot snapshot) {
+    counters = snapshot.counters;
+    countersTime = snapshot.time;
+
+    //Smooth each entry over a sliding window; anything that stopped reporting decays towards zero
+    for (WakeupsSample sample : snapshot.samples) {
+        window[sample.key].append(qMakePair(snapshot.time, sample.rate));
+        latest.insert(sample.key, sample);
+    }
+
+    QList<WakeupsSample> target;
+    for (QString key : window.keys()) {
+        QList<QPair<qint64, double>>& points = window[key];
+        if (points.last().first != snapshot.time) points.append(qMakePair(snapshot.time, 0.0));
+        while (points.first().first < snapshot.time - WAKEUPS_WINDOW) points.removeFirst();
+
+        double total = 0;
+        for (QPair<qint64, double> point : points) {
+            total += point.second;
+        }
+
+        if (total <= 0) {
+            window.remove(key);
+            latest.remove(key);
+        } else {
+            WakeupsSample entry = latest.value(key);
+            entry.rate = total / points.count();
+            target.append(entry);
+        }
+    }
+
+    std::sort(target.begin(), target.end(), [](const WakeupsSample& first, const WakeupsSample& second) {
+        return first.rate > second.rate;
+    });
+
+    //Move rows into place one at a time so the view keeps its selection and scroll position
+    QSet<QString> targetKeys;
+    for (WakeupsSample entry : target) {
+        targetKeys.insert(entry.key);
+    }
+    for (int i = rows.count() - 1; i >= 0; i--) {
+        if (!targetKeys.contains(rows.at(i).key)) {
+            beginRemoveRows(QModelIndex(), i, i);
+            rows.removeAt(i);
+            endRemoveRows();
+        }
+    }
+
+    for (int i = 0; i < target.count(); i++) {
+        int current = -1;
+        for (int j = i; j < rows.count(); j++) {
+            if (rows.at(j).key == target.at(i).key) {
+                current = j;
+                break;
+            }
+        }
+
+        if (current == -1) {
+            beginInsertRows(QModelIndex(), i, i);
+            rows.insert(i, target.at(i));
+            endInsertRows();
+        } else {
+            if (current != i) {
+                beginMoveRows(QModelIndex(), current, current, QModelIndex(), i);
+                rows.move(current, i);
+                endMoveRows();
+            }
+            rows[i] = target.at(i);
+            emit dataChanged(index(i), index(i));
+        }
+    }
+}
+
+int WakeupsModel::rowCount(const QModelIndex &parent) const {
+    if (parent.isValid()) return 0;
+    return rows.count();
+}
+
+QVariant WakeupsModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= rows.count()) return QVariant();
+
+    WakeupsSample entry = rows.at(index.row());
+    QString name = entry.process ? QFileInfo(entry.path).fileName() : entry.description;
+    switch (role) {
+        case Qt::DisplayRole:
+            return tr("%1 · %2 wakeups/s").arg(name, QString::number(entry.rate, 'f', 1));
+        case Qt::ToolTipRole:
+            if (entry.process) {
+                return tr("%1 (%n processes)", nullptr, entry.processes).arg(entry.path);
+            } else {
+                return tr("Interrupt: %1").arg(entry.description);
+            }
+        case Qt::DecorationRole:
+            if (entry.process) {
+                return QIcon::fromTheme(name, QIcon::fromTheme("application-x-executable"));
+            } else {
+                return QIcon::fromTheme("cpu");
+            }
+    }
+    return QVariant();
+}
+
+WakeupsView::WakeupsView(QWidget* parent) : QListView(parent) {
+    profiler = new WakeupsModel(this);
+    this->setModel(profiler);
+}
+
+void WakeupsView::refresh() {
+    profiler->poll();
+}
+
+void WakeupsView::showEvent(QShowEvent* event) {
+    profiler->start();
+    QListView::showEvent(event);
+}
+
+void WakeupsView::hideEvent(QHideEvent* event) {
+    //Walking /proc isn't free, so only profile while someone is looking
+    profiler->stop();
+    QListView::hideEvent(event);
+}
@@ -0,0 +1,95 @@
+/****************************************
+ *
+ *   theShell - Desktop Environment
+ *   Copyright (C) 2018 Victor Tran
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * *************************************/
+
+#ifndef WAKEUPSPROFILER_H
+#define WAKEUPSPROFILER_H
+
+#include <QAbstractListModel>
+#include <QListView>
+#include <QTimer>
+#include <QMap>
+#include <QFutureWatcher>
+
+struct WakeupsSample {
+    QString key, path, description;
+    bool process;
+    int processes;
+    double rate;
+};
+
+struct WakeupsSnapshot {
+    qint64 time;
+    QList<WakeupsSample> samples;
+    QMap<QString, quint64> counters;
+};
+
+class WakeupsModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit WakeupsModel(QObject* parent = 0);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+public slots:
+    void start();
+    void stop();
+    void poll();
+
+private slots:
+    void sampled();
+
+private:
+    static WakeupsSnapshot sample(QMap<QString, quint64> previousCounters, qint64 previousTime);
+    static bool sampleUPower(WakeupsSnapshot &snapshot);
+    static void sampleProc(WakeupsSnapshot &snapshot, QMap<QString, quint64> previousCounters, qint64 previousTime);
+
+    void apply(WakeupsSnapshot snapshot);
+
+    QList<WakeupsSample> rows;
+    QMap<QString, QList<QPair<qint64, double>>> window;
+    QMap<QString, WakeupsSample> latest;
+    QMap<QString, quint64> counters;
+    qint64 countersTime = 0;
+
+    QTimer* pollTimer;
+    QFutureWatcher<WakeupsSnapshot>* watcher;
+};
+
+class WakeupsView : public QListView
+{
+    Q_OBJECT
+
+public:
+    explicit WakeupsView(QWidget* parent = 0);
+
+public slots:
+    void refresh();
+
+private:
+    void showEvent(QShowEvent* event);
+    void hideEvent(QHideEvent* event);
+
+    WakeupsModel* profiler;
+};
+
+#endif // WAKEUPSPROFILER_H
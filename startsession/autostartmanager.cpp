@@ -0,0 +1,199 @@
+#include "autostartmanager.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QProcess>
+#include <QMutex>
+#include <QDebug>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
+//Spawn a few entries per tick so autostart applications don't all hit the disk at once
+#define SPAWNS_PER_TICK 2
+#define SPAWN_INTERVAL 150
+
+AutostartManager::AutostartManager(QObject *parent) : QObject(parent)
+{
+    spawnTimer = new QTimer(this);
+    spawnTimer->setInterval(SPAWN_INTERVAL);
+    connect(spawnTimer, SIGNAL(timeout()), this, SLOT(spawnNext()));
+}
+
+void AutostartManager::start() {
+    //Entries in the user's autostart directory override system ones with the same name
+    QStringList knownFileNames;
+    QStringList paths;
+    QDir autostartDir(QDir::homePath() + "/.config/autostart");
+    for (QString fileName : autostartDir.entryList(QDir::NoDotAndDotDot | QDir::Files)) {
+        paths.append(autostartDir.absoluteFilePath(fileName));
+        knownFileNames.append(fileName);
+    }
+
+    autostartDir.cd("/etc/xdg/autostart");
+    for (QString fileName : autostartDir.entryList(QDir::NoDotAndDotDot | QDir::Files)) {
+        if (!knownFileNames.contains(fileName)) {
+            paths.append(autostartDir.absoluteFilePath(fileName));
+        }
+    }
+
+    QFutureWatcher<Entry>* watcher = new QFutureWatcher<Entry>(this);
+    connect(watcher, &QFutureWatcher<Entry>::finished, [=] {
+        for (Entry entry : watcher->future().results()) {
+            if (entry.valid) entries.append(entry);
+        }
+        watcher->deleteLater();
+        parsed = true;
+
+        //Phases up to and including the panel are needed to bring the session up;
+        //everything else waits for theShell so it doesn't compete with it
+        releasePhases(ready ? Applications : Panel);
+    });
+    watcher->setFuture(QtConcurrent::mapped(paths, &AutostartManager::parse));
+}
+
+void AutostartManager::shellReady() {
+    ready = true;
+    if (parsed) releasePhases(Applications);
+}
+
+void AutostartManager::releasePhases(Phase upTo) {
+    //Entries are removed once released so later releases don't start things twice
+    QList<Entry> remaining;
+    for (Entry entry : entries) {
+        if (entry.phase > upTo) {
+            remaining.append(entry);
+        } else if (entry.delay > 0) {
+            QTimer::singleShot(entry.delay * 1000, this, [=] {
+                queueSpawn(entry);
+            });
+        } else {
+            queueSpawn(entry);
+        }
+    }
+    entries = remaining;
+}
+
+void AutostartManager::queueSpawn(Entry entry) {
+    spawnQueue.enqueue(entry);
+    if (!spawnTimer->isActive()) {
+        spawnNext();
+        spawnTimer->start();
+    }
+}
+
+void AutostartManager::spawnNext() {
+    for (int i = 0; i < SPAWNS_PER_TICK && !spawnQueue.isEmpty(); i++) {
+        Entry entry = spawnQueue.dequeue();
+        qDebug() << "Starting " + entry.exec;
+        QProcess::startDetached(entry.exec);
+    }
+
+    if (spawnQueue.isEmpty()) spawnTimer->stop();
+}
+
+AutostartManager::Entry AutostartManager::parse(QString path) {
+    Entry entry;
+    entry.fileName = path;
+
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly)) return entry;
+
+    QHash<QString, QString> values;
+    QString group;
+    while (!file.atEnd()) {
+        QString line = file.readLine().trimmed();
+        if (line == "" || line.startsWith("#")) {
+
+        } else if (line.startsWith("[") && line.endsWith("]")) {
+            group = line.mid(1, line.length() - 2);
+        } else if (group == "Desktop Entry" && line.contains("=")) {
+            QString key = line.left(line.indexOf("=")).trimmed();
+            QString value = line.mid(line.indexOf("=") + 1).trimmed();
+            values.insert(key.toLower(), value);
+        }
+    }
+    file.close();
+
+    if (values.contains("onlyshowin")) {
+        QStringList desktops = values.value("onlyshowin").split(";");
+        if (!desktops.contains("theshell")) {
+            return entry;
+        }
+    }
+
+    if (values.contains("notshowin")) {
+        QStringList desktops = values.value("notshowin").split(";");
+        if (desktops.contains("theshell")) {
+            return entry;
+        }
+    }
+
+    if (values.value("hidden") == "true") {
+        return entry;
+    }
+
+    if (values.contains("tryexec") && !tryExecExists(values.value("tryexec"))) {
+        return entry;
+    }
+
+    entry.exec = stripFieldCodes(values.value("exec"));
+    if (entry.exec == "") return entry;
+
+    QString phase = values.value("x-gnome-autostart-phase");
+    if (phase == "EarlyInitialization") {
+        entry.phase = EarlyInitialization;
+    } else if (phase == "PreDisplayServer") {
+        entry.phase = PreDisplayServer;
+    } else if (phase == "Initialization") {
+        entry.phase = Initialization;
+    } else if (phase == "WindowManager") {
+        entry.phase = WindowManager;
+    } else if (phase == "Panel") {
+        entry.phase = Panel;
+    } else if (phase == "Desktop") {
+        entry.phase = Desktop;
+    } else {
+        entry.phase = Applications;
+    }
+
+    entry.delay = qMax(0, values.value("x-gnome-autostart-delay").toInt());
+    entry.valid = true;
+    return entry;
+}
+
+bool AutostartManager::tryExecExists(QString tryExec) {
+    //Many entries share the same TryExec, and parsing happens on several threads
+    static QMutex cacheMutex;
+    static QHash<QString, bool> cache;
+
+    QMutexLocker locker(&cacheMutex);
+    if (cache.contains(tryExec)) return cache.value(tryExec);
+    locker.unlock();
+
+    bool exists;
+    if (tryExec.startsWith("/")) {
+        exists = QFileInfo(tryExec).isExecutable();
+    } else {
+        exists = !QStandardPaths::findExecutable(tryExec).isEmpty();
+    }
+
+    locker.relock();
+    cache.insert(tryExec, exists);
+    return exists;
+}
+
+QString AutostartManager::stripFieldCodes(QString exec) {
+    //Autostart entries are never given files or URLs, so drop the field codes
+    QStringList parts = exec.split(" ", QString::SkipEmptyParts);
+    QStringList arguments;
+    for (QString part : parts) {
+        if (part.length() == 2 && part.startsWith("%")) {
+            if (part == "%%") arguments.append("%");
+        } else {
+            arguments.append(part);
+        }
+    }
+    return arguments.join(" ");
+}
@@ -0,0 +1,56 @@
+#ifndef AUTOSTARTMANAGER_H
+#define AUTOSTARTMANAGER_H
+
+#include <QObject>
+#include <QStringList>
+#include <QQueue>
+#include <QHash>
+#include <QTimer>
+
+class AutostartManager : public QObject
+{
+        Q_OBJECT
+    public:
+        explicit AutostartManager(QObject *parent = nullptr);
+
+        enum Phase {
+            EarlyInitialization,
+            PreDisplayServer,
+            Initialization,
+            WindowManager,
+            Panel,
+            Desktop,
+            Applications
+        };
+
+        struct Entry {
+            QString fileName;
+            QString exec;
+            Phase phase = Applications;
+            int delay = 0;
+            bool valid = false;
+        };
+
+    public slots:
+        void start();
+        void shellReady();
+
+    private slots:
+        void spawnNext();
+
+    private:
+        static Entry parse(QString path);
+        static bool tryExecExists(QString tryExec);
+        static QString stripFieldCodes(QString exec);
+
+        void releasePhases(Phase upTo);
+        void queueSpawn(Entry entry);
+
+        QList<Entry> entries;
+        QQueue<Entry> spawnQueue;
+        QTimer* spawnTimer;
+        bool parsed = false;
+        bool ready = false;
+};
+
+#endif // AUTOSTARTMANAGER_H
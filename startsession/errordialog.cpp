@@ -9,15 +9,24 @@ ErrorDialog::ErrorDialog(bool started, int errorCount, QWidget *parent) :
 
     this->setWindowFlags(Qt::Dialog | Qt::WindowStaysOnTopHint);
 
-    QFile backtrace(QDir::homePath() + "/.tsbacktrace");
-    if (backtrace.exists()) {
-        backtrace.open(QFile::ReadOnly);
-        this->backtrace = backtrace.readAll();
-        backtrace.close();
-        backtrace.remove();
-
-        ui->backtrace->setPlainText(this->backtrace);
+    QString reportPath = QDir::homePath() + "/.tscrashreport";
+    CrashCapture::Report report = CrashCapture::load(reportPath);
+    if (report.valid) {
+        QFile::remove(reportPath);
+
+        //Symbolizing runs addr2line, so keep it off the GUI thread
+        ui->backtrace->setPlainText(tr("Reading backtrace..."));
         ui->backtrace->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+        ui->saveBacktraceButton->setEnabled(false);
+
+        QFutureWatcher<QString>* watcher = new QFutureWatcher<QString>(this);
+        connect(watcher, &QFutureWatcher<QString>::finished, [=] {
+            this->backtrace = watcher->result();
+            ui->backtrace->setPlainText(this->backtrace);
+            ui->saveBacktraceButton->setEnabled(true);
+            watcher->deleteLater();
+        });
+        watcher->setFuture(QtConcurrent::run(CrashCapture::symbolize, report));
     } else {
         ui->debugButton->setVisible(false);
     }
@@ -13,6 +13,9 @@
 #include <QFontDatabase>
 #include <QMessageBox>
 #include <QSettings>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include "../shell/crashcapture.h"
 
 namespace Ui {
     class ErrorDialog;
@@ -26,45 +26,29 @@
 #include <QSettings>
 #include <QDebug>
 #include <QDBusConnection>
+#include <QTimer>
+#include <QElapsedTimer>
 #include "errordialog.h"
 #include "startmonitor.h"
+#include "autostartmanager.h"
+#include "../shell/startuptrace.h"
 
-void startupDesktopFile(QString path, QSettings::Format format) {
-    QSettings desktopFile(path, format);
-    desktopFile.beginGroup("Desktop Entry");
-
-    if (desktopFile.contains("OnlyShowIn")) {
-        QStringList desktops = desktopFile.value("OnlyShowIn").toString().split(";");
-        if (!desktops.contains("theshell")) {
-            return;
-        }
-    }
-
-    if (desktopFile.contains("NotShowIn")) {
-        QStringList desktops = desktopFile.value("NotShowIn").toString().split(";");
-        if (desktops.contains("theshell")) {
-            return;
-        }
-    }
-
-    if (desktopFile.contains("TryExec")) {
-        if (!QFile(desktopFile.value("TryExec").toString()).exists() && !QFile("/usr/bin/" + desktopFile.value("TryExec").toString()).exists()) {
-            return;
-        }
-    }
-
-    if (desktopFile.value("Hidden", false).toBool()) {
-        return;
-    }
-
-    //Execute the Exec parameter
-    qDebug() << "Starting " + desktopFile.value("Exec").toString();
-    QProcess::startDetached(desktopFile.value("Exec").toString());
-}
+#define CRASH_REPORTS_KEPT 5
 
 QProcess* tsProcess;
 int errorCount = 0;
+int consecutiveCrashes = 0;
 bool started = false;
+QElapsedTimer shellUptime;
+
+void startShell(QString arguments) {
+    shellUptime.start();
+    #ifdef BLUEPRINT
+        tsProcess->start("theshellb " + arguments);
+    #else
+        tsProcess->start("theshell " + arguments);
+    #endif
+}
 
 int main(int argc, char *argv[])
 {
@@ -83,42 +67,80 @@ int main(int argc, char *argv[])
     QSettings tsSettings("theSuite", "theShell");
 
     //Set DPI
-    QProcess::execute("xrandr --dpi " + QString::number(tsSettings.value("screen/dpi", 96).toInt()));
+    {
+        TRACE_SPAN("xrandr --dpi");
+        QProcess::execute("xrandr --dpi " + QString::number(tsSettings.value("screen/dpi", 96).toInt()));
+    }
 
     StartMonitor* monitor = new StartMonitor;
 
+    //Pass profiling through to theShell so both sides of the login are traced
+    QString shellArguments = "--session-starter-running";
+    if (a.arguments().contains("--profile-startup")) {
+        monitor->setProfiling(true);
+        shellArguments += " --profile-startup";
+    }
+
     QDBusConnection::sessionBus().connect("org.thesuite.theshell", "/org/thesuite/theshell", "org.thesuite.theshell", "Ready", monitor, SLOT(MarkStarted()));
     QDBusConnection::sessionBus().connect("org.thesuite.theshell", "/org/thesuite/theshell", "org.thesuite.theshell", "ShowSplash", monitor, SLOT(ShowSplash()));
     QDBusConnection::sessionBus().connect("org.thesuite.theshell", "/org/thesuite/theshell", "org.thesuite.theshell", "HideSplash", monitor, SLOT(HideSplash()));
 
     monitor->ShowSplash();
     tsProcess = new QProcess();
-    #ifdef BLUEPRINT
-        tsProcess->start("theshellb --session-starter-running");
-    #else
-        tsProcess->start("theshell --session-starter-running");
-    #endif
+    startShell(shellArguments);
 
     QObject::connect(tsProcess, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
-        [=](int exitCode, QProcess::ExitStatus exitStatus){
-        if (exitCode == 0) {
+        [=, &settings](int exitCode, QProcess::ExitStatus exitStatus){
+        if (exitStatus == QProcess::NormalExit && exitCode == 0) {
             QCoreApplication::exit(0);
         } else {
             //Restart theShell
+            errorCount++;
+
+            //A shell that stayed up for a while isn't part of a crash loop
+            if (shellUptime.elapsed() > 60000) {
+                consecutiveCrashes = 0;
+            }
+            consecutiveCrashes++;
+
+            if (monitor->started() && consecutiveCrashes <= 5 && settings.value("supervisor/autoRestart", true).toBool()) {
+                //Bring theShell straight back with its previous state, backing off if it keeps crashing
+                int delay = consecutiveCrashes == 1 ? 0 : qMin(250 << (consecutiveCrashes - 2), 4000);
+                qDebug() << "theShell crashed; restarting in" << delay << "ms";
+
+                //No error dialog shows this crash's report, so set it aside for the restarted theShell to point out.
+                //A later error dialog then only shows a crash nobody has been told about
+                QString reportPath = QDir::homePath() + "/.tscrashreport";
+                CrashCapture::Report report = CrashCapture::load(reportPath);
+                if (report.valid) {
+                    qWarning() << "theShell was killed by signal" << report.signal << "- crash report kept in" << reportPath + ".1";
+
+                    QFile::remove(reportPath + "." + QString::number(CRASH_REPORTS_KEPT));
+                    for (int i = CRASH_REPORTS_KEPT - 1; i > 0; i--) {
+                        QFile::rename(reportPath + "." + QString::number(i), reportPath + "." + QString::number(i + 1));
+                    }
+                    QFile::rename(reportPath, reportPath + ".1");
+                } else {
+                    QFile::remove(reportPath);
+                }
+
+                QTimer::singleShot(delay, [=] {
+                    monitor->MarkNotStarted();
+                    startShell(shellArguments + " --restore-session");
+                });
+                return;
+            }
 
             monitor->HideSplash();
-            errorCount++;
             ErrorDialog* d = new ErrorDialog(monitor->started(), errorCount);
             ErrorDialog::connect(d, &ErrorDialog::restart, [=] {
                 d->deleteLater();
                 monitor->MarkNotStarted();
                 monitor->ShowSplash();
+                consecutiveCrashes = 0;
 
-                #ifdef BLUEPRINT
-                    tsProcess->start("theshellb --session-starter-running");
-                #else
-                    tsProcess->start("theshell --session-starter-running");
-                #endif
+                //Start cold in case the saved state is what keeps bringing theShell down
+                startShell(shellArguments);
             });
             ErrorDialog::connect(d, &ErrorDialog::logout, [=] {
                 d->deleteLater();
@@ -150,25 +172,6 @@ int main(int argc, char *argv[])
     });
 
     if (!a.arguments().contains("--no-autostart")) {
-        QSettings::Format desktopFileFormat = QSettings::registerFormat("desktop", [](QIODevice &device, QSettings::SettingsMap &map) -> bool {
-            QString group;
-            while (!device.atEnd()) {
-                QString line = device.readLine().trimmed();
-                if (line == "") {
-
-                } else if (line.startsWith("[") && line.endsWith("]")) {
-                    group = line.mid(1, line.length() - 2);
-                } else {
-                    QString key = line.left(line.indexOf("="));
-                    QString value = line.mid(line.indexOf("=") + 1);
-                    map.insert(group + "/" + key, value);
-                }
-            }
-            return true;
-        }, [](QIODevice &device, const QSettings::SettingsMap &map) -> bool {
-            return false;
-        }, Qt::CaseInsensitive);
-
         //Start system daemons
         QProcess* polkitProcess = new QProcess();
 
@@ -178,20 +181,10 @@ int main(int argc, char *argv[])
         polkitProcess->start("/usr/lib/ts-polkitagent");
 #endif
 
-        //Start startup applications
-        QStringList knownFileNames;
-        QDir autostartDir(QDir::homePath() + "/.config/autostart");
-        for (QString fileName : autostartDir.entryList(QDir::NoDotAndDotDot | QDir::Files)) {
-            startupDesktopFile(QDir::homePath() + "/.config/autostart/" + fileName, desktopFileFormat);
-            knownFileNames.append(fileName);
-        }
-
-        autostartDir.cd("/etc/xdg/autostart");
-        for (QString fileName : autostartDir.entryList(QDir::NoDotAndDotDot | QDir::Files)) {
-            if (!knownFileNames.contains(fileName)) {
-                startupDesktopFile("/etc/xdg/autostart/" + fileName, desktopFileFormat);
-            }
-        }
+        //Start startup applications; anything not needed to bring up the session waits for theShell
+        AutostartManager* autostart = new AutostartManager();
+        QDBusConnection::sessionBus().connect("org.thesuite.theshell", "/org/thesuite/theshell", "org.thesuite.theshell", "Ready", autostart, SLOT(shellReady()));
+        autostart->start();
     }
 
     return a.exec();
@@ -1,7 +1,11 @@
 #include "startmonitor.h"
+#include "../shell/startuptrace.h"
+#include <QDir>
+#include <iostream>
 
 StartMonitor::StartMonitor(QObject *parent) : QObject(parent)
 {
+    startTime = StartupTrace::now();
     splash = new LoginSplash();
     splash->setWindowFlags(Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint | Qt::SubWindow);
 
@@ -12,13 +16,26 @@ bool StartMonitor::started() {
     return s;
 }
 
+void StartMonitor::setProfiling(bool profiling) {
+    this->profiling = profiling;
+}
+
 void StartMonitor::MarkStarted() {
     s = true;
     splash->hide();
+
+    StartupTrace::record("Splash to theShell Ready", startTime, StartupTrace::now());
+    if (profiling) {
+        QString traceFile = QDir::homePath() + "/.ts-startsession-startup.json";
+        StartupTrace::dump(traceFile);
+        std::cerr << "Session trace written to " << traceFile.toStdString() << "\n";
+        std::cerr << StartupTrace::summary().toStdString();
+    }
 }
 
 void StartMonitor::MarkNotStarted() {
     s = false;
+    startTime = StartupTrace::now();
 }
 
 void StartMonitor::ShowSplash() {
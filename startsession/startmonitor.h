@@ -12,6 +12,7 @@ class StartMonitor : public QObject
         explicit StartMonitor(QObject *parent = nullptr);
 
         bool started();
+        void setProfiling(bool profiling);
     signals:
         void questionResponse(QString response);
 
@@ -26,6 +27,8 @@ class StartMonitor : public QObject
 
     private:
         bool s = false;
+        bool profiling = false;
+        qint64 startTime;
         LoginSplash* splash;
 };
 
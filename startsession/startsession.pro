@@ -1,4 +1,4 @@
-QT += core gui dbus thelib
+QT += core gui dbus concurrent thelib
 CONFIG += c++11
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
@@ -10,6 +10,9 @@ blueprint {
 } else {
     TARGET = ts-startsession
 }
+CONFIG += link_pkgconfig
+PKGCONFIG += libunwind
+
 # CONFIG += console
 # CONFIG -= app_bundle
 
@@ -18,7 +21,10 @@ TEMPLATE = app
 SOURCES += main.cpp \
     errordialog.cpp \
     startmonitor.cpp \
-    loginsplash.cpp
+    autostartmanager.cpp \
+    loginsplash.cpp \
+    ../shell/startuptrace.cpp \
+    ../shell/crashcapture.cpp
 
 # The following define makes your compiler emit warnings if you use
 # any feature of Qt which as been marked deprecated (the exact warnings
@@ -44,7 +50,10 @@ FORMS += \
 HEADERS += \
     errordialog.h \
     startmonitor.h \
-    loginsplash.h
+    autostartmanager.h \
+    loginsplash.h \
+    ../shell/startuptrace.h \
+    ../shell/crashcapture.h
 
 RESOURCES += \
     resources.qrc